@@ -0,0 +1,561 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file aggregator.c
+ *
+ * Summarizes raw sensor samples over tumbling windows, so that they can be sampled quickly on
+ * the device but uploaded cheaply.
+ *
+ * For each aggregated sensor, we register for the samples arriving at the sensor's Data Hub
+ * Input and fold each one into a set of running statistics (count, min, max, mean, standard
+ * deviation and RMS).  Only a handful of numbers are kept per axis, no matter how many samples
+ * fall into a window.  When a window closes, its summary is published as a JSON value to one of
+ * our own Data Hub Inputs (see SUMMARY_PATH), from which avPublisher pushes it to AirVantage.
+ *
+ * Windows are aligned to multiples of their length (e.g., a 60 second window starts on the
+ * minute).  A window is closed when the first sample of the next window arrives, or shortly after
+ * the window's end time if the sensor goes quiet.  Samples that arrive late, for a window that
+ * has already been closed, are dropped.
+ *
+ * Scalar summaries look like this:
+ *
+ * { "count": 60, "min": 20.1, "max": 22.5, "mean": 21.2, "stdDev": 0.4, "rms": 21.2 }
+ *
+ * Vector (accelerometer and gyro) summaries carry the same statistics for each axis, with member
+ * names prefixed by the axis, e.g., "x.min", "y.mean", "z.rms".
+ *
+ * The window lengths default to the _WINDOW constants below, and can be changed in the app's
+ * config tree:
+ *
+ * @verbatim
+    aggregator/
+        <name>/                 "accel", "gyro", "light", "pressure" or "temperature"
+            window          float   window length (seconds, more than 0)
+   @endverbatim
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "packedVector.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Aggregation configuration defaults.
+ */
+//--------------------------------------------------------------------------------------------------
+
+// Window lengths (seconds), unless set in the config tree:
+
+#define ACCEL_WINDOW 60
+#define GYRO_WINDOW 60
+#define LIGHT_WINDOW 60
+#define PRESSURE_WINDOW 60
+#define TEMP_WINDOW 60
+
+/// Path of the aggregation settings in the config tree.
+#define AGGREGATOR_CONFIG_PATH "aggregator"
+
+/// How long to wait after a window's end time for stragglers before closing it (milliseconds).
+#define WINDOW_CLOSE_GRACE_MS 1000
+
+// Data Hub sensor Input resource paths:
+
+#define ACCEL_SENSOR_INPUT_PATH     "/app/redSensor/accel/packed"
+#define GYRO_SENSOR_INPUT_PATH      "/app/redSensor/gyro/packed"
+#define LIGHT_SENSOR_INPUT_PATH     "/app/redSensor/light/value"
+#define PRESSURE_SENSOR_INPUT_PATH  "/app/redSensor/pressure/value"
+#define TEMP_SENSOR_INPUT_PATH      "/app/redSensor/pressure/temp/value"
+
+/// Path (relative to this app's Data Hub namespace) of the Input a sensor's summaries go to.
+#define SUMMARY_PATH(name) "summary/" name
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * type definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+/// Running statistics for one axis over one window (Welford's algorithm).
+typedef struct
+{
+    uint32_t count;     ///< Number of samples.
+    double min;
+    double max;
+    double mean;        ///< Running mean.
+    double m2;          ///< Running sum of squared differences from the mean.
+}
+Stats_t;
+
+
+/// Structure that holds variables needed to aggregate one sensor's samples.
+typedef struct
+{
+    const char* name;           ///< Name of the sensor's node in the config tree.
+    const char* inputPath;      ///< Data Hub Input the raw samples come from.
+    const char* summaryPath;    ///< Data Hub Input (relative path) the summaries are pushed to.
+    const char* units;          ///< Units of the samples.
+    size_t axisCount;           ///< 1 for numeric samples, 3 for packed (x, y, z) vectors.
+    double windowLength;        ///< Window length (seconds).
+    double windowEnd;           ///< End time of the open window (0 = no window open).
+    double closedUntil;         ///< End time of the newest window that has been closed.
+    Stats_t stats[3];           ///< Statistics for each axis.
+    le_timer_Ref_t timer;       ///< Closes the open window if the sensor goes quiet.
+}
+Aggregate_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * variable definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+/// Aggregation record for the accelerometer.
+static Aggregate_t AccelAggregate = {
+                                    name: "accel",
+                                    inputPath: ACCEL_SENSOR_INPUT_PATH,
+                                    summaryPath: SUMMARY_PATH("accel"),
+                                    units: "m/s2",
+                                    axisCount: 3,
+                                    windowLength: ACCEL_WINDOW,
+                                    windowEnd: 0,
+                                    closedUntil: 0
+                                };
+
+/// Aggregation record for the gyroscope.
+static Aggregate_t GyroAggregate = {
+                                    name: "gyro",
+                                    inputPath: GYRO_SENSOR_INPUT_PATH,
+                                    summaryPath: SUMMARY_PATH("gyro"),
+                                    units: "rad/s",
+                                    axisCount: 3,
+                                    windowLength: GYRO_WINDOW,
+                                    windowEnd: 0,
+                                    closedUntil: 0
+                                };
+
+/// Aggregation record for the light level.
+static Aggregate_t LightAggregate = {
+                                    name: "light",
+                                    inputPath: LIGHT_SENSOR_INPUT_PATH,
+                                    summaryPath: SUMMARY_PATH("light"),
+                                    units: "",
+                                    axisCount: 1,
+                                    windowLength: LIGHT_WINDOW,
+                                    windowEnd: 0,
+                                    closedUntil: 0
+                                };
+
+/// Aggregation record for the pressure.
+static Aggregate_t PressureAggregate = {
+                                    name: "pressure",
+                                    inputPath: PRESSURE_SENSOR_INPUT_PATH,
+                                    summaryPath: SUMMARY_PATH("pressure"),
+                                    units: "kPa",
+                                    axisCount: 1,
+                                    windowLength: PRESSURE_WINDOW,
+                                    windowEnd: 0,
+                                    closedUntil: 0
+                                };
+
+/// Aggregation record for the temperature.
+static Aggregate_t TempAggregate = {
+                                    name: "temperature",
+                                    inputPath: TEMP_SENSOR_INPUT_PATH,
+                                    summaryPath: SUMMARY_PATH("temperature"),
+                                    units: "degC",
+                                    axisCount: 1,
+                                    windowLength: TEMP_WINDOW,
+                                    windowEnd: 0,
+                                    closedUntil: 0
+                                };
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * static function definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Clear a set of running statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResetStats
+(
+    Stats_t* statsPtr
+)
+{
+    statsPtr->count = 0;
+    statsPtr->min = HUGE_VAL;
+    statsPtr->max = -HUGE_VAL;
+    statsPtr->mean = 0.0;
+    statsPtr->m2 = 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fold a sample into a set of running statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToStats
+(
+    Stats_t* statsPtr,
+    double value
+)
+{
+    statsPtr->count++;
+
+    if (value < statsPtr->min)
+    {
+        statsPtr->min = value;
+    }
+    if (value > statsPtr->max)
+    {
+        statsPtr->max = value;
+    }
+
+    double delta = value - statsPtr->mean;
+    statsPtr->mean += delta / statsPtr->count;
+    statsPtr->m2 += delta * (value - statsPtr->mean);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the (sample) standard deviation from a set of running statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetStdDev
+(
+    const Stats_t* statsPtr
+)
+{
+    if (statsPtr->count < 2)
+    {
+        return 0.0;
+    }
+
+    return sqrt(statsPtr->m2 / (statsPtr->count - 1));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the root-mean-square from a set of running statistics.  The mean of the squares is the
+ * square of the mean plus the (population) variance, so it doesn't need its own accumulator.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetRms
+(
+    const Stats_t* statsPtr
+)
+{
+    if (statsPtr->count == 0)
+    {
+        return 0.0;
+    }
+
+    return sqrt((statsPtr->mean * statsPtr->mean) + (statsPtr->m2 / statsPtr->count));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current time, as a Data Hub timestamp (seconds since the Epoch).
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+
+    return ((double)now.sec) + (((double)now.usec) / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the summary of an aggregate's open window to the Data Hub, close the window and clear
+ * its statistics.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseWindow
+(
+    Aggregate_t* aggPtr
+)
+{
+    static const char* const axisPrefixes[] = { "x.", "y.", "z." };
+
+    le_timer_Stop(aggPtr->timer);
+
+    if (aggPtr->stats[0].count > 0)
+    {
+        char summary[IO_MAX_STRING_VALUE_LEN + 1];
+        size_t len = 0;
+
+        len += snprintf(summary + len, sizeof(summary) - len, "{\"count\":%" PRIu32,
+                        aggPtr->stats[0].count);
+
+        for (size_t axis = 0; axis < aggPtr->axisCount; axis++)
+        {
+            const Stats_t* statsPtr = &aggPtr->stats[axis];
+            const char* prefix = (aggPtr->axisCount == 1) ? "" : axisPrefixes[axis];
+
+            LE_ASSERT(len < sizeof(summary));
+            len += snprintf(summary + len,
+                            sizeof(summary) - len,
+                            ",\"%smin\":%.9g,\"%smax\":%.9g,\"%smean\":%.9g"
+                            ",\"%sstdDev\":%.9g,\"%srms\":%.9g",
+                            prefix, statsPtr->min,
+                            prefix, statsPtr->max,
+                            prefix, statsPtr->mean,
+                            prefix, GetStdDev(statsPtr),
+                            prefix, GetRms(statsPtr));
+        }
+
+        LE_ASSERT(len < sizeof(summary));
+        len += snprintf(summary + len, sizeof(summary) - len, "}");
+        LE_ASSERT(len < sizeof(summary));
+
+        LE_DEBUG("Summary of '%s': %s", aggPtr->inputPath, summary);
+
+        // Timestamp the summary with the end of its window.
+        dhubIO_PushJson(aggPtr->summaryPath, aggPtr->windowEnd, summary);
+    }
+
+    aggPtr->closedUntil = aggPtr->windowEnd;
+    aggPtr->windowEnd = 0;
+
+    for (size_t axis = 0; axis < aggPtr->axisCount; axis++)
+    {
+        ResetStats(&aggPtr->stats[axis]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler that closes an aggregate's window after the sensor has gone quiet.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WindowTimerExpired
+(
+    le_timer_Ref_t timer
+)
+{
+    Aggregate_t* aggPtr = le_timer_GetContextPtr(timer);
+
+    CloseWindow(aggPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the window that a given sample timestamp falls into, and start the timer that will close
+ * it if the sensor goes quiet.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenWindow
+(
+    Aggregate_t* aggPtr,
+    double timestamp
+)
+{
+    aggPtr->windowEnd = (floor(timestamp / aggPtr->windowLength) + 1) * aggPtr->windowLength;
+
+    double remaining = aggPtr->windowEnd - Now();
+    uint32_t ms = WINDOW_CLOSE_GRACE_MS;
+
+    if (remaining > 0)
+    {
+        ms += (uint32_t)(remaining * 1000.0);
+    }
+
+    le_timer_SetMsInterval(aggPtr->timer, ms);
+    le_timer_Start(aggPtr->timer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fold a raw sample into an aggregate, closing and opening windows as needed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSample
+(
+    Aggregate_t* aggPtr,
+    double timestamp,
+    const double* values    ///< Array of axisCount numbers.
+)
+{
+    if (timestamp < aggPtr->closedUntil)
+    {
+        LE_DEBUG("Dropping late sample from '%s'.", aggPtr->inputPath);
+        return;
+    }
+
+    if ((aggPtr->windowEnd != 0) && (timestamp >= aggPtr->windowEnd))
+    {
+        CloseWindow(aggPtr);
+    }
+
+    if (aggPtr->windowEnd == 0)
+    {
+        OpenWindow(aggPtr, timestamp);
+    }
+
+    for (size_t axis = 0; axis < aggPtr->axisCount; axis++)
+    {
+        AddToStats(&aggPtr->stats[axis], values[axis]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric sample is received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericSample
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Pointer to the Aggregate_t object associated with the sensor.
+)
+{
+    AddSample(contextPtr, timestamp, &value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a packed vector sample is received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleVectorSample
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Pointer to the Aggregate_t object associated with the sensor.
+)
+{
+    Aggregate_t* aggPtr = contextPtr;
+    double vector[3];
+
+    if (packedVector_Decode(value, vector, aggPtr->axisCount) != LE_OK)
+    {
+        LE_ERROR("Failed to decode packed vector from '%s'.", aggPtr->inputPath);
+        return;
+    }
+
+    AddSample(aggPtr, timestamp, vector);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Override an aggregate's window length with the one in the config tree, if there is one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadWindowLength
+(
+    Aggregate_t* aggPtr
+)
+{
+    le_cfg_IteratorRef_t iteratorRef = le_cfg_CreateReadTxn(AGGREGATOR_CONFIG_PATH);
+
+    le_cfg_GoToNode(iteratorRef, aggPtr->name);
+
+    double windowLength = le_cfg_GetFloat(iteratorRef, "window", aggPtr->windowLength);
+
+    le_cfg_CancelTxn(iteratorRef);
+
+    if (!(windowLength > 0.0))
+    {
+        LE_ERROR("Invalid window length (%lf) for '%s'.  Using %lf s.",
+                 windowLength,
+                 aggPtr->name,
+                 aggPtr->windowLength);
+        return;
+    }
+
+    aggPtr->windowLength = windowLength;
+
+    LE_INFO("Summarizing '%s' over %lf s windows.", aggPtr->name, aggPtr->windowLength);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an aggregate's summary Input and register for its sensor's samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartAggregate
+(
+    Aggregate_t* aggPtr,
+    const char* timerName
+)
+{
+    LoadWindowLength(aggPtr);
+
+    for (size_t axis = 0; axis < aggPtr->axisCount; axis++)
+    {
+        ResetStats(&aggPtr->stats[axis]);
+    }
+
+    aggPtr->timer = le_timer_Create(timerName);
+    le_timer_SetHandler(aggPtr->timer, WindowTimerExpired);
+    le_timer_SetContextPtr(aggPtr->timer, aggPtr);
+
+    le_result_t result = dhubIO_CreateInput(aggPtr->summaryPath, DHUBIO_DATA_TYPE_JSON,
+                                            aggPtr->units);
+    if (result != LE_OK)
+    {
+        LE_FATAL("Failed to create Data Hub Input '%s' (%s).",
+                 aggPtr->summaryPath,
+                 LE_RESULT_TXT(result));
+    }
+
+    if (aggPtr->axisCount == 1)
+    {
+        dhubIO_SetJsonExample(aggPtr->summaryPath,
+                              "{\"count\":1,\"min\":0.1,\"max\":0.1,\"mean\":0.1,"
+                              "\"stdDev\":0.0,\"rms\":0.1}");
+
+        dhubAdmin_AddNumericPushHandler(aggPtr->inputPath, HandleNumericSample, aggPtr);
+    }
+    else
+    {
+        dhubIO_SetJsonExample(aggPtr->summaryPath,
+                              "{\"count\":1,"
+                              "\"x.min\":0.1,\"x.max\":0.1,\"x.mean\":0.1,"
+                              "\"x.stdDev\":0.0,\"x.rms\":0.1,"
+                              "\"y.min\":0.2,\"y.max\":0.2,\"y.mean\":0.2,"
+                              "\"y.stdDev\":0.0,\"y.rms\":0.2,"
+                              "\"z.min\":0.3,\"z.max\":0.3,\"z.mean\":0.3,"
+                              "\"z.stdDev\":0.0,\"z.rms\":0.3}");
+
+        dhubAdmin_AddStringPushHandler(aggPtr->inputPath, HandleVectorSample, aggPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    StartAggregate(&AccelAggregate, "AccelWindow");
+    StartAggregate(&GyroAggregate, "GyroWindow");
+    StartAggregate(&LightAggregate, "LightWindow");
+    StartAggregate(&PressureAggregate, "PressureWindow");
+    StartAggregate(&TempAggregate, "TempWindow");
+}
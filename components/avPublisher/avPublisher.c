@@ -10,20 +10,62 @@
  * Some "variables" are provided to AirVantage that allow AirVantage to read (on-demand) the
  * current values reported by sensors on the mangOH Red (such as the pressure sensor and gyro).
  *
- * Time-series data will be collected from the sensors via the Data Hub and will be pushed to
- * AirVantage on-change.  This allows us to use the Data Hub to do the buffering and queuing
- * for us.  We do this by creating "observations" inside the Data Hub, configuring them
- * to have non-zero buffer sizes and receive samples from the sensors that we care about.  We then
- * register for notification when new data arrives at those observations.  This can be throttled
- * to reduce the rate of reporting by changing the filtering and buffering parameters on the
- * Data Hub observations.  The default values for the buffer sizes can be found below.  Look for
- * _BUFFER_COUNT.  In addition, observations that receive numerical values have default "change-by"
- * thresholds. Look for _CHANGE_BY.  We also configure the polling periods of the sensors to
- * prevent excessive data generation and battery consumption.  Look for constants ending in _PERIOD.
+ * Time-series data is collected from the sensors via the Data Hub and pushed to AirVantage as
+ * it arrives.  Each sensor is described by an entry in the BuiltInSensors table (see
+ * SensorDesc_t), and handled by one generic engine: a Data Hub observation with its own polling
+ * period (see _PERIOD), buffer (_BUFFER_COUNT) and change-by filter (_CHANGE_BY), feeding a
+ * flash-backed sample queue (see sampleQueue.h) that holds the samples until AirVantage has
+ * acknowledged them, so outages and restarts don't lose them.  Backlogs are pushed in batches,
+ * packed into compact columnar blocks (see columnCodec.h), with several pushes in flight at once
+ * (_PUSH_WINDOW), retries that back off (RETRY_BASE_MS) and an upload budget
+ * (BUDGET_BYTES_PER_HOUR).
  *
- * When there's an AirVantage session available, we can immediately push data when it arrives
- * from the Data Hub.  But, if the AV session goes down, then we have to wait until the session
- * comes back up, at which time we read data samples from the Data Hub's buffers and push it.
+ * The fast sensors are summarized on the device by the aggregator component, and only their
+ * summaries are pushed; their raw samples are "on-demand": the most recent ones are kept in a
+ * smaller sample queue (RAW_QUEUE_SEGMENT_COUNT), and pushed on the UploadRawSamples command.
+ * Orientation, shock and spin events and vibration are worked out at the IMU's full rate in
+ * redSensor, and pushed as they arrive.
+ *
+ * The defaults can be overridden without rebuilding, and extra sensors added, in the app's config
+ * tree:
+ *
+ * @verbatim
+    sensors/
+        <name>/                 e.g., "accel" for the built-in accelerometer sensor
+            enable          bool    false to leave a built-in sensor out (default true)
+            period          float   polling period (seconds, 0 = leave the sensor's period alone)
+            maxPeriod       float   longest adaptive polling period (seconds, <= period = fixed)
+            priority        string  "high", or "low" to sample at maxPeriod while offline and
+                                    leave the upload budget's reserve alone
+            bufferCount     int     size of the Data Hub observation's buffer
+            changeBy        float   change-by threshold (0 = none)
+            batchCount      int     max # of backlogged samples per record
+            pushWindow      int     max # of pushes in flight (1 to MAX_PUSH_WINDOW)
+            onDemand        bool    true to only push the samples on UploadRawSamples
+            keepRaw         bool    false to not queue an on-demand sensor's samples in flash,
+                                    which leaves UploadRawSamples nothing to push (default true)
+        <name>/                 extra sensors also need:
+            type            string  "numeric", "vector" (packed vector) or "json"
+            input           string  Data Hub Input path to take samples from
+            compactAvPath   string  AirVantage path for compact backlog blocks (optional)
+            fields/
+                0/ 1/ ...           one node per number in a sample, up to MAX_SENSOR_FIELDS
+                    avPath      string  AirVantage path to record the number under
+                    member      string  name of the JSON member holding it ("json" only)
+                    isInt       bool    true to record it as an integer (default false)
+                    resolution  int     power of ten it is quantized to in compact blocks
+    budget/
+        bytesPerHour        int     upload budget (bytes per hour, 0 = unlimited)
+        pushesPerHour       int     upload budget (pushes per hour, 0 = unlimited)
+    worker/
+        enable              bool    true to run the push pipeline on a worker thread
+                                    (default false)
+   @endverbatim
+ *
+ * The sensors can also be tuned from AirVantage through the /Settings/<name>/... settings, and
+ * each one's push pipeline is reported every METRICS_PERIOD_MS through the /Metrics/<name>/...
+ * variables (see PublishSensorMetrics()).  The pipeline runs on the main thread, or on a worker
+ * thread if worker/enable is set (see HANDOFF_QUEUE_COUNT).
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -32,6 +74,9 @@
 #include "legato.h"
 #include "interfaces.h"
 #include "json.h"
+#include "packedVector.h"
+#include "sampleQueue.h"
+#include "columnCodec.h"
 
 
 //--------------------------------------------------------------------------------------------------
@@ -42,13 +87,30 @@
 
 // Polling periods (seconds):
 
-#define ACCEL_PERIOD 10
-#define GYRO_PERIOD 10
+#define ACCEL_PERIOD 1
+#define GYRO_PERIOD 1
 #define LIGHT_PERIOD 10
 #define PRESSURE_PERIOD 10
 #define TEMP_PERIOD 10
 #define POS_PERIOD 10
 
+// Longest polling periods (seconds) the adaptive scheduler may stretch the periods above to, while
+// a sensor's readings stay within its change-by threshold.  No more than the period = fixed.
+
+#define ACCEL_MAX_PERIOD 8
+#define GYRO_MAX_PERIOD 8
+#define LIGHT_MAX_PERIOD 60
+#define PRESSURE_MAX_PERIOD 60
+#define TEMP_MAX_PERIOD 60
+#define POS_MAX_PERIOD 60
+
+/// Number of polling periods without a change after which the adaptive scheduler doubles a
+/// sensor's period.
+#define ADAPTIVE_QUIET_PERIODS 10
+
+/// Interval between the adaptive scheduler's checks of the sensors' activity (ms).
+#define ADAPTIVE_CHECK_INTERVAL_MS 2000
+
 // Buffer sizes (# of samples):
 
 #define ACCEL_BUFFER_COUNT 100
@@ -57,6 +119,10 @@
 #define PRESSURE_BUFFER_COUNT 100
 #define TEMP_BUFFER_COUNT 100
 #define POS_BUFFER_COUNT 100
+#define ORIENT_BUFFER_COUNT 100
+#define EVENT_BUFFER_COUNT 100
+#define VIB_BUFFER_COUNT 100
+#define SUMMARY_BUFFER_COUNT 60
 
 // Change-by thresholds:
 
@@ -64,6 +130,191 @@
 #define PRESSURE_CHANGE_BY 1.0 // kPa
 #define TEMP_CHANGE_BY 2.0  // degC
 
+// Vector change-by thresholds.  The Data Hub only applies change-by to numeric observations, so
+// these are applied here instead: a sample is only pushed if it differs from the last one pushed
+// by at least this much (Euclidean norm of the difference, or distance moved for the position).
+
+#define ACCEL_CHANGE_BY 0.1 // m/s2
+#define GYRO_CHANGE_BY 0.02 // rad/s
+#define POS_CHANGE_BY 10.0  // metres
+#define ORIENT_CHANGE_BY 0.0 // reported at a low rate already
+#define EVENT_CHANGE_BY 0.0 // every frame of an event window is wanted
+#define VIB_CHANGE_BY 0.0   // reported at a low rate already
+
+/// Number of members in a vector window summary (the count, then 5 statistics for each axis).
+#define MAX_SUMMARY_MEMBERS 16
+
+/// Size of the storage for the AirVantage paths built at start-up (see InternPath()).
+#define PATH_ARENA_BYTES 16384
+
+/// Mean radius of the Earth (metres), used to convert position changes into distances.
+#define EARTH_RADIUS 6371000.0
+
+// Backlog batch sizes (max # of buffered samples packed into one record when catching up):
+
+#define ACCEL_BATCH_COUNT 20
+#define GYRO_BATCH_COUNT 20
+#define LIGHT_BATCH_COUNT 50
+#define PRESSURE_BATCH_COUNT 50
+#define TEMP_BATCH_COUNT 50
+#define POS_BATCH_COUNT 10
+#define ORIENT_BATCH_COUNT 20
+#define EVENT_BATCH_COUNT 50
+#define EVENT_BLOCK_BATCH_COUNT 8   // about a window's worth of frame blocks
+#define VIB_BATCH_COUNT 20
+#define SUMMARY_BATCH_COUNT 10
+
+// Max # of backlogged raw samples packed into one compact block when catching up:
+#define COMPACT_BATCH_COUNT COLUMN_CODEC_MAX_SAMPLES
+
+#if COLUMN_CODEC_TEXT_BYTES > (LE_AVDATA_STRING_VALUE_LEN + 1)
+#error "Compact backlog blocks don't fit in an AirVantage string value."
+#endif
+
+/// Typical size of a block published by a sensor (e.g., an event block of the trigger component,
+/// which holds up to COLUMN_CODEC_MAX_SAMPLES IMU frames in about 700 bytes of text), for
+/// budgeting its fresh samples.
+#define BLOCK_TEXT_BYTES 768
+
+// Resolutions of the values in compact backlog blocks (powers of ten):
+
+#define ACCEL_RESOLUTION_EXP -3     // 0.001 m/s2
+#define GYRO_RESOLUTION_EXP -4      // 0.0001 rad/s
+#define LIGHT_RESOLUTION_EXP 0      // 1 ADC count
+#define PRESSURE_RESOLUTION_EXP -4  // 0.1 Pa
+#define TEMP_RESOLUTION_EXP -2      // 0.01 degC
+#define POS_RESOLUTION_EXP -6       // 0.000001 degrees latitude and longitude (about 0.1 m)
+#define POS_ACCURACY_RESOLUTION_EXP -1  // 0.1 m altitude and accuracies
+#define ORIENT_QUATERNION_RESOLUTION_EXP -4 // 0.0001 (about 0.01 degrees)
+#define ORIENT_ANGLE_RESOLUTION_EXP -2      // 0.01 degrees roll, pitch and yaw
+#define EVENT_TIME_RESOLUTION_EXP -3        // 1 ms event window start and end times
+#define VIB_RMS_RESOLUTION_EXP -4           // 0.0001 m/s2 RMS vibration
+#define VIB_CREST_RESOLUTION_EXP -2         // 0.01 crest factor
+#define VIB_FREQUENCY_RESOLUTION_EXP -2     // 0.01 Hz dominant frequency
+#define VIB_ENERGY_RESOLUTION_EXP -7        // 0.0000001 (m/s2)^2 band energies
+
+// Coalescing window (ms).  New samples from all sensors that arrive within this long of each other
+// are pushed together in one record.  0 = push each sample as soon as it arrives.
+
+#define COALESCE_WINDOW_MS 500
+
+// Push windows (max # of pushes per sensor that may be awaiting acknowledgement at the same time):
+
+#define ACCEL_PUSH_WINDOW 4
+#define GYRO_PUSH_WINDOW 4
+#define LIGHT_PUSH_WINDOW 2
+#define PRESSURE_PUSH_WINDOW 2
+#define TEMP_PUSH_WINDOW 2
+#define POS_PUSH_WINDOW 2
+#define ORIENT_PUSH_WINDOW 2
+#define EVENT_PUSH_WINDOW 4
+#define VIB_PUSH_WINDOW 2
+#define SUMMARY_PUSH_WINDOW 2
+
+/// Upper limit on any sensor's push window.
+#define MAX_PUSH_WINDOW 8
+
+// Defaults for sensors added in the config tree (see LoadSensors()):
+
+#define CONFIG_SENSOR_BUFFER_COUNT 100
+#define CONFIG_SENSOR_BATCH_COUNT 20
+#define CONFIG_SENSOR_PUSH_WINDOW 2
+
+#if    (ACCEL_PUSH_WINDOW > MAX_PUSH_WINDOW) || (GYRO_PUSH_WINDOW > MAX_PUSH_WINDOW) \
+    || (LIGHT_PUSH_WINDOW > MAX_PUSH_WINDOW) || (PRESSURE_PUSH_WINDOW > MAX_PUSH_WINDOW) \
+    || (TEMP_PUSH_WINDOW > MAX_PUSH_WINDOW) || (POS_PUSH_WINDOW > MAX_PUSH_WINDOW) \
+    || (ORIENT_PUSH_WINDOW > MAX_PUSH_WINDOW) || (EVENT_PUSH_WINDOW > MAX_PUSH_WINDOW) \
+    || (VIB_PUSH_WINDOW > MAX_PUSH_WINDOW) \
+    || (SUMMARY_PUSH_WINDOW > MAX_PUSH_WINDOW) || (CONFIG_SENSOR_PUSH_WINDOW > MAX_PUSH_WINDOW)
+#error "Push window larger than MAX_PUSH_WINDOW."
+#endif
+
+// Flash-backed sample queue sizes (each sensor's queue can use up to
+// QUEUE_SEGMENT_COUNT * QUEUE_SEGMENT_BYTES of flash, and each on-demand sensor's queue of raw
+// samples up to RAW_QUEUE_SEGMENT_COUNT * QUEUE_SEGMENT_BYTES, which holds the most recent raw
+// samples with less flash wear):
+
+#define QUEUE_SEGMENT_COUNT 8
+#define RAW_QUEUE_SEGMENT_COUNT 2
+#define QUEUE_SEGMENT_BYTES (32 * 1024)
+
+// Node of the app's config tree holding the sensor settings:
+
+#define SENSORS_CONFIG_PATH "sensors"
+
+// Upload budget.  Pushes are paced by token buckets holding bytes and pushes, refilled at these
+// rates (per hour, 0 = unlimited), so a metered SIM plan can't be overrun.  They can be
+// overridden in the config tree, under BUDGET_CONFIG_PATH.
+
+#define BUDGET_BYTES_PER_HOUR 0
+#define BUDGET_PUSHES_PER_HOUR 0
+#define BUDGET_CONFIG_PATH "budget"
+
+/// How much of the budget can be spent in one burst (seconds' worth of refill).
+#define BUDGET_BURST_SECONDS 600
+
+/// Fraction of each bucket kept back for fresh samples from high-priority sensors.  Backlogs,
+/// resends and fresh samples from low-priority sensors are held back while the bucket is below it.
+#define BUDGET_RESERVE_FRACTION 0.25
+
+/// Interval between retries of the pushes held back for lack of budget (ms).
+#define BUDGET_RETRY_INTERVAL_MS 5000
+
+// Retries of failed pushes.  A sensor whose push fails waits RETRY_BASE_MS before trying again,
+// doubling with each failure in a row up to RETRY_MAX_MS, and each wait is cut by a random amount
+// of up to half, so the sensors don't all retry together.
+
+#define RETRY_BASE_MS 2000
+#define RETRY_MAX_MS (5 * 60 * 1000)
+
+// Retries of a sensor's Data Hub setup.  The Data Hub can be slow to come up at boot, so a sensor
+// whose setup fails doesn't hold up the others: it waits SETUP_RETRY_BASE_MS and carries on from
+// the step that failed, doubling the wait with each failure in a row up to SETUP_RETRY_MAX_MS.
+// See SetUpSensor().
+
+#define SETUP_RETRY_BASE_MS 1000
+#define SETUP_RETRY_MAX_MS (60 * 1000)
+
+/// Number of push failures in a row (across all sensors) after which all pushes are paused until
+/// the AirVantage session (re)starts.
+#define BREAKER_FAILURE_COUNT 6
+
+/// How long pushes stay paused if the session doesn't restart (ms), after which they are tried
+/// again anyway, in case the session never went down.
+#define BREAKER_PROBE_MS (10 * 60 * 1000)
+
+/// Interval between sensors restarting their pushes when pushes resume (ms).
+#define RESUME_STAGGER_MS 250
+
+/// Estimated size of each entry in a record, not counting its path (the value, the timestamp and
+/// the framing), for budgeting.
+#define RECORD_ENTRY_BYTES 16
+
+/// How often the metrics of each sensor's push pipeline are published (milliseconds).
+#define METRICS_PERIOD_MS (60 * 1000)
+
+/// Weight given to each new interval between samples in a sensor's moving average (0 to 1).
+#define METRICS_INTERVAL_WEIGHT 0.1
+
+/// Data Hub Input path prefix of the metrics (relative to the app, i.e., <prefix>/<name>).
+#define METRICS_INPUT_PREFIX "metrics"
+
+// Optional worker thread.  When "worker/enable" is true in the config tree, the push pipeline
+// runs on its own thread, and the Data Hub push handlers on the main thread only hand the samples
+// over to it, through a lock-free queue.  See HandOffSample().
+
+#define WORKER_CONFIG_PATH "worker"
+
+/// Max # of samples waiting to be picked up by the worker thread (a power of two).
+#define HANDOFF_QUEUE_COUNT 512
+
+/// Size of the buffer holding the string values of those samples (bytes, a power of two).
+#define HANDOFF_STRING_BYTES (128 * 1024)
+
+#if HANDOFF_STRING_BYTES < (IO_MAX_STRING_VALUE_LEN + 1)
+#error "Handoff string buffer can't hold the largest Data Hub string value."
+#endif
+
 // Data Hub Observation resource paths:
 
 #define ACCEL_OBS_PATH "/obs/accel"
@@ -72,16 +323,48 @@
 #define PRESSURE_OBS_PATH "/obs/pressure"
 #define TEMP_OBS_PATH "/obs/temperature"
 #define POS_OBS_PATH "/obs/position"
+#define ORIENT_OBS_PATH "/obs/orientation"
+#define ACCEL_EVENT_OBS_PATH "/obs/event/accel"
+#define GYRO_EVENT_OBS_PATH "/obs/event/gyro"
+#define PRESSURE_EVENT_OBS_PATH "/obs/event/pressure"
+#define SHOCK_ALARM_OBS_PATH "/obs/event/shock"
+#define SPIN_ALARM_OBS_PATH "/obs/event/spin"
+#define VIB_OBS_PATH "/obs/vibration"
+#define VIB_BANDS_OBS_PATH "/obs/vibrationBands"
+#define ACCEL_SUMMARY_OBS_PATH "/obs/summary/accel"
+#define GYRO_SUMMARY_OBS_PATH "/obs/summary/gyro"
+#define LIGHT_SUMMARY_OBS_PATH "/obs/summary/light"
+#define PRESSURE_SUMMARY_OBS_PATH "/obs/summary/pressure"
+#define TEMP_SUMMARY_OBS_PATH "/obs/summary/temperature"
 
 // Data Hub sensor Input resource paths:
 
-#define ACCEL_SENSOR_INPUT_PATH     "/app/redSensor/accel/value"
-#define GYRO_SENSOR_INPUT_PATH      "/app/redSensor/gyro/value"
+// Note: The accelerometer and gyro are taken in packed vector form (see packedVector.h) rather than
+//       from their JSON "value" Inputs, to avoid converting the numbers to and from text.
+
+#define ACCEL_SENSOR_INPUT_PATH     "/app/redSensor/accel/packed"
+#define GYRO_SENSOR_INPUT_PATH      "/app/redSensor/gyro/packed"
 #define LIGHT_SENSOR_INPUT_PATH     "/app/redSensor/light/value"
 #define POS_SENSOR_INPUT_PATH       "/app/redSensor/position/value"
+#define ORIENT_SENSOR_INPUT_PATH    "/app/redSensor/orientation/value"
+#define ACCEL_EVENT_INPUT_PATH      "/app/redSensor/event/accel"
+#define GYRO_EVENT_INPUT_PATH       "/app/redSensor/event/gyro"
+#define PRESSURE_EVENT_INPUT_PATH   "/app/redSensor/event/pressure"
+#define SHOCK_ALARM_INPUT_PATH      "/app/redSensor/event/shock"
+#define SPIN_ALARM_INPUT_PATH       "/app/redSensor/event/spin"
+#define VIB_SENSOR_INPUT_PATH       "/app/redSensor/vibration/value"
+#define VIB_BANDS_INPUT_PATH        "/app/redSensor/vibration/bandEnergy"
 #define PRESSURE_SENSOR_INPUT_PATH  "/app/redSensor/pressure/value"
 #define TEMP_SENSOR_INPUT_PATH      "/app/redSensor/pressure/temp/value"
 
+// Data Hub summary Input resource paths (published by the aggregator component):
+
+#define ACCEL_SUMMARY_INPUT_PATH    "/app/redCloud/summary/accel"
+#define GYRO_SUMMARY_INPUT_PATH     "/app/redCloud/summary/gyro"
+#define LIGHT_SUMMARY_INPUT_PATH    "/app/redCloud/summary/light"
+#define PRESSURE_SUMMARY_INPUT_PATH "/app/redCloud/summary/pressure"
+#define TEMP_SUMMARY_INPUT_PATH     "/app/redCloud/summary/temperature"
+
 
 //--------------------------------------------------------------------------------------------------
 /*
@@ -97,1086 +380,5495 @@
 #define LED_CMD_ACTIVATE_RES                "/ActivateLED"
 #define LED_CMD_DEACTIVATE_RES              "/DeactivateLED"
 
+// command to upload the raw samples of the on-demand sensors
+#define UPLOAD_RAW_SAMPLES_CMD_RES          "/UploadRawSamples"
+
 
 //--------------------------------------------------------------------------------------------------
 /*
- * type definitions
+ * AirVantage "setting" definitions
  */
 //--------------------------------------------------------------------------------------------------
 
-/// Structure that holds variables needed to manage one sensor's data.
-typedef struct
-{
-    const char* obsPath; ///< String containing Data Hub observation path to fetch data from.
-    double lastDeliveredTimestamp; ///< Timestamp of newest sample successfully delivered to cloud.
-    double timestamp; ///< Timestamp of sample we are trying to push to the cloud.
-    enum
-    {
-        SENSOR_STATE_IDLE,      ///< No data to send.
-        SENSOR_STATE_PUSHING,   ///< Sending data to the cloud.
-        SENSOR_STATE_BACKLOGGED,///< Sending data to the cloud and more data waiting to be sent.
-        SENSOR_STATE_FAULT,     ///< Failed to push data.
+// prefix of the settings to tune each sensor (<prefix>/<name>/Period, BufferCount and ChangeBy)
+#define SENSOR_SETTINGS_RES                 "/Settings"
 
-    } state; ///< State of the sensor.
-}
-Sensor_t;
+// setting holding the edges of the vibration frequency bands (a JSON array of numbers, in Hz)
+#define VIB_BANDS_SETTING_RES               "/Settings/vibration/Bands"
+
+// Data Hub Output that the vibration component takes its band edges from
+#define VIB_BANDS_OUTPUT_PATH               "/app/redSensor/vibration/bands"
+
+// default vibration band edges (Hz), as a JSON array; must match the vibration component's
+#define VIB_DEFAULT_BANDS                   "[1,5,10,20,30,45,60,80,100]"
 
 
 //--------------------------------------------------------------------------------------------------
 /*
- * variable definitions
+ * AirVantage "variable" definitions
  */
 //--------------------------------------------------------------------------------------------------
 
-/// True if the AirVantage session is active.  False if not.
-static bool IsAvSessionActive = false;
-
-
-/// Cloud push tracking record for the accelerometer.
-static Sensor_t Accelerometer = {
-                                    obsPath: ACCEL_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
-/// Cloud push tracking record for the gyroscope.
-static Sensor_t Gyroscope = {
-                                    obsPath: GYRO_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
-/// Cloud push tracking record for the light level.
-static Sensor_t LightSensor = {
-                                    obsPath: LIGHT_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
-/// Cloud push tracking record for the pressure.
-static Sensor_t PressureSensor = {
-                                    obsPath: PRESSURE_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
-/// Cloud push tracking record for the temperature.
-static Sensor_t Thermometer = {
-                                    obsPath: TEMP_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
-/// Cloud push tracking record for the position.
-static Sensor_t PositionSensor = {
-                                    obsPath: POS_OBS_PATH,
-                                    lastDeliveredTimestamp: 0,
-                                    timestamp: 0,
-                                    state: SENSOR_STATE_IDLE
-                                };
-
+// prefix of the variables that report on each sensor's push pipeline (<prefix>/<name>/Pushed, ...)
+#define SENSOR_METRICS_RES                  "/Metrics"
 
 
 //--------------------------------------------------------------------------------------------------
 /*
- * static function definitions
+ * type definitions
  */
 //--------------------------------------------------------------------------------------------------
 
-
-static void PushBacklog(Sensor_t* sensorPtr);
+/// Maximum number of fields in a sensor's samples.
+#define MAX_SENSOR_FIELDS COLUMN_CODEC_MAX_COLUMNS
 
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Handles notification of AirVantage time-series push status.
- */
-//--------------------------------------------------------------------------------------------------
-static void HandleAvPushComplete
-(
-    le_avdata_PushStatus_t status, ///< Push success/failure status
-    void* context                  ///< Not used
-)
+/// Range of one sensor's sample timestamps that has been pushed but not yet acknowledged.
+typedef struct
 {
-    Sensor_t* sensorPtr = context;
-
-    switch (status)
+    double startAfter;  ///< Timestamp of the newest sample sent before this range.
+    double newest;      ///< Timestamp of the newest sample in this range.
+    unsigned int sampleCount; ///< Number of samples recorded in this range.
+    double referenceValues[MAX_SENSOR_FIELDS]; ///< Change-by reference the range's samples were
+                                               ///< filtered against (see IsWithinChangeBy()).
+    bool hasReference;  ///< true if referenceValues is valid.
+    bool isPartial;     ///< true if the push under way only resends part of the range, too big
+                        ///< for one record: the samples up to partNewest.
+    double partNewest;  ///< Timestamp of the newest sample in that part (isPartial only).
+    double partValues[MAX_SENSOR_FIELDS]; ///< Change-by reference as of partNewest.
+    bool hasPartValues; ///< true if partValues is valid.
+    enum
     {
-        case LE_AVDATA_PUSH_SUCCESS:
+        RANGE_STATE_SENDING,    ///< Pushed, waiting for the result.
+        RANGE_STATE_DELIVERED,  ///< Delivered, but an older range is still outstanding.
+        RANGE_STATE_FAILED,     ///< Push failed (or only part of the range has been resent),
+                                ///< needs to be sent again.
 
-            // Remember the timestamp we last successfully delivered.
-            sensorPtr->lastDeliveredTimestamp = sensorPtr->timestamp;
+    } state; ///< State of the range.
+}
+Range_t;
 
-            // If there's more data to push, push it now.
-            if (sensorPtr->state == SENSOR_STATE_BACKLOGGED)
-            {
-                PushBacklog(sensorPtr);
-            }
 
-            return;
+/// Forms that a sensor's samples come in.
+typedef enum
+{
+    SAMPLE_TYPE_NUMERIC,    ///< A number (one field).
+    SAMPLE_TYPE_VECTOR,     ///< A packed vector (see packedVector.h) holding one number per field.
+    SAMPLE_TYPE_JSON,       ///< A JSON object holding one member per field.
+    SAMPLE_TYPE_SUMMARY,    ///< A JSON window summary published by the aggregator component.
+    SAMPLE_TYPE_BLOCK,      ///< A compact block of samples (see columnCodec.h), already encoded
+                            ///< as text, which is pushed as it is under the compactAvPath.
+}
+SampleType_t;
 
-        case LE_AVDATA_PUSH_FAILED:
 
-            LE_WARN("Push to AirVantage failed (%s). Retrying...", sensorPtr->obsPath);
+/// Ways of measuring how far a sample is from the last one pushed, for change-by filtering.
+typedef enum
+{
+    CHANGE_BY_EUCLIDEAN,    ///< Euclidean norm of the difference, over all the fields.
+    CHANGE_BY_DISTANCE,     ///< Distance moved in metres, fields 0 and 1 being latitude and
+                            ///< longitude.
+}
+ChangeByMetric_t;
 
-            // Try this one again.
-            PushBacklog(sensorPtr);
 
-            return;
-    }
+/// How much a sensor's samples matter when they can't be delivered right away.
+typedef enum
+{
+    SENSOR_PRIORITY_LOW,    ///< Sampled at its longest period while the AirVantage session is
+                            ///< down, and pushed only while the upload budget isn't low.
+    SENSOR_PRIORITY_HIGH,   ///< Sampled as usual while the AirVantage session is down, and fresh
+                            ///< samples pushed first, out of the budget's reserve if need be.
+}
+SensorPriority_t;
 
-    LE_FATAL("Unexpected push result status %d (%s).", status, sensorPtr->obsPath);
+
+/// Description of one of the numbers making up a sensor's samples.
+typedef struct
+{
+    const char* avPath;     ///< AirVantage path the field is recorded under.
+    const char* member;     ///< Name of the JSON member holding the field (JSON samples only).
+    bool isInt;             ///< true to record the field as an integer rather than a float.
+    int8_t resolutionExp;   ///< Resolution (power of ten) of the field in compact backlog blocks.
 }
+SensorField_t;
 
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Records a light sensor reading into an avdata record and pushes it.
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
- */
-//--------------------------------------------------------------------------------------------------
-static le_result_t PushLightLevel
-(
-    double timestamp,
-    double value
-)
+/// Description of a sensor whose samples are pushed to the cloud.
+typedef struct
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    const char* name;       ///< Name of the sensor's node in the config tree.
+    const char* obsPath;    ///< Data Hub observation path to fetch data from.
+    const char* inputPath;  ///< Data Hub Input that feeds the observation.
+    SampleType_t type;      ///< Form of the sensor's samples.
+    const SensorField_t* fields; ///< Fields of the samples (not used by summaries and blocks).
+    size_t fieldCount;      ///< Number of fields (1 to MAX_SENSOR_FIELDS, 0 if not used).
+    double period;          ///< Polling period to set on the sensor (seconds, 0 = not polled).
+    double maxPeriod;       ///< Longest period the adaptive scheduler may use (seconds, no more
+                            ///< than the period = fixed).
+    SensorPriority_t priority; ///< How the sensor is sampled, and its samples pushed, when they
+                               ///< can't all be delivered right away.
+    unsigned int bufferCount; ///< Size of the observation's buffer (# of samples).
+    double changeBy; ///< Change-by threshold (0 = none).  Numeric samples are filtered by the
+                     ///< Data Hub; the others by avPublisher itself, using the changeByMetric.
+    ChangeByMetric_t changeByMetric; ///< How change-by is measured for non-numeric samples.
+    unsigned int batchCount; ///< Max # of backlogged samples to push in one record (at least 1).
+    unsigned int pushWindow; ///< Max # of pushes in flight at once (1 to MAX_PUSH_WINDOW).
+    bool isOnDemand; ///< true if fresh samples are only pushed when requested.
+    bool isRawKept;  ///< true if an on-demand sensor's samples are queued until requested
+                     ///< (the samples of the other sensors are always queued).
+    const char* summaryAvPath; ///< AirVantage path prefix of the summaries (summaries only).
+    size_t summaryAxisCount; ///< 1 for scalar summaries, 3 for (x, y, z) vector summaries.
+    const char* compactAvPath; ///< AirVantage path of the sensor's compact backlog blocks
+                               ///< (NULL if the backlog is recorded sample by sample), or of
+                               ///< the blocks themselves (blocks only).
+}
+SensorDesc_t;
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
 
-    const char *path = "MangOH.Sensors.Light.Level";
+/// States of a sensor's push pipeline.
+typedef enum
+{
+    SENSOR_STATE_IDLE,      ///< No data to send.
+    SENSOR_STATE_PUSHING,   ///< Sending data to the cloud (room for more in the push window).
+    SENSOR_STATE_BACKLOGGED,///< Sending data to the cloud and more data waiting to be sent.
+    SENSOR_STATE_FAULT,     ///< Failed to push data.
+}
+SensorState_t;
 
-    le_result_t result = le_avdata_RecordInt(rec, path, (int32_t)value, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record light sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Number of sensor states.
+#define SENSOR_STATE_COUNT (SENSOR_STATE_FAULT + 1)
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &LightSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
-    }
 
-done:
+/// Steps of setting a sensor up in the Data Hub, in the order they're done.  See SetUpSensor().
+typedef enum
+{
+    SETUP_STEP_OBSERVATION, ///< Create the sensor's observation, and set its buffer and change-by.
+    SETUP_STEP_PUSH_HANDLER,///< Register for notification of the observation's updates.
+    SETUP_STEP_SENSOR,      ///< Set the sensor's period and enable it.
+    SETUP_STEP_SOURCE,      ///< Connect the observation to the sensor's input.
+    SETUP_STEP_METRICS,     ///< Create the Data Hub Input the sensor's metrics go to.
+    SETUP_STEP_DONE,        ///< All set up.
+}
+SetupStep_t;
 
-    le_avdata_DeleteRecord(rec);
 
-    return result;
+/// Metrics published for each sensor.  See PublishSensorMetrics().
+typedef enum
+{
+    METRIC_RECEIVED,        ///< Samples received from the Data Hub.
+    METRIC_PUSHED,          ///< Samples delivered to AirVantage.
+    METRIC_DROPPED,         ///< Samples discarded as unchanged or malformed.
+    METRIC_FAILED,          ///< Pushes that failed.
+    METRIC_LATENCY_MEAN,    ///< Mean sample-to-ack latency (seconds).
+    METRIC_LATENCY_HISTOGRAM, ///< Sample-to-ack latency histogram (see LatencyBucketLimits).
+    METRIC_IDLE_TIME,       ///< Time spent in each state (seconds).
+    METRIC_PUSHING_TIME,
+    METRIC_BACKLOGGED_TIME,
+    METRIC_FAULT_TIME,
+    METRIC_BACKLOG_SECONDS, ///< Age of the oldest undelivered sample, relative to the newest.
+    METRIC_BACKLOG_FILL,    ///< Estimated # of undelivered samples, relative to the buffer count.
+    METRIC_PUSHES,          ///< Pushes started with some of the sensor's samples.
+    METRIC_PUSHES_PER_SAMPLE, ///< Pushes per sample delivered.
+    METRIC_SAMPLE_RATE,     ///< Samples received per second, over the last METRICS_PERIOD_MS.
+    METRIC_DELIVERY_RATE,   ///< Samples delivered per second, over the last METRICS_PERIOD_MS.
+    METRIC_CPU_PER_SAMPLE,  ///< CPU time spent handling the sensor, per sample received (us).
+    METRIC_HANDOFF_DROPPED, ///< Samples lost because the worker thread's queue was full.
+    METRIC_HANDOFF_PEAK,    ///< Fullest the worker thread's queue was when one of the sensor's
+                            ///< samples arrived, over the last METRICS_PERIOD_MS (0 to 1).
+
+    METRIC_COUNT            ///< Number of metrics.
 }
+Metric_t;
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Records a pressure sensor reading into an avdata record and pushes it.
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
- */
-//--------------------------------------------------------------------------------------------------
-static le_result_t PushPressure
-(
-    double timestamp,
-    double value
-)
+
+/// Number of buckets in the sample-to-ack latency histograms.  See LatencyBucketLimits.
+#define LATENCY_BUCKET_COUNT 9
+
+
+/// Performance of a sensor's push pipeline.
+typedef struct
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    uint32_t receivedCount; ///< Samples received from the Data Hub.
+    uint32_t pushedCount;   ///< Samples delivered to AirVantage.
+    uint32_t droppedCount;  ///< Samples discarded as unchanged or malformed.
+    uint32_t failedCount;   ///< Pushes of the sensor's samples that failed.
+    uint32_t pushCount;     ///< Pushes started with some of the sensor's samples.
+    uint32_t latencyCounts[LATENCY_BUCKET_COUNT]; ///< Histogram of sample-to-ack latencies.
+    double latencySum;      ///< Sum of the sample-to-ack latencies (seconds).
+    uint32_t latencyCount;  ///< Number of sample-to-ack latencies measured.
+    double stateTimes[SENSOR_STATE_COUNT]; ///< Time spent in each state (seconds).
+    double stateSince;      ///< When the current state was entered (seconds since boot).
+    double lastDroppedTimestamp;  ///< Timestamp of the newest sample counted as dropped.
+    double lastReceivedTimestamp; ///< Timestamp of the newest sample received.
+    double sampleInterval;  ///< Moving average of the interval between samples (seconds).
+    double cpuTime;         ///< CPU time spent handling the sensor's samples and pushes (seconds).
+    double periodStart;     ///< When the metrics were last published (seconds since boot).
+    uint32_t periodReceivedCount; ///< receivedCount when the metrics were last published.
+    uint32_t periodPushedCount;   ///< pushedCount when the metrics were last published.
+    uint32_t handoffDroppedCount; ///< Samples lost to a full worker queue (only written by the
+                                  ///< main thread).
+    uint32_t handoffPeak;   ///< Most samples seen waiting in the worker queue when one of the
+                            ///< sensor's arrived, since the metrics were last published.
+    const char* avPaths[METRIC_COUNT]; ///< AirVantage path of each metric.
+    char inputPath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1]; ///< Data Hub Input the metrics go to.
+}
+SensorMetrics_t;
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
 
-    const char *path = "MangOH.Sensors.Pressure.Pressure";
+/// Structure that holds variables needed to manage one sensor's data.
+typedef struct
+{
+    SensorDesc_t desc; ///< Description of the sensor, with any config tree overrides applied.
+    double lastDeliveredTimestamp; ///< Timestamp of newest sample successfully delivered to cloud,
+                                   ///< such that all older samples have been delivered too.
+    double sentTimestamp; ///< Timestamp of newest sample handed to the AirVantage Agent.
+    Range_t inFlight[MAX_PUSH_WINDOW]; ///< Ring of outstanding ranges, oldest first.
+    size_t inFlightHead;  ///< Index of the oldest range in the inFlight ring.
+    size_t inFlightCount; ///< Number of ranges in the inFlight ring.
+    double lastPushedValues[MAX_SENSOR_FIELDS]; ///< Fields of the last sample recorded.
+    bool hasLastPushedValues; ///< true if lastPushedValues is valid.
+    double sentValues[MAX_SENSOR_FIELDS]; ///< lastPushedValues as of sentTimestamp, i.e., the
+                                          ///< change-by reference of the next range.
+    bool hasSentValues; ///< true if sentValues is valid.
+    sampleQueue_Ref_t queueRef; ///< Flash-backed queue of the sensor's samples (NULL if they
+                                ///< aren't kept).
+    const char* summaryPaths[MAX_SUMMARY_MEMBERS]; ///< AirVantage path of each summary member
+                                                   ///< (summaries only).
+    double period; ///< Polling period in effect (seconds), which the adaptive scheduler moves
+                   ///< between desc.period and desc.maxPeriod.
+    double lastActivityTime;     ///< When the readings last changed by the change-by threshold
+                                 ///< (seconds since boot).
+    double lastPeriodChangeTime; ///< When the period in effect last changed (seconds since boot).
+    double activityValues[MAX_SENSOR_FIELDS]; ///< Fields of the sample that last changed.
+    bool hasActivityValues; ///< true if activityValues is valid.
+    bool isLinkBackedOff;   ///< true if slowed down because the AirVantage session is down.
+    size_t sampleBytes;     ///< Estimated size of one sample recorded on its own (bytes).
+    bool isWaitingForBudget; ///< true if a push was held back for lack of upload budget.
+    unsigned int failureCount; ///< Number of the sensor's pushes that have failed in a row.
+    le_timer_Ref_t retryTimer; ///< Timer used to retry the sensor's failed pushes after a wait.
+    SetupStep_t setupStep; ///< Next step of setting the sensor up in the Data Hub.
+    unsigned int setupFailureCount; ///< Number of times in a row the sensor's setup has failed.
+    le_timer_Ref_t setupTimer; ///< Timer used to retry the sensor's failed setup after a wait.
+    SensorState_t state; ///< State of the sensor.  Only to be changed by SetSensorState().
+    SensorMetrics_t metrics; ///< Performance of the sensor's push pipeline.
+}
+Sensor_t;
 
-    le_result_t result = le_avdata_RecordFloat(rec, path, value, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record pressure sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &PressureSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Maximum number of sensors being pushed to the cloud (built-in ones plus those added in the
+/// config tree).
+#define MAX_SENSORS 24
 
-done:
 
-    le_avdata_DeleteRecord(rec);
+/// Maximum size of a sensor or field name in the config tree (including null terminator).
+#define MAX_CONFIG_NAME_BYTES 32
 
-    return result;
+
+/// Storage for the description of a sensor added in the config tree.
+typedef struct
+{
+    char name[MAX_CONFIG_NAME_BYTES];
+    char obsPath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    char inputPath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    char compactAvPath[LE_AVDATA_PATH_NAME_LEN + 1];
+    SensorField_t fields[MAX_SENSOR_FIELDS];
+    char avPaths[MAX_SENSOR_FIELDS][LE_AVDATA_PATH_NAME_LEN + 1];
+    char members[MAX_SENSOR_FIELDS][MAX_CONFIG_NAME_BYTES];
 }
+ConfigSensor_t;
 
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Records a temperature reading into an avdata record and pushes it.
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
- */
-//--------------------------------------------------------------------------------------------------
-static le_result_t PushTemperature
-(
-    double timestamp,
-    double value
-)
+/// A sensor sample, as received from the Data Hub or read back from a sample queue.
+typedef struct
 {
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    double timestamp;
+    double number;          ///< Value of a numeric sample.
+    const char* string;     ///< Value of any other sample (JSON or packed vector).
+}
+Sample_t;
+
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+/// Token bucket used to pace uploads.
+typedef struct
+{
+    double rate;            ///< Tokens added per second (0 = unlimited).
+    double capacity;        ///< Most tokens the bucket can hold.
+    double tokens;          ///< Tokens in the bucket (negative when overdrawn by the last push).
+    double lastRefillTime;  ///< When tokens were last added (seconds since boot).
+}
+TokenBucket_t;
 
-    const char *path = "MangOH.Sensors.Pressure.Temperature";
 
-    le_result_t result = le_avdata_RecordFloat(rec, path, value, ms);
-    if (result != LE_OK)
+/// Tracks one record pushed to AirVantage and which sensors' samples it contains.
+typedef struct
+{
+    size_t byteCount;           ///< Estimated size of the samples in the record (bytes).
+    size_t memberCount;         ///< Number of sensors in the members array.
+    struct
     {
-        LE_ERROR("Couldn't record pressure sensor reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        Sensor_t* sensorPtr;    ///< Sensor whose samples are in the record.
+        Range_t* rangePtr;      ///< Range of that sensor's samples that are in the record.
     }
+    members[MAX_SENSORS];
+}
+Push_t;
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Thermometer);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
-    }
 
-done:
+/// A sample waiting in the handoff queue for the worker thread.
+typedef struct
+{
+    Sensor_t* sensorPtr;    ///< Sensor the sample belongs to.
+    double timestamp;
+    double number;          ///< Value of a numeric sample.
+    bool hasString;         ///< true if the sample's value is the string at stringStart.
+    uint32_t stringStart;   ///< Position of the string value in the string buffer.
+    uint32_t stringEnd;     ///< Position just past the string value (or stringStart if none).
+}
+HandoffEntry_t;
 
-    le_avdata_DeleteRecord(rec);
 
-    return result;
+/// Single-producer, single-consumer queue of samples, from the Data Hub push handlers on the main
+/// thread to the worker thread.  The positions count up forever (wrapping around at 2^32), and are
+/// taken modulo the size of their array.  Each is only written by one of the threads.
+typedef struct
+{
+    HandoffEntry_t entries[HANDOFF_QUEUE_COUNT];
+    char strings[HANDOFF_STRING_BYTES];
+    uint32_t head;          ///< Position of the next entry to fill (main thread).
+    uint32_t tail;          ///< Position of the next entry to handle (worker thread).
+    uint32_t stringHead;    ///< Position of the next string byte to fill (main thread).
+    uint32_t stringTail;    ///< Position of the oldest string byte still in use (worker thread).
+    bool isWakePending;     ///< true if the worker thread has been asked to drain the queue.
 }
+HandoffQueue_t;
 
 
 //--------------------------------------------------------------------------------------------------
-/**
- * Extract a numerical member from a JSON structure.
- *
- * @return The number, or NAN if failed (check using isnan()) .
+/*
+ * variable definitions
  */
 //--------------------------------------------------------------------------------------------------
-static double ExtractNumber
-(
-    const char* json,
-    const char* memberName
-)
-{
-    char member[32];
-    json_DataType_t dataType;
 
-    le_result_t result = json_Extract(member, sizeof(member), json, memberName, &dataType);
+/// True if the AirVantage session is active.  False if not.
+static bool IsAvSessionActive = false;
 
-    if (result != LE_OK)
-    {
-        LE_ERROR("'%s' not found in JSON value '%s'.", memberName, json);
-        return NAN;
-    }
+/// Timer used to publish the sensors' metrics every METRICS_PERIOD_MS.
+static le_timer_Ref_t MetricsTimer;
 
-    if (dataType != JSON_TYPE_NUMBER)
-    {
-        LE_ERROR("'%s' has wrong data type (%s) in JSON value '%s'.",
-                 memberName,
-                 json_GetDataTypeName(dataType),
-                 json);
-        return NAN;
-    }
+/// Upper limits (seconds) of all but the last bucket of the sample-to-ack latency histograms.
+static const double LatencyBucketLimits[LATENCY_BUCKET_COUNT - 1] =
+    { 1.0, 2.0, 5.0, 10.0, 30.0, 60.0, 300.0, 3600.0 };
 
-    double number = json_ConvertToNumber(member);
+/// Names of the metrics, as used in their AirVantage paths and Data Hub JSON members.
+static const char* const MetricNames[METRIC_COUNT] =
+{
+    [METRIC_RECEIVED] = "Received",
+    [METRIC_PUSHED] = "Pushed",
+    [METRIC_DROPPED] = "Dropped",
+    [METRIC_FAILED] = "Failed",
+    [METRIC_LATENCY_MEAN] = "LatencyMean",
+    [METRIC_LATENCY_HISTOGRAM] = "LatencyHistogram",
+    [METRIC_IDLE_TIME] = "IdleTime",
+    [METRIC_PUSHING_TIME] = "PushingTime",
+    [METRIC_BACKLOGGED_TIME] = "BackloggedTime",
+    [METRIC_FAULT_TIME] = "FaultTime",
+    [METRIC_BACKLOG_SECONDS] = "BacklogSeconds",
+    [METRIC_BACKLOG_FILL] = "BacklogFill",
+    [METRIC_PUSHES] = "Pushes",
+    [METRIC_PUSHES_PER_SAMPLE] = "PushesPerSample",
+    [METRIC_SAMPLE_RATE] = "SampleRate",
+    [METRIC_DELIVERY_RATE] = "DeliveryRate",
+    [METRIC_CPU_PER_SAMPLE] = "CpuPerSample",
+    [METRIC_HANDOFF_DROPPED] = "HandoffDropped",
+    [METRIC_HANDOFF_PEAK] = "HandoffPeak",
+};
 
-    if (isnan(number))
-    {
-        LE_CRIT("Unable to convert '%s' to a number! (member '%s' of '%s')",
-                member,
-                memberName,
-                json);
-    }
+/// Pool from which Push_t objects are allocated.
+static le_mem_PoolRef_t PushPool;
 
-    return number;
-}
+/// Record collecting samples during the current coalescing window (NULL if no window is open).
+static le_avdata_RecordRef_t CoalescedRecord = NULL;
 
+/// Push tracking object for the CoalescedRecord (NULL if no window is open).
+static Push_t* CoalescedPushPtr = NULL;
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Records an accelerometer reading into an avdata record and pushes it.
- *
- * The JSON value is expected to look like this:
- *
- * {"x":-1.094340, "y":0.085514, "z":9.778496}
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
- */
-//--------------------------------------------------------------------------------------------------
-static le_result_t PushAcceleration
-(
-    double timestamp,
-    const char* value   ///< JSON string.
-)
-{
-    double x = ExtractNumber(value, "x");
-    if (isnan(x))
-    {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
-    }
+/// Number of sensors whose fresh samples join the coalescing windows, i.e., those that aren't
+/// on-demand and whose observations have been connected to their inputs.  A window is pushed
+/// early once all of them have joined it.  See JoinCoalescedRecord().
+static size_t FreshSensorCount = 0;
 
-    double y = ExtractNumber(value, "y");
-    if (isnan(y))
-    {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
-    }
+/// Timer used to close the coalescing window.
+static le_timer_Ref_t CoalesceTimer;
 
-    double z = ExtractNumber(value, "z");
-    if (isnan(z))
-    {
-        LE_ERROR("Failed to decode accelerometer value.");
-        return LE_FAULT;
-    }
+/// Timer used to run the adaptive scheduler.  See AdaptSensorPeriods().
+static le_timer_Ref_t AdaptiveTimer;
 
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+/// Order in which the sensors are given the chance to push their backlogs.
+static const SensorPriority_t PriorityOrder[] = { SENSOR_PRIORITY_HIGH, SENSOR_PRIORITY_LOW };
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+/// The sensors in the Sensors array, in PriorityOrder.
+static Sensor_t* SensorsByPriority[MAX_SENSORS];
 
-    // The '_' is a placeholder that will be replaced
-    static char path[] = "MangOH.Sensors.Accelerometer.Acceleration._";
+/// true if all pushes are paused after too many failures (the "circuit breaker" is open).
+static bool IsPushPaused = false;
 
-    le_result_t result;
+/// Number of push failures in a row, across all sensors.
+static unsigned int ConsecutiveFailures = 0;
 
-    path[sizeof(path) - 2] = 'X';
-    result = le_avdata_RecordFloat(rec, path, x, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record accelerometer x reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Timer used to try pushing again if pushes have been paused for a long time.
+static le_timer_Ref_t BreakerTimer;
 
-    path[sizeof(path) - 2] = 'Y';
-    result = le_avdata_RecordFloat(rec, path, y, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record accelerometer y reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Timer used to stagger the sensors' pushes when pushes resume.
+static le_timer_Ref_t ResumeTimer;
 
-    path[sizeof(path) - 2] = 'Z';
-    result = le_avdata_RecordFloat(rec, path, z, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record accelerometer z reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Index in SensorsByPriority of the next sensor to be resumed.
+static size_t ResumeIndex = 0;
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Accelerometer);
-    if ((result != LE_OK) && (result != LE_BUSY))
-    {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
-    }
+/// Upload budgets, in bytes and in pushes.  See HasBudget().
+static TokenBucket_t ByteBudget;
+static TokenBucket_t PushBudget;
 
-done:
+/// Timer used to retry the pushes held back for lack of budget.
+static le_timer_Ref_t BudgetTimer;
 
-    le_avdata_DeleteRecord(rec);
+/// Block used to pack a batch of backlogged samples compactly.
+static columnCodec_Block_t CompactBlock;
 
-    return result;
-}
+/// Pool from which ConfigSensor_t objects are allocated.
+static le_mem_PoolRef_t ConfigSensorPool;
 
+/// The sensors being pushed to the cloud.  See LoadSensors().
+static Sensor_t Sensors[MAX_SENSORS];
 
-//--------------------------------------------------------------------------------------------------
-/**
- * Records an angular velocity (gyro) reading into an avdata record and pushes it.
- *
- * The JSON value is expected to look like this:
- *
- * {"x":-0.008520, "y":-0.006390, "z":-0.007455}
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
- */
-//--------------------------------------------------------------------------------------------------
-static le_result_t PushAngularVelocity
-(
-    double timestamp,
-    const char* value   ///< JSON string.
-)
-{
-    double x = ExtractNumber(value, "x");
-    if (isnan(x))
-    {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
-    }
+/// Number of entries in the Sensors array.
+static size_t SensorCount = 0;
 
-    double y = ExtractNumber(value, "y");
-    if (isnan(y))
+/// Storage for the AirVantage paths built at start-up, so none need building while pushing.
+static char PathArena[PATH_ARENA_BYTES];
+
+/// Number of bytes of the PathArena in use.
+static size_t PathArenaUsed = 0;
+
+/// Thread that runs the push pipeline, or NULL if it runs on the main thread.
+static le_thread_Ref_t WorkerThread = NULL;
+
+/// Main thread, which runs the Data Hub push handlers.
+static le_thread_Ref_t MainThread;
+
+/// Samples handed from the main thread to the worker thread.
+static HandoffQueue_t HandoffQueue;
+
+
+/// Fields of the accelerometer samples.
+static const SensorField_t AccelFields[] =
+{
+    { avPath: "MangOH.Sensors.Accelerometer.Acceleration.X", resolutionExp: ACCEL_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Accelerometer.Acceleration.Y", resolutionExp: ACCEL_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Accelerometer.Acceleration.Z", resolutionExp: ACCEL_RESOLUTION_EXP },
+};
+
+/// Fields of the gyroscope samples.
+static const SensorField_t GyroFields[] =
+{
+    { avPath: "MangOH.Sensors.Accelerometer.Gyro.X", resolutionExp: GYRO_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Accelerometer.Gyro.Y", resolutionExp: GYRO_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Accelerometer.Gyro.Z", resolutionExp: GYRO_RESOLUTION_EXP },
+};
+
+/// Fields of the light level samples.
+static const SensorField_t LightFields[] =
+{
+    { avPath: "MangOH.Sensors.Light.Level", isInt: true, resolutionExp: LIGHT_RESOLUTION_EXP },
+};
+
+/// Fields of the pressure samples.
+static const SensorField_t PressureFields[] =
+{
+    { avPath: "MangOH.Sensors.Pressure.Pressure", resolutionExp: PRESSURE_RESOLUTION_EXP },
+};
+
+/// Fields of the temperature samples.
+static const SensorField_t TempFields[] =
+{
+    { avPath: "MangOH.Sensors.Pressure.Temperature", resolutionExp: TEMP_RESOLUTION_EXP },
+};
+
+/// Fields of the position samples, which are JSON values that look like this:
+///
+/// { "lat": 49.172350, "lon": -123.070987, "hAcc": 14.000000, "alt": 0.009000, "vAcc": 8.000000 }
+///
+/// @note The latitude and longitude must stay first (see CHANGE_BY_DISTANCE).
+static const SensorField_t PosFields[] =
+{
+    { avPath: "lwm2m.6.0.0", member: "lat", resolutionExp: POS_RESOLUTION_EXP },
+    { avPath: "lwm2m.6.0.1", member: "lon", resolutionExp: POS_RESOLUTION_EXP },
+    { avPath: "lwm2m.6.0.3", member: "hAcc", resolutionExp: POS_ACCURACY_RESOLUTION_EXP },
+    { avPath: "lwm2m.6.0.2", member: "alt", resolutionExp: POS_ACCURACY_RESOLUTION_EXP },
+    {
+        avPath: "MangOH.Sensors.Gps.VerticalAccuracy",
+        member: "vAcc",
+        resolutionExp: POS_ACCURACY_RESOLUTION_EXP
+    },
+};
+
+/// Orientation fields (from the fusion component, which isn't polled, so has no period).
+static const SensorField_t OrientFields[] =
+{
+    { avPath: "MangOH.Sensors.Orientation.Qw", member: "qw",
+      resolutionExp: ORIENT_QUATERNION_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Qx", member: "qx",
+      resolutionExp: ORIENT_QUATERNION_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Qy", member: "qy",
+      resolutionExp: ORIENT_QUATERNION_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Qz", member: "qz",
+      resolutionExp: ORIENT_QUATERNION_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Roll", member: "roll",
+      resolutionExp: ORIENT_ANGLE_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Pitch", member: "pitch",
+      resolutionExp: ORIENT_ANGLE_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Orientation.Yaw", member: "yaw",
+      resolutionExp: ORIENT_ANGLE_RESOLUTION_EXP },
+};
+
+/// Fields of the shock alarms, which are JSON values that look like this:
+///
+/// { "value": 25.1, "start": 1546300798.0, "end": 1546300803.0, "frames": 1000 }
+static const SensorField_t ShockAlarmFields[] =
+{
+    { avPath: "MangOH.Sensors.Event.Shock.Value", member: "value",
+      resolutionExp: ACCEL_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Shock.Start", member: "start",
+      resolutionExp: EVENT_TIME_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Shock.End", member: "end",
+      resolutionExp: EVENT_TIME_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Shock.Frames", member: "frames", isInt: true },
+};
+
+/// Fields of the spin alarms (like the shock alarms).
+static const SensorField_t SpinAlarmFields[] =
+{
+    { avPath: "MangOH.Sensors.Event.Spin.Value", member: "value",
+      resolutionExp: GYRO_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Spin.Start", member: "start",
+      resolutionExp: EVENT_TIME_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Spin.End", member: "end",
+      resolutionExp: EVENT_TIME_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Event.Spin.Frames", member: "frames", isInt: true },
+};
+
+/// Fields of the vibration features, which are JSON values that look like this:
+///
+/// { "rms": 0.35, "crest": 3.2, "peakHz": 49.8 }
+static const SensorField_t VibFields[] =
+{
+    { avPath: "MangOH.Sensors.Vibration.Rms", member: "rms",
+      resolutionExp: VIB_RMS_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Crest", member: "crest",
+      resolutionExp: VIB_CREST_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.PeakFrequency", member: "peakHz",
+      resolutionExp: VIB_FREQUENCY_RESOLUTION_EXP },
+};
+
+/// Fields of the vibration band energies (one per band, lowest frequency first).
+static const SensorField_t VibBandFields[] =
+{
+    { avPath: "MangOH.Sensors.Vibration.Band.0", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.1", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.2", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.3", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.4", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.5", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.6", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+    { avPath: "MangOH.Sensors.Vibration.Band.7", resolutionExp: VIB_ENERGY_RESOLUTION_EXP },
+};
+
+/// Sensors that are pushed to the cloud unless disabled in the config tree.  See LoadSensors().
+static const SensorDesc_t BuiltInSensors[] =
+{
+    {
+        name: "accel",
+        obsPath: ACCEL_OBS_PATH,
+        inputPath: ACCEL_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_VECTOR,
+        fields: AccelFields,
+        fieldCount: NUM_ARRAY_MEMBERS(AccelFields),
+        period: ACCEL_PERIOD,
+        maxPeriod: ACCEL_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: ACCEL_BUFFER_COUNT,
+        changeBy: ACCEL_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: ACCEL_BATCH_COUNT,
+        pushWindow: ACCEL_PUSH_WINDOW,
+        isOnDemand: true,
+        isRawKept: true,
+        compactAvPath: "MangOH.Sensors.Backlog.Acceleration",
+    },
+    {
+        name: "gyro",
+        obsPath: GYRO_OBS_PATH,
+        inputPath: GYRO_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_VECTOR,
+        fields: GyroFields,
+        fieldCount: NUM_ARRAY_MEMBERS(GyroFields),
+        period: GYRO_PERIOD,
+        maxPeriod: GYRO_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: GYRO_BUFFER_COUNT,
+        changeBy: GYRO_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: GYRO_BATCH_COUNT,
+        pushWindow: GYRO_PUSH_WINDOW,
+        isOnDemand: true,
+        isRawKept: true,
+        compactAvPath: "MangOH.Sensors.Backlog.Gyro",
+    },
+    {
+        name: "light",
+        obsPath: LIGHT_OBS_PATH,
+        inputPath: LIGHT_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_NUMERIC,
+        fields: LightFields,
+        fieldCount: NUM_ARRAY_MEMBERS(LightFields),
+        period: LIGHT_PERIOD,
+        maxPeriod: LIGHT_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_LOW,
+        bufferCount: LIGHT_BUFFER_COUNT,
+        changeBy: LIGHT_CHANGE_BY,
+        batchCount: LIGHT_BATCH_COUNT,
+        pushWindow: LIGHT_PUSH_WINDOW,
+        isOnDemand: true,
+        isRawKept: true,
+        compactAvPath: "MangOH.Sensors.Backlog.Light",
+    },
+    {
+        name: "pressure",
+        obsPath: PRESSURE_OBS_PATH,
+        inputPath: PRESSURE_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_NUMERIC,
+        fields: PressureFields,
+        fieldCount: NUM_ARRAY_MEMBERS(PressureFields),
+        period: PRESSURE_PERIOD,
+        maxPeriod: PRESSURE_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_LOW,
+        bufferCount: PRESSURE_BUFFER_COUNT,
+        changeBy: PRESSURE_CHANGE_BY,
+        batchCount: PRESSURE_BATCH_COUNT,
+        pushWindow: PRESSURE_PUSH_WINDOW,
+        isOnDemand: true,
+        isRawKept: true,
+        compactAvPath: "MangOH.Sensors.Backlog.Pressure",
+    },
+    {
+        name: "temperature",
+        obsPath: TEMP_OBS_PATH,
+        inputPath: TEMP_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_NUMERIC,
+        fields: TempFields,
+        fieldCount: NUM_ARRAY_MEMBERS(TempFields),
+        period: TEMP_PERIOD,
+        maxPeriod: TEMP_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_LOW,
+        bufferCount: TEMP_BUFFER_COUNT,
+        changeBy: TEMP_CHANGE_BY,
+        batchCount: TEMP_BATCH_COUNT,
+        pushWindow: TEMP_PUSH_WINDOW,
+        isOnDemand: true,
+        isRawKept: true,
+        compactAvPath: "MangOH.Sensors.Backlog.Temperature",
+    },
+    {
+        name: "position",
+        obsPath: POS_OBS_PATH,
+        inputPath: POS_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_JSON,
+        fields: PosFields,
+        fieldCount: NUM_ARRAY_MEMBERS(PosFields),
+        period: POS_PERIOD,
+        maxPeriod: POS_MAX_PERIOD,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: POS_BUFFER_COUNT,
+        changeBy: POS_CHANGE_BY,
+        changeByMetric: CHANGE_BY_DISTANCE,
+        batchCount: POS_BATCH_COUNT,
+        pushWindow: POS_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Backlog.Position",
+    },
+    {
+        name: "orientation",
+        obsPath: ORIENT_OBS_PATH,
+        inputPath: ORIENT_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_JSON,
+        fields: OrientFields,
+        fieldCount: NUM_ARRAY_MEMBERS(OrientFields),
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: ORIENT_BUFFER_COUNT,
+        changeBy: ORIENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: ORIENT_BATCH_COUNT,
+        pushWindow: ORIENT_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Backlog.Orientation",
+    },
+    {
+        name: "vibration",
+        obsPath: VIB_OBS_PATH,
+        inputPath: VIB_SENSOR_INPUT_PATH,
+        type: SAMPLE_TYPE_JSON,
+        fields: VibFields,
+        fieldCount: NUM_ARRAY_MEMBERS(VibFields),
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: VIB_BUFFER_COUNT,
+        changeBy: VIB_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: VIB_BATCH_COUNT,
+        pushWindow: VIB_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Backlog.Vibration",
+    },
+    {
+        name: "vibrationBands",
+        obsPath: VIB_BANDS_OBS_PATH,
+        inputPath: VIB_BANDS_INPUT_PATH,
+        type: SAMPLE_TYPE_VECTOR,
+        fields: VibBandFields,
+        fieldCount: NUM_ARRAY_MEMBERS(VibBandFields),
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: VIB_BUFFER_COUNT,
+        changeBy: VIB_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: VIB_BATCH_COUNT,
+        pushWindow: VIB_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Backlog.VibrationBands",
+    },
+    {
+        name: "shockAlarm",
+        obsPath: SHOCK_ALARM_OBS_PATH,
+        inputPath: SHOCK_ALARM_INPUT_PATH,
+        type: SAMPLE_TYPE_JSON,
+        fields: ShockAlarmFields,
+        fieldCount: NUM_ARRAY_MEMBERS(ShockAlarmFields),
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: EVENT_BUFFER_COUNT,
+        changeBy: EVENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: EVENT_BATCH_COUNT,
+        pushWindow: EVENT_PUSH_WINDOW,
+        isOnDemand: false,
+    },
+    {
+        name: "spinAlarm",
+        obsPath: SPIN_ALARM_OBS_PATH,
+        inputPath: SPIN_ALARM_INPUT_PATH,
+        type: SAMPLE_TYPE_JSON,
+        fields: SpinAlarmFields,
+        fieldCount: NUM_ARRAY_MEMBERS(SpinAlarmFields),
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: EVENT_BUFFER_COUNT,
+        changeBy: EVENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: EVENT_BATCH_COUNT,
+        pushWindow: EVENT_PUSH_WINDOW,
+        isOnDemand: false,
+    },
+    {
+        name: "accelEvent",
+        obsPath: ACCEL_EVENT_OBS_PATH,
+        inputPath: ACCEL_EVENT_INPUT_PATH,
+        type: SAMPLE_TYPE_BLOCK,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: EVENT_BUFFER_COUNT,
+        changeBy: EVENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: EVENT_BLOCK_BATCH_COUNT,
+        pushWindow: EVENT_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Event.Acceleration",
+    },
+    {
+        name: "gyroEvent",
+        obsPath: GYRO_EVENT_OBS_PATH,
+        inputPath: GYRO_EVENT_INPUT_PATH,
+        type: SAMPLE_TYPE_BLOCK,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: EVENT_BUFFER_COUNT,
+        changeBy: EVENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: EVENT_BLOCK_BATCH_COUNT,
+        pushWindow: EVENT_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Event.Gyro",
+    },
+    {
+        name: "pressureEvent",
+        obsPath: PRESSURE_EVENT_OBS_PATH,
+        inputPath: PRESSURE_EVENT_INPUT_PATH,
+        type: SAMPLE_TYPE_BLOCK,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: EVENT_BUFFER_COUNT,
+        changeBy: EVENT_CHANGE_BY,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: EVENT_BLOCK_BATCH_COUNT,
+        pushWindow: EVENT_PUSH_WINDOW,
+        isOnDemand: false,
+        compactAvPath: "MangOH.Sensors.Event.Pressure",
+    },
+    {
+        name: "accelSummary",
+        obsPath: ACCEL_SUMMARY_OBS_PATH,
+        inputPath: ACCEL_SUMMARY_INPUT_PATH,
+        type: SAMPLE_TYPE_SUMMARY,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: SUMMARY_BUFFER_COUNT,
+        batchCount: SUMMARY_BATCH_COUNT,
+        pushWindow: SUMMARY_PUSH_WINDOW,
+        isOnDemand: false,
+        summaryAvPath: "MangOH.Sensors.Summary.Acceleration",
+        summaryAxisCount: 3,
+    },
+    {
+        name: "gyroSummary",
+        obsPath: GYRO_SUMMARY_OBS_PATH,
+        inputPath: GYRO_SUMMARY_INPUT_PATH,
+        type: SAMPLE_TYPE_SUMMARY,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: SUMMARY_BUFFER_COUNT,
+        batchCount: SUMMARY_BATCH_COUNT,
+        pushWindow: SUMMARY_PUSH_WINDOW,
+        isOnDemand: false,
+        summaryAvPath: "MangOH.Sensors.Summary.Gyro",
+        summaryAxisCount: 3,
+    },
+    {
+        name: "lightSummary",
+        obsPath: LIGHT_SUMMARY_OBS_PATH,
+        inputPath: LIGHT_SUMMARY_INPUT_PATH,
+        type: SAMPLE_TYPE_SUMMARY,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: SUMMARY_BUFFER_COUNT,
+        batchCount: SUMMARY_BATCH_COUNT,
+        pushWindow: SUMMARY_PUSH_WINDOW,
+        isOnDemand: false,
+        summaryAvPath: "MangOH.Sensors.Summary.Light",
+        summaryAxisCount: 1,
+    },
+    {
+        name: "pressureSummary",
+        obsPath: PRESSURE_SUMMARY_OBS_PATH,
+        inputPath: PRESSURE_SUMMARY_INPUT_PATH,
+        type: SAMPLE_TYPE_SUMMARY,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: SUMMARY_BUFFER_COUNT,
+        batchCount: SUMMARY_BATCH_COUNT,
+        pushWindow: SUMMARY_PUSH_WINDOW,
+        isOnDemand: false,
+        summaryAvPath: "MangOH.Sensors.Summary.Pressure",
+        summaryAxisCount: 1,
+    },
+    {
+        name: "temperatureSummary",
+        obsPath: TEMP_SUMMARY_OBS_PATH,
+        inputPath: TEMP_SUMMARY_INPUT_PATH,
+        type: SAMPLE_TYPE_SUMMARY,
+        priority: SENSOR_PRIORITY_HIGH,
+        bufferCount: SUMMARY_BUFFER_COUNT,
+        batchCount: SUMMARY_BATCH_COUNT,
+        pushWindow: SUMMARY_PUSH_WINDOW,
+        isOnDemand: false,
+        summaryAvPath: "MangOH.Sensors.Summary.Temperature",
+        summaryAxisCount: 1,
+    },
+};
+
+#if MAX_SENSORS < 18
+#error "MAX_SENSORS too small for the built-in sensors."
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * static function definitions
+ */
+//--------------------------------------------------------------------------------------------------
+
+
+static void ServiceSensor(Sensor_t* sensorPtr);
+static void SetUpSensor(Sensor_t* sensorPtr);
+static void ResumeSensors(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time since boot, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetUptime
+(
+    void
+)
+{
+    le_clk_Time_t now = le_clk_GetRelativeTime();
+
+    return (double)now.sec + ((double)now.usec / 1000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the CPU time used by the calling thread, in seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetCpuTime
+(
+    void
+)
+{
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+    {
+        return 0.0;
+    }
+
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add the time a sensor has spent in its current state, since it was last accounted for, to that
+ * state's total.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AccountStateTime
+(
+    Sensor_t* sensorPtr
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+    double now = GetUptime();
+
+    metricsPtr->stateTimes[sensorPtr->state] += now - metricsPtr->stateSince;
+    metricsPtr->stateSince = now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Change the state of a sensor's push pipeline, keeping track of the time spent in each state.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSensorState
+(
+    Sensor_t* sensorPtr,
+    SensorState_t state
+)
+{
+    if (state != sensorPtr->state)
+    {
+        AccountStateTime(sensorPtr);
+        sensorPtr->state = state;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a sample received from the Data Hub, and update the average interval between samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountReceivedSample
+(
+    Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+
+    metricsPtr->receivedCount++;
+
+    double interval = timestamp - metricsPtr->lastReceivedTimestamp;
+
+    if ((metricsPtr->lastReceivedTimestamp > 0.0) && (interval > 0.0))
+    {
+        if (metricsPtr->sampleInterval == 0.0)
+        {
+            metricsPtr->sampleInterval = interval;
+        }
+        else
+        {
+            metricsPtr->sampleInterval += (interval - metricsPtr->sampleInterval)
+                                        * METRICS_INTERVAL_WEIGHT;
+        }
+    }
+
+    if (timestamp > metricsPtr->lastReceivedTimestamp)
+    {
+        metricsPtr->lastReceivedTimestamp = timestamp;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a sample discarded as unchanged or malformed.  A sample may be come across more than once
+ * (e.g., when it arrives and again when the backlog is drained), but is only counted once.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountDroppedSample
+(
+    Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+
+    if (timestamp > metricsPtr->lastDroppedTimestamp)
+    {
+        metricsPtr->droppedCount++;
+        metricsPtr->lastDroppedTimestamp = timestamp;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count the samples in an in-flight range that has just been delivered, and add the range's
+ * sample-to-ack latency (the age of its newest sample) to the sensor's latency histogram.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountDeliveredRange
+(
+    Sensor_t* sensorPtr,
+    const Range_t* rangePtr
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+
+    if (rangePtr->sampleCount == 0)
+    {
+        return;
+    }
+
+    metricsPtr->pushedCount += rangePtr->sampleCount;
+
+    le_clk_Time_t now = le_clk_GetAbsoluteTime();
+    double latency = (double)now.sec + ((double)now.usec / 1000000.0) - rangePtr->newest;
+
+    // The clock may have been stepped since the sample was taken.
+    if (latency < 0.0)
+    {
+        latency = 0.0;
+    }
+
+    size_t bucket = 0;
+
+    while ((bucket < NUM_ARRAY_MEMBERS(LatencyBucketLimits))
+           && (latency > LatencyBucketLimits[bucket]))
+    {
+        bucket++;
+    }
+
+    metricsPtr->latencyCounts[bucket]++;
+    metricsPtr->latencySum += latency;
+    metricsPtr->latencyCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get one of a sensor's in-flight ranges.
+ *
+ * @return Pointer to the range, index 0 being the oldest.
+ */
+//--------------------------------------------------------------------------------------------------
+static Range_t* GetRange
+(
+    Sensor_t* sensorPtr,
+    size_t index
+)
+{
+    LE_ASSERT(index < sensorPtr->inFlightCount);
+
+    return &sensorPtr->inFlight[(sensorPtr->inFlightHead + index) % MAX_PUSH_WINDOW];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance a sensor's sentTimestamp to the newest sample handed to the AirVantage Agent, and keep
+ * the change-by reference that goes with it, for the range that will follow.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NoteSent
+(
+    Sensor_t* sensorPtr,
+    double newest
+)
+{
+    sensorPtr->sentTimestamp = newest;
+    memcpy(sensorPtr->sentValues, sensorPtr->lastPushedValues, sizeof(sensorPtr->sentValues));
+    sensorPtr->hasSentValues = sensorPtr->hasLastPushedValues;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start tracking a new in-flight range of samples, newer than all the sensor's other ranges.
+ * The sensor's sentTimestamp is moved up to the newest sample in the range.
+ *
+ * @return Pointer to the new range.
+ */
+//--------------------------------------------------------------------------------------------------
+static Range_t* AddRange
+(
+    Sensor_t* sensorPtr,
+    double newest   ///< Timestamp of the newest sample in the range.
+)
+{
+    LE_ASSERT(sensorPtr->inFlightCount < MAX_PUSH_WINDOW);
+
+    sensorPtr->inFlightCount++;
+
+    Range_t* rangePtr = GetRange(sensorPtr, sensorPtr->inFlightCount - 1);
+    rangePtr->startAfter = sensorPtr->sentTimestamp;
+    rangePtr->newest = newest;
+    rangePtr->sampleCount = 0;
+    rangePtr->state = RANGE_STATE_SENDING;
+    memcpy(rangePtr->referenceValues, sensorPtr->sentValues, sizeof(rangePtr->referenceValues));
+    rangePtr->hasReference = sensorPtr->hasSentValues;
+    rangePtr->isPartial = false;
+
+    NoteSent(sensorPtr, newest);
+
+    return rangePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mark an in-flight range of samples delivered.  Advances the sensor's lastDeliveredTimestamp
+ * over every range that has been delivered with no older range still outstanding, and moves the
+ * delivered cursor of the sensor's queue up to match.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AckRange
+(
+    Sensor_t* sensorPtr,
+    Range_t* rangePtr
+)
+{
+    rangePtr->state = RANGE_STATE_DELIVERED;
+
+    double oldDelivered = sensorPtr->lastDeliveredTimestamp;
+
+    while (   (sensorPtr->inFlightCount > 0)
+           && (GetRange(sensorPtr, 0)->state == RANGE_STATE_DELIVERED))
+    {
+        sensorPtr->lastDeliveredTimestamp = GetRange(sensorPtr, 0)->newest;
+
+        sensorPtr->inFlightHead = (sensorPtr->inFlightHead + 1) % MAX_PUSH_WINDOW;
+        sensorPtr->inFlightCount--;
+    }
+
+    if (sensorPtr->lastDeliveredTimestamp != oldDelivered)
+    {
+        sampleQueue_SetDelivered(sensorPtr->queueRef, sensorPtr->lastDeliveredTimestamp);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pause all pushes (open the "circuit breaker"), after so many failures in a row that the link is
+ * probably down.  They resume when the AirVantage session (re)starts, or after BREAKER_PROBE_MS.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PausePushes
+(
+    void
+)
+{
+    LE_WARN("%u pushes failed in a row.  Pausing pushes until the session restarts.",
+            ConsecutiveFailures);
+
+    IsPushPaused = true;
+
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        le_timer_Stop(Sensors[i].retryTimer);
+    }
+
+    le_timer_Stop(ResumeTimer);
+    le_timer_Start(BreakerTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resume pushes (close the "circuit breaker"), if they are paused.  The sensors that have samples
+ * waiting are started again one at a time.  See ResumeSensors().
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResumePushes
+(
+    void
+)
+{
+    if (IsPushPaused)
+    {
+        LE_INFO("Resuming pushes.");
+
+        IsPushPaused = false;
+        le_timer_Stop(BreakerTimer);
+    }
+
+    ConsecutiveFailures = 0;
+
+    ResumeSensors();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler called when pushes have been paused for BREAKER_PROBE_MS without the session
+ * restarting.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BreakerTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    ResumePushes();
+
+    // One more failure is enough to pause again.
+    ConsecutiveFailures = BREAKER_FAILURE_COUNT - 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Work out how long to wait before retrying something that has failed a number of times in a row:
+ * the base wait, doubled with each failure after the first up to a maximum, and cut by a random
+ * amount of up to half, so that the sensors don't all retry together.
+ *
+ * @return The wait (ms).
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GetRetryWaitMs
+(
+    unsigned int failureCount,  ///< Number of failures in a row (at least 1).
+    uint32_t baseMs,
+    uint32_t maxMs
+)
+{
+    // Note: the shift is capped so it can't overflow; the wait is capped at maxMs anyway.
+    unsigned int doublings = failureCount - 1;
+    uint64_t backoffMs = (uint64_t)baseMs << ((doublings < 16) ? doublings : 16);
+
+    if (backoffMs > maxMs)
+    {
+        backoffMs = maxMs;
+    }
+
+    return le_rand_GetNumBetween((uint32_t)(backoffMs / 2), (uint32_t)backoffMs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a failed push, however many sensors had samples in it.  Pauses all pushes if there have
+ * been too many failures in a row.  Called once per push, before NotePushFailure() is called for
+ * each of its members.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CountFailedPush
+(
+    void
+)
+{
+    ConsecutiveFailures++;
+
+    if (!IsPushPaused && (ConsecutiveFailures >= BREAKER_FAILURE_COUNT))
+    {
+        PausePushes();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Schedule a retry of a sensor's pushes after an exponentially growing, randomized wait, based on
+ * how many times in a row they have failed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScheduleRetry
+(
+    Sensor_t* sensorPtr
+)
+{
+    if (IsPushPaused)
+    {
+        // Everything will be retried when pushes resume.
+        return;
+    }
+
+    uint32_t waitMs = GetRetryWaitMs(sensorPtr->failureCount, RETRY_BASE_MS, RETRY_MAX_MS);
+
+    LE_INFO("Retrying push of '%s' in %u ms.", sensorPtr->desc.obsPath, (unsigned int)waitMs);
+
+    le_timer_Stop(sensorPtr->retryTimer);
+    le_timer_SetMsInterval(sensorPtr->retryTimer, waitMs);
+    le_timer_Start(sensorPtr->retryTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a failed push of a sensor's samples, and schedule a retry.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NotePushFailure
+(
+    Sensor_t* sensorPtr
+)
+{
+    sensorPtr->failureCount++;
+    sensorPtr->metrics.failedCount++;
+
+    ScheduleRetry(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a failure to get a sensor's samples into a push (e.g., a record that couldn't be built),
+ * and schedule a retry, as for a failed push.  Does nothing if a retry is already due, e.g.,
+ * because the push itself was refused and has been counted already.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NoteStall
+(
+    Sensor_t* sensorPtr
+)
+{
+    if (IsPushPaused || le_timer_IsRunning(sensorPtr->retryTimer))
+    {
+        return;
+    }
+
+    sensorPtr->failureCount++;
+
+    ScheduleRetry(sensorPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler called when it's time to retry a sensor's failed pushes.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RetryTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    ServiceSensor(le_timer_GetContextPtr(timerRef));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handles notification of AirVantage time-series push status.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleAvPushComplete
+(
+    le_avdata_PushStatus_t status, ///< Push success/failure status
+    void* context                  ///< Pointer to the Push_t object for the record pushed.
+)
+{
+    Push_t* pushPtr = context;
+    double cpuStart = GetCpuTime();
+
+    if ((status != LE_AVDATA_PUSH_SUCCESS) && (status != LE_AVDATA_PUSH_FAILED))
+    {
+        LE_FATAL("Unexpected push result status %d.", status);
+    }
+
+    if (status == LE_AVDATA_PUSH_SUCCESS)
+    {
+        ConsecutiveFailures = 0;
+    }
+    else
+    {
+        CountFailedPush();
+    }
+
+    // Acknowledge (or retry) delivery for every sensor that had samples in the record.
+    for (size_t i = 0; i < pushPtr->memberCount; i++)
+    {
+        Sensor_t* sensorPtr = pushPtr->members[i].sensorPtr;
+        Range_t* rangePtr = pushPtr->members[i].rangePtr;
+
+        if (status == LE_AVDATA_PUSH_SUCCESS)
+        {
+            sensorPtr->failureCount = 0;
+
+            CountDeliveredRange(sensorPtr, rangePtr);
+
+            if (rangePtr->isPartial)
+            {
+                // Only part of the range was resent.  The rest goes in the next record.
+                rangePtr->isPartial = false;
+                rangePtr->startAfter = rangePtr->partNewest;
+                memcpy(rangePtr->referenceValues,
+                       rangePtr->partValues,
+                       sizeof(rangePtr->referenceValues));
+                rangePtr->hasReference = rangePtr->hasPartValues;
+                rangePtr->state = RANGE_STATE_FAILED;
+            }
+            else
+            {
+                AckRange(sensorPtr, rangePtr);
+            }
+
+            // If there's more data to push (or resend), push it now.
+            ServiceSensor(sensorPtr);
+        }
+        else
+        {
+            LE_WARN("Push to AirVantage failed (%s).", sensorPtr->desc.obsPath);
+
+            // Try this range again, after a wait.
+            rangePtr->state = RANGE_STATE_FAILED;
+            NotePushFailure(sensorPtr);
+        }
+    }
+
+    // Share the CPU time among the sensors in the record.
+    double cpuShare = (GetCpuTime() - cpuStart) / pushPtr->memberCount;
+
+    for (size_t i = 0; i < pushPtr->memberCount; i++)
+    {
+        pushPtr->members[i].sensorPtr->metrics.cpuTime += cpuShare;
+    }
+
+    le_mem_Release(pushPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip over whitespace in a JSON document.
+ *
+ * @return Pointer to the first non-whitespace character.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* SkipJsonWhitespace
+(
+    const char* cursor
+)
+{
+    while ((*cursor == ' ') || (*cursor == '\t') || (*cursor == '\n') || (*cursor == '\r'))
+    {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip over a JSON string, starting at its opening quote.
+ *
+ * @return Pointer to the character following the closing quote, or NULL if unterminated.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* SkipJsonString
+(
+    const char* cursor
+)
+{
+    cursor++;   // Opening quote.
+
+    while (*cursor != '"')
+    {
+        if (*cursor == '\0')
+        {
+            return NULL;
+        }
+
+        if ((*cursor == '\\') && (cursor[1] != '\0'))
+        {
+            cursor++;
+        }
+
+        cursor++;
+    }
+
+    return cursor + 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Skip over a JSON value (of any type), starting at its first character.
+ *
+ * @return Pointer to the character following the value, or NULL if malformed.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* SkipJsonValue
+(
+    const char* cursor,
+    json_DataType_t* typePtr    ///< [OUT] Type of the value.
+)
+{
+    switch (*cursor)
+    {
+        case '"':
+
+            *typePtr = JSON_TYPE_STRING;
+            return SkipJsonString(cursor);
+
+        case '{':
+        case '[':
+        {
+            *typePtr = (*cursor == '{') ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY;
+
+            // Skip to the matching close bracket, ignoring any brackets inside strings.
+            unsigned int depth = 0;
+
+            do
+            {
+                if (*cursor == '"')
+                {
+                    cursor = SkipJsonString(cursor);
+                    if (cursor == NULL)
+                    {
+                        return NULL;
+                    }
+                    continue;
+                }
+
+                if ((*cursor == '{') || (*cursor == '['))
+                {
+                    depth++;
+                }
+                else if ((*cursor == '}') || (*cursor == ']'))
+                {
+                    depth--;
+                }
+                else if (*cursor == '\0')
+                {
+                    return NULL;
+                }
+
+                cursor++;
+            }
+            while (depth > 0);
+
+            return cursor;
+        }
+
+        case 't':
+        case 'f':
+
+            *typePtr = JSON_TYPE_BOOLEAN;
+            break;
+
+        case 'n':
+
+            *typePtr = JSON_TYPE_NULL;
+            break;
+
+        default:
+
+            *typePtr = JSON_TYPE_NUMBER;
+            break;
+    }
+
+    // Literals and numbers run until the next delimiter.
+    const char* startPtr = cursor;
+
+    while (   (*cursor != '\0') && (*cursor != ',') && (*cursor != '}') && (*cursor != ']')
+           && (*cursor != ' ') && (*cursor != '\t') && (*cursor != '\n') && (*cursor != '\r'))
+    {
+        cursor++;
+    }
+
+    return (cursor == startPtr) ? NULL : cursor;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract several numerical members from a JSON object in a single pass over the document.
+ *
+ * Members that are not found, have the wrong data type or can't be converted are logged and
+ * set to NAN.
+ *
+ * @return
+ *      - LE_OK if all the members were extracted.
+ *      - LE_FORMAT_ERROR if any member is NAN (check using isnan()).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ExtractNumbers
+(
+    const char* json,
+    const char* const memberNames[],    ///< Names of the members to extract.
+    double values[],                    ///< [OUT] Values of the members, in the same order.
+    size_t count                        ///< Number of members to extract.
+)
+{
+    LE_ASSERT(count <= 32);
+
+    uint32_t foundMask = 0; // Bit i set if memberNames[i] was found (even if it couldn't be used).
+
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = NAN;
+    }
+
+    const char* cursor = SkipJsonWhitespace(json);
+
+    if (*cursor == '{')
+    {
+        cursor = SkipJsonWhitespace(cursor + 1);
+
+        while (*cursor == '"')
+        {
+            // Member name.
+            const char* namePtr = cursor + 1;
+            cursor = SkipJsonString(cursor);
+            if (cursor == NULL)
+            {
+                break;
+            }
+            size_t nameLen = (cursor - 1) - namePtr;
+
+            cursor = SkipJsonWhitespace(cursor);
+            if (*cursor != ':')
+            {
+                break;
+            }
+            cursor = SkipJsonWhitespace(cursor + 1);
+
+            // Member value.
+            const char* valuePtr = cursor;
+            json_DataType_t dataType;
+            cursor = SkipJsonValue(cursor, &dataType);
+            if (cursor == NULL)
+            {
+                break;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (   (strncmp(memberNames[i], namePtr, nameLen) != 0)
+                    || (memberNames[i][nameLen] != '\0'))
+                {
+                    continue;
+                }
+
+                foundMask |= (1u << i);
+
+                if (dataType != JSON_TYPE_NUMBER)
+                {
+                    LE_ERROR("'%s' has wrong data type (%s) in JSON value '%s'.",
+                             memberNames[i],
+                             json_GetDataTypeName(dataType),
+                             json);
+                    break;
+                }
+
+                char member[32];
+                size_t valueLen = cursor - valuePtr;
+                char* endPtr = NULL;
+
+                if (valueLen < sizeof(member))
+                {
+                    memcpy(member, valuePtr, valueLen);
+                    member[valueLen] = '\0';
+
+                    values[i] = strtod(member, &endPtr);
+                }
+
+                if ((endPtr == NULL) || (*endPtr != '\0'))
+                {
+                    LE_CRIT("Unable to convert '%.*s' to a number! (member '%s' of '%s')",
+                            (int)valueLen,
+                            valuePtr,
+                            memberNames[i],
+                            json);
+                    values[i] = NAN;
+                }
+                break;
+            }
+
+            cursor = SkipJsonWhitespace(cursor);
+            if (*cursor != ',')
+            {
+                break;
+            }
+            cursor = SkipJsonWhitespace(cursor + 1);
+        }
+    }
+
+    le_result_t result = LE_OK;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((foundMask & (1u << i)) == 0)
+        {
+            LE_ERROR("'%s' not found in JSON value '%s'.", memberNames[i], json);
+        }
+
+        if (isnan(values[i]))
+        {
+            result = LE_FORMAT_ERROR;
+        }
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode the fields of a (non-summary) sensor sample.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the value could not be decoded
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DecodeSample
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr,
+    double* values          ///< [OUT] Array of the sensor's fieldCount numbers.
+)
+{
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+    le_result_t result = LE_OK;
+
+    switch (descPtr->type)
+    {
+        case SAMPLE_TYPE_NUMERIC:
+
+            values[0] = samplePtr->number;
+            break;
+
+        case SAMPLE_TYPE_VECTOR:
+
+            result = packedVector_Decode(samplePtr->string, values, descPtr->fieldCount);
+            break;
+
+        case SAMPLE_TYPE_JSON:
+        {
+            const char* memberNames[MAX_SENSOR_FIELDS];
+
+            for (size_t i = 0; i < descPtr->fieldCount; i++)
+            {
+                memberNames[i] = descPtr->fields[i].member;
+            }
+
+            result = ExtractNumbers(samplePtr->string, memberNames, values, descPtr->fieldCount);
+            break;
+        }
+
+        case SAMPLE_TYPE_SUMMARY:
+        case SAMPLE_TYPE_BLOCK:
+
+            LE_FATAL("Samples of '%s' have no fields.", descPtr->obsPath);
+    }
+
+    return (result == LE_OK) ? LE_OK : LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records the fields of a sensor sample into a given avdata record, each under its own path.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the record is full
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordFields
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    double timestamp,
+    const double* values    ///< Array of the sensor's fieldCount numbers.
+)
+{
+    uint64_t ms = columnCodec_TimestampToMs(timestamp);
+
+    for (size_t i = 0; i < sensorPtr->desc.fieldCount; i++)
+    {
+        const SensorField_t* fieldPtr = &sensorPtr->desc.fields[i];
+        le_result_t result;
+
+        if (fieldPtr->isInt)
+        {
+            result = le_avdata_RecordInt(rec, fieldPtr->avPath, (int32_t)values[i], ms);
+        }
+        else
+        {
+            result = le_avdata_RecordFloat(rec, fieldPtr->avPath, values[i], ms);
+        }
+
+        if (result != LE_OK)
+        {
+            LE_ERROR("Couldn't record '%s' reading - %s", fieldPtr->avPath, LE_RESULT_TXT(result));
+            return result;
+        }
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute how far a sample's fields are from those of a reference sample (e.g., the last sample
+ * pushed).
+ *
+ * @return The Euclidean norm of the difference, or for the CHANGE_BY_DISTANCE metric, the distance
+ *         in metres (using an equirectangular approximation, which is plenty accurate over these
+ *         distances).
+ */
+//--------------------------------------------------------------------------------------------------
+static double ChangeByDistance
+(
+    Sensor_t* sensorPtr,
+    const double* values,
+    const double* referencePtr  ///< Fields of the reference sample.
+)
+{
+    if (sensorPtr->desc.changeByMetric == CHANGE_BY_DISTANCE)
+    {
+        const double radiansPerDegree = M_PI / 180.0;
+        double meanLatitude = ((values[0] + referencePtr[0]) / 2.0) * radiansPerDegree;
+        double north = (values[0] - referencePtr[0]) * radiansPerDegree * EARTH_RADIUS;
+        double east = (values[1] - referencePtr[1]) * radiansPerDegree * EARTH_RADIUS
+                      * cos(meanLatitude);
+
+        return sqrt((north * north) + (east * east));
+    }
+
+    double sumOfSquares = 0.0;
+
+    for (size_t i = 0; i < sensorPtr->desc.fieldCount; i++)
+    {
+        double difference = values[i] - referencePtr[i];
+
+        sumOfSquares += difference * difference;
+    }
+
+    return sqrt(sumOfSquares);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor sample has changed enough since the last one pushed to be worth pushing.
+ *
+ * @note Numeric samples are filtered by the Data Hub (see CreateObservation()), and summaries and
+ *       blocks are never filtered, so this only applies to vector and JSON samples.
+ *
+ * @return true if the sample should be dropped.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsWithinChangeBy
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+{
+    double values[MAX_SENSOR_FIELDS];
+
+    if (   (sensorPtr->desc.type == SAMPLE_TYPE_NUMERIC)
+        || (sensorPtr->desc.type == SAMPLE_TYPE_SUMMARY)
+        || (sensorPtr->desc.type == SAMPLE_TYPE_BLOCK)
+        || (sensorPtr->desc.changeBy <= 0.0)
+        || !sensorPtr->hasLastPushedValues
+        || (DecodeSample(sensorPtr, samplePtr, values) != LE_OK) )
+    {
+        // A malformed sample will be reported when it's recorded.
+        return false;
+    }
+
+    return (ChangeByDistance(sensorPtr, values, sensorPtr->lastPushedValues)
+            < sensorPtr->desc.changeBy);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the fields of a sensor sample that has been recorded for pushing, as the reference for
+ * change-by filtering of the samples after it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateChangeByReference
+(
+    Sensor_t* sensorPtr,
+    const double* values    ///< Array of the sensor's fieldCount numbers.
+)
+{
+    memcpy(sensorPtr->lastPushedValues, values, sensorPtr->desc.fieldCount * sizeof(values[0]));
+    sensorPtr->hasLastPushedValues = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a window summary published by the aggregator component into a given avdata record.
+ *
+ * The JSON value is expected to look like this for scalar summaries:
+ *
+ * { "count": 60, "min": 20.1, "max": 22.5, "mean": 21.2, "stdDev": 0.4, "rms": 21.2 }
+ *
+ * Vector summaries carry the same statistics for each axis, prefixed by "x.", "y." and "z.".
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the record is full
+ *      - LE_FORMAT_ERROR if the JSON value could not be decoded
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordSummary
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    double timestamp,
+    const char* value   ///< JSON string.
+)
+{
+    static const char* const scalarMembers[] =
+    {
+        "count", "min", "max", "mean", "stdDev", "rms"
+    };
+    static const char* const vectorMembers[MAX_SUMMARY_MEMBERS] =
+    {
+        "count",
+        "x.min", "x.max", "x.mean", "x.stdDev", "x.rms",
+        "y.min", "y.max", "y.mean", "y.stdDev", "y.rms",
+        "z.min", "z.max", "z.mean", "z.stdDev", "z.rms"
+    };
+
+    const bool isVector = (sensorPtr->desc.summaryAxisCount > 1);
+    const char* const* memberNames = isVector ? vectorMembers : scalarMembers;
+    size_t memberCount = isVector ? NUM_ARRAY_MEMBERS(vectorMembers)
+                                  : NUM_ARRAY_MEMBERS(scalarMembers);
+    double members[MAX_SUMMARY_MEMBERS];
+
+    if (ExtractNumbers(value, memberNames, members, memberCount) != LE_OK)
+    {
+        LE_ERROR("Failed to decode summary value.");
+        return LE_FORMAT_ERROR;
+    }
+
+    uint64_t ms = columnCodec_TimestampToMs(timestamp);
+
+    le_result_t result;
+
+    result = le_avdata_RecordInt(rec, sensorPtr->summaryPaths[0], (int32_t)members[0], ms);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Couldn't record summary sample count - %s", LE_RESULT_TXT(result));
+        return result;
+    }
+
+    for (size_t i = 1; i < memberCount; i++)
+    {
+        result = le_avdata_RecordFloat(rec, sensorPtr->summaryPaths[i], members[i], ms);
+        if (result != LE_OK)
+        {
+            LE_ERROR("Couldn't record summary '%s' - %s",
+                     sensorPtr->summaryPaths[i],
+                     LE_RESULT_TXT(result));
+            return result;
+        }
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a compact block of samples, encoded as text, into a given avdata record as a single
+ * string under the sensor's compactAvPath.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the record is full
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordBlockText
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    const char* text,
+    double timestamp        ///< Timestamp of the newest sample in the block.
+)
+{
+    uint64_t ms = columnCodec_TimestampToMs(timestamp);
+
+    le_result_t result = le_avdata_RecordString(rec, sensorPtr->desc.compactAvPath, text, ms);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Couldn't record compact block of '%s' - %s",
+                 sensorPtr->desc.obsPath,
+                 LE_RESULT_TXT(result));
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a sensor sample into a given avdata record.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the record is full
+ *      - LE_FORMAT_ERROR if the value could not be decoded
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordSample
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    const Sample_t* samplePtr
+)
+{
+    if (sensorPtr->desc.type == SAMPLE_TYPE_SUMMARY)
+    {
+        return RecordSummary(sensorPtr, rec, samplePtr->timestamp, samplePtr->string);
+    }
+
+    if (sensorPtr->desc.type == SAMPLE_TYPE_BLOCK)
+    {
+        return RecordBlockText(sensorPtr, rec, samplePtr->string, samplePtr->timestamp);
+    }
+
+    double values[MAX_SENSOR_FIELDS];
+
+    if (DecodeSample(sensorPtr, samplePtr, values) != LE_OK)
+    {
+        LE_ERROR("Failed to decode sample from '%s'.", sensorPtr->desc.obsPath);
+        return LE_FORMAT_ERROR;
+    }
+
+    le_result_t result = RecordFields(sensorPtr, rec, samplePtr->timestamp, values);
+
+    if (result == LE_OK)
+    {
+        UpdateChangeByReference(sensorPtr, values);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adds a (non-summary) sensor sample to a compact backlog block.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the block is full
+ *      - LE_FORMAT_ERROR if the value could not be decoded, or can't be encoded at the sensor's
+ *        resolution
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CompactSample
+(
+    Sensor_t* sensorPtr,
+    columnCodec_Block_t* blockPtr,
+    const Sample_t* samplePtr
+)
+{
+    double values[MAX_SENSOR_FIELDS];
+
+    if (DecodeSample(sensorPtr, samplePtr, values) != LE_OK)
+    {
+        LE_ERROR("Failed to decode sample from '%s'.", sensorPtr->desc.obsPath);
+        return LE_FORMAT_ERROR;
+    }
+
+    le_result_t result = columnCodec_Add(blockPtr, samplePtr->timestamp, values);
+
+    if (result == LE_OUT_OF_RANGE)
+    {
+        LE_ERROR("Sample from '%s' can't be compactly encoded.", sensorPtr->desc.obsPath);
+        return LE_FORMAT_ERROR;
+    }
+
+    if (result == LE_OK)
+    {
+        UpdateChangeByReference(sensorPtr, values);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Records a compact backlog block into a given avdata record, as a single base64 string timestamped
+ * with the newest sample in the block.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_OVERFLOW if the record is full
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordCompactBlock
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t rec,
+    const columnCodec_Block_t* blockPtr,
+    double timestamp,
+    size_t* bytesPtr    ///< [OUT] Estimated size of the block's entry in the record (bytes).
+)
+{
+    static char text[COLUMN_CODEC_TEXT_BYTES];
+
+    le_result_t result = columnCodec_Encode(blockPtr, text, sizeof(text));
+    LE_ASSERT_OK(result);
+
+    *bytesPtr = strlen(sensorPtr->desc.compactAvPath) + strlen(text) + RECORD_ENTRY_BYTES;
+
+    return RecordBlockText(sensorPtr, rec, text, timestamp);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up a token bucket, full.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitBucket
+(
+    TokenBucket_t* bucketPtr,
+    unsigned int perHour    ///< Refill rate (0 = unlimited).
+)
+{
+    bucketPtr->rate = perHour / 3600.0;
+    bucketPtr->capacity = bucketPtr->rate * BUDGET_BURST_SECONDS;
+    bucketPtr->tokens = bucketPtr->capacity;
+    bucketPtr->lastRefillTime = GetUptime();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a token bucket holds more than a given fraction of its capacity, after adding the
+ * tokens earned since it was last refilled.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsBucketAbove
+(
+    TokenBucket_t* bucketPtr,
+    double fraction
+)
+{
+    if (bucketPtr->rate == 0.0)
+    {
+        return true;
+    }
+
+    double now = GetUptime();
+
+    bucketPtr->tokens = fmin(bucketPtr->capacity,
+                             bucketPtr->tokens + ((now - bucketPtr->lastRefillTime)
+                                                  * bucketPtr->rate));
+    bucketPtr->lastRefillTime = now;
+
+    return (bucketPtr->tokens > (bucketPtr->capacity * fraction));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether there's enough upload budget left to push a sensor's samples.  Fresh samples from
+ * high-priority sensors may use the whole budget; everything else has to leave the reserve alone.
+ * If there isn't enough, the sensor is flagged so the push will be retried by the BudgetTimer.
+ *
+ * @note The size of a push isn't known until its record has been built, so this only checks that
+ *       the budget isn't used up.  The push is charged in full when it's made, which may overdraw
+ *       the buckets, in which case later pushes wait for them to refill.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool HasBudget
+(
+    Sensor_t* sensorPtr,
+    bool isFresh    ///< true for a fresh sample, false for a backlog or resend.
+)
+{
+    double reserve = (isFresh && (sensorPtr->desc.priority == SENSOR_PRIORITY_HIGH))
+                     ? 0.0
+                     : BUDGET_RESERVE_FRACTION;
+
+    if (IsBucketAbove(&ByteBudget, reserve) && IsBucketAbove(&PushBudget, reserve))
+    {
+        return true;
+    }
+
+    LE_DEBUG("Holding back '%s' until there's more upload budget.", sensorPtr->desc.obsPath);
+
+    sensorPtr->isWaitingForBudget = true;
+
+    if (!le_timer_IsRunning(BudgetTimer))
+    {
+        le_timer_Start(BudgetTimer);
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Charge a push to the upload budget.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChargeBudget
+(
+    size_t byteCount
+)
+{
+    if (ByteBudget.rate != 0.0)
+    {
+        ByteBudget.tokens -= byteCount;
+    }
+
+    if (PushBudget.rate != 0.0)
+    {
+        PushBudget.tokens -= 1.0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a new push tracking object with no members.
+ */
+//--------------------------------------------------------------------------------------------------
+static Push_t* CreatePush
+(
+    void
+)
+{
+    Push_t* pushPtr = le_mem_ForceAlloc(PushPool);
+
+    pushPtr->byteCount = 0;
+    pushPtr->memberCount = 0;
+
+    return pushPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sensor's range of samples to the list of ranges that are in a record being pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddPushMember
+(
+    Push_t* pushPtr,
+    Sensor_t* sensorPtr,
+    Range_t* rangePtr
+)
+{
+    LE_ASSERT(pushPtr->memberCount < NUM_ARRAY_MEMBERS(pushPtr->members));
+
+    pushPtr->members[pushPtr->memberCount].sensorPtr = sensorPtr;
+    pushPtr->members[pushPtr->memberCount].rangePtr = rangePtr;
+    pushPtr->memberCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a sensor's range in the list of ranges that are in a record being pushed.
+ *
+ * @return Pointer to the range, or NULL if the sensor has no samples in the record.
+ */
+//--------------------------------------------------------------------------------------------------
+static Range_t* FindPushMember
+(
+    Push_t* pushPtr,
+    Sensor_t* sensorPtr
+)
+{
+    for (size_t i = 0; i < pushPtr->memberCount; i++)
+    {
+        if (pushPtr->members[i].sensorPtr == sensorPtr)
+        {
+            return pushPtr->members[i].rangePtr;
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a record holding samples from one or more sensors to AirVantage.
+ *
+ * The record is deleted, whether the push was accepted or not.  If the push could not be started,
+ * the member ranges are marked for resending, the member sensors are put into the FAULT state
+ * (with retries scheduled) and the push object is released.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t PushRecord
+(
+    Push_t* pushPtr,
+    le_avdata_RecordRef_t rec
+)
+{
+    le_result_t result = le_avdata_PushRecord(rec, HandleAvPushComplete, pushPtr);
+    if (result == LE_BUSY)
+    {
+        result = LE_OK;
+    }
+
+    if (result == LE_OK)
+    {
+        ChargeBudget(pushPtr->byteCount);
+
+        for (size_t i = 0; i < pushPtr->memberCount; i++)
+        {
+            pushPtr->members[i].sensorPtr->metrics.pushCount++;
+        }
+    }
+    else
+    {
+        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
+
+        CountFailedPush();
+
+        for (size_t i = 0; i < pushPtr->memberCount; i++)
+        {
+            LE_CRIT("Delivery of '%s' stalled.", pushPtr->members[i].sensorPtr->desc.obsPath);
+
+            pushPtr->members[i].rangePtr->state = RANGE_STATE_FAILED;
+            SetSensorState(pushPtr->members[i].sensorPtr, SENSOR_STATE_FAULT);
+
+            // Try again after a wait.
+            NotePushFailure(pushPtr->members[i].sensorPtr);
+        }
+
+        le_mem_Release(pushPtr);
+    }
+
+    le_avdata_DeleteRecord(rec);
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push the record collected during the current coalescing window, if there is one.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FlushCoalescedRecord
+(
+    void
+)
+{
+    if (CoalescedRecord == NULL)
+    {
+        return;
+    }
+
+    le_timer_Stop(CoalesceTimer);
+
+    le_avdata_RecordRef_t rec = CoalescedRecord;
+    Push_t* pushPtr = CoalescedPushPtr;
+
+    CoalescedRecord = NULL;
+    CoalescedPushPtr = NULL;
+
+    if (pushPtr->memberCount == 0)
+    {
+        le_avdata_DeleteRecord(rec);
+        le_mem_Release(pushPtr);
+    }
+    else
+    {
+        LE_DEBUG("Pushing coalesced samples from %zu sensors.", pushPtr->memberCount);
+
+        (void)PushRecord(pushPtr, rec);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler that closes the coalescing window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CoalesceTimerExpired
+(
+    le_timer_Ref_t timer
+)
+{
+    FlushCoalescedRecord();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the record that fresh samples should be added to, opening a new coalescing window if there
+ * isn't one open already.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_avdata_RecordRef_t GetCoalescedRecord
+(
+    void
+)
+{
+    if (CoalescedRecord == NULL)
+    {
+        CoalescedRecord = le_avdata_CreateRecord();
+        CoalescedPushPtr = CreatePush();
+    }
+
+    return CoalescedRecord;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a fresh sample from a sensor can be pushed right away.  This is the case if the
+ * sensor's newest range is in the current coalescing window (that range will just be extended)
+ * or, if the sensor has no samples in the window, if its push window has room for another range.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool CanPushFresh
+(
+    Sensor_t* sensorPtr
+)
+{
+    if (CoalescedPushPtr != NULL)
+    {
+        Range_t* rangePtr = FindPushMember(CoalescedPushPtr, sensorPtr);
+
+        if (rangePtr != NULL)
+        {
+            return (rangePtr->newest == sensorPtr->sentTimestamp);
+        }
+    }
+
+    return (sensorPtr->inFlightCount < sensorPtr->desc.pushWindow);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account for a sample that was just recorded into the CoalescedRecord, so that it will be
+ * acknowledged when that record is delivered.  Pushes the record right away if coalescing is
+ * disabled or every sensor pushing fresh samples has joined the window (there's nothing more to
+ * wait for), or starts the coalescing window timer if it isn't running yet.
+ */
+//--------------------------------------------------------------------------------------------------
+static void JoinCoalescedRecord
+(
+    Sensor_t* sensorPtr,
+    double timestamp
+)
+{
+    Range_t* rangePtr = FindPushMember(CoalescedPushPtr, sensorPtr);
+
+    CoalescedPushPtr->byteCount += sensorPtr->sampleBytes;
+
+    if (rangePtr != NULL)
+    {
+        // Already have this sensor's newest samples in this window, so just extend its range.
+        rangePtr->newest = timestamp;
+        NoteSent(sensorPtr, timestamp);
+    }
+    else
+    {
+        rangePtr = AddRange(sensorPtr, timestamp);
+        AddPushMember(CoalescedPushPtr, sensorPtr, rangePtr);
+    }
+
+    rangePtr->sampleCount++;
+
+    if (   (COALESCE_WINDOW_MS == 0)
+        || (CoalescedPushPtr->memberCount >= FreshSensorCount) )
+    {
+        FlushCoalescedRecord();
+    }
+    else if (!le_timer_IsRunning(CoalesceTimer))
+    {
+        le_timer_Start(CoalesceTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a fresh sensor sample to the cloud (as part of the current coalescing window).
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushFresh
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+{
+    le_result_t result = RecordSample(sensorPtr, GetCoalescedRecord(), samplePtr);
+
+    // If the record is full, push what's in it already and start a new one.
+    // Note: some of this sample's fields may have made it into the full record.  They will be
+    //       sent again in the next one, which is harmless because they carry the same timestamp.
+    if ((result == LE_OVERFLOW) && (CoalescedPushPtr->memberCount > 0))
+    {
+        FlushCoalescedRecord();
+
+        if (!CanPushFresh(sensorPtr))
+        {
+            // The flush used up the last free slot in the push window, so leave it for later.
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            return;
+        }
+
+        result = RecordSample(sensorPtr, GetCoalescedRecord(), samplePtr);
+    }
+
+    if (result == LE_OK)
+    {
+        JoinCoalescedRecord(sensorPtr, samplePtr->timestamp);
+    }
+    else if (result == LE_FORMAT_ERROR)
+    {
+        LE_CRIT("Discarding malformed value from '%s' (%s).",
+                sensorPtr->desc.obsPath,
+                samplePtr->string);
+
+        // Let the backlog drain skip over it, so the delivery cursors stay consistent.
+        SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+        ServiceSensor(sensorPtr);
+    }
+    else
+    {
+        LE_CRIT("%s: Delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->desc.obsPath);
+
+        SetSensorState(sensorPtr, SENSOR_STATE_FAULT);
+
+        // Try again after a wait.  The sample is in the queue, so the retry picks it up there.
+        NoteStall(sensorPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fetch the oldest sample newer than a given timestamp from a sensor's sample queue and add it to
+ * a given avdata record (or compact backlog block).  The record is only created when a sample is
+ * about to be added to it, so no record is created for a batch that turns out to be empty.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_NOT_FOUND if there are no samples in the queue newer than startAfter (and no newer
+ *        than newestAllowed)
+ *      - LE_OVERFLOW if the record (or block) is full
+ *      - LE_FORMAT_ERROR if the sample was malformed (*timestampPtr is still set, so it can be
+ *        skipped)
+ *      - LE_DUPLICATE if the sample is within the sensor's change-by threshold of the last one
+ *        pushed (*timestampPtr is still set, so it can be skipped)
+ *      - LE_FAULT non-specific failure
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordBufferedSample
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t* recPtr,  ///< [IN/OUT] Record to add the sample to (NULL = create one).
+    double startAfter,
+    double newestAllowed,   ///< Samples newer than this are left alone (HUGE_VAL = no limit).
+    columnCodec_Block_t* blockPtr,  ///< Block to add the sample to instead of the record (or
+                                    ///< NULL).
+    double* timestampPtr    ///< [OUT] Timestamp of the sample fetched.
+)
+{
+    char value[IO_MAX_STRING_VALUE_LEN + 1];
+    Sample_t sample = { timestamp: 0.0, number: 0.0, string: NULL };
+    le_result_t result;
+
+    if (sensorPtr->desc.type == SAMPLE_TYPE_NUMERIC)
+    {
+        result = sampleQueue_ReadNumeric(sensorPtr->queueRef,
+                                         startAfter,
+                                         timestampPtr,
+                                         &sample.number);
+    }
+    else
+    {
+        result = sampleQueue_ReadString(sensorPtr->queueRef,
+                                        startAfter,
+                                        timestampPtr,
+                                        value,
+                                        sizeof(value));
+        sample.string = value;
+
+        if (result == LE_OVERFLOW)
+        {
+            // Nothing this large is ever queued, so the sample must be corrupt.  Skip it.
+            LE_CRIT("Discarding oversized value from '%s'.", sensorPtr->desc.obsPath);
+            result = LE_FORMAT_ERROR;
+        }
+    }
+
+    if (result == LE_OK)
+    {
+        sample.timestamp = *timestampPtr;
+
+        if (*timestampPtr > newestAllowed)
+        {
+            result = LE_NOT_FOUND;
+        }
+        else if (IsWithinChangeBy(sensorPtr, &sample))
+        {
+            result = LE_DUPLICATE;
+        }
+        else if (blockPtr != NULL)
+        {
+            result = CompactSample(sensorPtr, blockPtr, &sample);
+        }
+        else
+        {
+            if (*recPtr == NULL)
+            {
+                *recPtr = le_avdata_CreateRecord();
+            }
+
+            result = RecordSample(sensorPtr, *recPtr, &sample);
+
+            if (result == LE_FORMAT_ERROR)
+            {
+                LE_CRIT("Discarding malformed value from '%s' (%s).",
+                        sensorPtr->desc.obsPath,
+                        value);
+            }
+        }
+    }
+    else if (result == LE_IO_ERROR)
+    {
+        result = LE_FAULT;
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a batch of the oldest samples newer than a given timestamp from a sensor's sample queue
+ * into a given avdata record (created if NULL and there are samples to record).
+ *
+ * If the sensor has a compactAvPath, the batch is packed into a single compact block, and can hold
+ * up to COMPACT_BATCH_COUNT samples rather than the sensor's batchCount.
+ *
+ * @return
+ *      - LE_OK if the batch is full (there may be more samples waiting)
+ *      - LE_NOT_FOUND if the queue ran out of samples (or reached newestAllowed)
+ *      - LE_OVERFLOW if the record filled up
+ *      - LE_FAULT (or another error code) if the queue couldn't be read
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RecordBatch
+(
+    Sensor_t* sensorPtr,
+    le_avdata_RecordRef_t* recPtr,  ///< [IN/OUT] Record to add the samples to (NULL = create one).
+    double startAfter,
+    double newestAllowed,       ///< Samples newer than this are left alone (HUGE_VAL = no limit).
+    unsigned int* countPtr,     ///< [OUT] Number of samples recorded.
+    double* newestPtr,          ///< [OUT] Timestamp of the newest sample recorded.
+    double* consumedPtr,        ///< [OUT] Timestamp of the newest sample recorded or skipped.
+    size_t* bytesPtr            ///< [OUT] Estimated size of the samples recorded (bytes).
+)
+{
+    le_result_t result = LE_OK;
+    columnCodec_Block_t* blockPtr = NULL;
+    unsigned int batchCount = sensorPtr->desc.batchCount;
+
+    // Change-by reference from before the batch, in case the block doesn't make it into the record.
+    double referenceValues[MAX_SENSOR_FIELDS];
+    bool hasReference = sensorPtr->hasLastPushedValues;
+
+    memcpy(referenceValues, sensorPtr->lastPushedValues, sizeof(referenceValues));
+
+    *countPtr = 0;
+    *newestPtr = startAfter;
+    *consumedPtr = startAfter;
+    *bytesPtr = 0;
+
+    // Blocks are already compact, so they're recorded one by one like summaries.
+    if ((sensorPtr->desc.compactAvPath != NULL) && (sensorPtr->desc.type != SAMPLE_TYPE_BLOCK))
+    {
+        int8_t exponents[MAX_SENSOR_FIELDS];
+
+        LE_ASSERT(sensorPtr->desc.type != SAMPLE_TYPE_SUMMARY);
+
+        for (size_t i = 0; i < sensorPtr->desc.fieldCount; i++)
+        {
+            exponents[i] = sensorPtr->desc.fields[i].resolutionExp;
+        }
+
+        blockPtr = &CompactBlock;
+        columnCodec_Start(blockPtr, sensorPtr->desc.fieldCount, exponents);
+        batchCount = COMPACT_BATCH_COUNT;
+    }
+
+    while (*countPtr < batchCount)
+    {
+        double timestamp;
+
+        result = RecordBufferedSample(sensorPtr,
+                                      recPtr,
+                                      *consumedPtr,
+                                      newestAllowed,
+                                      blockPtr,
+                                      &timestamp);
+
+        if (result == LE_OK)
+        {
+            *newestPtr = timestamp;
+            *bytesPtr += sensorPtr->sampleBytes;
+            (*countPtr)++;
+        }
+        else if ((result == LE_FORMAT_ERROR) || (result == LE_DUPLICATE))
+        {
+            CountDroppedSample(sensorPtr, timestamp);
+        }
+        else
+        {
+            // Note: on LE_OVERFLOW, some of the sample's fields may already be in the record.
+            //       They will be sent again with the next batch, which is harmless because
+            //       they carry the same timestamp.
+            break;
+        }
+
+        *consumedPtr = timestamp;
+    }
+
+    if ((blockPtr != NULL) && (*countPtr > 0))
+    {
+        if (*recPtr == NULL)
+        {
+            *recPtr = le_avdata_CreateRecord();
+        }
+
+        le_result_t recordResult = RecordCompactBlock(sensorPtr,
+                                                      *recPtr,
+                                                      blockPtr,
+                                                      *newestPtr,
+                                                      bytesPtr);
+
+        if (recordResult != LE_OK)
+        {
+            // None of the batch made it into the record, so the samples after it must be
+            // filtered against the reference from before it, as they will be when it's retried.
+            memcpy(sensorPtr->lastPushedValues, referenceValues, sizeof(referenceValues));
+            sensorPtr->hasLastPushedValues = hasReference;
+
+            *countPtr = 0;
+            *newestPtr = startAfter;
+            *consumedPtr = startAfter;
+            *bytesPtr = 0;
+
+            return recordResult;
+        }
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a sensor's backlog (or at least, the oldest samples of the backlog).
+ *
+ * Up to the sensor's batchCount of the oldest samples not yet handed to the AirVantage Agent are
+ * packed into a single record (each sample carrying its own timestamp) and pushed in one go.  This
+ * is repeated until the sensor's push window is full or the backlog has been emptied.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushBacklog
+(
+    Sensor_t* sensorPtr
+)
+{
+    while (sensorPtr->inFlightCount < sensorPtr->desc.pushWindow)
+    {
+        le_avdata_RecordRef_t rec = NULL;
+
+        unsigned int sampleCount;
+        double newest;
+        double consumed;
+        size_t byteCount;
+
+        if (!HasBudget(sensorPtr, false))
+        {
+            // The BudgetTimer will pick this up again.
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            return;
+        }
+
+        le_result_t result = RecordBatch(sensorPtr,
+                                         &rec,
+                                         sensorPtr->sentTimestamp,
+                                         HUGE_VAL,
+                                         &sampleCount,
+                                         &newest,
+                                         &consumed,
+                                         &byteCount);
+        if (sampleCount == 0)
+        {
+            if (rec != NULL)
+            {
+                le_avdata_DeleteRecord(rec);
+            }
+
+            // Skip over any malformed or unchanged samples that were discarded.
+            if (consumed != sensorPtr->sentTimestamp)
+            {
+                AckRange(sensorPtr, AddRange(sensorPtr, consumed));
+            }
+
+            if (result == LE_NOT_FOUND)
+            {
+                SetSensorState(sensorPtr, (sensorPtr->inFlightCount > 0) ? SENSOR_STATE_PUSHING
+                                                                  : SENSOR_STATE_IDLE);
+            }
+            else
+            {
+                LE_CRIT("Unexpected result code (%s) fetching backlog of '%s'.",
+                        LE_RESULT_TXT(result),
+                        sensorPtr->desc.obsPath);
+
+                SetSensorState(sensorPtr, SENSOR_STATE_FAULT);
+                NoteStall(sensorPtr);
+            }
+
+            return;
+        }
+
+        if ((result != LE_OK) && (result != LE_NOT_FOUND) && (result != LE_OVERFLOW))
+        {
+            LE_CRIT("Unexpected result code (%s) reading queue.", LE_RESULT_TXT(result));
+        }
+
+        // If the queue has been emptied, there's no need to read it again when this push
+        // completes, unless another update arrives in the meantime.
+        SetSensorState(sensorPtr, (result == LE_NOT_FOUND) ? SENSOR_STATE_PUSHING
+                                                    : SENSOR_STATE_BACKLOGGED);
+
+        LE_DEBUG("Pushing %u backlogged samples of '%s'.", sampleCount, sensorPtr->desc.obsPath);
+
+        // The batch already packs several samples into one record, so push it straight away
+        // rather than holding it for the coalescing window.
+        Push_t* pushPtr = CreatePush();
+        pushPtr->byteCount = byteCount;
+        Range_t* rangePtr = AddRange(sensorPtr, newest);
+        rangePtr->sampleCount = sampleCount;
+        AddPushMember(pushPtr, sensorPtr, rangePtr);
+
+        if ((PushRecord(pushPtr, rec) != LE_OK) || (sensorPtr->state != SENSOR_STATE_BACKLOGGED))
+        {
+            return;
+        }
+    }
+
+    // The push window is full.  Completion of one of the pushes in flight will result in more
+    // being pushed.
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resend the samples in a range whose push failed.  They are filtered against the change-by
+ * reference the range was first filtered against, so the same samples are sent again, and the
+ * sensor's own reference, which has moved on to its newest samples, is left alone.
+ *
+ * If the range doesn't fit in one record, as much as fits is pushed, and the rest is resent in
+ * the next record once that has been delivered.  See HandleAvPushComplete().
+ *
+ * @return
+ *      - LE_OK if the range was resent (or its samples are no longer available)
+ *      - LE_FAULT (or another error code) if it could not be resent
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResendRange
+(
+    Sensor_t* sensorPtr,
+    Range_t* rangePtr
+)
+{
+    le_avdata_RecordRef_t rec = NULL;
+
+    unsigned int sampleCount;
+    double newest;
+    double consumed;
+    size_t byteCount;
+    le_result_t result;
+
+    double liveValues[MAX_SENSOR_FIELDS];
+    bool hasLiveValues = sensorPtr->hasLastPushedValues;
+
+    memcpy(liveValues, sensorPtr->lastPushedValues, sizeof(liveValues));
+    memcpy(sensorPtr->lastPushedValues, rangePtr->referenceValues, sizeof(liveValues));
+    sensorPtr->hasLastPushedValues = rangePtr->hasReference;
+
+    // Keep reading batches until the whole range is in the record.
+    double startAfter = rangePtr->startAfter;
+    unsigned int totalCount = 0;
+    size_t totalBytes = 0;
+
+    do
+    {
+        result = RecordBatch(sensorPtr,
+                             &rec,
+                             startAfter,
+                             rangePtr->newest,
+                             &sampleCount,
+                             &newest,
+                             &consumed,
+                             &byteCount);
+        totalCount += sampleCount;
+        totalBytes += byteCount;
+        startAfter = consumed;
+    }
+    while ((result == LE_OK) && (sampleCount > 0));
+
+    rangePtr->isPartial = ((result == LE_OVERFLOW) && (totalCount > 0));
+    if (rangePtr->isPartial)
+    {
+        LE_DEBUG("Resending '%s' in parts.", sensorPtr->desc.obsPath);
+
+        rangePtr->partNewest = startAfter;
+        memcpy(rangePtr->partValues, sensorPtr->lastPushedValues, sizeof(rangePtr->partValues));
+        rangePtr->hasPartValues = sensorPtr->hasLastPushedValues;
+        result = LE_OK;
+    }
+
+    memcpy(sensorPtr->lastPushedValues, liveValues, sizeof(liveValues));
+    sensorPtr->hasLastPushedValues = hasLiveValues;
+
+    if ((result != LE_OK) && (result != LE_NOT_FOUND))
+    {
+        LE_CRIT("Failed (%s) to resend backlog of '%s'.",
+                LE_RESULT_TXT(result),
+                sensorPtr->desc.obsPath);
+
+        if (rec != NULL)
+        {
+            le_avdata_DeleteRecord(rec);
+        }
+
+        return result;
+    }
+
+    if (totalCount == 0)
+    {
+        if (rec != NULL)
+        {
+            le_avdata_DeleteRecord(rec);
+        }
+
+        LE_WARN("Samples of '%s' to be resent are no longer queued.", sensorPtr->desc.obsPath);
+
+        AckRange(sensorPtr, rangePtr);
+
+        return LE_OK;
+    }
+
+    LE_DEBUG("Resending %u samples of '%s'.", totalCount, sensorPtr->desc.obsPath);
+
+    rangePtr->state = RANGE_STATE_SENDING;
+    rangePtr->sampleCount = totalCount;
+
+    Push_t* pushPtr = CreatePush();
+    pushPtr->byteCount = totalBytes;
+    AddPushMember(pushPtr, sensorPtr, rangePtr);
+
+    return PushRecord(pushPtr, rec);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a sensor's data moving again: resend any ranges whose pushes failed, then push whatever
+ * backlog fits in the push window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ServiceSensor
+(
+    Sensor_t* sensorPtr
+)
+{
+    // While waiting to retry, leave it to the retry timer (or to ResumeSensors()).
+    if (IsPushPaused || le_timer_IsRunning(sensorPtr->retryTimer))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < sensorPtr->inFlightCount; i++)
+    {
+        Range_t* rangePtr = GetRange(sensorPtr, i);
+
+        if (rangePtr->state == RANGE_STATE_FAILED)
+        {
+            if (!HasBudget(sensorPtr, false))
+            {
+                // The BudgetTimer will pick this up again.
+                SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+                return;
+            }
+
+            if (ResendRange(sensorPtr, rangePtr) != LE_OK)
+            {
+                // Try again after a wait.
+                SetSensorState(sensorPtr, SENSOR_STATE_FAULT);
+                NoteStall(sensorPtr);
+                return;
+            }
+
+            // Resending an empty range may have acknowledged it, changing the ring.
+            i = (size_t)-1;
+        }
+    }
+
+    if (   (sensorPtr->state == SENSOR_STATE_BACKLOGGED)
+        || (sensorPtr->state == SENSOR_STATE_FAULT)  )
+    {
+        PushBacklog(sensorPtr);
+    }
+    else if (sensorPtr->inFlightCount == 0)
+    {
+        SetSensorState(sensorPtr, SENSOR_STATE_IDLE);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------------------
+/**
+ * Command data handler.
+ * This function is called whenever AirVantage performs an execute on the set value command
+ */
+//-------------------------------------------------------------------------------------------------
+static void SetLedBlinkIntervalCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    char val[32];
+    le_result_t result = LE_OK;
+
+    LE_DEBUG("Set LED blink interval");
+
+    result = le_avdata_GetStringArg(argumentList, LED_CMD_LED_BLINK_INTERVAL_RES, val, sizeof(val));
+    if (result != LE_OK)
+    {
+        LE_ERROR("le_avdata_GetStringArg('%s') failed(%d)", LED_CMD_LED_BLINK_INTERVAL_RES, result);
+        goto cleanup;
+    }
+
+    LE_INFO("interval('%s')", val);
+    int ledBlinkDuration = atoi(val);
+    if (ledBlinkDuration < 0)
+    {
+        LE_WARN("Invalid max interval between publish (%d >= 0)", ledBlinkDuration);
+        result = LE_OUT_OF_RANGE;
+        goto cleanup;
+    }
+    else
+    {
+        // Push the period (which is 2 * the interval) to the Data Hub.
+        dhubAdmin_PushNumeric("/app/ledService/blinkPeriod", 0.0, (double)(ledBlinkDuration * 2));
+
+        // Activate the LED.
+        dhubAdmin_PushBoolean("/app/ledService/value", 0.0, true);
+    }
+
+cleanup:
+    le_avdata_ReplyExecResult(argumentList, result);
+}
+
+//-------------------------------------------------------------------------------------------------
+/**
+ * Command data handler.
+ * This function is called whenever AirVantage performs an execute on the activate LED command
+ */
+//-------------------------------------------------------------------------------------------------
+static void ActivateLedCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    LE_DEBUG("Activate LED");
+
+    dhubAdmin_PushBoolean("/app/ledService/value", 0.0, true);
+
+    le_avdata_ReplyExecResult(argumentList, LE_OK);
+}
+
+//-------------------------------------------------------------------------------------------------
+/**
+ * Command data handler.
+ * This function is called whenever AirVantage performs an execute on the deactivate LED command
+ */
+//-------------------------------------------------------------------------------------------------
+static void DeactivateLedCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    LE_DEBUG("Deactivate LED");
+
+    dhubAdmin_PushBoolean("/app/ledService/value", 0.0, false);
+
+    le_avdata_ReplyExecResult(argumentList, LE_OK);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start pushing the samples of an on-demand sensor that are waiting in its sample queue.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RequestRawUpload
+(
+    Sensor_t* sensorPtr
+)
+{
+    LE_ASSERT(sensorPtr->desc.isOnDemand);
+
+    switch (sensorPtr->state)
+    {
+        case SENSOR_STATE_IDLE:
+        case SENSOR_STATE_FAULT:
+
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            ServiceSensor(sensorPtr);
+
+            break;
+
+        case SENSOR_STATE_PUSHING:
+
+            // Pick up anything queued since the current upload emptied the queue.
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+
+            break;
+
+        case SENSOR_STATE_BACKLOGGED:
+
+            // Already uploading.
+            break;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+/**
+ * Command data handler.
+ * This function is called whenever AirVantage performs an execute on the upload raw samples
+ * command.  The raw samples of all the on-demand sensors that are still in their sample queues
+ * are pushed (those of the sensors whose raw samples aren't kept are gone already).
+ */
+//-------------------------------------------------------------------------------------------------
+static void UploadRawSamplesCmd
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    LE_INFO("Uploading raw samples");
+
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        if (Sensors[i].desc.isOnDemand && (Sensors[i].queueRef != NULL))
+        {
+            RequestRawUpload(&Sensors[i]);
+        }
+    }
+
+    le_avdata_ReplyExecResult(argumentList, LE_OK);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Setting handler.
+ * This function is called whenever AirVantage writes the vibration band edges setting.  The new
+ * edges are passed on to the vibration component, which checks them, and applies them from its
+ * next report.
+ */
+//--------------------------------------------------------------------------------------------------
+static void VibBandsSettingHandler
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr
+)
+{
+    char bands[256];
+
+    if (accessType != LE_AVDATA_ACCESS_WRITE)
+    {
+        return;
+    }
+
+    if (le_avdata_GetString(path, bands, sizeof(bands)) != LE_OK)
+    {
+        LE_WARN("Invalid vibration bands.");
+        return;
+    }
+
+    LE_INFO("Changing vibration bands to %s.", bands);
+
+    // Update the default too, in case redSensor restarts.
+    dhubAdmin_SetJsonDefault(VIB_BANDS_OUTPUT_PATH, bands);
+    dhubAdmin_PushJson(VIB_BANDS_OUTPUT_PATH, 0.0, bands);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of one of a sensor's Data Hub resources, given the path of its 'value' input
+ * (e.g., "/app/redSensor/light/period" from "/app/redSensor/light/value").
+ */
+//--------------------------------------------------------------------------------------------------
+static void GetSensorResourcePath
+(
+    const char* inputPath,
+    const char* name,   ///< Name of the resource, e.g. "period".
+    char* path,         ///< [OUT] Buffer of DHUBIO_MAX_RESOURCE_PATH_LEN + 1 bytes.
+    size_t pathSize
+)
+{
+    const char* lastSlashPtr = strrchr(inputPath, '/');
+
+    if (lastSlashPtr == NULL)
+    {
+        LE_FATAL("No '/' found in path '%s'.", inputPath);
+    }
+
+    size_t basePathLen = (lastSlashPtr - inputPath) + 1; // +1 to include the slash.
+
+    // Buffer size check.
+    LE_ASSERT((basePathLen + strlen(name)) < pathSize);
+
+    (void)strncpy(path, inputPath, basePathLen);    // WARNING: May not be null-terminated.
+    (void)strcpy(path + basePathLen, name);         // Guaranteed to null-terminate.
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether the adaptive scheduler may change a sensor's polling period.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsAdaptive
+(
+    const Sensor_t* sensorPtr
+)
+{
+    return (sensorPtr->desc.period > 0.0) && (sensorPtr->desc.maxPeriod > sensorPtr->desc.period);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Change the polling period in effect for a sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetSensorPeriod
+(
+    Sensor_t* sensorPtr,
+    double period ///< seconds
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    LE_DEBUG("Polling '%s' every %lf s.", sensorPtr->desc.obsPath, period);
+
+    sensorPtr->period = period;
+    sensorPtr->lastPeriodChangeTime = GetUptime();
+
+    GetSensorResourcePath(sensorPtr->desc.inputPath, "period", path, sizeof(path));
+    dhubAdmin_PushNumeric(path, 0.0, period);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start adapting a sensor's polling period, from its configured period.  Called whenever the
+ * configured period is set.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartAdaptiveSampling
+(
+    Sensor_t* sensorPtr
+)
+{
+    double now = GetUptime();
+
+    sensorPtr->period = sensorPtr->desc.period;
+    sensorPtr->lastActivityTime = now;
+    sensorPtr->lastPeriodChangeTime = now;
+    sensorPtr->hasActivityValues = false;
+    sensorPtr->isLinkBackedOff = false;
+
+    if (IsAdaptive(sensorPtr) && !le_timer_IsRunning(AdaptiveTimer))
+    {
+        LE_ASSERT_OK(le_timer_Start(AdaptiveTimer));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Look for activity in a sample received from a sensor whose period is adaptive.  A sample that
+ * differs from the last active one by at least the change-by threshold (e.g., the accelerometer
+ * reading jumps) puts the sensor straight back to its configured period, so the rest of the event
+ * is sampled at full rate.
+ *
+ * @note This sees every sample, including those of on-demand sensors, whereas IsWithinChangeBy()
+ *       only sees the ones that might be pushed.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NoteSensorActivity
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+{
+    double values[MAX_SENSOR_FIELDS];
+
+    if (!IsAdaptive(sensorPtr) || (DecodeSample(sensorPtr, samplePtr, values) != LE_OK))
+    {
+        return;
+    }
+
+    if (   sensorPtr->hasActivityValues
+        && (ChangeByDistance(sensorPtr, values, sensorPtr->activityValues)
+            < sensorPtr->desc.changeBy))
+    {
+        // Still quiet.
+        return;
+    }
+
+    memcpy(sensorPtr->activityValues, values, sensorPtr->desc.fieldCount * sizeof(values[0]));
+    sensorPtr->hasActivityValues = true;
+    sensorPtr->lastActivityTime = GetUptime();
+
+    if (!sensorPtr->isLinkBackedOff && (sensorPtr->period > sensorPtr->desc.period))
+    {
+        SetSensorPeriod(sensorPtr, sensorPtr->desc.period);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adaptive scheduler.  Doubles the polling period of each adaptive sensor whose readings have
+ * stayed within the change-by threshold for ADAPTIVE_QUIET_PERIODS periods, up to its maxPeriod.
+ * While the AirVantage session is down, every sample only adds to a backlog, so low-priority
+ * sensors are slowed down to their maxPeriod until the session comes back.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AdaptSensorPeriods
+(
+    void
+)
+{
+    double now = GetUptime();
+
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        Sensor_t* sensorPtr = &Sensors[i];
+        double period = sensorPtr->period;
+
+        // Sensors that haven't been configured yet are left alone until they are.
+        if (!IsAdaptive(sensorPtr) || (sensorPtr->setupStep <= SETUP_STEP_SENSOR))
+        {
+            continue;
+        }
+
+        bool isLinkBackedOff = (!IsAvSessionActive)
+                               && (sensorPtr->desc.priority == SENSOR_PRIORITY_LOW);
+
+        if (isLinkBackedOff)
+        {
+            period = sensorPtr->desc.maxPeriod;
+        }
+        else if (sensorPtr->isLinkBackedOff)
+        {
+            // The session is back.  Start again from the configured period, as the readings
+            // haven't been looked at closely for a while.
+            period = sensorPtr->desc.period;
+            sensorPtr->lastActivityTime = now;
+        }
+        else
+        {
+            double quietTime = now - fmax(sensorPtr->lastActivityTime,
+                                          sensorPtr->lastPeriodChangeTime);
+
+            if (quietTime >= (ADAPTIVE_QUIET_PERIODS * period))
+            {
+                period = fmin(period * 2.0, sensorPtr->desc.maxPeriod);
+            }
+        }
+
+        sensorPtr->isLinkBackedOff = isLinkBackedOff;
+
+        if (period != sensorPtr->period)
+        {
+            SetSensorPeriod(sensorPtr, period);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler that runs the adaptive scheduler.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AdaptiveTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    AdaptSensorPeriods();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor has samples waiting to be pushed (or resent) but no push under way that
+ * will get them moving when it completes.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsStalled
+(
+    Sensor_t* sensorPtr
+)
+{
+    if (sensorPtr->state == SENSOR_STATE_IDLE)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < sensorPtr->inFlightCount; i++)
+    {
+        if (GetRange(sensorPtr, i)->state == RANGE_STATE_SENDING)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next stalled sensor in priority order moving again.  Restarts the ResumeTimer if there
+ * may be more.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResumeNextSensor
+(
+    void
+)
+{
+    while (ResumeIndex < SensorCount)
+    {
+        Sensor_t* sensorPtr = SensorsByPriority[ResumeIndex++];
+
+        if (IsStalled(sensorPtr))
+        {
+            // Start afresh, rather than carrying on with the back-off from before.
+            le_timer_Stop(sensorPtr->retryTimer);
+            sensorPtr->failureCount = 0;
+
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            ServiceSensor(sensorPtr);
+
+            if ((ResumeIndex < SensorCount) && !IsPushPaused)
+            {
+                le_timer_Start(ResumeTimer);
+            }
+
+            return;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler that resumes the next sensor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResumeTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    ResumeNextSensor();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the sensors that have undelivered samples moving again.  Called when the AirVantage session
+ * starts, so samples queued during an outage (or before a restart) are replayed from the delivered
+ * cursor onwards.  The sensors are started RESUME_STAGGER_MS apart, high-priority sensors first,
+ * so they don't all hit the AirVantage Agent at once and get first call on the upload budget.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResumeSensors
+(
+    void
+)
+{
+    le_timer_Stop(ResumeTimer);
+    ResumeIndex = 0;
+
+    ResumeNextSensor();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler that retries the pushes held back for lack of upload budget, high-priority
+ * sensors first.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BudgetTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        Sensor_t* sensorPtr = SensorsByPriority[i];
+
+        if (sensorPtr->isWaitingForBudget)
+        {
+            sensorPtr->isWaitingForBudget = false;
+            ServiceSensor(sensorPtr);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle changes in the AirVantage session state
+ *
+ * The AV Agent queues our push requests until the session comes back anyway, but pushes that fail
+ * while the link is down are retried with a growing back-off, and eventually paused altogether.
+ * When the session starts, pushes are resumed, one sensor at a time.  See ResumePushes().
+ */
+//--------------------------------------------------------------------------------------------------
+static void AvSessionStateHandler
+(
+    le_avdata_SessionState_t state,
+    void *context   ///< Not used.
+)
+{
+    switch (state)
+    {
+        case LE_AVDATA_SESSION_STARTED:
+        {
+            // Temporary workaround for the session state problem.
+            if (IsAvSessionActive)
+            {
+                LE_ERROR("Received 'session started' indication when already started.");
+            }
+            else
+            {
+                LE_INFO("AirVantage(tm) session started");
+
+                IsAvSessionActive = true;
+
+                AdaptSensorPeriods();
+                ResumePushes();
+            }
+            break;
+        }
+
+        case LE_AVDATA_SESSION_STOPPED:
+        {
+            LE_INFO("AirVantage(tm) session stopped");
+
+            IsAvSessionActive = false;
+
+            AdaptSensorPeriods();
+
+            break;
+        }
+
+        default:
+            LE_ERROR("Unsupported AV session state %d", state);
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a sensor update received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleUpdate
+(
+    Sensor_t* sensorPtr,
+    const Sample_t* samplePtr
+)
+{
+    le_result_t result;
+
+    CountReceivedSample(sensorPtr, samplePtr->timestamp);
+
+    // Keep the sample in flash until it has been delivered, unless nobody will ask for it.
+    if (sensorPtr->queueRef == NULL)
+    {
+        result = LE_OK;
+    }
+    else if (sensorPtr->desc.type == SAMPLE_TYPE_NUMERIC)
+    {
+        result = sampleQueue_AppendNumeric(sensorPtr->queueRef,
+                                           samplePtr->timestamp,
+                                           samplePtr->number);
+    }
+    else
+    {
+        result = sampleQueue_AppendString(sensorPtr->queueRef,
+                                          samplePtr->timestamp,
+                                          samplePtr->string);
+    }
+
+    if (result == LE_IO_ERROR)
+    {
+        LE_ERROR("Failed to queue sample of '%s'.", sensorPtr->desc.obsPath);
+    }
+
+    NoteSensorActivity(sensorPtr, samplePtr);
+
+    // A backlog drain may already have picked this sample up from the queue.
+    if (samplePtr->timestamp <= sensorPtr->sentTimestamp)
+    {
+        return;
+    }
+
+    // Leave on-demand samples in the queue until they're asked for.
+    if (sensorPtr->desc.isOnDemand)
+    {
+        return;
+    }
+
+    switch (sensorPtr->state)
+    {
+        case SENSOR_STATE_IDLE:
+        case SENSOR_STATE_PUSHING:
+
+            if (IsWithinChangeBy(sensorPtr, samplePtr))
+            {
+                // Not worth pushing.  If a backlog drain comes across it later, it will be
+                // dropped there too.
+                CountDroppedSample(sensorPtr, samplePtr->timestamp);
+                break;
+            }
+
+            if (!IsPushPaused && CanPushFresh(sensorPtr) && HasBudget(sensorPtr, true))
+            {
+                SetSensorState(sensorPtr, SENSOR_STATE_PUSHING);
+
+                PushFresh(sensorPtr, samplePtr);
+            }
+            else
+            {
+                // It will be pushed with the backlog, when a push in flight completes, there's
+                // more upload budget or pushes resume.
+                SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            }
+
+            break;
+
+        case SENSOR_STATE_BACKLOGGED:
+
+            // Don't need to do anything.  Completion of one of the pushes in flight will result
+            // in more being pushed.
+            break;
+
+        case SENSOR_STATE_FAULT:
+
+            SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+            ServiceSensor(sensorPtr);
+
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the samples waiting in the handoff queue.  Runs on the worker thread, whenever the main
+ * thread hands off a sample while the queue is idle.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DrainHandoffQueue
+(
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    HandoffQueue_t* queuePtr = &HandoffQueue;
+
+    // Samples handed off from now on need another drain, unless this one gets to them.
+    __atomic_store_n(&queuePtr->isWakePending, false, __ATOMIC_SEQ_CST);
+
+    uint32_t tail = queuePtr->tail;
+
+    for (size_t i = 0; i < HANDOFF_QUEUE_COUNT; i++)
+    {
+        if (tail == __atomic_load_n(&queuePtr->head, __ATOMIC_SEQ_CST))
+        {
+            return;
+        }
+
+        const HandoffEntry_t* entryPtr = &queuePtr->entries[tail % HANDOFF_QUEUE_COUNT];
+        Sensor_t* sensorPtr = entryPtr->sensorPtr;
+        Sample_t sample = {
+            timestamp: entryPtr->timestamp,
+            number: entryPtr->number,
+            string: entryPtr->hasString
+                    ? &queuePtr->strings[entryPtr->stringStart % HANDOFF_STRING_BYTES]
+                    : NULL
+        };
+        double cpuStart = GetCpuTime();
+
+        HandleUpdate(sensorPtr, &sample);
+
+        sensorPtr->metrics.cpuTime += GetCpuTime() - cpuStart;
+
+        // Give the entry and its string back to the main thread.
+        tail++;
+        __atomic_store_n(&queuePtr->stringTail, entryPtr->stringEnd, __ATOMIC_RELEASE);
+        __atomic_store_n(&queuePtr->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    // Let the timers and push completions in, before carrying on with the rest.
+    le_event_QueueFunction(DrainHandoffQueue, NULL, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hand a sample received from the Data Hub over to the worker thread.  Runs on the main thread.
+ *
+ * Never blocks: the queue is lock-free, and the worker thread is only woken (by queueing a call
+ * to DrainHandoffQueue() to it) when it isn't already due to drain the queue.  If the queue is
+ * full, the sample is dropped and counted in the sensor's HandoffDropped metric, so a worker
+ * thread that can't keep up shows up in the metrics rather than stalling the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandOffSample
+(
+    Sensor_t* sensorPtr,
+    double timestamp,
+    double number,
+    const char* string      ///< Value of a string sample (NULL for numeric samples).
+)
+{
+    static bool isFull = false;
+
+    HandoffQueue_t* queuePtr = &HandoffQueue;
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+    uint32_t head = queuePtr->head;
+    uint32_t depth = head - __atomic_load_n(&queuePtr->tail, __ATOMIC_ACQUIRE);
+    uint32_t stringStart = queuePtr->stringHead;
+    uint32_t stringEnd = stringStart;
+    bool hasRoom = (depth < HANDOFF_QUEUE_COUNT);
+
+    if (hasRoom && (string != NULL))
+    {
+        size_t len = strlen(string) + 1;
+        uint32_t offset = stringStart % HANDOFF_STRING_BYTES;
+
+        // Strings aren't split across the end of the buffer, so skip what's left of it if need be.
+        if ((offset + len) > HANDOFF_STRING_BYTES)
+        {
+            stringStart += HANDOFF_STRING_BYTES - offset;
+        }
+        stringEnd = stringStart + len;
+
+        // An empty queue has the whole buffer free, whatever the skipped bytes make it look like.
+        hasRoom = (   (depth == 0)
+                   || ((stringEnd - __atomic_load_n(&queuePtr->stringTail, __ATOMIC_ACQUIRE))
+                       <= HANDOFF_STRING_BYTES));
+        if (hasRoom)
+        {
+            memcpy(&queuePtr->strings[stringStart % HANDOFF_STRING_BYTES], string, len);
+        }
+    }
+
+    uint32_t peak = __atomic_load_n(&metricsPtr->handoffPeak, __ATOMIC_RELAXED);
+    uint32_t fill = hasRoom ? (depth + 1) : depth;
+    while (   (fill > peak)
+           && !__atomic_compare_exchange_n(&metricsPtr->handoffPeak,
+                                           &peak,
+                                           fill,
+                                           true,
+                                           __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+    {
+    }
+
+    if (!hasRoom)
+    {
+        __atomic_add_fetch(&metricsPtr->handoffDroppedCount, 1, __ATOMIC_RELAXED);
+
+        if (!isFull)
+        {
+            LE_WARN("Worker thread queue full.  Dropping samples.");
+            isFull = true;
+        }
+
+        return;
+    }
+
+    isFull = false;
+
+    queuePtr->entries[head % HANDOFF_QUEUE_COUNT] = (HandoffEntry_t){
+        sensorPtr: sensorPtr,
+        timestamp: timestamp,
+        number: number,
+        hasString: (string != NULL),
+        stringStart: stringStart,
+        stringEnd: stringEnd
+    };
+    queuePtr->stringHead = stringEnd;
+    __atomic_store_n(&queuePtr->head, head + 1, __ATOMIC_SEQ_CST);
+
+    if (!__atomic_exchange_n(&queuePtr->isWakePending, true, __ATOMIC_SEQ_CST))
+    {
+        le_event_QueueFunctionToThread(WorkerThread, DrainHandoffQueue, NULL, NULL);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a numeric sensor update is received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleNumericUpdate
+(
+    double timestamp,
+    double value,
+    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+)
+{
+    Sample_t sample = { timestamp: timestamp, number: value, string: NULL };
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (WorkerThread != NULL)
+    {
+        HandOffSample(sensorPtr, timestamp, value, NULL);
+        return;
+    }
+
+    double cpuStart = GetCpuTime();
+
+    HandleUpdate(sensorPtr, &sample);
+
+    sensorPtr->metrics.cpuTime += GetCpuTime() - cpuStart;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call-back function that gets called when a string (JSON or packed vector) sensor update is
+ * received from the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleStringUpdate
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+)
+{
+    Sample_t sample = { timestamp: timestamp, number: 0.0, string: value };
+    Sensor_t* sensorPtr = contextPtr;
+
+    if (WorkerThread != NULL)
+    {
+        HandOffSample(sensorPtr, timestamp, 0.0, value);
+        return;
+    }
+
+    double cpuStart = GetCpuTime();
+
+    HandleUpdate(sensorPtr, &sample);
+
+    sensorPtr->metrics.cpuTime += GetCpuTime() - cpuStart;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create an Obsevation with a buffer in the data hub.  The observation may already exist, e.g., if
+ * the app was restarted but the Data Hub wasn't, in which case its buffer and change-by threshold
+ * are only set if they're not already right.
+ *
+ * @note The Data Hub's change-by filter only works on numeric values, so the other sensors are
+ *       filtered by avPublisher itself.  See IsWithinChangeBy().
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - any other result of dhubAdmin_CreateObs() if the observation couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CreateObservation
+(
+    Sensor_t* sensorPtr
+)
+{
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+    le_result_t result = dhubAdmin_CreateObs(descPtr->obsPath);
+
+    if (result != LE_OK)
+    {
+        LE_WARN("Failed to create Data Hub observation at path '%s' (%s).",
+                descPtr->obsPath,
+                LE_RESULT_TXT(result));
+        return result;
+    }
+
+    if (dhubAdmin_GetBufferMaxCount(descPtr->obsPath) != descPtr->bufferCount)
+    {
+        dhubAdmin_SetBufferMaxCount(descPtr->obsPath, descPtr->bufferCount);
+    }
+
+    if (   (descPtr->type == SAMPLE_TYPE_NUMERIC)
+        && (dhubAdmin_GetChangeBy(descPtr->obsPath) != descPtr->changeBy))
+    {
+        dhubAdmin_SetChangeBy(descPtr->obsPath, descPtr->changeBy);
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sensor's sample queue, and pick up where it left off before the app was restarted.
+ * The queue is named after the sensor's observation (e.g., "/obs/summary/accel" is queued in
+ * "summary-accel").  On-demand sensors whose raw samples aren't kept get no queue.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenQueue
+(
+    Sensor_t* sensorPtr
+)
+{
+    static const char obsPrefix[] = "/obs/";
+    char name[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    const char* obsPath = sensorPtr->desc.obsPath;
+
+    if (sensorPtr->desc.isOnDemand && !sensorPtr->desc.isRawKept)
+    {
+        sensorPtr->queueRef = NULL;
+        return;
+    }
+
+    LE_ASSERT(strncmp(obsPath, obsPrefix, sizeof(obsPrefix) - 1) == 0);
+    LE_ASSERT_OK(le_utf8_Copy(name, obsPath + sizeof(obsPrefix) - 1, sizeof(name), NULL));
+
+    for (char* charPtr = name; *charPtr != '\0'; charPtr++)
+    {
+        if (*charPtr == '/')
+        {
+            *charPtr = '-';
+        }
+    }
+
+    sensorPtr->queueRef = sampleQueue_Open(name,
+                                           sensorPtr->desc.isOnDemand ? RAW_QUEUE_SEGMENT_COUNT
+                                                                      : QUEUE_SEGMENT_COUNT,
+                                           QUEUE_SEGMENT_BYTES);
+
+    sensorPtr->lastDeliveredTimestamp = sampleQueue_GetDelivered(sensorPtr->queueRef);
+    sensorPtr->sentTimestamp = sensorPtr->lastDeliveredTimestamp;
+
+    // Undelivered samples left over from before the restart are pushed when the session starts.
+    // Until then, fresh samples must not jump the queue.
+    if (   (!sensorPtr->desc.isOnDemand)
+        && (sampleQueue_GetNewest(sensorPtr->queueRef) > sensorPtr->lastDeliveredTimestamp))
+    {
+        SetSensorState(sensorPtr, SENSOR_STATE_BACKLOGGED);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure and enable a sensor whose 'value' input is at a given path.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConfigureSensor
+(
+    const char* inputPath,
+    double period ///< seconds
+)
+{
+    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+
+    // Set the period.
+    GetSensorResourcePath(inputPath, "period", path, sizeof(path));
+    dhubAdmin_SetNumericDefault(path, period);
+
+    // Enable the sensor.
+    GetSensorResourcePath(inputPath, "enable", path, sizeof(path));
+    dhubAdmin_PushBoolean(path, 0.0, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build an AirVantage path in the PathArena, where it stays for the life of the process.
+ *
+ * @return Pointer to the path.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* InternPath
+(
+    const char* format,     ///< printf-style format of the path.
+    ...
+)
+{
+    char* pathPtr = PathArena + PathArenaUsed;
+    size_t size = sizeof(PathArena) - PathArenaUsed;
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(pathPtr, size, format, args);
+    va_end(args);
+
+    LE_FATAL_IF((len < 0) || ((size_t)len >= size), "PATH_ARENA_BYTES is too small.");
+    LE_FATAL_IF(len > LE_AVDATA_PATH_NAME_LEN, "AirVantage path '%s' too long.", pathPtr);
+
+    PathArenaUsed += len + 1;
+
+    return pathPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the AirVantage paths of a summary sensor's members (in the order of the members in
+ * RecordSummary()), e.g., "MangOH.Sensors.Summary.Acceleration.X.Mean".
+ */
+//--------------------------------------------------------------------------------------------------
+static void InternSummaryPaths
+(
+    Sensor_t* sensorPtr
+)
+{
+    static const char* const statNames[] = { "Min", "Max", "Mean", "StdDev", "Rms" };
+    static const char* const axisNames[] = { "X.", "Y.", "Z." };
+
+    const bool isVector = (sensorPtr->desc.summaryAxisCount > 1);
+    size_t memberCount = 1 + (NUM_ARRAY_MEMBERS(statNames) * sensorPtr->desc.summaryAxisCount);
+
+    LE_ASSERT(memberCount <= MAX_SUMMARY_MEMBERS);
+
+    sensorPtr->summaryPaths[0] = InternPath("%s.Count", sensorPtr->desc.summaryAvPath);
+
+    for (size_t i = 1; i < memberCount; i++)
+    {
+        size_t stat = (i - 1) % NUM_ARRAY_MEMBERS(statNames);
+        size_t axis = (i - 1) / NUM_ARRAY_MEMBERS(statNames);
+
+        sensorPtr->summaryPaths[i] = InternPath("%s.%s%s",
+                                                sensorPtr->desc.summaryAvPath,
+                                                isVector ? axisNames[axis] : "",
+                                                statNames[stat]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the size of a sensor sample recorded on its own, each number under its own path, for
+ * budgeting.
+ *
+ * @return The size (bytes).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t EstimateSampleBytes
+(
+    const Sensor_t* sensorPtr
+)
+{
+    size_t byteCount = 0;
+
+    if (sensorPtr->desc.type == SAMPLE_TYPE_SUMMARY)
+    {
+        for (size_t i = 0; (i < MAX_SUMMARY_MEMBERS) && (sensorPtr->summaryPaths[i] != NULL); i++)
+        {
+            byteCount += strlen(sensorPtr->summaryPaths[i]) + RECORD_ENTRY_BYTES;
+        }
+    }
+    else if (sensorPtr->desc.type == SAMPLE_TYPE_BLOCK)
+    {
+        byteCount = strlen(sensorPtr->desc.compactAvPath) + BLOCK_TEXT_BYTES + RECORD_ENTRY_BYTES;
+    }
+    else
+    {
+        for (size_t i = 0; i < sensorPtr->desc.fieldCount; i++)
+        {
+            byteCount += strlen(sensorPtr->desc.fields[i].avPath) + RECORD_ENTRY_BYTES;
+        }
+    }
+
+    return byteCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read an unsigned integer setting of a sensor from the config tree.
+ *
+ * @return The setting, or the default if it isn't set (or is out of range).
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned int GetConfigUint
+(
+    le_cfg_IteratorRef_t iter,  ///< Iterator positioned at the sensor's node.
+    const char* sensorName,
+    const char* settingName,
+    unsigned int defaultValue,
+    unsigned int minValue,
+    unsigned int maxValue
+)
+{
+    int32_t value = le_cfg_GetInt(iter, settingName, (int32_t)defaultValue);
+
+    if ((value < (int32_t)minValue) || (value > (int32_t)maxValue))
+    {
+        LE_ERROR("Ignoring out of range %s (%d, must be %u to %u) of sensor '%s'.",
+                 settingName,
+                 (int)value,
+                 minValue,
+                 maxValue,
+                 sensorName);
+
+        return defaultValue;
+    }
+
+    return (unsigned int)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a non-negative floating point setting of a sensor from the config tree.
+ *
+ * @return The setting, or the default if it isn't set (or is negative).
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetConfigFloat
+(
+    le_cfg_IteratorRef_t iter,  ///< Iterator positioned at the sensor's node.
+    const char* sensorName,
+    const char* settingName,
+    double defaultValue
+)
+{
+    double value = le_cfg_GetFloat(iter, settingName, defaultValue);
+
+    if (!(value >= 0.0))
+    {
+        LE_ERROR("Ignoring negative %s (%lf) of sensor '%s'.", settingName, value, sensorName);
+
+        return defaultValue;
+    }
+
+    return value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the priority ("high" or "low") of a sensor from the config tree.
+ *
+ * @return The priority, or the default if it isn't set (or isn't valid).
+ */
+//--------------------------------------------------------------------------------------------------
+static SensorPriority_t GetConfigPriority
+(
+    le_cfg_IteratorRef_t iter,  ///< Iterator positioned at the sensor's node.
+    const char* sensorName,
+    SensorPriority_t defaultValue
+)
+{
+    char priorityName[8];
+    le_result_t result = le_cfg_GetString(iter,
+                                          "priority",
+                                          priorityName,
+                                          sizeof(priorityName),
+                                          "");
+
+    if ((result == LE_OK) && (strcmp(priorityName, "high") == 0))
+    {
+        return SENSOR_PRIORITY_HIGH;
+    }
+
+    if ((result == LE_OK) && (strcmp(priorityName, "low") == 0))
+    {
+        return SENSOR_PRIORITY_LOW;
+    }
+
+    if ((result != LE_OK) || (priorityName[0] != '\0'))
+    {
+        LE_ERROR("Ignoring unsupported priority of sensor '%s'.", sensorName);
+    }
+
+    return defaultValue;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sensor to the Sensors array, with any settings found in the config tree overriding those
+ * of its description.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddSensor
+(
+    const SensorDesc_t* descPtr,
+    le_cfg_IteratorRef_t iter   ///< Iterator positioned at the sensor's node.
+)
+{
+    if (SensorCount >= MAX_SENSORS)
+    {
+        LE_ERROR("Too many sensors (max %d).  Ignoring '%s'.", MAX_SENSORS, descPtr->name);
+        return;
+    }
+
+    Sensor_t* sensorPtr = &Sensors[SensorCount];
+    SensorDesc_t* overridePtr = &sensorPtr->desc;
+
+    *overridePtr = *descPtr;
+
+    // Summaries come from the aggregator component, which has no polling period.
+    if (descPtr->type != SAMPLE_TYPE_SUMMARY)
+    {
+        overridePtr->period = GetConfigFloat(iter, descPtr->name, "period", descPtr->period);
+        overridePtr->maxPeriod = GetConfigFloat(iter,
+                                                descPtr->name,
+                                                "maxPeriod",
+                                                descPtr->maxPeriod);
+    }
+
+    overridePtr->priority = GetConfigPriority(iter, descPtr->name, descPtr->priority);
+
+    overridePtr->bufferCount = GetConfigUint(iter,
+                                             descPtr->name,
+                                             "bufferCount",
+                                             descPtr->bufferCount,
+                                             1,
+                                             INT32_MAX);
+    overridePtr->changeBy = GetConfigFloat(iter, descPtr->name, "changeBy", descPtr->changeBy);
+    overridePtr->batchCount = GetConfigUint(iter,
+                                            descPtr->name,
+                                            "batchCount",
+                                            descPtr->batchCount,
+                                            1,
+                                            INT32_MAX);
+    overridePtr->pushWindow = GetConfigUint(iter,
+                                            descPtr->name,
+                                            "pushWindow",
+                                            descPtr->pushWindow,
+                                            1,
+                                            MAX_PUSH_WINDOW);
+    overridePtr->isOnDemand = le_cfg_GetBool(iter, "onDemand", descPtr->isOnDemand);
+    overridePtr->isRawKept = le_cfg_GetBool(iter, "keepRaw", descPtr->isRawKept);
+
+    if (descPtr->type == SAMPLE_TYPE_SUMMARY)
+    {
+        InternSummaryPaths(sensorPtr);
+    }
+
+    sensorPtr->sampleBytes = EstimateSampleBytes(sensorPtr);
+    SetSensorState(sensorPtr, SENSOR_STATE_IDLE);
+
+    SensorCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the description of a sensor that was added in the config tree, and add it to the Sensors
+ * array.
+ *
+ * @return
+ *      - LE_OK on success
+ *      - LE_FORMAT_ERROR if the sensor's description is incomplete or invalid
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LoadConfigSensor
+(
+    le_cfg_IteratorRef_t iter,  ///< Iterator positioned at the sensor's node.
+    const char* name
+)
+{
+    ConfigSensor_t* configPtr = le_mem_ForceAlloc(ConfigSensorPool);
+    char typeName[16];
+    char path[64];
+
+    SensorDesc_t desc =
+    {
+        name: configPtr->name,
+        obsPath: configPtr->obsPath,
+        inputPath: configPtr->inputPath,
+        fields: configPtr->fields,
+        fieldCount: 0,
+        period: 0.0,
+        maxPeriod: 0.0,
+        priority: SENSOR_PRIORITY_LOW,
+        bufferCount: CONFIG_SENSOR_BUFFER_COUNT,
+        changeBy: 0.0,
+        changeByMetric: CHANGE_BY_EUCLIDEAN,
+        batchCount: CONFIG_SENSOR_BATCH_COUNT,
+        pushWindow: CONFIG_SENSOR_PUSH_WINDOW,
+        isOnDemand: false,
+        isRawKept: true,
+        compactAvPath: NULL,
+    };
+
+    LE_ASSERT_OK(le_utf8_Copy(configPtr->name, name, sizeof(configPtr->name), NULL));
+    LE_ASSERT(snprintf(configPtr->obsPath, sizeof(configPtr->obsPath), "/obs/%s", name)
+              < (int)sizeof(configPtr->obsPath));
+
+    (void)le_cfg_GetString(iter, "type", typeName, sizeof(typeName), "");
+
+    if (strcmp(typeName, "numeric") == 0)
+    {
+        desc.type = SAMPLE_TYPE_NUMERIC;
+    }
+    else if (strcmp(typeName, "vector") == 0)
+    {
+        desc.type = SAMPLE_TYPE_VECTOR;
+    }
+    else if (strcmp(typeName, "json") == 0)
+    {
+        desc.type = SAMPLE_TYPE_JSON;
+    }
+    else
+    {
+        LE_ERROR("Sensor '%s' has unsupported type '%s'.", name, typeName);
+        goto error;
+    }
+
+    if (   (le_cfg_GetString(iter,
+                             "input",
+                             configPtr->inputPath,
+                             sizeof(configPtr->inputPath),
+                             "") != LE_OK)
+        || (configPtr->inputPath[0] == '\0') )
+    {
+        LE_ERROR("Sensor '%s' has no valid input path.", name);
+        goto error;
+    }
+
+    // Fields are numbered from 0 up.
+    while (desc.fieldCount < MAX_SENSOR_FIELDS)
+    {
+        size_t i = desc.fieldCount;
+        SensorField_t* fieldPtr = &configPtr->fields[i];
+
+        snprintf(path, sizeof(path), "fields/%zu", i);
+        if (!le_cfg_NodeExists(iter, path))
+        {
+            break;
+        }
+
+        snprintf(path, sizeof(path), "fields/%zu/avPath", i);
+        if (   (le_cfg_GetString(iter,
+                                 path,
+                                 configPtr->avPaths[i],
+                                 sizeof(configPtr->avPaths[i]),
+                                 "") != LE_OK)
+            || (configPtr->avPaths[i][0] == '\0') )
+        {
+            LE_ERROR("Field %zu of sensor '%s' has no valid avPath.", i, name);
+            goto error;
+        }
+        fieldPtr->avPath = configPtr->avPaths[i];
+
+        snprintf(path, sizeof(path), "fields/%zu/member", i);
+        if (   (le_cfg_GetString(iter,
+                                 path,
+                                 configPtr->members[i],
+                                 sizeof(configPtr->members[i]),
+                                 "") != LE_OK)
+            || ((desc.type == SAMPLE_TYPE_JSON) && (configPtr->members[i][0] == '\0')) )
+        {
+            LE_ERROR("Field %zu of sensor '%s' has no valid JSON member name.", i, name);
+            goto error;
+        }
+        fieldPtr->member = configPtr->members[i];
+
+        snprintf(path, sizeof(path), "fields/%zu/isInt", i);
+        fieldPtr->isInt = le_cfg_GetBool(iter, path, false);
+
+        snprintf(path, sizeof(path), "fields/%zu/resolution", i);
+        int32_t exponent = le_cfg_GetInt(iter, path, 0);
+        if ((exponent < INT8_MIN) || (exponent > INT8_MAX))
+        {
+            LE_ERROR("Field %zu of sensor '%s' has invalid resolution %d.", i, name, (int)exponent);
+            goto error;
+        }
+        fieldPtr->resolutionExp = (int8_t)exponent;
+
+        desc.fieldCount++;
+    }
+
+    if (   (desc.fieldCount == 0)
+        || ((desc.type == SAMPLE_TYPE_NUMERIC) && (desc.fieldCount != 1)) )
     {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
+        LE_ERROR("Sensor '%s' has the wrong number of fields (%zu).", name, desc.fieldCount);
+        goto error;
     }
 
-    double z = ExtractNumber(value, "z");
-    if (isnan(z))
+    if (   (le_cfg_GetString(iter,
+                             "compactAvPath",
+                             configPtr->compactAvPath,
+                             sizeof(configPtr->compactAvPath),
+                             "") == LE_OK)
+        && (configPtr->compactAvPath[0] != '\0') )
     {
-        LE_ERROR("Failed to decode gyro value.");
-        return LE_FAULT;
+        desc.compactAvPath = configPtr->compactAvPath;
     }
 
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    LE_INFO("Adding %s sensor '%s' from the config tree.", typeName, name);
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+    AddSensor(&desc, iter);
 
-    // The '_' is a placeholder that will be replaced
-    char path[] = "MangOH.Sensors.Accelerometer.Gyro._";
-    le_result_t result;
+    return LE_OK;
 
-    path[sizeof(path) - 2] = 'X';
-    result = le_avdata_RecordFloat(rec, path, x, ms);
-    if (result != LE_OK)
+error:
+
+    le_mem_Release(configPtr);
+
+    return LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a sensor name is that of one of the BuiltInSensors.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsBuiltInSensor
+(
+    const char* name
+)
+{
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(BuiltInSensors); i++)
     {
-        LE_ERROR("Couldn't record gyro x reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        if (strcmp(BuiltInSensors[i].name, name) == 0)
+        {
+            return true;
+        }
     }
 
-    path[sizeof(path) - 2] = 'Y';
-    result = le_avdata_RecordFloat(rec, path, y, ms);
-    if (result != LE_OK)
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the Sensors array from the BuiltInSensors and the app's config tree.
+ *
+ * Each node under "sensors" in the config tree holds the settings of the sensor with that name.
+ * A built-in sensor's settings override those in its description, and the sensor is left out if
+ * its "enable" setting is false.  Any other node describes an extra sensor to push.  See the top
+ * of this file for the settings.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadSensors
+(
+    void
+)
+{
+    le_cfg_IteratorRef_t iter = le_cfg_CreateReadTxn(SENSORS_CONFIG_PATH);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(BuiltInSensors); i++)
     {
-        LE_ERROR("Couldn't record gyro y reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        const SensorDesc_t* descPtr = &BuiltInSensors[i];
+
+        le_cfg_GoToNode(iter, descPtr->name);
+
+        if (le_cfg_GetBool(iter, "enable", true))
+        {
+            AddSensor(descPtr, iter);
+        }
+        else
+        {
+            LE_INFO("Sensor '%s' is disabled.", descPtr->name);
+        }
+
+        le_cfg_GoToNode(iter, "..");
     }
 
-    path[sizeof(path) - 2] = 'Z';
-    result = le_avdata_RecordFloat(rec, path, z, ms);
-    if (result != LE_OK)
+    if (le_cfg_GoToFirstChild(iter) == LE_OK)
     {
-        LE_ERROR("Couldn't record gyro z reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        do
+        {
+            char name[MAX_CONFIG_NAME_BYTES];
+
+            if (le_cfg_GetNodeName(iter, "", name, sizeof(name)) != LE_OK)
+            {
+                LE_ERROR("Ignoring sensor with a name longer than %d bytes.",
+                         MAX_CONFIG_NAME_BYTES - 1);
+            }
+            else if (!IsBuiltInSensor(name))
+            {
+                (void)LoadConfigSensor(iter, name);
+            }
+        }
+        while (le_cfg_GoToNextSibling(iter) == LE_OK);
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &Gyroscope);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    le_cfg_CancelTxn(iter);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill in the SensorsByPriority array.
+ */
+//--------------------------------------------------------------------------------------------------
+static void OrderSensorsByPriority
+(
+    void
+)
+{
+    size_t count = 0;
+
+    for (size_t p = 0; p < NUM_ARRAY_MEMBERS(PriorityOrder); p++)
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        for (size_t i = 0; i < SensorCount; i++)
+        {
+            if (Sensors[i].desc.priority == PriorityOrder[p])
+            {
+                SensorsByPriority[count++] = &Sensors[i];
+            }
+        }
     }
 
-done:
+    LE_ASSERT(count == SensorCount);
+}
 
-    le_avdata_DeleteRecord(rec);
 
-    return result;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set up the upload budget, with any rates found in the config tree overriding the defaults.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadBudget
+(
+    void
+)
+{
+    le_cfg_IteratorRef_t iter = le_cfg_CreateReadTxn(BUDGET_CONFIG_PATH);
+
+    unsigned int bytesPerHour = GetConfigUint(iter,
+                                              BUDGET_CONFIG_PATH,
+                                              "bytesPerHour",
+                                              BUDGET_BYTES_PER_HOUR,
+                                              0,
+                                              INT32_MAX);
+    unsigned int pushesPerHour = GetConfigUint(iter,
+                                               BUDGET_CONFIG_PATH,
+                                               "pushesPerHour",
+                                               BUDGET_PUSHES_PER_HOUR,
+                                               0,
+                                               INT32_MAX);
+
+    le_cfg_CancelTxn(iter);
+
+    LE_INFO("Upload budget: %u bytes and %u pushes per hour (0 = unlimited).",
+            bytesPerHour,
+            pushesPerHour);
+
+    InitBucket(&ByteBudget, bytesPerHour);
+    InitBucket(&PushBudget, pushesPerHour);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Records a position reading into a given avdata record.
- *
- * The JSON value is expected to look like this:
- *
- * { "lat": 49.172350, "lon": -123.070987, "hAcc": 14.000000, "alt": 0.009000, "vAcc": 8.000000 }
- *
- * @return
- *      - LE_OK on success
- *      - LE_OVERFLOW if the record is full
- *      - LE_FAULT non-specific failure
+ * Setting handler.
+ * This function is called whenever AirVantage writes a sensor's Period setting.  The new polling
+ * period (seconds) takes effect right away.
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t PushPosition
+static void PeriodSettingHandler
 (
-    double timestamp,
-    const char* value   ///< JSON string.
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
 )
 {
-    double latitude = ExtractNumber(value, "lat");
-    if (isnan(latitude))
-    {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
+    Sensor_t* sensorPtr = contextPtr;
+    double period;
 
-    double longitude = ExtractNumber(value, "lon");
-    if (isnan(longitude))
+    if (accessType != LE_AVDATA_ACCESS_WRITE)
     {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
+        return;
     }
 
-    double hAccuracy = ExtractNumber(value, "hAcc");
-    if (isnan(hAccuracy))
+    if ((le_avdata_GetFloat(path, &period) != LE_OK) || !(period > 0.0))
     {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
-    }
+        LE_WARN("Invalid period for '%s'.", sensorPtr->desc.obsPath);
 
-    double altitude = ExtractNumber(value, "alt");
-    if (isnan(altitude))
-    {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
+        // Put back the period in effect.
+        (void)le_avdata_SetFloat(path, sensorPtr->desc.period);
+        return;
     }
 
-    double vAccuracy = ExtractNumber(value, "vAcc");
-    if (isnan(vAccuracy))
+    LE_INFO("Changing period of '%s' to %lf s.", sensorPtr->desc.obsPath, period);
+
+    sensorPtr->desc.period = period;
+
+    // A sensor that hasn't been configured yet gets the new period when it is.
+    if (sensorPtr->setupStep <= SETUP_STEP_SENSOR)
     {
-        LE_ERROR("Failed to decode position value.");
-        return LE_FAULT;
+        return;
     }
 
-    // Convert the timestamp to an integer number of milliseconds.
-    uint64_t ms = (uint64_t)(timestamp * 1000.0);
+    char periodPath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
+    GetSensorResourcePath(sensorPtr->desc.inputPath, "period", periodPath, sizeof(periodPath));
 
-    le_avdata_RecordRef_t rec = le_avdata_CreateRecord();
+    // Update the default too, in case the sensor's period input is ever reset.
+    dhubAdmin_SetNumericDefault(periodPath, period);
+    dhubAdmin_PushNumeric(periodPath, 0.0, period);
 
-    // The '_' is a placeholder that will be replaced
-    char path[] = "lwm2m.6.0._";
-    le_result_t result;
+    StartAdaptiveSampling(sensorPtr);
+}
 
-    path[sizeof(path) - 2] = '0';
-    result = le_avdata_RecordFloat(rec, path, latitude, ms);
-    if (result != LE_OK)
-    {
-        LE_ERROR("Couldn't record gps latitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
-    }
 
-    path[sizeof(path) - 2] = '1';
-    result = le_avdata_RecordFloat(rec, path, longitude, ms);
-    if (result != LE_OK)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Setting handler.
+ * This function is called whenever AirVantage writes a sensor's BufferCount setting.  The new size
+ * of the sensor's Data Hub observation buffer (# of samples) takes effect right away.
+ */
+//--------------------------------------------------------------------------------------------------
+static void BufferCountSettingHandler
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+)
+{
+    Sensor_t* sensorPtr = contextPtr;
+    int32_t bufferCount;
+
+    if (accessType != LE_AVDATA_ACCESS_WRITE)
     {
-        LE_ERROR("Couldn't record gps longitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        return;
     }
 
-    path[sizeof(path) - 2] = '3';
-    result = le_avdata_RecordFloat(rec, path, hAccuracy, ms);
-    if (result != LE_OK)
+    if ((le_avdata_GetInt(path, &bufferCount) != LE_OK) || (bufferCount < 1))
     {
-        LE_ERROR("Couldn't record gps horizontal accuracy reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        LE_WARN("Invalid buffer count for '%s'.", sensorPtr->desc.obsPath);
+
+        // Put back the buffer count in effect.
+        (void)le_avdata_SetInt(path, (int32_t)sensorPtr->desc.bufferCount);
+        return;
     }
 
-    path[sizeof(path) - 2] = '2';
-    result = le_avdata_RecordFloat(rec, path, altitude, ms);
-    if (result != LE_OK)
+    LE_INFO("Changing buffer count of '%s' to %d.", sensorPtr->desc.obsPath, (int)bufferCount);
+
+    sensorPtr->desc.bufferCount = (unsigned int)bufferCount;
+
+    // An observation that hasn't been created yet gets the new buffer count when it is.
+    if (sensorPtr->setupStep > SETUP_STEP_OBSERVATION)
     {
-        LE_ERROR("Couldn't record gps altitude reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        dhubAdmin_SetBufferMaxCount(sensorPtr->desc.obsPath, sensorPtr->desc.bufferCount);
     }
+}
 
-    result = le_avdata_RecordFloat(rec, "MangOH.Sensors.Gps.VerticalAccuracy", vAccuracy, ms);
-    if (result != LE_OK)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Setting handler.
+ * This function is called whenever AirVantage writes a sensor's ChangeBy setting.  The new
+ * change-by threshold (0 = none) applies to the next sample received.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChangeBySettingHandler
+(
+    const char* path,
+    le_avdata_AccessType_t accessType,
+    le_avdata_ArgumentListRef_t argumentList,
+    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+)
+{
+    Sensor_t* sensorPtr = contextPtr;
+    double changeBy;
+
+    if (accessType != LE_AVDATA_ACCESS_WRITE)
     {
-        LE_ERROR("Couldn't record gps vertical accuracy reading - %s", LE_RESULT_TXT(result));
-        goto done;
+        return;
     }
 
-    result = le_avdata_PushRecord(rec, HandleAvPushComplete, &PositionSensor);
-    if ((result != LE_OK) && (result != LE_BUSY))
+    if ((le_avdata_GetFloat(path, &changeBy) != LE_OK) || !(changeBy >= 0.0))
     {
-        LE_CRIT("Failed to push to AirVantage Agent (%s).", LE_RESULT_TXT(result));
-        goto done;
+        LE_WARN("Invalid change-by threshold for '%s'.", sensorPtr->desc.obsPath);
+
+        // Put back the threshold in effect.
+        (void)le_avdata_SetFloat(path, sensorPtr->desc.changeBy);
+        return;
     }
 
-done:
+    LE_INFO("Changing change-by threshold of '%s' to %lf.", sensorPtr->desc.obsPath, changeBy);
 
-    le_avdata_DeleteRecord(rec);
+    sensorPtr->desc.changeBy = changeBy;
 
-    return result;
+    // Numeric samples are filtered by the Data Hub, the others by IsWithinChangeBy().  An
+    // observation that hasn't been created yet gets the new threshold when it is.
+    if (   (sensorPtr->desc.type == SAMPLE_TYPE_NUMERIC)
+        && (sensorPtr->setupStep > SETUP_STEP_OBSERVATION))
+    {
+        dhubAdmin_SetChangeBy(sensorPtr->desc.obsPath, changeBy);
+    }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a numeric sensor sample to the cloud.
+ * Create the AirVantage settings that let a sensor be tuned while it's running, e.g.,
+ * "/Settings/light/Period".  Changes made through the settings are not saved; the sensor goes back
+ * to its configured settings when the app restarts.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushNumeric
+static void CreateSensorSettings
 (
-    Sensor_t* sensorPtr,
-    double timestamp,
-    double value
+    Sensor_t* sensorPtr
 )
 {
-    le_result_t result;
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+    const char* path;
 
-    sensorPtr->timestamp = timestamp;
-
-    if (sensorPtr == &LightSensor)
-    {
-        result = PushLightLevel(timestamp, value);
-    }
-    else if (sensorPtr == &PressureSensor)
+    // Only sensors that avPublisher polls have a period to change.
+    if (descPtr->period > 0.0)
     {
-        result = PushPressure(timestamp, value);
+        path = InternPath("%s/%s/Period", SENSOR_SETTINGS_RES, descPtr->name);
+        le_avdata_CreateResource(path, LE_AVDATA_ACCESS_SETTING);
+        (void)le_avdata_SetFloat(path, descPtr->period);
+        le_avdata_AddResourceEventHandler(path, PeriodSettingHandler, sensorPtr);
     }
-    else if (sensorPtr == &Thermometer)
+
+    path = InternPath("%s/%s/BufferCount", SENSOR_SETTINGS_RES, descPtr->name);
+    le_avdata_CreateResource(path, LE_AVDATA_ACCESS_SETTING);
+    (void)le_avdata_SetInt(path, (int32_t)descPtr->bufferCount);
+    le_avdata_AddResourceEventHandler(path, BufferCountSettingHandler, sensorPtr);
+
+    // Summaries and blocks are never filtered.
+    if ((descPtr->type != SAMPLE_TYPE_SUMMARY) && (descPtr->type != SAMPLE_TYPE_BLOCK))
     {
-        result = PushTemperature(timestamp, value);
+        path = InternPath("%s/%s/ChangeBy", SENSOR_SETTINGS_RES, descPtr->name);
+        le_avdata_CreateResource(path, LE_AVDATA_ACCESS_SETTING);
+        (void)le_avdata_SetFloat(path, descPtr->changeBy);
+        le_avdata_AddResourceEventHandler(path, ChangeBySettingHandler, sensorPtr);
     }
-    else
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the AirVantage variables (e.g., "/Metrics/light/Pushed") that a sensor's metrics are
+ * published to, and work out the path of their Data Hub Input (e.g., "metrics/light").  The Input
+ * itself is created by the sensor's setup.  See CreateMetricsInput().
+ */
+//--------------------------------------------------------------------------------------------------
+static void CreateSensorMetrics
+(
+    Sensor_t* sensorPtr
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+
+    metricsPtr->stateSince = GetUptime();
+    metricsPtr->periodStart = metricsPtr->stateSince;
+
+    for (size_t i = 0; i < METRIC_COUNT; i++)
     {
-        LE_FATAL("Unexpected numeric sensor '%s'.", sensorPtr->obsPath);
+        metricsPtr->avPaths[i] = InternPath("%s/%s/%s",
+                                            SENSOR_METRICS_RES,
+                                            sensorPtr->desc.name,
+                                            MetricNames[i]);
+        le_avdata_CreateResource(metricsPtr->avPaths[i], LE_AVDATA_ACCESS_VARIABLE);
     }
 
+    int len = snprintf(metricsPtr->inputPath,
+                       sizeof(metricsPtr->inputPath),
+                       "%s/%s",
+                       METRICS_INPUT_PREFIX,
+                       sensorPtr->desc.name);
+    LE_ASSERT((len > 0) && ((size_t)len < sizeof(metricsPtr->inputPath)));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create the Data Hub Input that a sensor's metrics are published to.  If it already exists with
+ * the same type, that one is used.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - any other result of dhubIO_CreateInput() if the Input couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CreateMetricsInput
+(
+    Sensor_t* sensorPtr
+)
+{
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+
+    le_result_t result = dhubIO_CreateInput(metricsPtr->inputPath, DHUBIO_DATA_TYPE_JSON, "");
     if (result != LE_OK)
     {
-        LE_CRIT("Failed (%s) delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
+        LE_WARN("Failed to create Data Hub Input '%s' (%s).",
+                metricsPtr->inputPath,
+                LE_RESULT_TXT(result));
+        return result;
+    }
 
-        sensorPtr->state = SENSOR_STATE_FAULT;
+    dhubIO_SetJsonExample(metricsPtr->inputPath,
+                          "{\"Received\":1,\"Pushed\":1,\"Dropped\":0,\"Failed\":0,"
+                          "\"LatencyMean\":0.5,\"LatencyHistogram\":[1,0,0,0,0,0,0,0,0],"
+                          "\"IdleTime\":1.0,\"PushingTime\":0.5,\"BackloggedTime\":0.0,"
+                          "\"FaultTime\":0.0,\"BacklogSeconds\":0.0,\"BacklogFill\":0.0,"
+                          "\"Pushes\":1,\"PushesPerSample\":1.0,\"SampleRate\":0.1,"
+                          "\"DeliveryRate\":0.1,\"CpuPerSample\":50.0,"
+                          "\"HandoffDropped\":0,\"HandoffPeak\":0.0}");
 
-        // Wait for another update from the sensor to trigger a retry.
-    }
+    return LE_OK;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a JSON sensor sample to the cloud.
+ * Publish the metrics of a sensor's push pipeline, as AirVantage variables and to the Data Hub.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushJson
+static void PublishSensorMetrics
 (
-    Sensor_t* sensorPtr,
-    double timestamp,
-    const char* value
+    Sensor_t* sensorPtr
 )
 {
-    le_result_t result;
-
-    sensorPtr->timestamp = timestamp;
-
-    if (sensorPtr == &Accelerometer)
+    SensorMetrics_t* metricsPtr = &sensorPtr->metrics;
+    double values[METRIC_COUNT];
+    double now = GetUptime();
+    double elapsed = now - metricsPtr->periodStart;
+
+    AccountStateTime(sensorPtr);
+
+    values[METRIC_RECEIVED] = metricsPtr->receivedCount;
+    values[METRIC_PUSHED] = metricsPtr->pushedCount;
+    values[METRIC_DROPPED] = metricsPtr->droppedCount;
+    values[METRIC_FAILED] = metricsPtr->failedCount;
+    values[METRIC_LATENCY_MEAN] = (metricsPtr->latencyCount == 0) ? 0.0
+                                : (metricsPtr->latencySum / metricsPtr->latencyCount);
+    values[METRIC_LATENCY_HISTOGRAM] = 0.0;
+    values[METRIC_IDLE_TIME] = metricsPtr->stateTimes[SENSOR_STATE_IDLE];
+    values[METRIC_PUSHING_TIME] = metricsPtr->stateTimes[SENSOR_STATE_PUSHING];
+    values[METRIC_BACKLOGGED_TIME] = metricsPtr->stateTimes[SENSOR_STATE_BACKLOGGED];
+    values[METRIC_FAULT_TIME] = metricsPtr->stateTimes[SENSOR_STATE_FAULT];
+
+    // The queue doesn't count its samples, so estimate the number undelivered from how far
+    // behind the newest sample the delivery cursor is, and how often samples arrive.
+    double backlog = 0.0;
+    if (sensorPtr->queueRef != NULL)
     {
-        result = PushAcceleration(timestamp, value);
+        backlog = sampleQueue_GetNewest(sensorPtr->queueRef) - sensorPtr->lastDeliveredTimestamp;
     }
-    else if (sensorPtr == &Gyroscope)
+    if (!(backlog > 0.0))
     {
-        result = PushAngularVelocity(timestamp, value);
+        backlog = 0.0;
     }
-    else if (sensorPtr == &PositionSensor)
+
+    values[METRIC_BACKLOG_SECONDS] = backlog;
+    values[METRIC_BACKLOG_FILL] = (metricsPtr->sampleInterval > 0.0)
+                                ? ((backlog / metricsPtr->sampleInterval)
+                                   / sensorPtr->desc.bufferCount)
+                                : 0.0;
+
+    values[METRIC_PUSHES] = metricsPtr->pushCount;
+    values[METRIC_PUSHES_PER_SAMPLE] = (metricsPtr->pushedCount == 0) ? 0.0
+                                     : ((double)metricsPtr->pushCount / metricsPtr->pushedCount);
+
+    // If the delivery rate stays below the sample rate, the link can't sustain the sample rate.
+    if (elapsed > 0.0)
     {
-        result = PushPosition(timestamp, value);
+        values[METRIC_SAMPLE_RATE] =
+            (metricsPtr->receivedCount - metricsPtr->periodReceivedCount) / elapsed;
+        values[METRIC_DELIVERY_RATE] =
+            (metricsPtr->pushedCount - metricsPtr->periodPushedCount) / elapsed;
     }
     else
     {
-        LE_FATAL("Unexpected numeric sensor '%s'.", sensorPtr->obsPath);
+        values[METRIC_SAMPLE_RATE] = 0.0;
+        values[METRIC_DELIVERY_RATE] = 0.0;
     }
 
-    if (result == LE_FORMAT_ERROR)
+    values[METRIC_CPU_PER_SAMPLE] = (metricsPtr->receivedCount == 0) ? 0.0
+                                  : ((metricsPtr->cpuTime * 1000000.0) / metricsPtr->receivedCount);
+
+    // The handoff statistics are updated by the main thread while the worker thread runs.
+    values[METRIC_HANDOFF_DROPPED] = __atomic_load_n(&metricsPtr->handoffDroppedCount,
+                                                     __ATOMIC_RELAXED);
+    values[METRIC_HANDOFF_PEAK] = (double)__atomic_exchange_n(&metricsPtr->handoffPeak,
+                                                              0,
+                                                              __ATOMIC_RELAXED)
+                                / HANDOFF_QUEUE_COUNT;
+
+    metricsPtr->periodStart = now;
+    metricsPtr->periodReceivedCount = metricsPtr->receivedCount;
+    metricsPtr->periodPushedCount = metricsPtr->pushedCount;
+
+    char histogram[LATENCY_BUCKET_COUNT * 11 + 1];
+    size_t histogramLen = 0;
+
+    for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        histogramLen += snprintf(histogram + histogramLen,
+                                 sizeof(histogram) - histogramLen,
+                                 "%s%" PRIu32,
+                                 (i == 0) ? "" : ",",
+                                 metricsPtr->latencyCounts[i]);
+        LE_ASSERT(histogramLen < sizeof(histogram));
+    }
+
+    char json[IO_MAX_STRING_VALUE_LEN + 1];
+    size_t len = snprintf(json, sizeof(json), "{");
+
+    for (size_t i = 0; i < METRIC_COUNT; i++)
     {
-        LE_CRIT("Discarding malformed value from '%s' (%s).", sensorPtr->obsPath, value);
+        const char* separator = (i == 0) ? "" : ",";
 
-        sensorPtr->lastDeliveredTimestamp = timestamp;
-        if (sensorPtr->state == SENSOR_STATE_PUSHING)
+        if (i == METRIC_LATENCY_HISTOGRAM)
         {
-            sensorPtr->state = SENSOR_STATE_IDLE;
+            (void)le_avdata_SetString(metricsPtr->avPaths[i], histogram);
+            len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":[%s]",
+                            separator, MetricNames[i], histogram);
         }
+        else if ((i <= METRIC_FAILED) || (i == METRIC_PUSHES) || (i == METRIC_HANDOFF_DROPPED))
+        {
+            (void)le_avdata_SetInt(metricsPtr->avPaths[i], (int32_t)values[i]);
+            len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":%.0f",
+                            separator, MetricNames[i], values[i]);
+        }
+        else
+        {
+            (void)le_avdata_SetFloat(metricsPtr->avPaths[i], values[i]);
+            len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":%.9g",
+                            separator, MetricNames[i], values[i]);
+        }
+        LE_ASSERT(len < sizeof(json));
     }
 
-    if (result != LE_OK)
+    len += snprintf(json + len, sizeof(json) - len, "}");
+    LE_ASSERT(len < sizeof(json));
+
+    // Until the sensor's setup gets as far as creating the metrics' Input, they only go to
+    // AirVantage.
+    if (sensorPtr->setupStep == SETUP_STEP_DONE)
     {
-        LE_CRIT("%s: Delivery of '%s' stalled.", LE_RESULT_TXT(result), sensorPtr->obsPath);
+        dhubIO_PushJson(metricsPtr->inputPath, 0.0, json);
+    }
+}
 
-        sensorPtr->state = SENSOR_STATE_FAULT;
 
-        // Wait for another update from the sensor to trigger a retry.
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler called every METRICS_PERIOD_MS to publish the sensors' metrics.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MetricsTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        PublishSensorMetrics(&Sensors[i]);
     }
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Push a sensor's backlog (or at least, the oldest samples of the backlog).
+ * Register for notification when a sensor's observation receives updates.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FAULT if the push handler couldn't be registered.
  */
 //--------------------------------------------------------------------------------------------------
-static void PushBacklog
+static le_result_t AddPushHandler
 (
     Sensor_t* sensorPtr
 )
-//--------------------------------------------------------------------------------------------------
 {
-    // Fetch the oldest undelivered record from the Data Hub observation buffer for this sensor.
-    if (   (sensorPtr == &Accelerometer)
-        || (sensorPtr == &Gyroscope)
-        || (sensorPtr == &PositionSensor)  )
-    {
-        double timestamp;
-        char value[IO_MAX_STRING_VALUE_LEN + 1];
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+    void* handlerRef = NULL;
 
-        le_result_t result = dhubQuery_ReadBufferSampleJson(sensorPtr->obsPath,
-                                                            sensorPtr->lastDeliveredTimestamp,
-                                                            &timestamp,
-                                                            value,
-                                                            sizeof(value));
-        if (result == LE_OK)
-        {
-            PushJson(sensorPtr, timestamp, value);
-        }
-        else if (result == LE_NOT_FOUND)
-        {
-            sensorPtr->state = SENSOR_STATE_IDLE;
-        }
-        else
-        {
-            LE_CRIT("Unexpected result code (%s) from Data Hub query.", LE_RESULT_TXT(result));
-        }
-    }
-    else if (   (sensorPtr == &LightSensor)
-             || (sensorPtr == &PressureSensor)
-             || (sensorPtr == &Thermometer)  )
+    switch (descPtr->type)
     {
-        double timestamp;
-        double value;
+        case SAMPLE_TYPE_NUMERIC:
 
-        le_result_t result = dhubQuery_ReadBufferSampleNumeric(sensorPtr->obsPath,
-                                                               sensorPtr->lastDeliveredTimestamp,
-                                                               &timestamp,
-                                                               &value);
-        if (result == LE_OK)
-        {
-            PushNumeric(sensorPtr, timestamp, value);
-        }
-        else if (result == LE_NOT_FOUND)
-        {
-            sensorPtr->state = SENSOR_STATE_IDLE;
-        }
-        else
-        {
-            LE_CRIT("Unexpected result code (%s) from Data Hub query.", LE_RESULT_TXT(result));
-        }
+            handlerRef = dhubAdmin_AddNumericPushHandler(descPtr->obsPath,
+                                                         HandleNumericUpdate,
+                                                         sensorPtr);
+            break;
+
+        case SAMPLE_TYPE_VECTOR:
+        case SAMPLE_TYPE_BLOCK:
+
+            handlerRef = dhubAdmin_AddStringPushHandler(descPtr->obsPath,
+                                                        HandleStringUpdate,
+                                                        sensorPtr);
+            break;
+
+        case SAMPLE_TYPE_JSON:
+        case SAMPLE_TYPE_SUMMARY:
+
+            handlerRef = dhubAdmin_AddJsonPushHandler(descPtr->obsPath,
+                                                      HandleStringUpdate,
+                                                      sensorPtr);
+            break;
     }
-    else
+
+    if (handlerRef == NULL)
     {
-        LE_FATAL("Unrecognized sensor object %p.", sensorPtr);
+        LE_WARN("Failed to register for updates of '%s'.", descPtr->obsPath);
+        return LE_FAULT;
     }
+
+    return LE_OK;
 }
 
 
-//-------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------
 /**
- * Command data handler.
- * This function is called whenever AirVantage performs an execute on the set value command
+ * Connect a sensor's observation to the sensor's input in the Data Hub, unless it already is.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - any other result of dhubAdmin_SetSource() if the observation couldn't be connected.
  */
-//-------------------------------------------------------------------------------------------------
-static void SetLedBlinkIntervalCmd
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetObservationSource
 (
-    const char* path,
-    le_avdata_AccessType_t accessType,
-    le_avdata_ArgumentListRef_t argumentList,
-    void* contextPtr
+    Sensor_t* sensorPtr
 )
 {
-    char val[32];
-    le_result_t result = LE_OK;
-
-    LE_DEBUG("Set LED blink interval");
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+    char sourcePath[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
 
-    result = le_avdata_GetStringArg(argumentList, LED_CMD_LED_BLINK_INTERVAL_RES, val, sizeof(val));
-    if (result != LE_OK)
+    if (   (dhubAdmin_GetSource(descPtr->obsPath, sourcePath, sizeof(sourcePath)) == LE_OK)
+        && (strcmp(sourcePath, descPtr->inputPath) == 0))
     {
-        LE_ERROR("le_avdata_GetStringArg('%s') failed(%d)", LED_CMD_LED_BLINK_INTERVAL_RES, result);
-        goto cleanup;
+        return LE_OK;
     }
 
-    LE_INFO("interval('%s')", val);
-    int ledBlinkDuration = atoi(val);
-    if (ledBlinkDuration < 0)
-    {
-        LE_WARN("Invalid max interval between publish (%d >= 0)", ledBlinkDuration);
-        result = LE_OUT_OF_RANGE;
-        goto cleanup;
-    }
-    else
+    le_result_t result = dhubAdmin_SetSource(descPtr->obsPath, descPtr->inputPath);
+    if (result != LE_OK)
     {
-        // Push the period (which is 2 * the interval) to the Data Hub.
-        dhubAdmin_PushNumeric("/app/ledService/blinkPeriod", 0.0, (double)(ledBlinkDuration * 2));
-
-        // Activate the LED.
-        dhubAdmin_PushBoolean("/app/ledService/value", 0.0, true);
+        LE_WARN("Failed to connect '%s' to '%s' (%s).",
+                descPtr->obsPath,
+                descPtr->inputPath,
+                LE_RESULT_TXT(result));
     }
 
-cleanup:
-    le_avdata_ReplyExecResult(argumentList, result);
+    return result;
 }
 
-//-------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
 /**
- * Command data handler.
- * This function is called whenever AirVantage performs an execute on the activate LED command
+ * Schedule a retry of a sensor's setup, from the step that failed, after an exponentially
+ * growing, randomized wait.
  */
-//-------------------------------------------------------------------------------------------------
-static void ActivateLedCmd
+//--------------------------------------------------------------------------------------------------
+static void NoteSetupFailure
 (
-    const char* path,
-    le_avdata_AccessType_t accessType,
-    le_avdata_ArgumentListRef_t argumentList,
-    void* contextPtr
+    Sensor_t* sensorPtr
 )
 {
-    LE_DEBUG("Activate LED");
+    sensorPtr->setupFailureCount++;
 
-    dhubAdmin_PushBoolean("/app/ledService/value", 0.0, true);
+    uint32_t waitMs = GetRetryWaitMs(sensorPtr->setupFailureCount,
+                                     SETUP_RETRY_BASE_MS,
+                                     SETUP_RETRY_MAX_MS);
 
-    le_avdata_ReplyExecResult(argumentList, LE_OK);
+    LE_INFO("Retrying setup of '%s' in %u ms.", sensorPtr->desc.obsPath, (unsigned int)waitMs);
+
+    le_timer_SetMsInterval(sensorPtr->setupTimer, waitMs);
+    le_timer_Start(sensorPtr->setupTimer);
 }
 
-//-------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
 /**
- * Command data handler.
- * This function is called whenever AirVantage performs an execute on the deactivate LED command
+ * Carry on with a sensor's setup, on the worker thread, once the main thread has tried to register
+ * its push handler.
  */
-//-------------------------------------------------------------------------------------------------
-static void DeactivateLedCmd
+//--------------------------------------------------------------------------------------------------
+static void PushHandlerAdded
 (
-    const char* path,
-    le_avdata_AccessType_t accessType,
-    le_avdata_ArgumentListRef_t argumentList,
-    void* contextPtr
+    void* param1Ptr,    ///< Sensor_t object.
+    void* param2Ptr     ///< Result of AddPushHandler(), as an intptr_t.
 )
 {
-    LE_DEBUG("Deactivate LED");
+    Sensor_t* sensorPtr = param1Ptr;
 
-    dhubAdmin_PushBoolean("/app/ledService/value", 0.0, false);
+    if ((le_result_t)(intptr_t)param2Ptr != LE_OK)
+    {
+        NoteSetupFailure(sensorPtr);
+        return;
+    }
 
-    le_avdata_ReplyExecResult(argumentList, LE_OK);
+    sensorPtr->setupStep++;
+    sensorPtr->setupFailureCount = 0;
+
+    SetUpSensor(sensorPtr);
 }
 
+
 //--------------------------------------------------------------------------------------------------
 /**
- * Handle changes in the AirVantage session state
- *
- * Actually, we don't really need to do anything here, because the AV Agent will queue our
- * push requests until the session comes back anyway.
+ * Register a sensor's push handler, on the main thread, for the worker thread.
  */
 //--------------------------------------------------------------------------------------------------
-static void AvSessionStateHandler
+static void AddPushHandlerOnMain
 (
-    le_avdata_SessionState_t state,
-    void *context   ///< Not used.
+    void* param1Ptr,    ///< Sensor_t object.
+    void* param2Ptr     ///< Not used.
 )
 {
-    switch (state)
-    {
-        case LE_AVDATA_SESSION_STARTED:
-        {
-            // Temporary workaround for the session state problem.
-            if (IsAvSessionActive)
-            {
-                LE_ERROR("Received 'session started' indication when already started.");
-            }
-            else
-            {
-                LE_INFO("AirVantage(tm) session started");
-
-                IsAvSessionActive = true;
-            }
-            break;
-        }
-
-        case LE_AVDATA_SESSION_STOPPED:
-        {
-            LE_INFO("AirVantage(tm) session stopped");
-
-            IsAvSessionActive = false;
-
-            break;
-        }
+    le_result_t result = AddPushHandler(param1Ptr);
 
-        default:
-            LE_ERROR("Unsupported AV session state %d", state);
-            break;
-    }
+    le_event_QueueFunctionToThread(WorkerThread, PushHandlerAdded, param1Ptr,
+                                   (void*)(intptr_t)result);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Call-back function that gets called when a numeric sensor update is received from the Data Hub.
+ * Do the next step of a sensor's setup.
+ *
+ * @return
+ *  - LE_OK if the step is done
+ *  - LE_IN_PROGRESS if it's been handed to the main thread, which carries on from there (see
+ *    AddPushHandlerOnMain())
+ *  - any other result if it failed.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleNumericUpdate
+static le_result_t DoSetupStep
 (
-    double timestamp,
-    double value,
-    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+    Sensor_t* sensorPtr
 )
 {
-    Sensor_t* sensorPtr = contextPtr;
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
 
-    switch (sensorPtr->state)
+    switch (sensorPtr->setupStep)
     {
-        case SENSOR_STATE_IDLE:
+        case SETUP_STEP_OBSERVATION:
 
-            sensorPtr->state = SENSOR_STATE_PUSHING;
+            // Create an "observation" in the Data Hub for filtering, buffering, and receiving
+            // updates.
+            return CreateObservation(sensorPtr);
 
-            PushNumeric(sensorPtr, timestamp, value);
+        case SETUP_STEP_PUSH_HANDLER:
 
-            break;
+            // The push handlers always run on the main thread, so the worker thread (if any) has
+            // it register them.
+            if (WorkerThread != NULL)
+            {
+                le_event_QueueFunctionToThread(MainThread, AddPushHandlerOnMain, sensorPtr, NULL);
+                return LE_IN_PROGRESS;
+            }
+            return AddPushHandler(sensorPtr);
 
-        case SENSOR_STATE_PUSHING:
+        case SETUP_STEP_SENSOR:
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
+            if (descPtr->period > 0.0)
+            {
+                ConfigureSensor(descPtr->inputPath, descPtr->period);
+                StartAdaptiveSampling(sensorPtr);
+            }
+            return LE_OK;
 
-            break;
+        case SETUP_STEP_SOURCE:
 
-        case SENSOR_STATE_BACKLOGGED:
+            // Samples start arriving as soon as this is done.
+            return SetObservationSource(sensorPtr);
 
-            // Don't need to do anything.  Completion of the current push will result in more
-            // being pushed.
-            break;
+        case SETUP_STEP_METRICS:
 
-        case SENSOR_STATE_FAULT:
+            return CreateMetricsInput(sensorPtr);
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
-            PushBacklog(sensorPtr);
+        case SETUP_STEP_DONE:
 
             break;
     }
+
+    return LE_OK;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Call-back function that gets called when a JSON sensor update is received from the Data Hub.
+ * Set a sensor up in the Data Hub, carrying on from wherever its setup got to.  If a step fails,
+ * the setup is retried from that step after a wait (see SETUP_RETRY_BASE_MS), while the other
+ * sensors carry on without it.
  */
 //--------------------------------------------------------------------------------------------------
-static void HandleJsonUpdate
+static void SetUpSensor
 (
-    double timestamp,
-    const char* value,
-    void* contextPtr    ///< Pointer to the Sensor_t object associated with the sensor.
+    Sensor_t* sensorPtr
 )
 {
-    Sensor_t* sensorPtr = contextPtr;
-
-    switch (sensorPtr->state)
+    while (sensorPtr->setupStep != SETUP_STEP_DONE)
     {
-        case SENSOR_STATE_IDLE:
+        le_result_t result = DoSetupStep(sensorPtr);
 
-            sensorPtr->state = SENSOR_STATE_PUSHING;
+        if (result == LE_IN_PROGRESS)
+        {
+            return;
+        }
 
-            PushJson(sensorPtr, timestamp, value);
+        if (result != LE_OK)
+        {
+            NoteSetupFailure(sensorPtr);
+            return;
+        }
 
-            break;
+        // Once connected to its input, the sensor's fresh samples start joining the coalescing
+        // windows.
+        if ((sensorPtr->setupStep == SETUP_STEP_SOURCE) && !sensorPtr->desc.isOnDemand)
+        {
+            FreshSensorCount++;
+        }
 
-        case SENSOR_STATE_PUSHING:
+        sensorPtr->setupStep++;
+        sensorPtr->setupFailureCount = 0;
+    }
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
+    LE_DEBUG("'%s' is set up.", sensorPtr->desc.obsPath);
+}
 
-            break;
 
-        case SENSOR_STATE_BACKLOGGED:
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start or retry a sensor's setup, as a job of its own on the event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetUpSensorJob
+(
+    void* param1Ptr,    ///< Sensor_t object.
+    void* param2Ptr     ///< Not used.
+)
+{
+    SetUpSensor(param1Ptr);
+}
 
-            // Don't need to do anything.  Completion of the current push will result in more
-            // being pushed.
-            break;
 
-        case SENSOR_STATE_FAULT:
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler called when it's time to retry a sensor's failed setup.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetupTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    SetUpSensor(le_timer_GetContextPtr(timerRef));
+}
 
-            sensorPtr->state = SENSOR_STATE_BACKLOGGED;
-            PushBacklog(sensorPtr);
 
-            break;
-    }
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a sensor: open its sample queue and create its AirVantage settings and metrics right away,
+ * and queue up its setup in the Data Hub, which fetches its samples once done (see SetUpSensor()).
+ * Each sensor's setup is a separate job on the event loop, so a sensor can start pushing as soon
+ * as its own setup is done, with the others' still to come, and a slow or failing Data Hub doesn't
+ * hold up anything else.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartSensor
+(
+    Sensor_t* sensorPtr
+)
+{
+    const SensorDesc_t* descPtr = &sensorPtr->desc;
+
+    // Create the timer used to retry the sensor's failed pushes.
+    sensorPtr->retryTimer = le_timer_Create(descPtr->name);
+    le_timer_SetHandler(sensorPtr->retryTimer, RetryTimerExpired);
+    le_timer_SetContextPtr(sensorPtr->retryTimer, sensorPtr);
+
+    // And the one used to retry its setup.
+    sensorPtr->setupTimer = le_timer_Create(descPtr->name);
+    le_timer_SetHandler(sensorPtr->setupTimer, SetupTimerExpired);
+    le_timer_SetContextPtr(sensorPtr->setupTimer, sensorPtr);
+
+    // Open the flash-backed queue that holds the sensor's samples until they're delivered.  Its
+    // backlog can be pushed before the sensor is set up in the Data Hub.
+    OpenQueue(sensorPtr);
+
+    // Let AirVantage tune the sensor while it's running.
+    CreateSensorSettings(sensorPtr);
+
+    // Report on the sensor's push pipeline.
+    CreateSensorMetrics(sensorPtr);
+
+    sensorPtr->setupStep = SETUP_STEP_OBSERVATION;
+    sensorPtr->setupFailureCount = 0;
+    le_event_QueueFunction(SetUpSensorJob, sensorPtr, NULL);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Create an Obsevation with a buffer in the data hub.
+ * Handler for SIGTERM, which the Supervisor sends when the app is stopped.  Syncs the samples
+ * still waiting to be written to flash, and the delivered cursors, which would otherwise be lost
+ * along with up to SYNC_INTERVAL_MS of samples (see sampleQueue.c), then exits.
  */
 //--------------------------------------------------------------------------------------------------
-static void CreateObservation
+static void TermSignalHandler
 (
-    Sensor_t* sensorPtr,
-    unsigned int bufferMaxCount,
-    double changeBy ///< Ignored if 0
+    int sigNum
 )
 {
-    le_result_t result = dhubAdmin_CreateObs(sensorPtr->obsPath);
-
-    if (result != LE_OK)
-    {
-        LE_FATAL("Failed to create Data Hub observation at path '%s' (%s).",
-                 sensorPtr->obsPath,
-                 LE_RESULT_TXT(result));
-    }
+    LE_INFO("Stopping: syncing the sample queues.");
 
-    dhubAdmin_SetBufferMaxCount(sensorPtr->obsPath, bufferMaxCount);
+    sampleQueue_SyncAll();
 
-    if (changeBy != 0.0)
-    {
-        dhubAdmin_SetChangeBy(sensorPtr->obsPath, changeBy);
-    }
+    exit(EXIT_SUCCESS);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Configure and enable a sensor whose 'value' input is at a given path.
+ * Set up the sensors, settings and commands, and start publishing.  Runs on the thread that runs
+ * the push pipeline.
  */
 //--------------------------------------------------------------------------------------------------
-static void ConfigureSensor
+static void StartPublisher
 (
-    const char* inputPath,
-    double period ///< seconds
+    void
 )
 {
-    const char* lastSlashPtr = strrchr(inputPath, '/');
+    // The sample queues belong to this thread, so they're synced from its event loop.
+    le_sig_SetEventHandler(SIGTERM, TermSignalHandler);
 
-    if (lastSlashPtr == NULL)
+    ConfigSensorPool = le_mem_CreatePool("ConfigSensor", sizeof(ConfigSensor_t));
+
+    LoadSensors();
+    OrderSensorsByPriority();
+    LoadBudget();
+
+    PushPool = le_mem_CreatePool("Push", sizeof(Push_t));
+    le_mem_ExpandPool(PushPool, SensorCount * MAX_PUSH_WINDOW);
+
+    CoalesceTimer = le_timer_Create("Coalesce");
+    le_timer_SetHandler(CoalesceTimer, CoalesceTimerExpired);
+    if (COALESCE_WINDOW_MS > 0)
     {
-        LE_FATAL("No '/' found in path '%s'.", inputPath);
+        le_timer_SetMsInterval(CoalesceTimer, COALESCE_WINDOW_MS);
     }
 
-    char path[DHUBIO_MAX_RESOURCE_PATH_LEN + 1];
-
-    size_t basePathLen = (lastSlashPtr - inputPath) + 1; // +1 to include the slash.
+    // The adaptive scheduler's timer is started by the first sensor with an adaptive period.
+    AdaptiveTimer = le_timer_Create("Adaptive");
+    le_timer_SetHandler(AdaptiveTimer, AdaptiveTimerExpired);
+    le_timer_SetMsInterval(AdaptiveTimer, ADAPTIVE_CHECK_INTERVAL_MS);
+    le_timer_SetRepeat(AdaptiveTimer, 0);
 
-    // Buffer size check.
-    LE_ASSERT((basePathLen + sizeof("period")) < DHUBIO_MAX_RESOURCE_PATH_LEN);
+    BudgetTimer = le_timer_Create("Budget");
+    le_timer_SetHandler(BudgetTimer, BudgetTimerExpired);
+    le_timer_SetMsInterval(BudgetTimer, BUDGET_RETRY_INTERVAL_MS);
 
-    // Set the period.
-    (void)strncpy(path, inputPath, basePathLen);    // WARNING: May not be null-terminated.
-    (void)strcpy(path + basePathLen, "period");   // Guaranteed to null-terminate.
-    dhubAdmin_SetNumericDefault(path, period);
+    BreakerTimer = le_timer_Create("Breaker");
+    le_timer_SetHandler(BreakerTimer, BreakerTimerExpired);
+    le_timer_SetMsInterval(BreakerTimer, BREAKER_PROBE_MS);
 
-    // Enable the sensor.
-    (void)strcpy(path + basePathLen, "enable");   // Guaranteed to null-terminate.
-    dhubAdmin_PushBoolean(path, 0.0, true);
-}
+    ResumeTimer = le_timer_Create("Resume");
+    le_timer_SetHandler(ResumeTimer, ResumeTimerExpired);
+    le_timer_SetMsInterval(ResumeTimer, RESUME_STAGGER_MS);
 
+    MetricsTimer = le_timer_Create("Metrics");
+    le_timer_SetHandler(MetricsTimer, MetricsTimerExpired);
+    le_timer_SetMsInterval(MetricsTimer, METRICS_PERIOD_MS);
+    le_timer_SetRepeat(MetricsTimer, 0);
 
-//--------------------------------------------------------------------------------------------------
-COMPONENT_INIT
-{
     // Create a setting to allow the cloud to push a blink interval for the LED.
     le_avdata_CreateResource(LED_CMD_LED_BLINK_INTERVAL_RES, LE_AVDATA_ACCESS_SETTING);
 
@@ -1192,39 +5884,70 @@ COMPONENT_INIT
     le_avdata_CreateResource(LED_CMD_DEACTIVATE_RES, LE_AVDATA_ACCESS_COMMAND);
     le_avdata_AddResourceEventHandler(LED_CMD_DEACTIVATE_RES, DeactivateLedCmd, NULL);
 
-    // Create "observations" in the Data Hub for filtering, buffering, and receiving sensor updates.
-    CreateObservation(&Accelerometer, ACCEL_BUFFER_COUNT, 0.0);
-    CreateObservation(&Gyroscope, GYRO_BUFFER_COUNT, 0.0);
-    CreateObservation(&PositionSensor, POS_BUFFER_COUNT, 0.0);
-    CreateObservation(&LightSensor, LIGHT_BUFFER_COUNT, LIGHT_CHANGE_BY);
-    CreateObservation(&PressureSensor, PRESSURE_BUFFER_COUNT, PRESSURE_CHANGE_BY);
-    CreateObservation(&Thermometer, TEMP_BUFFER_COUNT, TEMP_CHANGE_BY);
-
-    // Register for notification when the observations receive updates.
-    dhubAdmin_AddJsonPushHandler(Accelerometer.obsPath, HandleJsonUpdate, &Accelerometer);
-    dhubAdmin_AddJsonPushHandler(Gyroscope.obsPath, HandleJsonUpdate, &Gyroscope);
-    dhubAdmin_AddJsonPushHandler(PositionSensor.obsPath, HandleJsonUpdate, &PositionSensor);
-    dhubAdmin_AddNumericPushHandler(LightSensor.obsPath, HandleNumericUpdate, &LightSensor);
-    dhubAdmin_AddNumericPushHandler(PressureSensor.obsPath, HandleNumericUpdate, &PressureSensor);
-    dhubAdmin_AddNumericPushHandler(Thermometer.obsPath, HandleNumericUpdate, &Thermometer);
-
-    // Configure the sensors.
-    ConfigureSensor(ACCEL_SENSOR_INPUT_PATH, ACCEL_PERIOD);
-    ConfigureSensor(GYRO_SENSOR_INPUT_PATH, GYRO_PERIOD);
-    ConfigureSensor(POS_SENSOR_INPUT_PATH, POS_PERIOD);
-    ConfigureSensor(PRESSURE_SENSOR_INPUT_PATH, PRESSURE_PERIOD);
-    ConfigureSensor(TEMP_SENSOR_INPUT_PATH, TEMP_PERIOD);
-    ConfigureSensor(LIGHT_SENSOR_INPUT_PATH, LIGHT_PERIOD);
-
-    // Connect the observations to the sensor inputs in the Data Hub.
-    dhubAdmin_SetSource(Accelerometer.obsPath, ACCEL_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(Gyroscope.obsPath, GYRO_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(PositionSensor.obsPath, POS_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(PressureSensor.obsPath, PRESSURE_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(Thermometer.obsPath, TEMP_SENSOR_INPUT_PATH);
-    dhubAdmin_SetSource(LightSensor.obsPath, LIGHT_SENSOR_INPUT_PATH);
+    // Create a command for uploading the raw samples behind the summaries.
+    le_avdata_CreateResource(UPLOAD_RAW_SAMPLES_CMD_RES, LE_AVDATA_ACCESS_COMMAND);
+    le_avdata_AddResourceEventHandler(UPLOAD_RAW_SAMPLES_CMD_RES, UploadRawSamplesCmd, NULL);
+
+    // Create a setting to allow the cloud to change the vibration frequency bands.
+    le_avdata_CreateResource(VIB_BANDS_SETTING_RES, LE_AVDATA_ACCESS_SETTING);
+    (void)le_avdata_SetString(VIB_BANDS_SETTING_RES, VIB_DEFAULT_BANDS);
+    le_avdata_AddResourceEventHandler(VIB_BANDS_SETTING_RES, VibBandsSettingHandler, NULL);
+
+    // Start fetching the sensors' samples from the Data Hub, the high-priority ones first.
+    for (size_t i = 0; i < SensorCount; i++)
+    {
+        StartSensor(SensorsByPriority[i]);
+    }
+
+    le_timer_Start(MetricsTimer);
 
     // Request an AirVantage session.
     (void)le_avdata_AddSessionStateHandler(AvSessionStateHandler, NULL);
     LE_FATAL_IF(le_avdata_RequestSession() == NULL, "Failed to request avdata session");
 }
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of the worker thread, which runs the push pipeline on its own event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+static void* WorkerMain
+(
+    void* contextPtr
+)
+{
+    le_avdata_ConnectService();
+    dhubIO_ConnectService();
+    dhubAdmin_ConnectService();
+    le_cfg_ConnectService();
+
+    StartPublisher();
+
+    le_event_RunLoop();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    MainThread = le_thread_GetCurrent();
+
+    // Block SIGTERM before the worker thread is created, so that it's only taken by the handler.
+    le_sig_Block(SIGTERM);
+
+    le_cfg_IteratorRef_t iter = le_cfg_CreateReadTxn(WORKER_CONFIG_PATH);
+    bool isWorkerEnabled = le_cfg_GetBool(iter, "enable", false);
+    le_cfg_CancelTxn(iter);
+
+    if (!isWorkerEnabled)
+    {
+        StartPublisher();
+        return;
+    }
+
+    LE_INFO("Running the push pipeline on a worker thread.");
+
+    WorkerThread = le_thread_Create("avPublisher", WorkerMain, NULL);
+    le_thread_Start(WorkerThread);
+}
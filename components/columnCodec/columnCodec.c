@@ -0,0 +1,323 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file columnCodec.c
+ *
+ * Compact columnar encoding of blocks of timestamped sensor samples.  See columnCodec.h for a
+ * description of the format.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "columnCodec.h"
+
+/// Largest magnitude allowed for a quantized value, so that deltas can't overflow an int64_t.
+#define MAX_QUANTIZED 4.0e18
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of bytes needed to encode an unsigned integer as a varint.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t VarintSize
+(
+    uint64_t value
+)
+{
+    size_t size = 1;
+
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+
+    return size;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Map a signed integer to an unsigned one, so that numbers close to zero (of either sign) map to
+ * small numbers: 0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...
+ */
+//--------------------------------------------------------------------------------------------------
+static uint64_t Zigzag
+(
+    int64_t value
+)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write an unsigned integer as a varint.
+ *
+ * @return Pointer to the byte after the varint.
+ */
+//--------------------------------------------------------------------------------------------------
+static uint8_t* PutVarint
+(
+    uint8_t* bytePtr,
+    uint64_t value
+)
+{
+    while (value >= 0x80)
+    {
+        *bytePtr++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    *bytePtr++ = (uint8_t)value;
+
+    return bytePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the size of the block header for a given number of samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t HeaderSize
+(
+    const columnCodec_Block_t* blockPtr,
+    size_t sampleCount
+)
+{
+    return 2 + VarintSize(sampleCount) + blockPtr->columnCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a Data Hub timestamp to the integer number of milliseconds that the blocks (and
+ * AirVantage records) hold.
+ *
+ * The sensors timestamp their samples in whole microseconds (see sampleClock.h), which survive
+ * the trip through the Data Hub and the sample queues exactly as doubles.  So the timestamp is
+ * rounded back to integer microseconds first, and only then cut down to milliseconds, rather
+ * than letting floating point error push a sample into the millisecond before.
+ *
+ * @return The timestamp (milliseconds since the Epoch).
+ */
+//--------------------------------------------------------------------------------------------------
+uint64_t columnCodec_TimestampToMs
+(
+    double timestamp               ///< Seconds since the Epoch.
+)
+{
+    return ((uint64_t)llround(timestamp * 1000000.0)) / 1000;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a new, empty block.
+ */
+//--------------------------------------------------------------------------------------------------
+void columnCodec_Start
+(
+    columnCodec_Block_t* blockPtr,
+    size_t columnCount,             ///< 1 to COLUMN_CODEC_MAX_COLUMNS.
+    const int8_t* exponentsPtr      ///< Resolution of each column, as a power of ten.
+)
+{
+    LE_ASSERT((columnCount > 0) && (columnCount <= COLUMN_CODEC_MAX_COLUMNS));
+
+    blockPtr->columnCount = columnCount;
+    memcpy(blockPtr->exponents, exponentsPtr, columnCount * sizeof(blockPtr->exponents[0]));
+    blockPtr->sampleCount = 0;
+    blockPtr->encodedBytes = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to a block.  Samples must be added oldest first.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the block is full (the sample was not added).
+ *  - LE_OUT_OF_RANGE if a value can't be represented at its column's resolution, or the timestamp
+ *    is older than the previous sample's (the sample was not added).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t columnCodec_Add
+(
+    columnCodec_Block_t* blockPtr,
+    double timestamp,               ///< Seconds since the Epoch.
+    const double* valuesPtr         ///< One value per column.
+)
+{
+    size_t index = blockPtr->sampleCount;
+
+    if (index >= COLUMN_CODEC_MAX_SAMPLES)
+    {
+        return LE_OVERFLOW;
+    }
+
+    if (!(timestamp >= 0.0))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    uint64_t ms = columnCodec_TimestampToMs(timestamp);
+    size_t bytes;
+
+    if (index == 0)
+    {
+        bytes = VarintSize(ms);
+    }
+    else if (ms < blockPtr->timestamps[index - 1])
+    {
+        return LE_OUT_OF_RANGE;
+    }
+    else
+    {
+        bytes = VarintSize(ms - blockPtr->timestamps[index - 1]);
+    }
+
+    int64_t* quantizedPtr = blockPtr->values[index];
+
+    for (size_t i = 0; i < blockPtr->columnCount; i++)
+    {
+        double scaled = valuesPtr[i] * pow(10.0, -blockPtr->exponents[i]);
+
+        // Note: this also rejects NaN.
+        if (!(fabs(scaled) <= MAX_QUANTIZED))
+        {
+            return LE_OUT_OF_RANGE;
+        }
+
+        quantizedPtr[i] = llround(scaled);
+
+        if (index == 0)
+        {
+            bytes += VarintSize(Zigzag(quantizedPtr[i]));
+        }
+        else
+        {
+            bytes += VarintSize(Zigzag(quantizedPtr[i] - blockPtr->values[index - 1][i]));
+        }
+    }
+
+    if ((HeaderSize(blockPtr, index + 1) + blockPtr->encodedBytes + bytes) > COLUMN_CODEC_MAX_BYTES)
+    {
+        return LE_OVERFLOW;
+    }
+
+    blockPtr->timestamps[index] = ms;
+    blockPtr->encodedBytes += bytes;
+    blockPtr->sampleCount++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of samples in a block.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t columnCodec_GetCount
+(
+    const columnCodec_Block_t* blockPtr
+)
+{
+    return blockPtr->sampleCount;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a block as base64 text.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the buffer is too small (COLUMN_CODEC_TEXT_BYTES is always enough).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t columnCodec_Encode
+(
+    const columnCodec_Block_t* blockPtr,
+    char* textPtr,
+    size_t textSize
+)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    uint8_t bytes[COLUMN_CODEC_MAX_BYTES];
+    uint8_t* bytePtr = bytes;
+    size_t count = blockPtr->sampleCount;
+
+    // Header.
+    *bytePtr++ = COLUMN_CODEC_VERSION;
+    *bytePtr++ = (uint8_t)blockPtr->columnCount;
+    bytePtr = PutVarint(bytePtr, count);
+    for (size_t i = 0; i < blockPtr->columnCount; i++)
+    {
+        *bytePtr++ = (uint8_t)blockPtr->exponents[i];
+    }
+
+    // Timestamp column.
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t previous = (i == 0) ? 0 : blockPtr->timestamps[i - 1];
+
+        bytePtr = PutVarint(bytePtr, blockPtr->timestamps[i] - previous);
+    }
+
+    // Value columns.
+    for (size_t col = 0; col < blockPtr->columnCount; col++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            int64_t previous = (i == 0) ? 0 : blockPtr->values[i - 1][col];
+
+            bytePtr = PutVarint(bytePtr, Zigzag(blockPtr->values[i][col] - previous));
+        }
+    }
+
+    size_t byteCount = bytePtr - bytes;
+    LE_ASSERT(byteCount == (HeaderSize(blockPtr, count) + blockPtr->encodedBytes));
+
+    if (textSize < (((byteCount + 2) / 3) * 4 + 1))
+    {
+        return LE_OVERFLOW;
+    }
+
+    // Base64, 3 bytes to 4 characters, padding the last group with '='.
+    for (size_t i = 0; i < byteCount; i += 3)
+    {
+        uint32_t group = (uint32_t)bytes[i] << 16;
+
+        if ((i + 1) < byteCount)
+        {
+            group |= (uint32_t)bytes[i + 1] << 8;
+        }
+        if ((i + 2) < byteCount)
+        {
+            group |= bytes[i + 2];
+        }
+
+        *textPtr++ = digits[(group >> 18) & 0x3F];
+        *textPtr++ = digits[(group >> 12) & 0x3F];
+        *textPtr++ = ((i + 1) < byteCount) ? digits[(group >> 6) & 0x3F] : '=';
+        *textPtr++ = ((i + 2) < byteCount) ? digits[group & 0x3F] : '=';
+    }
+
+    *textPtr = '\0';
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
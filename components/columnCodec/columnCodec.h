@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file columnCodec.h
+ *
+ * Compact columnar encoding of blocks of timestamped sensor samples, used to cut the number of
+ * bytes needed to upload a backlog.
+ *
+ * A block holds up to COLUMN_CODEC_MAX_SAMPLES samples of one sensor, each sample having the same
+ * number of numeric columns (e.g., 3 for x, y, z acceleration).  Each column has a resolution of a
+ * power of ten (10^exponent), to which its values are quantized.  The encoded block is:
+ *
+ * @verbatim
+    uint8       version (COLUMN_CODEC_VERSION)
+    uint8       number of columns
+    varint      number of samples (n)
+    int8        exponent of each column
+    varint      timestamp of the first sample (milliseconds since the Epoch)
+    varint      n - 1 timestamp deltas (milliseconds since the previous sample)
+    for each column:
+        zvarint     first quantized value
+        zvarint     n - 1 quantized value deltas (difference from the previous sample)
+   @endverbatim
+ *
+ * "varint" is an unsigned LEB128 integer (7 bits per byte, least significant group first, the top
+ * bit set on all but the last byte) and "zvarint" is a signed integer zigzag-mapped to an unsigned
+ * varint.  A quantized value q represents q * 10^exponent.
+ *
+ * The block is then converted to text using standard base64 encoding, so it can be carried in a
+ * string resource.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef COLUMN_CODEC_H_INCLUDE_GUARD
+#define COLUMN_CODEC_H_INCLUDE_GUARD
+
+/// Version of the encoding, found in the first byte of every block.
+#define COLUMN_CODEC_VERSION 1
+
+/// Maximum number of columns per sample.
+#define COLUMN_CODEC_MAX_COLUMNS 8
+
+/// Maximum number of samples per block.
+#define COLUMN_CODEC_MAX_SAMPLES 128
+
+/// Maximum size of an encoded block before base64 conversion (bytes).
+#define COLUMN_CODEC_MAX_BYTES 3072
+
+/// Size of the buffer (including null terminator) needed to hold any base64-encoded block.
+#define COLUMN_CODEC_TEXT_BYTES (((COLUMN_CODEC_MAX_BYTES + 2) / 3) * 4 + 1)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Block of samples being encoded.  Treat as opaque; it's only declared here so blocks can be
+ * allocated by the caller.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    size_t columnCount;
+    int8_t exponents[COLUMN_CODEC_MAX_COLUMNS];
+    size_t sampleCount;
+    size_t encodedBytes;    ///< Size of the block if it were encoded now.
+    uint64_t timestamps[COLUMN_CODEC_MAX_SAMPLES];
+    int64_t values[COLUMN_CODEC_MAX_SAMPLES][COLUMN_CODEC_MAX_COLUMNS];
+}
+columnCodec_Block_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a Data Hub timestamp to the integer number of milliseconds that the blocks (and
+ * AirVantage records) hold.
+ *
+ * The sensors timestamp their samples in whole microseconds (see sampleClock.h), which survive
+ * the trip through the Data Hub and the sample queues exactly as doubles.  So the timestamp is
+ * rounded back to integer microseconds first, and only then cut down to milliseconds, rather
+ * than letting floating point error push a sample into the millisecond before.
+ *
+ * @return The timestamp (milliseconds since the Epoch).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED uint64_t columnCodec_TimestampToMs
+(
+    double timestamp               ///< Seconds since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a new, empty block.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void columnCodec_Start
+(
+    columnCodec_Block_t* blockPtr,
+    size_t columnCount,             ///< 1 to COLUMN_CODEC_MAX_COLUMNS.
+    const int8_t* exponentsPtr      ///< Resolution of each column, as a power of ten.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to a block.  Samples must be added oldest first.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the block is full (the sample was not added).
+ *  - LE_OUT_OF_RANGE if a value can't be represented at its column's resolution, or the timestamp
+ *    is older than the previous sample's (the sample was not added).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t columnCodec_Add
+(
+    columnCodec_Block_t* blockPtr,
+    double timestamp,               ///< Seconds since the Epoch.
+    const double* valuesPtr         ///< One value per column.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the number of samples in a block.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED size_t columnCodec_GetCount
+(
+    const columnCodec_Block_t* blockPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode a block as base64 text.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the buffer is too small (COLUMN_CODEC_TEXT_BYTES is always enough).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t columnCodec_Encode
+(
+    const columnCodec_Block_t* blockPtr,
+    char* textPtr,
+    size_t textSize
+);
+
+
+#endif // COLUMN_CODEC_H_INCLUDE_GUARD
@@ -2,7 +2,7 @@
 /**
  * @file fileUtils.c
  *
- * Utility functions used to read numbers from sysfs files.
+ * Utility functions used to read and write sysfs files.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -11,6 +11,30 @@
 #include "legato.h"
 #include "fileUtils.h"
 
+/// Maximum length of a number read from a sysfs attribute file.  Anything longer is truncated.
+#define MAX_ATTR_TEXT_LEN 63
+
+/// Maximum length of an attribute file path kept for logging purposes.
+#define MAX_ATTR_PATH_LEN 127
+
+/// An open sysfs attribute file.
+typedef struct file_Attr
+{
+    int fd;                             ///< File descriptor (-1 if not open).
+    char path[MAX_ATTR_PATH_LEN + 1];   ///< Path of the file.
+}
+Attr_t;
+
+/// Pool from which Attr_t objects are allocated.
+static le_mem_PoolRef_t AttrPool;
+
+/// Exact powers of ten that can be represented in a double.
+static const double PowersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Read a signed integer from a sysfs file (convert the string contents to a number).
@@ -85,6 +109,460 @@ done:
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the text contents of a sysfs file, without the trailing newline.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_OVERFLOW if the contents didn't fit in the buffer (they are truncated).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadStr
+(
+    const char *filePath,
+    char *buffPtr,
+    size_t buffSize
+)
+{
+    le_result_t r = LE_OK;
+    int fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_WARN("Couldn't open '%s' - %m", filePath);
+        r = LE_IO_ERROR;
+        goto done;
+    }
+
+    ssize_t len;
+    do
+    {
+        len = read(fd, buffPtr, buffSize - 1);
+    }
+    while ((len < 0) && (errno == EINTR));
+
+    if (len < 0)
+    {
+        LE_WARN("Couldn't read '%s' - %m", filePath);
+        r = LE_IO_ERROR;
+        len = 0;
+    }
+    else if (len == (buffSize - 1))
+    {
+        r = LE_OVERFLOW;
+    }
+
+    buffPtr[len] = '\0';
+    if ((len > 0) && (buffPtr[len - 1] == '\n'))
+    {
+        buffPtr[len - 1] = '\0';
+    }
+
+    close(fd);
+done:
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a string to a sysfs file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or the driver rejected the value.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_WriteStr
+(
+    const char *filePath,
+    const char *value
+)
+{
+    le_result_t r = LE_OK;
+    int fd = open(filePath, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_WARN("Couldn't open '%s' - %m", filePath);
+        r = LE_IO_ERROR;
+        goto done;
+    }
+
+    size_t len = strlen(value);
+    ssize_t written;
+    do
+    {
+        written = write(fd, value, len);
+    }
+    while ((written < 0) && (errno == EINTR));
+
+    if (written != (ssize_t)len)
+    {
+        LE_WARN("Couldn't write '%s' to '%s' - %m", value, filePath);
+        r = LE_IO_ERROR;
+    }
+
+    close(fd);
+done:
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a signed integer to a sysfs file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or the driver rejected the value.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_WriteInt
+(
+    const char *filePath,
+    int value
+)
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), "%d", value);
+
+    return file_WriteStr(filePath, text);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs attribute file for repeated reading.
+ *
+ * If the file can't be opened yet, a warning is logged, and another attempt will be made each
+ * time the attribute is read.
+ *
+ * @return Reference to the attribute (never NULL).
+ */
+//--------------------------------------------------------------------------------------------------
+file_AttrRef_t file_OpenAttr
+(
+    const char *filePath
+)
+{
+    Attr_t* attrPtr = le_mem_ForceAlloc(AttrPool);
+
+    (void)le_utf8_Copy(attrPtr->path, filePath, sizeof(attrPtr->path), NULL);
+
+    attrPtr->fd = open(filePath, O_RDONLY | O_CLOEXEC);
+    if (attrPtr->fd < 0)
+    {
+        LE_WARN("Couldn't open '%s' - %m", filePath);
+    }
+
+    return attrPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close a sysfs attribute file opened using file_OpenAttr().
+ */
+//--------------------------------------------------------------------------------------------------
+void file_CloseAttr
+(
+    file_AttrRef_t attrRef
+)
+{
+    if (attrRef->fd >= 0)
+    {
+        close(attrRef->fd);
+    }
+
+    le_mem_Release(attrRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the text contents of an open sysfs attribute file.  sysfs regenerates the contents of an
+ * attribute whenever it is read from offset 0, so there's no need to reopen or rewind the file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadAttrText
+(
+    Attr_t* attrPtr,
+    char* buffPtr,      ///< Buffer of at least MAX_ATTR_TEXT_LEN + 1 bytes.
+    size_t buffSize
+)
+{
+    if (attrPtr->fd < 0)
+    {
+        attrPtr->fd = open(attrPtr->path, O_RDONLY | O_CLOEXEC);
+        if (attrPtr->fd < 0)
+        {
+            return LE_IO_ERROR;
+        }
+    }
+
+    ssize_t len;
+
+    do
+    {
+        len = pread(attrPtr->fd, buffPtr, buffSize - 1, 0);
+    }
+    while ((len < 0) && (errno == EINTR));
+
+    if (len < 0)
+    {
+        LE_WARN("Couldn't read '%s' - %m", attrPtr->path);
+        return LE_IO_ERROR;
+    }
+
+    buffPtr[len] = '\0';
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert the text at the start of a buffer into a signed integer.  Leading whitespace is skipped,
+ * and anything following the number is ignored.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if there is no number.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseInt
+(
+    const char* text,
+    int *value
+)
+{
+    while ((*text == ' ') || (*text == '\t') || (*text == '\n'))
+    {
+        text++;
+    }
+
+    bool isNegative = (*text == '-');
+    if ((*text == '-') || (*text == '+'))
+    {
+        text++;
+    }
+
+    if ((*text < '0') || (*text > '9'))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    long long result = 0;
+
+    while ((*text >= '0') && (*text <= '9'))
+    {
+        result = (result * 10) + (*text - '0');
+        if (result > ((long long)INT_MAX + 1))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        text++;
+    }
+
+    if (isNegative)
+    {
+        result = -result;
+    }
+    else if (result > INT_MAX)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *value = (int)result;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert the text at the start of a buffer into a floating point number.  Leading whitespace is
+ * skipped, and anything following the number is ignored.
+ *
+ * Numbers with up to 15 significant digits and a small exponent (which covers everything the IIO
+ * drivers produce) are converted exactly without calling into the C library.  Anything else is
+ * handed to strtod().
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if there is no number.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseDouble
+(
+    const char* text,
+    double *value
+)
+{
+    while ((*text == ' ') || (*text == '\t') || (*text == '\n'))
+    {
+        text++;
+    }
+
+    const char* startPtr = text;
+
+    bool isNegative = (*text == '-');
+    if ((*text == '-') || (*text == '+'))
+    {
+        text++;
+    }
+
+    uint64_t mantissa = 0;
+    int digitCount = 0;     // Significant digits in the mantissa.
+    int exponent = 0;
+    bool haveDigits = false;
+
+    while ((*text >= '0') && (*text <= '9'))
+    {
+        if ((mantissa != 0) || (*text != '0'))
+        {
+            mantissa = (mantissa * 10) + (*text - '0');
+            digitCount++;
+        }
+        haveDigits = true;
+        text++;
+    }
+
+    if (*text == '.')
+    {
+        text++;
+
+        while ((*text >= '0') && (*text <= '9'))
+        {
+            if ((mantissa != 0) || (*text != '0'))
+            {
+                mantissa = (mantissa * 10) + (*text - '0');
+                digitCount++;
+            }
+            exponent--;
+            haveDigits = true;
+            text++;
+        }
+    }
+
+    if (!haveDigits)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if ((*text == 'e') || (*text == 'E'))
+    {
+        const char* expPtr = text + 1;
+        bool isExpNegative = (*expPtr == '-');
+        if ((*expPtr == '-') || (*expPtr == '+'))
+        {
+            expPtr++;
+        }
+
+        if ((*expPtr >= '0') && (*expPtr <= '9'))
+        {
+            int expValue = 0;
+            while ((*expPtr >= '0') && (*expPtr <= '9'))
+            {
+                if (expValue < 10000)
+                {
+                    expValue = (expValue * 10) + (*expPtr - '0');
+                }
+                expPtr++;
+            }
+            exponent += isExpNegative ? -expValue : expValue;
+        }
+    }
+
+    if (   (digitCount > 15)
+        || (exponent > (int)(NUM_ARRAY_MEMBERS(PowersOfTen) - 1))
+        || (exponent < -(int)(NUM_ARRAY_MEMBERS(PowersOfTen) - 1)) )
+    {
+        // Can't guarantee an exact result, so let the C library handle it.
+        *value = strtod(startPtr, NULL);
+        return LE_OK;
+    }
+
+    double result = (double)mantissa;
+
+    if (exponent < 0)
+    {
+        result /= PowersOfTen[-exponent];
+    }
+    else
+    {
+        result *= PowersOfTen[exponent];
+    }
+
+    *value = isNegative ? -result : result;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a signed integer from an open sysfs attribute file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a signed integer.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadAttrInt
+(
+    file_AttrRef_t attrRef,
+    int *value
+)
+{
+    char text[MAX_ATTR_TEXT_LEN + 1];
+
+    le_result_t r = ReadAttrText(attrRef, text, sizeof(text));
+    if (r == LE_OK)
+    {
+        r = ParseInt(text, value);
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a floating point number from an open sysfs attribute file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a number.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t file_ReadAttrDouble
+(
+    file_AttrRef_t attrRef,
+    double *value
+)
+{
+    char text[MAX_ATTR_TEXT_LEN + 1];
+
+    le_result_t r = ReadAttrText(attrRef, text, sizeof(text));
+    if (r == LE_OK)
+    {
+        r = ParseDouble(text, value);
+    }
+
+    return r;
+}
+
+
 COMPONENT_INIT
 {
+    AttrPool = le_mem_CreatePool("SysfsAttr", sizeof(Attr_t));
 }
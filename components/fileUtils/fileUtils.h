@@ -2,7 +2,7 @@
 /**
  * @file fileUtils.h
  *
- * Utility functions used to read numbers from sysfs files.
+ * Utility functions used to read and write sysfs files.
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -46,4 +46,124 @@ LE_SHARED le_result_t file_ReadDouble
 );
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the text contents of a sysfs file, without the trailing newline.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_OVERFLOW if the contents didn't fit in the buffer (they are truncated).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadStr
+(
+    const char *filePath,
+    char *buffPtr,
+    size_t buffSize
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a string to a sysfs file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or the driver rejected the value.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_WriteStr
+(
+    const char *filePath,
+    const char *value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a signed integer to a sysfs file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or the driver rejected the value.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_WriteInt
+(
+    const char *filePath,
+    int value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a sysfs attribute file that is kept open so it can be read repeatedly without
+ * opening and closing it every time.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct file_Attr* file_AttrRef_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sysfs attribute file for repeated reading.
+ *
+ * If the file can't be opened yet, a warning is logged, and another attempt will be made each
+ * time the attribute is read.
+ *
+ * @return Reference to the attribute (never NULL).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED file_AttrRef_t file_OpenAttr
+(
+    const char *filePath
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close a sysfs attribute file opened using file_OpenAttr().
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void file_CloseAttr
+(
+    file_AttrRef_t attrRef
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a signed integer from an open sysfs attribute file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a signed integer.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadAttrInt
+(
+    file_AttrRef_t attrRef,
+    int *value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a floating point number from an open sysfs attribute file.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_IO_ERROR if the file could not be opened or read.
+ *  - LE_FORMAT_ERROR if the file contents could not be converted into a number.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t file_ReadAttrDouble
+(
+    file_AttrRef_t attrRef,
+    double *value
+);
+
+
 #endif // FILE_UTILS_H_INCLUDE_GUARD
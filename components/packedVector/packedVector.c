@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file packedVector.c
+ *
+ * Utility functions used to pass vector sensor samples through the Data Hub in a fixed binary
+ * layout.  See packedVector.h for a description of the format.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "packedVector.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode an array of numbers as a packed vector string.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t packedVector_Encode
+(
+    const double* valuesPtr,
+    size_t count,
+    char* buffPtr,
+    size_t buffSize
+)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    if (buffSize < PACKED_VECTOR_BUFFER_BYTES(count))
+    {
+        return LE_OVERFLOW;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t bits;
+        memcpy(&bits, &valuesPtr[i], sizeof(bits));
+
+        for (int digit = PACKED_VECTOR_CHARS_PER_MEMBER - 1; digit >= 0; digit--)
+        {
+            buffPtr[digit] = hexDigits[bits & 0xF];
+            bits >>= 4;
+        }
+
+        buffPtr += PACKED_VECTOR_CHARS_PER_MEMBER;
+    }
+
+    *buffPtr = '\0';
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a packed vector string into an array of numbers.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the string is not a packed vector with the expected number of members.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t packedVector_Decode
+(
+    const char* packedPtr,
+    double* valuesPtr,
+    size_t count
+)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t bits = 0;
+
+        for (int digit = 0; digit < PACKED_VECTOR_CHARS_PER_MEMBER; digit++)
+        {
+            char c = *packedPtr;
+            unsigned int nibble;
+
+            if ((c >= '0') && (c <= '9'))
+            {
+                nibble = c - '0';
+            }
+            else if ((c >= 'a') && (c <= 'f'))
+            {
+                nibble = c - 'a' + 10;
+            }
+            else if ((c >= 'A') && (c <= 'F'))
+            {
+                nibble = c - 'A' + 10;
+            }
+            else
+            {
+                // Includes the null terminator, if the string is too short.
+                return LE_FORMAT_ERROR;
+            }
+
+            bits = (bits << 4) | nibble;
+            packedPtr++;
+        }
+
+        memcpy(&valuesPtr[i], &bits, sizeof(bits));
+    }
+
+    if (*packedPtr != '\0')
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file packedVector.h
+ *
+ * Utility functions used to pass vector sensor samples (e.g., x, y, z acceleration) through the
+ * Data Hub in a fixed binary layout, without converting the numbers to and from decimal text.
+ *
+ * A packed vector is a string holding, for each member of the vector in order, the 64-bit IEEE-754
+ * representation of the double-precision value as 16 lower-case hex digits, most significant digit
+ * first.  For example, a 3-member vector is always exactly 48 characters long.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PACKED_VECTOR_H_INCLUDE_GUARD
+#define PACKED_VECTOR_H_INCLUDE_GUARD
+
+/// Number of characters used to encode each member of a packed vector.
+#define PACKED_VECTOR_CHARS_PER_MEMBER 16
+
+/// Size of the buffer (including null terminator) needed to hold a packed vector of n members.
+#define PACKED_VECTOR_BUFFER_BYTES(n) (((n) * PACKED_VECTOR_CHARS_PER_MEMBER) + 1)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Encode an array of numbers as a packed vector string.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_OVERFLOW if the buffer is too small.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t packedVector_Encode
+(
+    const double* valuesPtr,
+    size_t count,
+    char* buffPtr,
+    size_t buffSize
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a packed vector string into an array of numbers.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the string is not a packed vector with the expected number of members.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t packedVector_Decode
+(
+    const char* packedPtr,
+    double* valuesPtr,
+    size_t count
+);
+
+
+#endif // PACKED_VECTOR_H_INCLUDE_GUARD
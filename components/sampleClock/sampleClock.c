@@ -0,0 +1,300 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleClock.c
+ *
+ * Implementation of the GNSS-disciplined sample clock.  See sampleClock.h.
+ *
+ * The offset from the monotonic clock is changed at a limited rate: when a new reference time
+ * shows the offset to be wrong by less than STEP_THRESHOLD_NS, the offset starts moving towards
+ * the right value at MAX_SLEW_PPM, and stops when it gets there.  While the offset moves, the
+ * sample clock runs a little fast or slow, but always forwards.  Larger errors are stepped out
+ * only if the sample clock is behind; one that is ahead is slewed out too, however long it takes,
+ * since stepping it back would make samples go back in time (and be refused by their queues).
+ *
+ * GNSS time comes from the fixes of the GNSS device, whenever something (e.g., the position
+ * source) has it running; the sample clock doesn't start it.  Until the first fix, and after more
+ * than GNSS_HOLDOVER_NS without one, the wall clock is used as the reference instead, checked
+ * every WALL_CLOCK_CHECK_MS.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "sampleClock.h"
+
+#define NS_PER_SEC 1000000000LL
+
+/// Fastest rate at which the offset is slewed (parts per million).
+#define MAX_SLEW_PPM 500
+
+/// Offset errors larger than this are stepped forwards rather than slewed (ns).  At MAX_SLEW_PPM,
+/// a 10 s error takes over 5 hours to slew out.
+#define STEP_THRESHOLD_NS (10 * NS_PER_SEC)
+
+/// How often the offset is checked against the wall clock, when there's no GNSS time (ms).
+#define WALL_CLOCK_CHECK_MS 10000
+
+/// GNSS fixes whose time is less accurate than this are ignored (ns).
+#define GNSS_MAX_TIME_ACCURACY_NS 10000000
+
+/// How long the offset is held after the last GNSS fix, before going back to the wall clock (ns).
+#define GNSS_HOLDOVER_NS (3600 * NS_PER_SEC)
+
+/// Offset of the sample clock from the monotonic clock, as a function of the monotonic clock.
+static struct
+{
+    int64_t baseMonotonic;  ///< Monotonic time at which the current slew started (ns).
+    int64_t baseOffset;     ///< Offset at baseMonotonic (ns).
+    int64_t slewRatePpm;    ///< Rate at which the offset is changing (signed).
+    int64_t slewEnd;        ///< Monotonic time at which the slew stops (ns).
+}
+Offset;
+
+/// Monotonic time of the last GNSS fix used (ns), or 0 if none has been yet.
+static int64_t LastGnssTime = 0;
+
+/// Timer used to check the offset against the wall clock.
+static le_timer_Ref_t WallClockTimer;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a clock in nanoseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t ReadClockNs
+(
+    clockid_t clockId
+)
+{
+    struct timespec now;
+
+    LE_ASSERT(clock_gettime(clockId, &now) == 0);
+
+    return ((int64_t)now.tv_sec * NS_PER_SEC) + now.tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the offset of the sample clock from the monotonic clock at a given monotonic time.
+ *
+ * @return The offset (ns).
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t GetOffset
+(
+    int64_t monotonicNs
+)
+{
+    int64_t until = (monotonicNs < Offset.slewEnd) ? monotonicNs : Offset.slewEnd;
+    int64_t elapsed = until - Offset.baseMonotonic;
+
+    if (elapsed <= 0)
+    {
+        return Offset.baseOffset;
+    }
+
+    // Split so that slews of hours or days (see Discipline()) don't overflow.
+    return Offset.baseOffset + ((elapsed / 1000000) * Offset.slewRatePpm)
+                             + (((elapsed % 1000000) * Offset.slewRatePpm) / 1000000);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Steer the offset towards the one given by a reference clock.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Discipline
+(
+    const char* sourceName,     ///< Reference clock, for logging.
+    int64_t monotonicNs,        ///< Monotonic time at which the reference was read (ns).
+    int64_t referenceNs         ///< Reference time (ns since the Epoch).
+)
+{
+    int64_t offset = GetOffset(monotonicNs);
+    int64_t error = (referenceNs - monotonicNs) - offset;
+    int64_t magnitude = (error < 0) ? -error : error;
+    bool isSlewingBack = (Offset.slewRatePpm < 0) && (Offset.slewEnd > monotonicNs);
+
+    Offset.baseMonotonic = monotonicNs;
+
+    if (error > STEP_THRESHOLD_NS)
+    {
+        LE_INFO("Stepping sample clock by %.3f s to %s time.", (double)error / NS_PER_SEC,
+                sourceName);
+
+        Offset.baseOffset = offset + error;
+        Offset.slewRatePpm = 0;
+        Offset.slewEnd = monotonicNs;
+    }
+    else
+    {
+        // The sample clock never steps backwards, so it stays ahead until the slew catches up.
+        // Say so once, rather than every time the reference is checked during the slew.
+        if ((error < -STEP_THRESHOLD_NS) && !isSlewingBack)
+        {
+            LE_WARN("Sample clock is %.3f s ahead of %s time.  Slewing it back, which will take"
+                    " %.1f hours; samples are timestamped ahead until then.",
+                    (double)magnitude / NS_PER_SEC,
+                    sourceName,
+                    ((double)magnitude * 1000000 / MAX_SLEW_PPM) / NS_PER_SEC / 3600);
+        }
+
+        Offset.baseOffset = offset;
+        Offset.slewRatePpm = (error < 0) ? -MAX_SLEW_PPM : MAX_SLEW_PPM;
+        Offset.slewEnd = monotonicNs + ((magnitude / MAX_SLEW_PPM) * 1000000)
+                                     + (((magnitude % MAX_SLEW_PPM) * 1000000) / MAX_SLEW_PPM);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler that checks the offset against the wall clock, unless GNSS time has been
+ * available recently.
+ */
+//--------------------------------------------------------------------------------------------------
+static void WallClockTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    int64_t monotonicNs = ReadClockNs(CLOCK_MONOTONIC);
+
+    if ((LastGnssTime != 0) && ((monotonicNs - LastGnssTime) < GNSS_HOLDOVER_NS))
+    {
+        return;
+    }
+
+    Discipline("wall clock", monotonicNs, ReadClockNs(CLOCK_REALTIME));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler for the fixes of the GNSS device.  Those with an accurate enough time discipline the
+ * offset.
+ */
+//--------------------------------------------------------------------------------------------------
+static void GnssPositionHandler
+(
+    le_gnss_SampleRef_t sampleRef,
+    void* contextPtr
+)
+{
+    int64_t monotonicNs = ReadClockNs(CLOCK_MONOTONIC);
+    uint64_t epochMs;
+    uint32_t accuracyNs;
+
+    if (   (le_gnss_GetEpochTime(sampleRef, &epochMs) == LE_OK)
+        && (epochMs != 0)
+        && (le_gnss_GetTimeAccuracy(sampleRef, &accuracyNs) == LE_OK)
+        && (accuracyNs <= GNSS_MAX_TIME_ACCURACY_NS))
+    {
+        if (LastGnssTime == 0)
+        {
+            LE_INFO("Sample clock locked to GNSS time.");
+        }
+
+        Discipline("GNSS", monotonicNs, (int64_t)epochMs * 1000000);
+        LastGnssTime = monotonicNs;
+    }
+
+    le_gnss_ReleaseSampleRef(sampleRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current sample clock time.
+ *
+ * @return Nanoseconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t sampleClock_GetNs
+(
+    void
+)
+{
+    return sampleClock_FromMonotonicNs(ReadClockNs(CLOCK_MONOTONIC));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a CLOCK_MONOTONIC time (e.g., a kernel timestamp) to sample clock time.
+ *
+ * @return Nanoseconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t sampleClock_FromMonotonicNs
+(
+    int64_t monotonicNs
+)
+{
+    return monotonicNs + GetOffset(monotonicNs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a sample clock time to a Data Hub timestamp.
+ *
+ * @return Seconds since the Epoch, in whole microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+double sampleClock_ToTimestamp
+(
+    int64_t ns
+)
+{
+    return (double)(ns / 1000) / 1000000.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current sample clock time as a Data Hub timestamp.
+ *
+ * @return Seconds since the Epoch, in whole microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+double sampleClock_Now
+(
+    void
+)
+{
+    return sampleClock_ToTimestamp(sampleClock_GetNs());
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the sample clock, starting from the wall clock.  The components that use it depend
+ * on it, so this runs before they take any samples.
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    int64_t monotonicNs = ReadClockNs(CLOCK_MONOTONIC);
+
+    Offset.baseMonotonic = monotonicNs;
+    Offset.baseOffset = ReadClockNs(CLOCK_REALTIME) - monotonicNs;
+    Offset.slewRatePpm = 0;
+    Offset.slewEnd = monotonicNs;
+
+    WallClockTimer = le_timer_Create("SampleClock");
+    le_timer_SetHandler(WallClockTimer, WallClockTimerExpired);
+    le_timer_SetMsInterval(WallClockTimer, WALL_CLOCK_CHECK_MS);
+    le_timer_SetRepeat(WallClockTimer, 0);
+    le_timer_Start(WallClockTimer);
+
+    if (le_gnss_AddPositionHandler(GnssPositionHandler, NULL) == NULL)
+    {
+        LE_WARN("Failed to register for GNSS fixes.  Sample clock follows the wall clock.");
+    }
+}
@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleClock.h
+ *
+ * Clock used to timestamp sensor samples when they are acquired.
+ *
+ * The wall clock can jump (when it's set from the network, or by NTP), which would make samples
+ * taken either side of the jump come out of order, or look like duplicates.  The sample clock is
+ * the monotonic clock plus an offset, so it can't jump with the wall clock.  The offset is
+ * disciplined against GNSS time whenever the position source has a fix, and against the wall
+ * clock otherwise.  Small errors are slewed out (see MAX_SLEW_PPM in sampleClock.c) so the sample
+ * clock never goes backwards; only errors too large to slew out in a reasonable time, e.g., when
+ * the first GNSS fix arrives on a device whose wall clock was never set, are stepped.
+ *
+ * Times are integer nanoseconds since the Epoch.  As Data Hub timestamps (double seconds), they
+ * are rounded down to whole microseconds, which a double holds exactly for centuries to come, so
+ * a timestamp converted back to integer microseconds always gives the same value, and
+ * timestamps can be compared for equality end to end.
+ *
+ * Not thread-safe: only use from the thread that runs the component's event loop.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SAMPLE_CLOCK_H_INCLUDE_GUARD
+#define SAMPLE_CLOCK_H_INCLUDE_GUARD
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current sample clock time.
+ *
+ * @return Nanoseconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED int64_t sampleClock_GetNs
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a CLOCK_MONOTONIC time (e.g., a kernel timestamp) to sample clock time.
+ *
+ * @return Nanoseconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED int64_t sampleClock_FromMonotonicNs
+(
+    int64_t monotonicNs
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a sample clock time to a Data Hub timestamp.
+ *
+ * @return Seconds since the Epoch, in whole microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double sampleClock_ToTimestamp
+(
+    int64_t ns
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the current sample clock time as a Data Hub timestamp.
+ *
+ * @return Seconds since the Epoch, in whole microseconds.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double sampleClock_Now
+(
+    void
+);
+
+
+#endif // SAMPLE_CLOCK_H_INCLUDE_GUARD
@@ -0,0 +1,1205 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleQueue.c
+ *
+ * Implementation of the persistent sample queue.  See sampleQueue.h.
+ *
+ * Each queue is a directory holding segment files named "seg-NNNNNNNN" (NNNNNNNN being the
+ * segment's sequence number, in hex) and a "cursor" file holding the delivered cursor.  A segment
+ * is a sequence of records, each made up of a RecordHeader_t followed by the sample's value.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "sampleQueue.h"
+
+#include <dirent.h>
+#include <sys/uio.h>
+
+/// Directory (in the sandbox) under which the queues are kept.  Host tests build with their own.
+#ifndef QUEUE_ROOT
+#define QUEUE_ROOT          "/data/queue"
+#endif
+
+/// Maximum time unsynced data is held before it is synced to flash (milliseconds).
+#define SYNC_INTERVAL_MS    5000
+
+/// Amount of unsynced data that triggers a sync straight away (bytes).
+#define SYNC_BYTES          (16 * 1024)
+
+/// Largest sample value that can be stored (bytes).
+#define MAX_VALUE_BYTES     4096
+
+/// Maximum length of a file path inside a queue.
+#define MAX_PATH_LEN        127
+
+#define CURSOR_FILE         "cursor"
+#define CURSOR_TEMP_FILE    "cursor.tmp"
+#define SEGMENT_NAME_FORMAT "seg-%08" PRIx32
+
+/// Marks the start of a record ("SQR1").
+#define RECORD_MAGIC        0x53515231
+
+/// Types of sample values.
+typedef enum
+{
+    RECORD_TYPE_NUMERIC = 1,
+    RECORD_TYPE_STRING = 2,
+}
+RecordType_t;
+
+/// Header at the start of each record in a segment file.
+typedef struct
+{
+    uint32_t magic;         ///< RECORD_MAGIC.
+    uint32_t valueBytes;    ///< Number of bytes of value following the header.
+    double timestamp;       ///< Timestamp of the sample.
+    uint32_t type;          ///< RecordType_t.
+    uint32_t checksum;      ///< Checksum of the rest of the header and the value.
+}
+RecordHeader_t;
+
+/// What's known about one segment file.
+typedef struct
+{
+    uint32_t seq;           ///< Sequence number (increases from the oldest to the newest).
+    size_t size;            ///< Number of bytes of valid records in the file.
+    double firstTimestamp;  ///< Timestamp of the oldest sample in the segment.
+    double lastTimestamp;   ///< Timestamp of the newest sample in the segment.
+}
+Segment_t;
+
+/// A sample queue.
+typedef struct sampleQueue
+{
+    le_dls_Link_t link;                 ///< Link in the QueueList.
+    char dirPath[MAX_PATH_LEN + 1];     ///< Directory holding the queue's files.
+    size_t maxSegments;
+    size_t segmentBytes;
+    Segment_t segments[SAMPLE_QUEUE_MAX_SEGMENTS];  ///< Oldest first.
+    size_t segmentCount;
+    int appendFd;                       ///< Newest segment, open for appending (-1 if not open).
+    size_t unsyncedBytes;               ///< Bytes appended since the last sync.
+    bool isCursorDirty;                 ///< true if the cursor changed since the last sync.
+    double delivered;                   ///< Delivered cursor.
+    double newest;                      ///< Timestamp of the newest sample appended.
+    int readFd;                         ///< Segment being read (-1 if not open).
+    uint32_t readSeq;                   ///< Sequence number of the segment being read.
+    off_t readOffset;                   ///< Offset of the record after the one last read.
+    double readTimestamp;               ///< Timestamp of the record last read.
+}
+Queue_t;
+
+/// Pool from which Queue_t objects are allocated.
+static le_mem_PoolRef_t QueuePool;
+
+/// List of all open queues.
+static le_dls_List_t QueueList = LE_DLS_LIST_INIT;
+
+/// Timer used to sync batches of writes.  Created by the thread that first writes to a queue, so
+/// that it runs on the event loop of the thread using the queues.
+static le_timer_Ref_t SyncTimer = NULL;
+
+/// Buffer used to check the values of records while scanning segments.
+static uint8_t ScratchBuffer[MAX_VALUE_BYTES];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute a record's checksum (32-bit FNV-1a over the header fields and the value).
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t ComputeChecksum
+(
+    const RecordHeader_t* headerPtr,
+    const void* valuePtr
+)
+{
+    uint32_t hash = 2166136261u;
+
+    const uint8_t* bytes = (const uint8_t*)&headerPtr->valueBytes;
+    size_t count = offsetof(RecordHeader_t, checksum) - offsetof(RecordHeader_t, valueBytes);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    bytes = valuePtr;
+
+    for (size_t i = 0; i < headerPtr->valueBytes; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a file in a queue's directory.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MakePath
+(
+    const Queue_t* queuePtr,
+    const char* fileName,
+    char* path              ///< Buffer of MAX_PATH_LEN + 1 bytes.
+)
+{
+    LE_ASSERT(snprintf(path, MAX_PATH_LEN + 1, "%s/%s", queuePtr->dirPath, fileName)
+              <= MAX_PATH_LEN);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build the path of a segment file.
+ */
+//--------------------------------------------------------------------------------------------------
+static void MakeSegmentPath
+(
+    const Queue_t* queuePtr,
+    uint32_t seq,
+    char* path              ///< Buffer of MAX_PATH_LEN + 1 bytes.
+)
+{
+    char fileName[32];
+
+    snprintf(fileName, sizeof(fileName), SEGMENT_NAME_FORMAT, seq);
+
+    MakePath(queuePtr, fileName, path);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sync a queue's directory, so that files created, renamed or deleted in it survive a power
+ * failure.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SyncDir
+(
+    const Queue_t* queuePtr
+)
+{
+    int fd = open(queuePtr->dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        (void)fsync(fd);
+        close(fd);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the record at a given offset in a segment file.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OUT_OF_RANGE if there is no complete, valid record at the offset.
+ *  - LE_OVERFLOW if the value doesn't fit in the buffer (the header is still read).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadRecord
+(
+    int fd,
+    off_t offset,
+    RecordHeader_t* headerPtr,  ///< [OUT]
+    void* valuePtr,             ///< [OUT] Buffer for the value.
+    size_t valueSize
+)
+{
+    if (pread(fd, headerPtr, sizeof(*headerPtr), offset) != sizeof(*headerPtr))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    if ((headerPtr->magic != RECORD_MAGIC) || (headerPtr->valueBytes > MAX_VALUE_BYTES))
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    if (headerPtr->valueBytes > valueSize)
+    {
+        return LE_OVERFLOW;
+    }
+
+    if (pread(fd, valuePtr, headerPtr->valueBytes, offset + sizeof(*headerPtr))
+        != (ssize_t)headerPtr->valueBytes)
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    if (ComputeChecksum(headerPtr, valuePtr) != headerPtr->checksum)
+    {
+        return LE_OUT_OF_RANGE;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the segment being read, if any.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseReadSegment
+(
+    Queue_t* queuePtr
+)
+{
+    if (queuePtr->readFd >= 0)
+    {
+        close(queuePtr->readFd);
+        queuePtr->readFd = -1;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a queue's oldest segment.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DropOldestSegment
+(
+    Queue_t* queuePtr
+)
+{
+    Segment_t* segmentPtr = &queuePtr->segments[0];
+    char path[MAX_PATH_LEN + 1];
+
+    if (segmentPtr->lastTimestamp > queuePtr->delivered)
+    {
+        LE_WARN("Queue '%s' is full.  Dropping undelivered samples up to %lf.",
+                queuePtr->dirPath,
+                segmentPtr->lastTimestamp);
+    }
+
+    if (queuePtr->readSeq == segmentPtr->seq)
+    {
+        CloseReadSegment(queuePtr);
+    }
+
+    if ((queuePtr->segmentCount == 1) && (queuePtr->appendFd >= 0))
+    {
+        close(queuePtr->appendFd);
+        queuePtr->appendFd = -1;
+        queuePtr->unsyncedBytes = 0;
+    }
+
+    MakeSegmentPath(queuePtr, segmentPtr->seq, path);
+    if (unlink(path) != 0)
+    {
+        LE_WARN("Failed to delete '%s' - %m", path);
+    }
+
+    queuePtr->segmentCount--;
+    memmove(&queuePtr->segments[0],
+            &queuePtr->segments[1],
+            queuePtr->segmentCount * sizeof(queuePtr->segments[0]));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the segments that only hold delivered samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DropDeliveredSegments
+(
+    Queue_t* queuePtr
+)
+{
+    bool droppedAny = false;
+
+    while (   (queuePtr->segmentCount > 0)
+           && (queuePtr->segments[0].lastTimestamp <= queuePtr->delivered) )
+    {
+        DropOldestSegment(queuePtr);
+        droppedAny = true;
+    }
+
+    if (droppedAny)
+    {
+        SyncDir(queuePtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save a queue's delivered cursor.  It's written to a temporary file and renamed into place, so
+ * the cursor is never half-written.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SaveCursor
+(
+    Queue_t* queuePtr
+)
+{
+    char tempPath[MAX_PATH_LEN + 1];
+    char path[MAX_PATH_LEN + 1];
+    char text[64];
+
+    MakePath(queuePtr, CURSOR_TEMP_FILE, tempPath);
+    MakePath(queuePtr, CURSOR_FILE, path);
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to create '%s' - %m", tempPath);
+        return;
+    }
+
+    // Hex float notation, so the timestamp reads back exactly.
+    int len = snprintf(text, sizeof(text), "%a\n", queuePtr->delivered);
+
+    bool isOk = ((write(fd, text, len) == len) && (fsync(fd) == 0));
+    close(fd);
+
+    if (!isOk || (rename(tempPath, path) != 0))
+    {
+        LE_ERROR("Failed to save '%s' - %m", path);
+        return;
+    }
+
+    SyncDir(queuePtr);
+
+    queuePtr->isCursorDirty = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load a queue's delivered cursor.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadCursor
+(
+    Queue_t* queuePtr
+)
+{
+    char path[MAX_PATH_LEN + 1];
+    char text[64];
+
+    MakePath(queuePtr, CURSOR_FILE, path);
+
+    queuePtr->delivered = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    ssize_t len = read(fd, text, sizeof(text) - 1);
+    close(fd);
+
+    if (len > 0)
+    {
+        text[len] = '\0';
+        queuePtr->delivered = strtod(text, NULL);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sync a queue's unsynced samples and delivered cursor to flash.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SyncQueue
+(
+    Queue_t* queuePtr
+)
+{
+    if ((queuePtr->appendFd >= 0) && (queuePtr->unsyncedBytes > 0))
+    {
+        if (fdatasync(queuePtr->appendFd) != 0)
+        {
+            LE_ERROR("Failed to sync queue '%s' - %m", queuePtr->dirPath);
+        }
+    }
+
+    queuePtr->unsyncedBytes = 0;
+
+    if (queuePtr->isCursorDirty)
+    {
+        SaveCursor(queuePtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer expiry handler that syncs the batched writes.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SyncTimerExpired
+(
+    le_timer_Ref_t timer
+)
+{
+    sampleQueue_SyncAll();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make sure a sync will happen soon.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScheduleSync
+(
+    void
+)
+{
+    if (SyncTimer == NULL)
+    {
+        SyncTimer = le_timer_Create("SampleQueueSync");
+        le_timer_SetHandler(SyncTimer, SyncTimerExpired);
+        le_timer_SetMsInterval(SyncTimer, SYNC_INTERVAL_MS);
+    }
+
+    if (!le_timer_IsRunning(SyncTimer))
+    {
+        le_timer_Start(SyncTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scan a segment file found when opening a queue, to find its timestamps and size.  Anything
+ * after the last valid record (e.g., a record torn by a power failure) is cut off.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScanSegment
+(
+    Queue_t* queuePtr,
+    uint32_t seq
+)
+{
+    char path[MAX_PATH_LEN + 1];
+    MakeSegmentPath(queuePtr, seq, path);
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to open '%s' - %m", path);
+        return;
+    }
+
+    Segment_t segment = { seq: seq, size: 0, firstTimestamp: 0, lastTimestamp: 0 };
+    RecordHeader_t header;
+
+    while (ReadRecord(fd, segment.size, &header, ScratchBuffer, sizeof(ScratchBuffer)) == LE_OK)
+    {
+        if (segment.size == 0)
+        {
+            segment.firstTimestamp = header.timestamp;
+        }
+        segment.lastTimestamp = header.timestamp;
+        segment.size += sizeof(header) + header.valueBytes;
+    }
+
+    struct stat fileStat;
+    if ((fstat(fd, &fileStat) == 0) && (fileStat.st_size != (off_t)segment.size))
+    {
+        LE_WARN("Discarding %lld bytes of incomplete records from '%s'.",
+                (long long)(fileStat.st_size - segment.size),
+                path);
+
+        if (ftruncate(fd, segment.size) != 0)
+        {
+            LE_ERROR("Failed to truncate '%s' - %m", path);
+        }
+    }
+
+    close(fd);
+
+    if (segment.size == 0)
+    {
+        (void)unlink(path);
+        return;
+    }
+
+    queuePtr->segments[queuePtr->segmentCount] = segment;
+    queuePtr->segmentCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two segment sequence numbers, for qsort().
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareSeq
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    uint32_t a = *(const uint32_t*)aPtr;
+    uint32_t b = *(const uint32_t*)bPtr;
+
+    return (a < b) ? -1 : (a > b);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find and scan the segment files of a queue being opened.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadSegments
+(
+    Queue_t* queuePtr
+)
+{
+    uint32_t seqs[SAMPLE_QUEUE_MAX_SEGMENTS * 2];
+    size_t seqCount = 0;
+
+    DIR* dirPtr = opendir(queuePtr->dirPath);
+    if (dirPtr == NULL)
+    {
+        LE_ERROR("Failed to open '%s' - %m", queuePtr->dirPath);
+        return;
+    }
+
+    struct dirent* entryPtr;
+    while ((entryPtr = readdir(dirPtr)) != NULL)
+    {
+        uint32_t seq;
+
+        if (   (sscanf(entryPtr->d_name, SEGMENT_NAME_FORMAT, &seq) == 1)
+            && (seqCount < NUM_ARRAY_MEMBERS(seqs)) )
+        {
+            seqs[seqCount] = seq;
+            seqCount++;
+        }
+    }
+
+    closedir(dirPtr);
+
+    qsort(seqs, seqCount, sizeof(seqs[0]), CompareSeq);
+
+    // If there are more segments than allowed (e.g., the limit was lowered), keep the newest.
+    size_t first = (seqCount > queuePtr->maxSegments) ? (seqCount - queuePtr->maxSegments) : 0;
+
+    for (size_t i = 0; i < first; i++)
+    {
+        char path[MAX_PATH_LEN + 1];
+        MakeSegmentPath(queuePtr, seqs[i], path);
+        (void)unlink(path);
+    }
+
+    for (size_t i = first; i < seqCount; i++)
+    {
+        ScanSegment(queuePtr, seqs[i]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the newest segment and start a new one, dropping the oldest segment if the queue is full.
+ *
+ * @return LE_OK if successful, LE_IO_ERROR if the new segment file couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartSegment
+(
+    Queue_t* queuePtr
+)
+{
+    if (queuePtr->appendFd >= 0)
+    {
+        SyncQueue(queuePtr);
+        close(queuePtr->appendFd);
+        queuePtr->appendFd = -1;
+    }
+
+    uint32_t seq = 1;
+    if (queuePtr->segmentCount > 0)
+    {
+        seq = queuePtr->segments[queuePtr->segmentCount - 1].seq + 1;
+    }
+
+    if (queuePtr->segmentCount == queuePtr->maxSegments)
+    {
+        DropOldestSegment(queuePtr);
+    }
+
+    char path[MAX_PATH_LEN + 1];
+    MakeSegmentPath(queuePtr, seq, path);
+
+    queuePtr->appendFd = open(path,
+                              O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                              S_IRUSR | S_IWUSR);
+    if (queuePtr->appendFd < 0)
+    {
+        LE_ERROR("Failed to create '%s' - %m", path);
+        return LE_IO_ERROR;
+    }
+
+    SyncDir(queuePtr);
+
+    Segment_t* segmentPtr = &queuePtr->segments[queuePtr->segmentCount];
+    segmentPtr->seq = seq;
+    segmentPtr->size = 0;
+    segmentPtr->firstTimestamp = 0;
+    segmentPtr->lastTimestamp = 0;
+    queuePtr->segmentCount++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a record to a queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the sample is no newer than the newest one in the queue.
+ *  - LE_OVERFLOW if the value is too large to be stored.
+ *  - LE_IO_ERROR if the sample couldn't be written.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Append
+(
+    Queue_t* queuePtr,
+    double timestamp,
+    RecordType_t type,
+    const void* valuePtr,
+    size_t valueBytes
+)
+{
+    if (timestamp <= queuePtr->newest)
+    {
+        return LE_DUPLICATE;
+    }
+
+    if (valueBytes > MAX_VALUE_BYTES)
+    {
+        LE_ERROR("Sample of %zu bytes too large for queue '%s'.", valueBytes, queuePtr->dirPath);
+        return LE_OVERFLOW;
+    }
+
+    size_t recordBytes = sizeof(RecordHeader_t) + valueBytes;
+    Segment_t* segmentPtr = NULL;
+
+    if (queuePtr->appendFd >= 0)
+    {
+        segmentPtr = &queuePtr->segments[queuePtr->segmentCount - 1];
+    }
+
+    if (   (segmentPtr == NULL)
+        || ((segmentPtr->size > 0) && ((segmentPtr->size + recordBytes) > queuePtr->segmentBytes)) )
+    {
+        if (StartSegment(queuePtr) != LE_OK)
+        {
+            return LE_IO_ERROR;
+        }
+
+        segmentPtr = &queuePtr->segments[queuePtr->segmentCount - 1];
+    }
+
+    RecordHeader_t header =
+    {
+        magic: RECORD_MAGIC,
+        valueBytes: valueBytes,
+        timestamp: timestamp,
+        type: type,
+        checksum: 0
+    };
+    header.checksum = ComputeChecksum(&header, valuePtr);
+
+    struct iovec iov[2] =
+    {
+        { iov_base: &header, iov_len: sizeof(header) },
+        { iov_base: (void*)valuePtr, iov_len: valueBytes }
+    };
+
+    ssize_t written;
+    do
+    {
+        written = writev(queuePtr->appendFd, iov, NUM_ARRAY_MEMBERS(iov));
+    }
+    while ((written < 0) && (errno == EINTR));
+
+    if (written != (ssize_t)recordBytes)
+    {
+        LE_ERROR("Failed to append to queue '%s' - %m", queuePtr->dirPath);
+
+        // Don't leave part of a record behind.
+        (void)ftruncate(queuePtr->appendFd, segmentPtr->size);
+
+        return LE_IO_ERROR;
+    }
+
+    if (segmentPtr->size == 0)
+    {
+        segmentPtr->firstTimestamp = timestamp;
+    }
+    segmentPtr->lastTimestamp = timestamp;
+    segmentPtr->size += recordBytes;
+
+    queuePtr->newest = timestamp;
+    queuePtr->unsyncedBytes += recordBytes;
+
+    if (queuePtr->unsyncedBytes >= SYNC_BYTES)
+    {
+        SyncQueue(queuePtr);
+    }
+    else
+    {
+        ScheduleSync();
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a segment by sequence number.
+ *
+ * @return Index of the segment, or -1 if it no longer exists.
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t FindSegment
+(
+    const Queue_t* queuePtr,
+    uint32_t seq
+)
+{
+    for (size_t i = 0; i < queuePtr->segmentCount; i++)
+    {
+        if (queuePtr->segments[i].seq == seq)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a segment for reading.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t OpenReadSegment
+(
+    Queue_t* queuePtr,
+    size_t index
+)
+{
+    char path[MAX_PATH_LEN + 1];
+
+    CloseReadSegment(queuePtr);
+
+    MakeSegmentPath(queuePtr, queuePtr->segments[index].seq, path);
+
+    queuePtr->readFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (queuePtr->readFd < 0)
+    {
+        LE_ERROR("Failed to open '%s' - %m", path);
+        return LE_IO_ERROR;
+    }
+
+    queuePtr->readSeq = queuePtr->segments[index].seq;
+    queuePtr->readOffset = 0;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest record in a queue that is newer than a given timestamp.
+ *
+ * If reading carries on from the previous read, it picks up where that one left off.  Otherwise,
+ * the segment holding the record is found using the segments' timestamps, and scanned.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND if there are no samples newer than startAfter.
+ *  - LE_OVERFLOW if the value doesn't fit in the buffer (the header is still read).
+ *  - LE_IO_ERROR if the queue couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Read
+(
+    Queue_t* queuePtr,
+    double startAfter,
+    RecordHeader_t* headerPtr,  ///< [OUT]
+    void* valuePtr,             ///< [OUT] Buffer for the value.
+    size_t valueSize
+)
+{
+    ssize_t index = -1;
+
+    if ((queuePtr->readFd >= 0) && (queuePtr->readTimestamp == startAfter))
+    {
+        index = FindSegment(queuePtr, queuePtr->readSeq);
+    }
+
+    if (index < 0)
+    {
+        for (size_t i = 0; i < queuePtr->segmentCount; i++)
+        {
+            if (queuePtr->segments[i].lastTimestamp > startAfter)
+            {
+                index = i;
+                break;
+            }
+        }
+
+        if (index < 0)
+        {
+            return LE_NOT_FOUND;
+        }
+
+        if (OpenReadSegment(queuePtr, index) != LE_OK)
+        {
+            return LE_IO_ERROR;
+        }
+    }
+
+    for (;;)
+    {
+        const Segment_t* segmentPtr = &queuePtr->segments[index];
+
+        if ((size_t)queuePtr->readOffset >= segmentPtr->size)
+        {
+            // Reached the end of this segment.  Move on to the next one, if there is one.
+            if ((size_t)(index + 1) >= queuePtr->segmentCount)
+            {
+                return LE_NOT_FOUND;
+            }
+
+            index++;
+
+            if (OpenReadSegment(queuePtr, index) != LE_OK)
+            {
+                return LE_IO_ERROR;
+            }
+
+            continue;
+        }
+
+        le_result_t result = ReadRecord(queuePtr->readFd,
+                                        queuePtr->readOffset,
+                                        headerPtr,
+                                        valuePtr,
+                                        valueSize);
+        if ((result != LE_OK) && (result != LE_OVERFLOW))
+        {
+            LE_ERROR("Corrupt record in queue '%s'.", queuePtr->dirPath);
+            CloseReadSegment(queuePtr);
+            return LE_IO_ERROR;
+        }
+
+        queuePtr->readOffset += sizeof(*headerPtr) + headerPtr->valueBytes;
+
+        if (headerPtr->timestamp > startAfter)
+        {
+            queuePtr->readTimestamp = headerPtr->timestamp;
+            return result;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sample queue, creating it if it doesn't exist yet.
+ *
+ * Samples left in the queue from before a restart are kept, along with the delivered cursor.
+ *
+ * @return Reference to the queue.
+ */
+//--------------------------------------------------------------------------------------------------
+sampleQueue_Ref_t sampleQueue_Open
+(
+    const char* name,       ///< Name of the queue (used as a directory name).
+    size_t maxSegments,     ///< Maximum number of segments (2 to SAMPLE_QUEUE_MAX_SEGMENTS).
+    size_t segmentBytes     ///< Size at which a segment is closed and a new one started.
+)
+{
+    LE_ASSERT((maxSegments >= 2) && (maxSegments <= SAMPLE_QUEUE_MAX_SEGMENTS));
+
+    Queue_t* queuePtr = le_mem_ForceAlloc(QueuePool);
+
+    memset(queuePtr, 0, sizeof(*queuePtr));
+    queuePtr->link = LE_DLS_LINK_INIT;
+    queuePtr->maxSegments = maxSegments;
+    queuePtr->segmentBytes = segmentBytes;
+    queuePtr->appendFd = -1;
+    queuePtr->readFd = -1;
+
+    LE_ASSERT(snprintf(queuePtr->dirPath, sizeof(queuePtr->dirPath), "%s/%s", QUEUE_ROOT, name)
+              < sizeof(queuePtr->dirPath));
+
+    le_result_t result = le_dir_MakePath(queuePtr->dirPath, S_IRWXU);
+    if ((result != LE_OK) && (result != LE_DUPLICATE))
+    {
+        LE_ERROR("Failed to create '%s' (%s).", queuePtr->dirPath, LE_RESULT_TXT(result));
+    }
+
+    LoadCursor(queuePtr);
+    LoadSegments(queuePtr);
+    DropDeliveredSegments(queuePtr);
+
+    queuePtr->newest = queuePtr->delivered;
+    if (queuePtr->segmentCount > 0)
+    {
+        queuePtr->newest = queuePtr->segments[queuePtr->segmentCount - 1].lastTimestamp;
+    }
+
+    LE_INFO("Opened queue '%s': %zu segments, delivered up to %lf, newest %lf.",
+            queuePtr->dirPath,
+            queuePtr->segmentCount,
+            queuePtr->delivered,
+            queuePtr->newest);
+
+    le_dls_Queue(&QueueList, &queuePtr->link);
+
+    return queuePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a numeric sample to a queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the sample is no newer than the newest one in the queue (it is ignored).
+ *  - LE_IO_ERROR if the sample couldn't be written.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sampleQueue_AppendNumeric
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp,
+    double value
+)
+{
+    return Append(queueRef, timestamp, RECORD_TYPE_NUMERIC, &value, sizeof(value));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a string (or JSON) sample to a queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the sample is no newer than the newest one in the queue (it is ignored).
+ *  - LE_IO_ERROR if the sample couldn't be written.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sampleQueue_AppendString
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp,
+    const char* value
+)
+{
+    le_result_t result = Append(queueRef, timestamp, RECORD_TYPE_STRING, value, strlen(value));
+
+    return (result == LE_OVERFLOW) ? LE_IO_ERROR : result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest numeric sample in a queue that is newer than a given timestamp.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND if there are no samples newer than startAfter.
+ *  - LE_FORMAT_ERROR if the sample isn't numeric (*timestampPtr is still set, so it can be
+ *    skipped).
+ *  - LE_IO_ERROR if the queue couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sampleQueue_ReadNumeric
+(
+    sampleQueue_Ref_t queueRef,
+    double startAfter,
+    double* timestampPtr,   ///< [OUT] Timestamp of the sample.
+    double* valuePtr        ///< [OUT] Value of the sample.
+)
+{
+    RecordHeader_t header;
+    double value;
+
+    le_result_t result = Read(queueRef, startAfter, &header, &value, sizeof(value));
+
+    if ((result == LE_OK) || (result == LE_OVERFLOW))
+    {
+        *timestampPtr = header.timestamp;
+
+        if ((result != LE_OK) || (header.type != RECORD_TYPE_NUMERIC)
+            || (header.valueBytes != sizeof(value)))
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        *valuePtr = value;
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest string (or JSON) sample in a queue that is newer than a given timestamp.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND if there are no samples newer than startAfter.
+ *  - LE_FORMAT_ERROR if the sample isn't a string (*timestampPtr is still set, so it can be
+ *    skipped).
+ *  - LE_OVERFLOW if the sample doesn't fit in the buffer (*timestampPtr is still set).
+ *  - LE_IO_ERROR if the queue couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sampleQueue_ReadString
+(
+    sampleQueue_Ref_t queueRef,
+    double startAfter,
+    double* timestampPtr,   ///< [OUT] Timestamp of the sample.
+    char* valuePtr,         ///< [OUT] Value of the sample.
+    size_t valueSize
+)
+{
+    RecordHeader_t header;
+
+    // Leave room for the null terminator.
+    le_result_t result = Read(queueRef, startAfter, &header, valuePtr, valueSize - 1);
+
+    if ((result == LE_OK) || (result == LE_OVERFLOW))
+    {
+        *timestampPtr = header.timestamp;
+
+        if (header.type != RECORD_TYPE_STRING)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        if (result == LE_OK)
+        {
+            valuePtr[header.valueBytes] = '\0';
+        }
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Move a queue's delivered cursor forward.  Segments that only hold samples no newer than the
+ * cursor are deleted.  The cursor is saved to flash along with the next batch of samples.
+ */
+//--------------------------------------------------------------------------------------------------
+void sampleQueue_SetDelivered
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp
+)
+{
+    if (timestamp <= queueRef->delivered)
+    {
+        return;
+    }
+
+    queueRef->delivered = timestamp;
+    queueRef->isCursorDirty = true;
+
+    DropDeliveredSegments(queueRef);
+
+    ScheduleSync();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a queue's delivered cursor.
+ *
+ * @return Timestamp of the newest delivered sample (0 if none).
+ */
+//--------------------------------------------------------------------------------------------------
+double sampleQueue_GetDelivered
+(
+    sampleQueue_Ref_t queueRef
+)
+{
+    return queueRef->delivered;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the timestamp of the newest sample in a queue.
+ *
+ * @return Timestamp of the newest sample (0 if the queue has never held any).
+ */
+//--------------------------------------------------------------------------------------------------
+double sampleQueue_GetNewest
+(
+    sampleQueue_Ref_t queueRef
+)
+{
+    return queueRef->newest;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sync everything written to all queues to flash now, rather than waiting for the next batch.
+ */
+//--------------------------------------------------------------------------------------------------
+void sampleQueue_SyncAll
+(
+    void
+)
+{
+    if (SyncTimer != NULL)
+    {
+        le_timer_Stop(SyncTimer);
+    }
+
+    le_dls_Link_t* linkPtr = le_dls_Peek(&QueueList);
+
+    while (linkPtr != NULL)
+    {
+        SyncQueue(CONTAINER_OF(linkPtr, Queue_t, link));
+
+        linkPtr = le_dls_PeekNext(&QueueList, linkPtr);
+    }
+}
+
+
+COMPONENT_INIT
+{
+    QueuePool = le_mem_CreatePool("SampleQueue", sizeof(Queue_t));
+}
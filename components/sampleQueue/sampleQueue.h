@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleQueue.h
+ *
+ * Persistent, flash-backed store-and-forward queue of timestamped sensor samples.
+ *
+ * Each queue lives in its own directory and is made up of append-only segment files.  Samples
+ * are appended to the newest segment, and a new segment is started when it fills up.  The oldest
+ * segment is discarded when the queue has its maximum number of segments, so the space used is
+ * bounded.  A "delivered" cursor records the timestamp of the newest sample that has made it to
+ * its destination; segments that only hold delivered samples are deleted.
+ *
+ * To limit flash wear, writes are not synced one by one.  The segment being appended to and the
+ * delivered cursor are synced together, after a few seconds or after enough data has been
+ * written, whichever comes first.  Samples written after the last sync may be lost if the power
+ * fails, but the queue will always reopen in a consistent state: a torn record at the end of a
+ * segment is detected by its checksum and discarded.
+ *
+ * The queues are not thread-safe.  All of them must be used from the same thread, which needn't be
+ * the main thread: the timer that syncs the batched writes runs on that thread's event loop.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SAMPLE_QUEUE_H_INCLUDE_GUARD
+#define SAMPLE_QUEUE_H_INCLUDE_GUARD
+
+/// Maximum number of segments a queue can be configured to keep.
+#define SAMPLE_QUEUE_MAX_SEGMENTS 32
+
+/// Reference to a sample queue.
+typedef struct sampleQueue* sampleQueue_Ref_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sample queue, creating it if it doesn't exist yet.
+ *
+ * Samples left in the queue from before a restart are kept, along with the delivered cursor.
+ *
+ * @return Reference to the queue.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED sampleQueue_Ref_t sampleQueue_Open
+(
+    const char* name,       ///< Name of the queue (used as a directory name).
+    size_t maxSegments,     ///< Maximum number of segments (2 to SAMPLE_QUEUE_MAX_SEGMENTS).
+    size_t segmentBytes     ///< Size at which a segment is closed and a new one started.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a numeric sample to a queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the sample is no newer than the newest one in the queue (it is ignored).
+ *  - LE_IO_ERROR if the sample couldn't be written.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sampleQueue_AppendNumeric
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append a string (or JSON) sample to a queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the sample is no newer than the newest one in the queue (it is ignored).
+ *  - LE_IO_ERROR if the sample couldn't be written.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sampleQueue_AppendString
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp,
+    const char* value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest numeric sample in a queue that is newer than a given timestamp.
+ *
+ * Reading through the samples in order (passing the timestamp of the previous sample each time)
+ * is cheap; it doesn't need to search the queue.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND if there are no samples newer than startAfter.
+ *  - LE_FORMAT_ERROR if the sample isn't numeric (*timestampPtr is still set, so it can be
+ *    skipped).
+ *  - LE_IO_ERROR if the queue couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sampleQueue_ReadNumeric
+(
+    sampleQueue_Ref_t queueRef,
+    double startAfter,
+    double* timestampPtr,   ///< [OUT] Timestamp of the sample.
+    double* valuePtr        ///< [OUT] Value of the sample.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the oldest string (or JSON) sample in a queue that is newer than a given timestamp.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_NOT_FOUND if there are no samples newer than startAfter.
+ *  - LE_FORMAT_ERROR if the sample isn't a string (*timestampPtr is still set, so it can be
+ *    skipped).
+ *  - LE_OVERFLOW if the sample doesn't fit in the buffer (*timestampPtr is still set).
+ *  - LE_IO_ERROR if the queue couldn't be read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sampleQueue_ReadString
+(
+    sampleQueue_Ref_t queueRef,
+    double startAfter,
+    double* timestampPtr,   ///< [OUT] Timestamp of the sample.
+    char* valuePtr,         ///< [OUT] Value of the sample.
+    size_t valueSize
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Move a queue's delivered cursor forward.  Segments that only hold samples no newer than the
+ * cursor are deleted.  The cursor is saved to flash along with the next batch of samples.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void sampleQueue_SetDelivered
+(
+    sampleQueue_Ref_t queueRef,
+    double timestamp
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a queue's delivered cursor.
+ *
+ * @return Timestamp of the newest delivered sample (0 if none).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double sampleQueue_GetDelivered
+(
+    sampleQueue_Ref_t queueRef
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the timestamp of the newest sample in a queue.
+ *
+ * @return Timestamp of the newest sample (0 if the queue has never held any).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED double sampleQueue_GetNewest
+(
+    sampleQueue_Ref_t queueRef
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sync everything written to all queues to flash now, rather than waiting for the next batch.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void sampleQueue_SyncAll
+(
+    void
+);
+
+#endif // SAMPLE_QUEUE_H_INCLUDE_GUARD
@@ -0,0 +1,408 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorRing.c
+ *
+ * Shared-memory sensor record rings.  See sensorRing.h for a description.
+ *
+ * The shared file starts with a header, followed by 'capacity' slots.  Record number n (counting
+ * from 0) goes to slot n % capacity.  Each slot starts with a sequence number, which the producer
+ * sets to 2n+1 before it writes record n, and to 2n+2 once it's done.  After that, it sets the
+ * header's head (the number of records published so far) to n+1.  A consumer copies the record
+ * out of the slot, and only keeps the copy if the sequence number was 2n+2 both before and after,
+ * so it never sees a record that's half-written, or that was replaced while it was copying it.
+ *
+ * The producer and consumers only ever share the file, which is created in /tmp and unlinked right
+ * away, so it's freed when the last process that maps it goes away.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <sys/mman.h>
+#include "sensorRing.h"
+
+/// Identifies a sensor ring file ("SRNG").
+#define RING_MAGIC 0x534e5247
+
+/// Version of the layout of the ring file.
+#define RING_VERSION 1
+
+/// Largest number of records a ring can hold.
+#define MAX_CAPACITY (1 << 20)
+
+/// Header at the start of a ring file.
+typedef struct
+{
+    uint32_t magic;         ///< RING_MAGIC.
+    uint32_t version;       ///< RING_VERSION.
+    uint32_t recordBytes;   ///< Size of each record (bytes).
+    uint32_t capacity;      ///< Number of slots (a power of two).
+    uint64_t head;          ///< Number of records published so far.
+}
+RingHeader_t;
+
+/// A ring as mapped into this process.
+typedef struct
+{
+    uint8_t* basePtr;       ///< Start of the mapping (the header).
+    size_t mapBytes;        ///< Size of the mapping (bytes).
+    size_t recordBytes;     ///< Size of each record (bytes).
+    size_t slotBytes;       ///< Size of each slot, including its sequence number (bytes).
+    uint64_t mask;          ///< capacity - 1.
+}
+Mapping_t;
+
+/// Ring being published to.
+struct sensorRing_Producer
+{
+    Mapping_t map;
+    int fd;                 ///< Ring's file.
+};
+
+/// Ring being read from.
+struct sensorRing_Consumer
+{
+    Mapping_t map;
+    uint64_t cursor;        ///< Number of the next record to read.
+};
+
+/// Pool from which producer objects are allocated.
+static le_mem_PoolRef_t ProducerPool;
+
+/// Pool from which consumer objects are allocated.
+static le_mem_PoolRef_t ConsumerPool;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the size of each slot of a ring, keeping the sequence numbers 8-byte aligned.
+ *
+ * @return The size (bytes).
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t SlotBytes
+(
+    size_t recordBytes
+)
+{
+    return sizeof(uint64_t) + ((recordBytes + 7) & ~(size_t)7);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a pointer to the header of a mapped ring.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline RingHeader_t* Header
+(
+    const Mapping_t* mapPtr
+)
+{
+    return (RingHeader_t*)mapPtr->basePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a pointer to the sequence number of the slot that holds a given record.  The record itself
+ * follows it.
+ */
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t* Slot
+(
+    const Mapping_t* mapPtr,
+    uint64_t recordNum
+)
+{
+    return (uint64_t*)(mapPtr->basePtr + sizeof(RingHeader_t)
+                                       + (recordNum & mapPtr->mask) * mapPtr->slotBytes);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a ring in a new, anonymous shared memory file.
+ *
+ * @return Reference to the ring, or NULL if it couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+sensorRing_ProducerRef_t sensorRing_Create
+(
+    size_t recordBytes,     ///< Size of each record (bytes).
+    size_t capacity         ///< Number of records the ring holds (rounded up to a power of two).
+)
+{
+    if ((recordBytes == 0) || (recordBytes > UINT16_MAX) || (capacity > MAX_CAPACITY))
+    {
+        LE_ERROR("Unsupported ring geometry (%zu records of %zu bytes).", capacity, recordBytes);
+        return NULL;
+    }
+
+    size_t slots = 1;
+    while (slots < capacity)
+    {
+        slots <<= 1;
+    }
+
+    char path[] = "/tmp/sensorRingXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to create ring file (%m).");
+        return NULL;
+    }
+    (void)unlink(path);
+
+    size_t slotBytes = SlotBytes(recordBytes);
+    size_t mapBytes = sizeof(RingHeader_t) + (slots * slotBytes);
+
+    void* basePtr = MAP_FAILED;
+    if (ftruncate(fd, mapBytes) == 0)
+    {
+        basePtr = mmap(NULL, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (basePtr == MAP_FAILED)
+    {
+        LE_ERROR("Failed to map a %zu byte ring file (%m).", mapBytes);
+        close(fd);
+        return NULL;
+    }
+
+    // The file is zero-filled, so every slot's sequence number (and the head) start at 0.
+    RingHeader_t* headerPtr = basePtr;
+    headerPtr->magic = RING_MAGIC;
+    headerPtr->version = RING_VERSION;
+    headerPtr->recordBytes = recordBytes;
+    headerPtr->capacity = slots;
+
+    sensorRing_ProducerRef_t producerRef = le_mem_ForceAlloc(ProducerPool);
+    producerRef->map = (Mapping_t){
+        basePtr: basePtr,
+        mapBytes: mapBytes,
+        recordBytes: recordBytes,
+        slotBytes: slotBytes,
+        mask: slots - 1
+    };
+    producerRef->fd = fd;
+
+    return producerRef;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish a record to a ring, overwriting the oldest one if the ring is full.  Never blocks.
+ */
+//--------------------------------------------------------------------------------------------------
+void sensorRing_Publish
+(
+    sensorRing_ProducerRef_t producerRef,
+    const void* recordPtr   ///< Record of the ring's record size.
+)
+{
+    Mapping_t* mapPtr = &producerRef->map;
+    RingHeader_t* headerPtr = Header(mapPtr);
+
+    // There's only one producer, so nobody else changes the head.
+    uint64_t recordNum = headerPtr->head;
+    uint64_t* seqPtr = Slot(mapPtr, recordNum);
+
+    __atomic_store_n(seqPtr, (2 * recordNum) + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(seqPtr + 1, recordPtr, mapPtr->recordBytes);
+
+    __atomic_store_n(seqPtr, (2 * recordNum) + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&headerPtr->head, recordNum + 1, __ATOMIC_RELEASE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a new file descriptor for a ring's shared memory file, to hand to a consumer.  The caller
+ * owns the descriptor.
+ *
+ * @return The file descriptor, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+int sensorRing_GetFd
+(
+    sensorRing_ProducerRef_t producerRef
+)
+{
+    int fd = dup(producerRef->fd);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to duplicate ring file descriptor (%m).");
+    }
+
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start reading from a ring, given its shared memory file.  The first read gets the first record
+ * published after this call.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the file isn't a ring of records of the given size
+ *  - LE_FAULT if the file couldn't be mapped.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sensorRing_Attach
+(
+    int fd,                 ///< Ring's file.  Closed by this function, whether it succeeds or not.
+    size_t recordBytes,     ///< Size of the records the caller expects (bytes).
+    sensorRing_ConsumerRef_t* consumerRefPtr    ///< [OUT] Reference to the ring, if LE_OK.
+)
+{
+    RingHeader_t header;
+    struct stat fileStat;
+
+    if (   (fstat(fd, &fileStat) != 0)
+        || (pread(fd, &header, sizeof(header), 0) != sizeof(header)))
+    {
+        LE_ERROR("Failed to read ring file header (%m).");
+        close(fd);
+        return LE_FAULT;
+    }
+
+    if (   (header.magic != RING_MAGIC)
+        || (header.version != RING_VERSION)
+        || (header.recordBytes != recordBytes)
+        || (header.capacity == 0)
+        || (header.capacity > MAX_CAPACITY)
+        || ((header.capacity & (header.capacity - 1)) != 0))
+    {
+        LE_ERROR("Not a ring of %zu byte records.", recordBytes);
+        close(fd);
+        return LE_FORMAT_ERROR;
+    }
+
+    size_t slotBytes = SlotBytes(recordBytes);
+    size_t mapBytes = sizeof(RingHeader_t) + (header.capacity * slotBytes);
+    if ((size_t)fileStat.st_size < mapBytes)
+    {
+        LE_ERROR("Ring file is truncated (%zu bytes of %zu).", (size_t)fileStat.st_size, mapBytes);
+        close(fd);
+        return LE_FORMAT_ERROR;
+    }
+
+    void* basePtr = mmap(NULL, mapBytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (basePtr == MAP_FAILED)
+    {
+        LE_ERROR("Failed to map a %zu byte ring file (%m).", mapBytes);
+        return LE_FAULT;
+    }
+
+    sensorRing_ConsumerRef_t consumerRef = le_mem_ForceAlloc(ConsumerPool);
+    consumerRef->map = (Mapping_t){
+        basePtr: basePtr,
+        mapBytes: mapBytes,
+        recordBytes: recordBytes,
+        slotBytes: slotBytes,
+        mask: header.capacity - 1
+    };
+    consumerRef->cursor = __atomic_load_n(&Header(&consumerRef->map)->head, __ATOMIC_ACQUIRE);
+
+    *consumerRefPtr = consumerRef;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next record from a ring, without blocking.
+ *
+ * @return
+ *  - LE_OK if a record was read
+ *  - LE_WOULD_BLOCK if no record has been published since the last one read.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sensorRing_Read
+(
+    sensorRing_ConsumerRef_t consumerRef,
+    void* recordPtr,        ///< [OUT] Buffer of the ring's record size.
+    uint64_t* lostCountPtr  ///< [OUT] Number of records overwritten before they could be read
+                            ///  since the last read (NULL if not wanted).
+)
+{
+    Mapping_t* mapPtr = &consumerRef->map;
+    uint64_t capacity = mapPtr->mask + 1;
+    uint64_t lost = 0;
+
+    for (;;)
+    {
+        uint64_t head = __atomic_load_n(&Header(mapPtr)->head, __ATOMIC_ACQUIRE);
+        if (consumerRef->cursor == head)
+        {
+            break;
+        }
+
+        // Skip the records that have already been overwritten.
+        if ((head - consumerRef->cursor) > capacity)
+        {
+            lost += head - consumerRef->cursor - capacity;
+            consumerRef->cursor = head - capacity;
+        }
+
+        const uint64_t* seqPtr = Slot(mapPtr, consumerRef->cursor);
+        uint64_t expected = (2 * consumerRef->cursor) + 2;
+
+        uint64_t seq = __atomic_load_n(seqPtr, __ATOMIC_ACQUIRE);
+        if (seq == expected)
+        {
+            memcpy(recordPtr, seqPtr + 1, mapPtr->recordBytes);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            seq = __atomic_load_n(seqPtr, __ATOMIC_RELAXED);
+        }
+
+        consumerRef->cursor++;
+
+        if (seq == expected)
+        {
+            if (lostCountPtr != NULL)
+            {
+                *lostCountPtr = lost;
+            }
+            return LE_OK;
+        }
+
+        // The producer has started writing over this record, so it's gone.
+        lost++;
+    }
+
+    if (lostCountPtr != NULL)
+    {
+        *lostCountPtr = lost;
+    }
+    return LE_WOULD_BLOCK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop reading from a ring.
+ */
+//--------------------------------------------------------------------------------------------------
+void sensorRing_Detach
+(
+    sensorRing_ConsumerRef_t consumerRef
+)
+{
+    (void)munmap(consumerRef->map.basePtr, consumerRef->map.mapBytes);
+    le_mem_Release(consumerRef);
+}
+
+
+COMPONENT_INIT
+{
+    ProducerPool = le_mem_CreatePool("SensorRingProducer", sizeof(struct sensorRing_Producer));
+    ConsumerPool = le_mem_CreatePool("SensorRingConsumer", sizeof(struct sensorRing_Consumer));
+}
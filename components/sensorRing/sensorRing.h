@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorRing.h
+ *
+ * Shared-memory rings that pass high-rate sensor records from one producer to any number of
+ * consumers in other processes, without any IPC per record.
+ *
+ * A ring lives in a memory-mapped file.  The producer creates it, and hands its file descriptor to
+ * consumers (e.g., through the sensorShm API, see sensorShm.api), which map it read-only.  The
+ * ring holds the last 'capacity' records, each in a slot guarded by a sequence number, so the
+ * producer never waits for the consumers: a consumer that falls more than 'capacity' records
+ * behind loses the oldest ones, and is told how many.  The consumers never write to the ring, so
+ * they can't disturb the producer or each other.
+ *
+ * Reads are non-blocking.  A consumer polls the ring at whatever rate suits it (e.g., on a timer),
+ * and reads all the records published since its last read.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SENSOR_RING_H_INCLUDE_GUARD
+#define SENSOR_RING_H_INCLUDE_GUARD
+
+/// Records of the IMU ring.
+typedef struct
+{
+    double timestamp;   ///< When the sample was taken (seconds since the Epoch).
+    double accel[3];    ///< x, y and z linear acceleration (m/s2).
+    double gyro[3];     ///< x, y and z angular velocity (rad/s).
+}
+sensorRing_ImuRecord_t;
+
+/// Records of the pressure ring.
+typedef struct
+{
+    double timestamp;   ///< When the sample was taken (seconds since the Epoch).
+    double pressure;    ///< Air pressure (kPa).
+}
+sensorRing_PressureRecord_t;
+
+/// Reference to a ring being published to.
+typedef struct sensorRing_Producer* sensorRing_ProducerRef_t;
+
+/// Reference to a ring being read from.
+typedef struct sensorRing_Consumer* sensorRing_ConsumerRef_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a ring in a new, anonymous shared memory file.
+ *
+ * @return Reference to the ring, or NULL if it couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED sensorRing_ProducerRef_t sensorRing_Create
+(
+    size_t recordBytes,     ///< Size of each record (bytes).
+    size_t capacity         ///< Number of records the ring holds (rounded up to a power of two).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish a record to a ring, overwriting the oldest one if the ring is full.  Never blocks.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void sensorRing_Publish
+(
+    sensorRing_ProducerRef_t producerRef,
+    const void* recordPtr   ///< Record of the ring's record size.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a new file descriptor for a ring's shared memory file, to hand to a consumer.  The caller
+ * owns the descriptor.
+ *
+ * @return The file descriptor, or -1 on failure.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED int sensorRing_GetFd
+(
+    sensorRing_ProducerRef_t producerRef
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start reading from a ring, given its shared memory file.  The first read gets the first record
+ * published after this call.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the file isn't a ring of records of the given size
+ *  - LE_FAULT if the file couldn't be mapped.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sensorRing_Attach
+(
+    int fd,                 ///< Ring's file.  Closed by this function, whether it succeeds or not.
+    size_t recordBytes,     ///< Size of the records the caller expects (bytes).
+    sensorRing_ConsumerRef_t* consumerRefPtr    ///< [OUT] Reference to the ring, if LE_OK.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the next record from a ring, without blocking.
+ *
+ * @return
+ *  - LE_OK if a record was read
+ *  - LE_WOULD_BLOCK if no record has been published since the last one read.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t sensorRing_Read
+(
+    sensorRing_ConsumerRef_t consumerRef,
+    void* recordPtr,        ///< [OUT] Buffer of the ring's record size.
+    uint64_t* lostCountPtr  ///< [OUT] Number of records overwritten before they could be read
+                            ///  since the last read (NULL if not wanted).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop reading from a ring.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void sensorRing_Detach
+(
+    sensorRing_ConsumerRef_t consumerRef
+);
+
+
+#endif // SENSOR_RING_H_INCLUDE_GUARD
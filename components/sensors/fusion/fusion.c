@@ -0,0 +1,279 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file fusion.c
+ *
+ * On-device orientation estimation from the Inertial Measurement Unit (IMU).
+ *
+ * The accelerometer and gyroscope frames streamed by the IMU component (see imuStream.h) are fed,
+ * at the IMU's native sample rate, into a Madgwick gradient-descent orientation filter.  The gyro
+ * readings are integrated into an orientation quaternion, and the accelerometer's measurement of
+ * gravity is used to correct the roll and pitch drift of that integration.  There's no
+ * magnetometer, so the yaw is relative to the orientation at start-up, and drifts slowly.
+ *
+ * Every REPORT_PERIOD seconds, the current orientation is published as a JSON value to the Data
+ * Hub Input "orientation/value", from which avPublisher pushes it to AirVantage:
+ *
+ * { "qw": 1.0, "qx": 0.0, "qy": 0.0, "qz": 0.0, "roll": 0.0, "pitch": 0.0, "yaw": 0.0 }
+ *
+ * The roll, pitch and yaw are in degrees (aerospace convention, rotating about x, y then z).  One
+ * such report replaces the hundreds of raw samples that would be needed to work out the
+ * orientation in the cloud.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "imuStream.h"
+
+#ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
+#define FUSION_PREFIX_NAME  "/app/redSensor/"
+#else
+#define FUSION_PREFIX_NAME  ""
+#endif
+
+/// Data Hub Input that the orientation reports are published to.
+#define ORIENTATION_PATH    FUSION_PREFIX_NAME "orientation/value"
+
+/// Time between orientation reports (seconds).
+#define REPORT_PERIOD 10.0
+
+/// Gain of the filter's accelerometer correction (rad/s).  Higher values converge faster after
+/// start-up but let more of the accelerometer's vibration noise into the orientation.
+#define FILTER_BETA 0.1
+
+/// Longest gap between frames that is integrated (seconds).  After a longer gap (e.g., the stream
+/// restarting), the orientation is not integrated over the gap.
+#define MAX_FRAME_GAP 1.0
+
+/// Orientation filter state.
+static struct
+{
+    double q[4];            ///< Orientation quaternion (w, x, y, z), of unit length.
+    bool isInitialized;     ///< false until the first frame has set the initial orientation.
+    double lastTimestamp;   ///< Timestamp of the last frame (seconds since the Epoch).
+    double nextReportTime;  ///< When the next report is due (seconds since the Epoch).
+}
+Filter;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Normalize a 4-vector to unit length.  A zero vector is left alone.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Normalize4
+(
+    double* v
+)
+{
+    double norm = sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]) + (v[3] * v[3]));
+
+    if (norm > 0.0)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            v[i] /= norm;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the initial orientation from the direction of gravity, so the filter doesn't have to
+ * converge from an arbitrary one.  The yaw starts at zero.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitOrientation
+(
+    const double* accel     ///< x, y and z acceleration (m/s2).
+)
+{
+    double roll = atan2(accel[1], accel[2]);
+    double pitch = atan2(-accel[0], sqrt((accel[1] * accel[1]) + (accel[2] * accel[2])));
+
+    double cr = cos(roll / 2.0);
+    double sr = sin(roll / 2.0);
+    double cp = cos(pitch / 2.0);
+    double sp = sin(pitch / 2.0);
+
+    Filter.q[0] = cr * cp;
+    Filter.q[1] = sr * cp;
+    Filter.q[2] = cr * sp;
+    Filter.q[3] = -sr * sp;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the orientation by one frame (Madgwick's IMU update).
+ */
+//--------------------------------------------------------------------------------------------------
+static void UpdateOrientation
+(
+    const double* gyro,     ///< x, y and z angular velocity (rad/s).
+    const double* accel,    ///< x, y and z acceleration (m/s2).
+    double dt               ///< Time since the previous frame (seconds).
+)
+{
+    double* q = Filter.q;
+
+    // Rate of change of the quaternion from the gyro: 0.5 * q * (0, gyro).
+    double qDot[4] =
+    {
+        0.5 * ((-q[1] * gyro[0]) - (q[2] * gyro[1]) - (q[3] * gyro[2])),
+        0.5 * (( q[0] * gyro[0]) + (q[2] * gyro[2]) - (q[3] * gyro[1])),
+        0.5 * (( q[0] * gyro[1]) - (q[1] * gyro[2]) + (q[3] * gyro[0])),
+        0.5 * (( q[0] * gyro[2]) + (q[1] * gyro[1]) - (q[2] * gyro[0])),
+    };
+
+    double norm = sqrt((accel[0] * accel[0]) + (accel[1] * accel[1]) + (accel[2] * accel[2]));
+
+    // Correct towards the orientation in which gravity points the way the accelerometer says it
+    // does, by one step of gradient descent.  (A zero reading, e.g., in free fall, has no
+    // direction to correct towards.)
+    if (norm > 0.0)
+    {
+        double ax = accel[0] / norm;
+        double ay = accel[1] / norm;
+        double az = accel[2] / norm;
+
+        double q0q0 = q[0] * q[0];
+        double q1q1 = q[1] * q[1];
+        double q2q2 = q[2] * q[2];
+        double q3q3 = q[3] * q[3];
+
+        double step[4] =
+        {
+            (4.0 * q[0] * q2q2) + (2.0 * q[2] * ax) + (4.0 * q[0] * q1q1) - (2.0 * q[1] * ay),
+            (4.0 * q[1] * q3q3) - (2.0 * q[3] * ax) + (4.0 * q0q0 * q[1]) - (2.0 * q[0] * ay)
+                - (4.0 * q[1]) + (8.0 * q[1] * q1q1) + (8.0 * q[1] * q2q2) + (4.0 * q[1] * az),
+            (4.0 * q0q0 * q[2]) + (2.0 * q[0] * ax) + (4.0 * q[2] * q3q3) - (2.0 * q[3] * ay)
+                - (4.0 * q[2]) + (8.0 * q[2] * q1q1) + (8.0 * q[2] * q2q2) + (4.0 * q[2] * az),
+            (4.0 * q1q1 * q[3]) - (2.0 * q[1] * ax) + (4.0 * q2q2 * q[3]) - (2.0 * q[2] * ay),
+        };
+
+        Normalize4(step);
+
+        for (int i = 0; i < 4; i++)
+        {
+            qDot[i] -= FILTER_BETA * step[i];
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        q[i] += qDot[i] * dt;
+    }
+
+    Normalize4(q);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the current orientation to the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReportOrientation
+(
+    double timestamp
+)
+{
+    const double* q = Filter.q;
+    const double degreesPerRadian = 180.0 / M_PI;
+
+    double roll = atan2(2.0 * ((q[0] * q[1]) + (q[2] * q[3])),
+                        1.0 - (2.0 * ((q[1] * q[1]) + (q[2] * q[2]))));
+    double sinPitch = 2.0 * ((q[0] * q[2]) - (q[3] * q[1]));
+    double pitch = (sinPitch >= 1.0) ? (M_PI / 2.0)
+                 : (sinPitch <= -1.0) ? (-M_PI / 2.0)
+                 : asin(sinPitch);
+    double yaw = atan2(2.0 * ((q[0] * q[3]) + (q[1] * q[2])),
+                       1.0 - (2.0 * ((q[2] * q[2]) + (q[3] * q[3]))));
+
+    char report[256];
+
+    int len = snprintf(report,
+                       sizeof(report),
+                       "{\"qw\":%.6f,\"qx\":%.6f,\"qy\":%.6f,\"qz\":%.6f,"
+                       "\"roll\":%.3f,\"pitch\":%.3f,\"yaw\":%.3f}",
+                       q[0], q[1], q[2], q[3],
+                       roll * degreesPerRadian,
+                       pitch * degreesPerRadian,
+                       yaw * degreesPerRadian);
+    if (len >= sizeof(report))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(report));
+    }
+
+    dhub_PushJson(ORIENTATION_PATH, timestamp, report);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a block of streamed IMU frames.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFrames
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        const imuStream_Frame_t* framePtr = &framesPtr[i];
+
+        if (!Filter.isInitialized)
+        {
+            InitOrientation(framePtr->accel);
+
+            Filter.isInitialized = true;
+            Filter.nextReportTime = framePtr->timestamp;
+        }
+        else
+        {
+            double dt = framePtr->timestamp - Filter.lastTimestamp;
+
+            if ((dt > 0.0) && (dt <= MAX_FRAME_GAP))
+            {
+                UpdateOrientation(framePtr->gyro, framePtr->accel, dt);
+            }
+        }
+
+        Filter.lastTimestamp = framePtr->timestamp;
+
+        if (framePtr->timestamp >= Filter.nextReportTime)
+        {
+            ReportOrientation(framePtr->timestamp);
+
+            Filter.nextReportTime = framePtr->timestamp + REPORT_PERIOD;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the fusion component.  The IMU component's COMPONENT_INIT (which sets up streaming)
+ * runs first, as this component depends on it.
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    LE_ASSERT_OK(dhub_CreateInput(ORIENTATION_PATH, DHUB_DATA_TYPE_JSON, ""));
+    dhub_SetJsonExample(ORIENTATION_PATH,
+                        "{\"qw\":1.0,\"qx\":0.0,\"qy\":0.0,\"qz\":0.0,"
+                        "\"roll\":0.0,\"pitch\":0.0,\"yaw\":0.0}");
+
+    if (imuStream_AddBlockHandler(HandleFrames, NULL) == NULL)
+    {
+        LE_ERROR("Failed to start the IMU stream.  No orientation will be reported.");
+    }
+}
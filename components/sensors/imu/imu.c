@@ -12,8 +12,11 @@
 #include "interfaces.h"
 
 #include "imu.h"
+#include "imuStream.h"
 #include "fileUtils.h"
+#include "packedVector.h"
 #include "periodicSensor.h"
+#include "sampleClock.h"
 
 #ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
 #define IMU_PREFIX_NAME   "/app/redSensor/"
@@ -21,47 +24,143 @@
 #define IMU_PREFIX_NAME   ""
 #endif
 
+/// Data Hub Inputs that carry the gyro and accelerometer samples as packed vectors (see
+/// packedVector.h), alongside the JSON "value" Inputs created by the Periodic Sensor component.
+#define GYRO_PACKED_PATH    IMU_PREFIX_NAME "gyro/packed"
+#define ACCEL_PACKED_PATH   IMU_PREFIX_NAME "accel/packed"
+
+/// sysfs attribute files of a three-axis IIO channel, kept open between samples, and the
+/// channel's cached calibration.
+typedef struct
+{
+    file_AttrRef_t scaleAttr;   ///< Scale that converts raw readings into SI units.
+    file_AttrRef_t raw[3];      ///< Raw x, y and z readings.
+    double scale;               ///< Cached copy of the scale.
+    bool isCalibrated;          ///< true if scale holds the driver's current value.
+}
+VectorChannel_t;
+
+static VectorChannel_t AccelChannel;
+static VectorChannel_t GyroChannel;
+
+/// Longest time (seconds) a motion snapshot taken for one of the accelerometer and gyro samples
+/// can be reused for the other's, so that both are read together when they're polled together.
+#define SNAPSHOT_MAX_AGE 0.05
+
+/// Most recent motion snapshot, and which of the accelerometer and gyro samples have used it.
+static struct
+{
+    imuStream_Frame_t frame;
+    bool isValid;
+    bool isAccelTaken;
+    bool isGyroTaken;
+}
+Snapshot;
+
+/// sysfs attribute files of the IMU's temperature channel and its cached calibration.
+static struct
+{
+    file_AttrRef_t scaleAttr;
+    file_AttrRef_t offsetAttr;
+    file_AttrRef_t rawAttr;
+    double scale;
+    double offset;
+    bool isCalibrated;
+}
+TempChannel;
+
+
 //--------------------------------------------------------------------------------------------------
 /**
- * Read the accelerometer's linear acceleration measurement in meters per second squared.
+ * Get the current time, as a Data Hub timestamp (seconds since the Epoch).  See sampleClock.h.
+ */
+//--------------------------------------------------------------------------------------------------
+static double Now
+(
+    void
+)
+{
+    return sampleClock_Now();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish an (x, y, z) sample to the Data Hub, both as JSON and as a packed vector.  Both carry
+ * the same timestamp.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushVector
+(
+    psensor_Ref_t ref,          ///< Periodic sensor that publishes the JSON form.
+    const char* packedPath,     ///< Data Hub Input that receives the packed form.
+    double timestamp,
+    const double* vector        ///< x, y and z.
+)
+{
+    char sample[256];
+
+    int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}",
+                       vector[0], vector[1], vector[2]);
+    if (len >= sizeof(sample))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
+    }
+
+    psensor_PushJson(ref, timestamp, sample);
+
+    char packed[PACKED_VECTOR_BUFFER_BYTES(3)];
+
+    LE_ASSERT_OK(packedVector_Encode(vector, 3, packed, sizeof(packed)));
+
+    dhub_PushString(packedPath, timestamp, packed);
+}
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a three-axis IIO channel and convert the raw readings into SI units using the channel's
+ * scale.  The scale is only read from the driver if it isn't already cached.
  *
  * @return LE_OK if successful.
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t imu_ReadAccel
+static le_result_t ReadVectorChannel
 (
+    VectorChannel_t* channelPtr,
     double* xPtr,
-        ///< [OUT] Where the x-axis acceleration (m/s2) will be put if LE_OK is returned.
     double* yPtr,
-        ///< [OUT] Where the y-axis acceleration (m/s2) will be put if LE_OK is returned.
     double* zPtr
-        ///< [OUT] Where the z-axis acceleration (m/s2) will be put if LE_OK is returned.
 )
 {
     le_result_t r;
 
-    double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_accel_scale", &scaling);
-    if (r != LE_OK)
+    if (!channelPtr->isCalibrated)
     {
-        goto done;
+        r = file_ReadAttrDouble(channelPtr->scaleAttr, &channelPtr->scale);
+        if (r != LE_OK)
+        {
+            goto done;
+        }
+        channelPtr->isCalibrated = true;
     }
 
-    r = file_ReadDouble("/driver/in_accel_x_raw", xPtr);
+    const double scaling = channelPtr->scale;
+
+    r = file_ReadAttrDouble(channelPtr->raw[0], xPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_y_raw", yPtr);
+    r = file_ReadAttrDouble(channelPtr->raw[1], yPtr);
     if (r != LE_OK)
     {
         goto done;
     }
     *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_accel_z_raw", zPtr);
+    r = file_ReadAttrDouble(channelPtr->raw[2], zPtr);
     if (r != LE_OK)
     {
         goto done;
@@ -73,6 +172,65 @@ done:
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the sysfs attribute files of a three-axis IIO channel (e.g., "accel" or "anglvel").
+ */
+//--------------------------------------------------------------------------------------------------
+static void OpenVectorChannel
+(
+    VectorChannel_t* channelPtr,
+    const char* channelName
+)
+{
+    static const char axes[] = { 'x', 'y', 'z' };
+    char path[64];
+
+    LE_ASSERT(snprintf(path, sizeof(path), "/driver/in_%s_scale", channelName) < sizeof(path));
+    channelPtr->scaleAttr = file_OpenAttr(path);
+    channelPtr->isCalibrated = false;
+
+    for (int i = 0; i < NUM_ARRAY_MEMBERS(axes); i++)
+    {
+        LE_ASSERT(snprintf(path, sizeof(path), "/driver/in_%s_%c_raw", channelName, axes[i])
+                  < sizeof(path));
+        channelPtr->raw[i] = file_OpenAttr(path);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer's linear acceleration measurement in meters per second squared.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imu_ReadAccel
+(
+    double* xPtr,
+        ///< [OUT] Where the x-axis acceleration (m/s2) will be put if LE_OK is returned.
+    double* yPtr,
+        ///< [OUT] Where the y-axis acceleration (m/s2) will be put if LE_OK is returned.
+    double* zPtr
+        ///< [OUT] Where the z-axis acceleration (m/s2) will be put if LE_OK is returned.
+)
+{
+    imuStream_Frame_t frame;
+
+    // While streaming, the driver won't let the raw readings be read through sysfs.
+    if (imuStream_GetLatest(&frame) == LE_OK)
+    {
+        *xPtr = frame.accel[0];
+        *yPtr = frame.accel[1];
+        *zPtr = frame.accel[2];
+        return LE_OK;
+    }
+
+    return ReadVectorChannel(&AccelChannel, xPtr, yPtr, zPtr);
+}
+
+
 //--------------------------------------------------------------------------------------------------
 /**
  * Read the gyroscope's angular velocity measurement in radians per seconds.
@@ -90,37 +248,137 @@ le_result_t imu_ReadGyro
         ///< [OUT] Where the z-axis rotation (rads/s) will be put if LE_OK is returned.
 )
 {
-    le_result_t r;
+    imuStream_Frame_t frame;
 
-    double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_anglvel_scale", &scaling);
-    if (r != LE_OK)
+    // While streaming, the driver won't let the raw readings be read through sysfs.
+    if (imuStream_GetLatest(&frame) == LE_OK)
     {
-        goto done;
+        *xPtr = frame.gyro[0];
+        *yPtr = frame.gyro[1];
+        *zPtr = frame.gyro[2];
+        return LE_OK;
     }
 
-    r = file_ReadDouble("/driver/in_anglvel_x_raw", xPtr);
-    if (r != LE_OK)
+    return ReadVectorChannel(&GyroChannel, xPtr, yPtr, zPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer and the gyroscope together.  While streaming, this is the latest IIO
+ * buffer frame.  Otherwise, the six raw readings are read back to back through sysfs (which
+ * has no bulk read), and stamped with the midpoint of the reads.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadMotionFrame
+(
+    imuStream_Frame_t* framePtr
+)
+{
+    if (imuStream_GetLatest(framePtr) == LE_OK)
     {
-        goto done;
+        return LE_OK;
     }
-    *xPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_y_raw", yPtr);
-    if (r != LE_OK)
+    double start = Now();
+
+    le_result_t r = ReadVectorChannel(&AccelChannel,
+                                      &framePtr->accel[0],
+                                      &framePtr->accel[1],
+                                      &framePtr->accel[2]);
+    if (r == LE_OK)
     {
-        goto done;
+        r = ReadVectorChannel(&GyroChannel,
+                              &framePtr->gyro[0],
+                              &framePtr->gyro[1],
+                              &framePtr->gyro[2]);
     }
-    *yPtr *= scaling;
 
-    r = file_ReadDouble("/driver/in_anglvel_z_raw", zPtr);
-    if (r != LE_OK)
+    framePtr->timestamp = (start + Now()) / 2.0;
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a motion snapshot for the accelerometer or gyro sample.  If the other sensor's sample read
+ * one within the last SNAPSHOT_MAX_AGE, and this one hasn't used it yet, it's reused; otherwise a
+ * new one is read.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t TakeSnapshot
+(
+    bool* isTakenPtr,   ///< [IN/OUT] Snapshot.isAccelTaken or isGyroTaken.
+    imuStream_Frame_t* framePtr
+)
+{
+    if (   !Snapshot.isValid
+        || *isTakenPtr
+        || ((Now() - Snapshot.frame.timestamp) > SNAPSHOT_MAX_AGE) )
     {
-        goto done;
+        le_result_t r = ReadMotionFrame(&Snapshot.frame);
+
+        Snapshot.isValid = (r == LE_OK);
+        Snapshot.isAccelTaken = false;
+        Snapshot.isGyroTaken = false;
+
+        if (r != LE_OK)
+        {
+            return r;
+        }
+    }
+
+    *isTakenPtr = true;
+    *framePtr = Snapshot.frame;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer and the gyroscope together, as one snapshot with a single timestamp.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imu_ReadMotion
+(
+    double* timestampPtr,
+        ///< [OUT] When the snapshot was taken (seconds since the Epoch).
+    double* accelXPtr,
+        ///< [OUT] x-axis acceleration (m/s2).
+    double* accelYPtr,
+        ///< [OUT] y-axis acceleration (m/s2).
+    double* accelZPtr,
+        ///< [OUT] z-axis acceleration (m/s2).
+    double* gyroXPtr,
+        ///< [OUT] x-axis rotation (rads/s).
+    double* gyroYPtr,
+        ///< [OUT] y-axis rotation (rads/s).
+    double* gyroZPtr
+        ///< [OUT] z-axis rotation (rads/s).
+)
+{
+    imuStream_Frame_t frame;
+
+    le_result_t r = ReadMotionFrame(&frame);
+    if (r == LE_OK)
+    {
+        *timestampPtr = frame.timestamp;
+        *accelXPtr = frame.accel[0];
+        *accelYPtr = frame.accel[1];
+        *accelZPtr = frame.accel[2];
+        *gyroXPtr = frame.gyro[0];
+        *gyroYPtr = frame.gyro[1];
+        *gyroZPtr = frame.gyro[2];
     }
-    *zPtr *= scaling;
 
-done:
     return r;
 }
 
@@ -140,30 +398,33 @@ le_result_t temperature_Read
 {
     le_result_t r;
 
-    double scaling = 0.0;
-    r = file_ReadDouble("/driver/in_temp_scale", &scaling);
-    if (r != LE_OK)
+    if (!TempChannel.isCalibrated)
     {
-        LE_ERROR("Failed to read scale");
-        goto done;
-    }
+        r = file_ReadAttrDouble(TempChannel.scaleAttr, &TempChannel.scale);
+        if (r != LE_OK)
+        {
+            LE_ERROR("Failed to read scale");
+            goto done;
+        }
 
-    double offset = 0.0;
-    r = file_ReadDouble("/driver/in_temp_offset", &offset);
-    if (r != LE_OK)
-    {
-        LE_ERROR("Failed to read offset (%s)", LE_RESULT_TXT(r));
-        goto done;
+        r = file_ReadAttrDouble(TempChannel.offsetAttr, &TempChannel.offset);
+        if (r != LE_OK)
+        {
+            LE_ERROR("Failed to read offset (%s)", LE_RESULT_TXT(r));
+            goto done;
+        }
+
+        TempChannel.isCalibrated = true;
     }
 
-    r = file_ReadDouble("/driver/in_temp_raw", readingPtr);
+    r = file_ReadAttrDouble(TempChannel.rawAttr, readingPtr);
     if (r != LE_OK)
     {
         LE_ERROR("Failed to read raw value (%s)", LE_RESULT_TXT(r));
         goto done;
     }
 
-    *readingPtr = (*readingPtr + offset) * scaling / 1000;
+    *readingPtr = (*readingPtr + TempChannel.offset) * TempChannel.scale / 1000;
 
 done:
     return r;
@@ -172,7 +433,59 @@ done:
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sample the gyroscope and publish the results to the Data Hub.
+ * Load the accelerometer, gyroscope and temperature calibration (scale and offset) from the
+ * driver into the cache.  Anything that can't be read now will be retried on the next sample.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadCalibration
+(
+    void
+)
+{
+    AccelChannel.isCalibrated =
+        (file_ReadAttrDouble(AccelChannel.scaleAttr, &AccelChannel.scale) == LE_OK);
+
+    GyroChannel.isCalibrated =
+        (file_ReadAttrDouble(GyroChannel.scaleAttr, &GyroChannel.scale) == LE_OK);
+
+    TempChannel.isCalibrated =
+        (   (file_ReadAttrDouble(TempChannel.scaleAttr, &TempChannel.scale) == LE_OK)
+         && (file_ReadAttrDouble(TempChannel.offsetAttr, &TempChannel.offset) == LE_OK) );
+
+    LE_DEBUG("Calibration: accel scale %lf (%s), gyro scale %lf (%s),"
+             " temp scale %lf offset %lf (%s)",
+             AccelChannel.scale, AccelChannel.isCalibrated ? "ok" : "pending",
+             GyroChannel.scale, GyroChannel.isCalibrated ? "ok" : "pending",
+             TempChannel.scale, TempChannel.offset, TempChannel.isCalibrated ? "ok" : "pending");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the cached calibration and re-read it from the driver, along with the streaming scales
+ * (see imuStream.h).  Must be called whenever the range of the accelerometer or gyroscope is
+ * reconfigured.
+ */
+//--------------------------------------------------------------------------------------------------
+void imu_RefreshCalibration
+(
+    void
+)
+{
+    LoadCalibration();
+
+    le_result_t r = imuStream_RefreshCalibration();
+    if (r != LE_OK)
+    {
+        LE_WARN("Failed to refresh the streaming calibration (%s).", LE_RESULT_TXT(r));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample the gyroscope and publish the results to the Data Hub.  Shares a snapshot with the
+ * accelerometer's sample if they're polled together.
  */
 //--------------------------------------------------------------------------------------------------
 static void SampleGyro
@@ -181,23 +494,20 @@ static void SampleGyro
     void *contextPtr
 )
 {
-    double x;
-    double y;
-    double z;
+    imuStream_Frame_t frame;
 
-    le_result_t result = imu_ReadGyro(&x, &y, &z);
+    le_result_t result = TakeSnapshot(&Snapshot.isGyroTaken, &frame);
 
-    if (result == LE_OK)
+    if (result != LE_OK)
     {
-        char sample[256];
-
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
-        {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
-        }
+        // The gyroscope may still be readable on its own.
+        frame.timestamp = Now();
+        result = imu_ReadGyro(&frame.gyro[0], &frame.gyro[1], &frame.gyro[2]);
+    }
 
-        psensor_PushJson(ref, 0 /* now */, sample);
+    if (result == LE_OK)
+    {
+        PushVector(ref, GYRO_PACKED_PATH, frame.timestamp, frame.gyro);
     }
     else
     {
@@ -208,7 +518,8 @@ static void SampleGyro
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Sample the accelerometer and publish the results to the Data Hub.
+ * Sample the accelerometer and publish the results to the Data Hub.  Shares a snapshot with the
+ * gyroscope's sample if they're polled together.
  */
 //--------------------------------------------------------------------------------------------------
 static void SampleAccel
@@ -217,23 +528,20 @@ static void SampleAccel
     void *contextPtr
 )
 {
-    double x;
-    double y;
-    double z;
+    imuStream_Frame_t frame;
 
-    le_result_t result = imu_ReadAccel(&x, &y, &z);
+    le_result_t result = TakeSnapshot(&Snapshot.isAccelTaken, &frame);
 
-    if (result == LE_OK)
+    if (result != LE_OK)
     {
-        char sample[256];
-
-        int len = snprintf(sample, sizeof(sample), "{\"x\":%lf, \"y\":%lf, \"z\":%lf}", x, y, z);
-        if (len >= sizeof(sample))
-        {
-            LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(sample));
-        }
+        // The accelerometer may still be readable on its own.
+        frame.timestamp = Now();
+        result = imu_ReadAccel(&frame.accel[0], &frame.accel[1], &frame.accel[2]);
+    }
 
-        psensor_PushJson(ref, 0 /* now */, sample);
+    if (result == LE_OK)
+    {
+        PushVector(ref, ACCEL_PACKED_PATH, frame.timestamp, frame.accel);
     }
     else
     {
@@ -259,7 +567,7 @@ static void SampleTemp
 
     if (result == LE_OK)
     {
-        psensor_PushNumeric(ref, 0 /* now */, sample);
+        psensor_PushNumeric(ref, Now(), sample);
     }
     else
     {
@@ -275,6 +583,18 @@ static void SampleTemp
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
+    // Open the driver's sysfs files once, rather than on every sample.
+    OpenVectorChannel(&AccelChannel, "accel");
+    OpenVectorChannel(&GyroChannel, "anglvel");
+    TempChannel.scaleAttr = file_OpenAttr("/driver/in_temp_scale");
+    TempChannel.offsetAttr = file_OpenAttr("/driver/in_temp_offset");
+    TempChannel.rawAttr = file_OpenAttr("/driver/in_temp_raw");
+
+    // The scales and offsets only change when the driver is reconfigured, so cache them.
+    LoadCalibration();
+
+    imuStream_Init();
+
     // Use the Periodic Sensor component from the Data Hub to implement the sensor interfaces.
     psensor_Create(IMU_PREFIX_NAME "gyro", IO_DATA_TYPE_JSON, "", SampleGyro, NULL);
     psensor_Create(IMU_PREFIX_NAME "accel", IO_DATA_TYPE_JSON, "", SampleAccel, NULL);
@@ -282,4 +602,9 @@ COMPONENT_INIT
 
     dhub_SetJsonExample(IMU_PREFIX_NAME "gyro/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
     dhub_SetJsonExample(IMU_PREFIX_NAME "accel/value", "{\"x\":0.1,\"y\":0.2,\"z\":0.3}");
+
+    // Also publish the gyro and accelerometer readings in packed binary form, so local consumers
+    // don't have to convert them to and from text.
+    LE_ASSERT_OK(dhub_CreateInput(GYRO_PACKED_PATH, DHUB_DATA_TYPE_STRING, "rad/s"));
+    LE_ASSERT_OK(dhub_CreateInput(ACCEL_PACKED_PATH, DHUB_DATA_TYPE_STRING, "m/s2"));
 }
@@ -0,0 +1,998 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuStream.c
+ *
+ * Implementation of high-rate streaming acquisition from the IMU using the IIO buffer of the
+ * IMU's driver.  See imuStream.h.
+ *
+ * To let the application processor sleep between bursts, the IIO buffer's watermark is set so
+ * that the device only becomes readable once about WAKE_PERIOD seconds of scans have piled up,
+ * and then the whole buffer is drained in one go.  If the driver can use the BMI160's on-chip FIFO
+ * (which it does when the buffer is enabled without a trigger), the watermark is programmed into
+ * the chip, and the CPU isn't even interrupted for each sample.  Otherwise, the chip's data-ready
+ * trigger clocks each scan into the kernel buffer, and only the wake-ups of this process are
+ * batched.  Drivers that drain the chip's FIFO without timestamping each scan give consecutive
+ * scans the same timestamp; those are spaced out again using the output data rate (ODR).
+ *
+ * If reading the device fails, streaming is stopped and started again every RESTART_DELAY_MS
+ * until it works, as long as there are block handlers.  The handlers stay registered meanwhile,
+ * and just don't get any frames.
+ *
+ * The sampling rate can be set in the app's config tree, and is applied as soon as it's changed
+ * there, e.g., to stream at full rate from a device under investigation for a while:
+ *
+ * @verbatim
+    imuStream/
+        sampleRate      float   sampling rate of the accelerometer and gyroscope (Hz, default 200)
+   @endverbatim
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "imuStream.h"
+#include "fileUtils.h"
+#include "sampleClock.h"
+
+/// Directory where the driver's sysfs files are bound into the sandbox.
+#define DRIVER_DIR          "/driver/"
+#define SCAN_ELEMENTS_DIR   DRIVER_DIR "scan_elements/"
+#define BUFFER_DIR          DRIVER_DIR "buffer/"
+
+/// IIO character device that the scan frames are read from.
+#define DEVICE_NODE         "/dev/iio:device0"
+
+/// IIO trigger that clocks the scans (the IMU's own data-ready trigger).
+#define TRIGGER_NAME        "bmi160-dev0"
+
+/// Number of scans the kernel buffers between reads.
+#define KERNEL_BUFFER_LENGTH 512
+
+/// Target time between wake-ups to drain the buffer (seconds).  The buffer's watermark is set to
+/// this many seconds' worth of scans, up to half of KERNEL_BUFFER_LENGTH.
+#define WAKE_PERIOD 0.5
+
+/// Sampling rate used unless set in the config tree or by imuStream_SetSampleRate().
+#define DEFAULT_SAMPLE_RATE_HZ 200.0
+
+/// Path of the streaming settings in the config tree, and of the sampling rate (Hz) in it.
+#define STREAM_CONFIG_PATH  "imuStream"
+#define SAMPLE_RATE_NODE    "sampleRate"
+
+/// Largest scan frame that is supported (bytes).
+#define MAX_FRAME_BYTES     64
+
+/// Time to wait before restarting the stream after it failed (ms).
+#define RESTART_DELAY_MS    5000
+
+/// Number of block handlers to allocate space for up front.
+#define HANDLER_POOL_SIZE   4
+
+/// Scan elements that the stream enables, in the order their readings are stored in a frame.
+typedef enum
+{
+    CHANNEL_ACCEL_X,
+    CHANNEL_ACCEL_Y,
+    CHANNEL_ACCEL_Z,
+    CHANNEL_GYRO_X,
+    CHANNEL_GYRO_Y,
+    CHANNEL_GYRO_Z,
+    CHANNEL_TIMESTAMP,
+    CHANNEL_COUNT
+}
+Channel_t;
+
+/// IIO names of the above scan elements.
+static const char* const ChannelNames[CHANNEL_COUNT] =
+{
+    "accel_x", "accel_y", "accel_z", "anglvel_x", "anglvel_y", "anglvel_z", "timestamp"
+};
+
+/// Location and format of one scan element within a scan frame.
+typedef struct
+{
+    int index;              ///< Position of the element in the scan (from the _index file).
+    bool isBigEndian;
+    bool isSigned;
+    unsigned int bits;      ///< Number of significant bits.
+    unsigned int storageBytes;
+    unsigned int shift;     ///< Right shift needed to line up the significant bits.
+    size_t offset;          ///< Offset of the element from the start of the frame (bytes).
+}
+ScanElement_t;
+
+/// Registered block handler.
+typedef struct imuStream_Handler
+{
+    le_dls_Link_t link;
+    imuStream_BlockHandlerFunc_t handlerPtr;
+    void* contextPtr;
+}
+Handler_t;
+
+static le_mem_PoolRef_t HandlerPool;
+static le_dls_List_t HandlerList = LE_DLS_LIST_INIT;
+
+static ScanElement_t ScanElements[CHANNEL_COUNT];
+static size_t FrameBytes;
+
+/// Driver scales, read when streaming starts and re-read by imuStream_RefreshCalibration().
+static double AccelScale;
+static double GyroScale;
+
+static double SampleRateHz = DEFAULT_SAMPLE_RATE_HZ;
+
+/// Output data rate that the driver actually set (Hz; it may round the requested rate).
+static double OdrHz = DEFAULT_SAMPLE_RATE_HZ;
+
+/// true if the scans come from the chip's FIFO, false if they're clocked in by the trigger.
+static bool IsHwFifo = false;
+
+/// true if the driver timestamps the scans with the monotonic clock, false if the wall clock.
+static bool IsMonotonicClock = false;
+
+/// Timestamp of the last frame delivered (seconds since the Epoch, 0 = none since streaming
+/// started).
+static double LastTimestamp = 0.0;
+
+/// Number of scans the buffer's watermark is set to.  See ApplyWatermark().
+static int Watermark = 1;
+
+static int DeviceFd = -1;
+static le_fdMonitor_Ref_t DeviceMonitor;
+
+/// Timer used to restart the stream after it failed.
+static le_timer_Ref_t RestartTimer;
+
+static bool HaveLatestFrame = false;
+static imuStream_Frame_t LatestFrame;
+
+/// Buffers for one block of frames, raw and decoded.
+static uint8_t ReadBuffer[IMU_STREAM_MAX_BLOCK_FRAMES * MAX_FRAME_BYTES];
+static imuStream_Frame_t Block[IMU_STREAM_MAX_BLOCK_FRAMES];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the contents of a scan element's _type file (e.g., "le:s16/16>>0").
+ *
+ * @return LE_OK if successful, LE_FORMAT_ERROR if the format isn't supported.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseScanType
+(
+    const char* text,
+    ScanElement_t* elementPtr
+)
+{
+    char endian[3];
+    char sign;
+    unsigned int storageBits;
+
+    if (   (strchr(text, 'X') != NULL)  // Repeated elements aren't supported.
+        || (sscanf(text, "%2[a-z]:%c%u/%u>>%u",
+                   endian, &sign, &elementPtr->bits, &storageBits, &elementPtr->shift) != 5) )
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    if (   ((storageBits != 8) && (storageBits != 16) && (storageBits != 32) && (storageBits != 64))
+        || (elementPtr->bits == 0)
+        || ((elementPtr->bits + elementPtr->shift) > storageBits) )
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    elementPtr->isBigEndian = (strcmp(endian, "be") == 0);
+    elementPtr->isSigned = (sign == 's');
+    elementPtr->storageBytes = storageBits / 8;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Enable a scan element and read its position and format.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ConfigureScanElement
+(
+    Channel_t channel
+)
+{
+    char path[96];
+    char text[32];
+    le_result_t r;
+
+    snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_en", ChannelNames[channel]);
+    r = file_WriteInt(path, 1);
+    if (r != LE_OK)
+    {
+        goto done;
+    }
+
+    snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_index", ChannelNames[channel]);
+    r = file_ReadInt(path, &ScanElements[channel].index);
+    if (r != LE_OK)
+    {
+        goto done;
+    }
+
+    snprintf(path, sizeof(path), SCAN_ELEMENTS_DIR "in_%s_type", ChannelNames[channel]);
+    r = file_ReadStr(path, text, sizeof(text));
+    if (r != LE_OK)
+    {
+        goto done;
+    }
+
+    r = ParseScanType(text, &ScanElements[channel]);
+    if (r != LE_OK)
+    {
+        LE_ERROR("Unsupported scan element type '%s' for '%s'.", text, ChannelNames[channel]);
+    }
+
+done:
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Work out where each scan element lives in a frame.  IIO stores the enabled elements in index
+ * order, each aligned to its own storage size, and pads the frame to the largest storage size.
+ *
+ * @return LE_OK if successful, LE_OVERFLOW if the frame would be too large.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ComputeFrameLayout
+(
+    void
+)
+{
+    bool isPlaced[CHANNEL_COUNT] = { false };
+    size_t offset = 0;
+    size_t largestStorage = 1;
+
+    for (int placed = 0; placed < CHANNEL_COUNT; placed++)
+    {
+        // Find the unplaced element with the lowest index.
+        int next = -1;
+        for (int i = 0; i < CHANNEL_COUNT; i++)
+        {
+            if (!isPlaced[i] && ((next < 0) || (ScanElements[i].index < ScanElements[next].index)))
+            {
+                next = i;
+            }
+        }
+
+        ScanElement_t* elementPtr = &ScanElements[next];
+        size_t align = elementPtr->storageBytes;
+
+        offset = ((offset + align - 1) / align) * align;
+        elementPtr->offset = offset;
+        offset += align;
+
+        if (align > largestStorage)
+        {
+            largestStorage = align;
+        }
+
+        isPlaced[next] = true;
+    }
+
+    FrameBytes = ((offset + largestStorage - 1) / largestStorage) * largestStorage;
+
+    if (FrameBytes > MAX_FRAME_BYTES)
+    {
+        LE_ERROR("Scan frame of %zu bytes is too large.", FrameBytes);
+        return LE_OVERFLOW;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Extract one scan element's reading from a frame.
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t ExtractElement
+(
+    const uint8_t* framePtr,
+    Channel_t channel
+)
+{
+    const ScanElement_t* elementPtr = &ScanElements[channel];
+    const uint8_t* bytesPtr = framePtr + elementPtr->offset;
+    uint64_t value = 0;
+
+    for (unsigned int i = 0; i < elementPtr->storageBytes; i++)
+    {
+        unsigned int byteIndex = elementPtr->isBigEndian ? i : (elementPtr->storageBytes - 1 - i);
+
+        value = (value << 8) | bytesPtr[byteIndex];
+    }
+
+    value >>= elementPtr->shift;
+
+    if (elementPtr->bits < 64)
+    {
+        uint64_t mask = (((uint64_t)1) << elementPtr->bits) - 1;
+
+        value &= mask;
+
+        if (elementPtr->isSigned && (value & (((uint64_t)1) << (elementPtr->bits - 1))))
+        {
+            value |= ~mask;
+        }
+    }
+
+    return (int64_t)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a scan frame.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DecodeFrame
+(
+    const uint8_t* framePtr,
+    imuStream_Frame_t* samplePtr
+)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        samplePtr->accel[axis] = ExtractElement(framePtr, CHANNEL_ACCEL_X + axis) * AccelScale;
+        samplePtr->gyro[axis] = ExtractElement(framePtr, CHANNEL_GYRO_X + axis) * GyroScale;
+    }
+
+    // The IIO timestamp is in nanoseconds, on the monotonic clock if the driver supports it.
+    int64_t stamp = ExtractElement(framePtr, CHANNEL_TIMESTAMP);
+
+    samplePtr->timestamp = IsMonotonicClock
+                         ? sampleClock_ToTimestamp(sampleClock_FromMonotonicNs(stamp))
+                         : (((double)stamp) / 1000000000.0);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make sure the timestamps of a block of frames go up.  Frames with a timestamp no later than the
+ * frame before are retimed one ODR period after it, e.g., frames drained from the chip's FIFO that
+ * the driver stamped with the time of the drain.
+ *
+ * If the block's last frame has a good timestamp, the earlier ones are back-computed from it
+ * instead.  If none have, the block is anchored to the current time.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RetimeBlock
+(
+    imuStream_Frame_t* framesPtr,
+    size_t frameCount
+)
+{
+    const double period = 1.0 / OdrHz;
+    double previous = LastTimestamp;
+    bool isMonotonic = true;
+
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        if (framesPtr[i].timestamp <= previous)
+        {
+            isMonotonic = false;
+        }
+        previous = framesPtr[i].timestamp;
+    }
+
+    if (isMonotonic)
+    {
+        return;
+    }
+
+    // Back-compute from the newest timestamp in the block, or from now if it's no good either.
+    double last = framesPtr[frameCount - 1].timestamp;
+
+    if (last <= LastTimestamp)
+    {
+        last = sampleClock_Now();
+    }
+
+    double first = last - ((frameCount - 1) * period);
+
+    // Never step back before the previous block.
+    if ((LastTimestamp > 0.0) && (first <= LastTimestamp))
+    {
+        first = LastTimestamp + period;
+    }
+
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        framesPtr[i].timestamp = first + (i * period);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pass a block of frames to all the registered handlers.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverBlock
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount
+)
+{
+    le_dls_Link_t* linkPtr = le_dls_Peek(&HandlerList);
+
+    while (linkPtr != NULL)
+    {
+        Handler_t* handlerPtr = CONTAINER_OF(linkPtr, Handler_t, link);
+
+        // Move on first, in case the handler removes itself.
+        linkPtr = le_dls_PeekNext(&HandlerList, linkPtr);
+
+        handlerPtr->handlerPtr(framesPtr, frameCount, handlerPtr->contextPtr);
+    }
+}
+
+
+static void HandleStreamError(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read all available scan frames from the IIO device and deliver them in blocks.
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeviceEventHandler
+(
+    int fd,
+    short events
+)
+{
+    if (events & POLLIN)
+    {
+        const size_t readSize = (sizeof(ReadBuffer) / FrameBytes) * FrameBytes;
+
+        for (;;)
+        {
+            ssize_t len = read(fd, ReadBuffer, readSize);
+
+            if (len < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                {
+                    LE_ERROR("Failed to read from '%s' - %m", DEVICE_NODE);
+                    HandleStreamError();
+                }
+                return;
+            }
+
+            size_t frameCount = ((size_t)len) / FrameBytes;
+
+            for (size_t i = 0; i < frameCount; i++)
+            {
+                DecodeFrame(ReadBuffer + (i * FrameBytes), &Block[i]);
+            }
+
+            if (frameCount > 0)
+            {
+                RetimeBlock(Block, frameCount);
+
+                LastTimestamp = Block[frameCount - 1].timestamp;
+                LatestFrame = Block[frameCount - 1];
+                HaveLatestFrame = true;
+
+                DeliverBlock(Block, frameCount);
+            }
+
+            if (((size_t)len) < readSize)
+            {
+                return;
+            }
+        }
+    }
+    else if (events & (POLLERR | POLLHUP))
+    {
+        LE_ERROR("Error on '%s' (events 0x%x).", DEVICE_NODE, events);
+        HandleStreamError();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the sampling rate on the driver.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ApplySampleRate
+(
+    void
+)
+{
+    char text[32];
+    le_result_t r;
+
+    snprintf(text, sizeof(text), "%lf", SampleRateHz);
+
+    r = file_WriteStr(DRIVER_DIR "in_accel_sampling_frequency", text);
+    if (r == LE_OK)
+    {
+        r = file_WriteStr(DRIVER_DIR "in_anglvel_sampling_frequency", text);
+    }
+
+    // Read back the rate the driver picked, for retiming FIFO scans.
+    if (   (file_ReadDouble(DRIVER_DIR "in_accel_sampling_frequency", &OdrHz) != LE_OK)
+        || !(OdrHz > 0.0) )
+    {
+        OdrHz = SampleRateHz;
+    }
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the buffer's watermark to WAKE_PERIOD seconds' worth of scans at the current output data
+ * rate, up to half of KERNEL_BUFFER_LENGTH.  The buffer must be disabled.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ApplyWatermark
+(
+    void
+)
+{
+    Watermark = (int)(OdrHz * WAKE_PERIOD);
+
+    if (Watermark > (KERNEL_BUFFER_LENGTH / 2))
+    {
+        Watermark = KERNEL_BUFFER_LENGTH / 2;
+    }
+    else if (Watermark < 1)
+    {
+        Watermark = 1;
+    }
+
+    // Older kernels don't have a watermark, and wake up for every scan.
+    if (file_WriteInt(BUFFER_DIR "watermark", Watermark) != LE_OK)
+    {
+        LE_WARN("Couldn't set IIO buffer watermark.  Waking up for every IMU sample.");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the accelerometer and gyroscope scales from the driver.  The cached scales are only
+ * replaced if both can be read.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadScales
+(
+    void
+)
+{
+    double accelScale;
+    double gyroScale;
+
+    le_result_t r = file_ReadDouble(DRIVER_DIR "in_accel_scale", &accelScale);
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    r = file_ReadDouble(DRIVER_DIR "in_anglvel_scale", &gyroScale);
+    if (r != LE_OK)
+    {
+        return r;
+    }
+
+    AccelScale = accelScale;
+    GyroScale = gyroScale;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Turn off the driver's buffer and stop reading from the device.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StopStreaming
+(
+    void
+)
+{
+    if (DeviceMonitor != NULL)
+    {
+        le_fdMonitor_Delete(DeviceMonitor);
+        DeviceMonitor = NULL;
+    }
+
+    if (DeviceFd >= 0)
+    {
+        close(DeviceFd);
+        DeviceFd = -1;
+    }
+
+    (void)file_WriteInt(BUFFER_DIR "enable", 0);
+
+    HaveLatestFrame = false;
+    LastTimestamp = 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Configure the scan elements, trigger and buffer of the driver, enable the buffer, and start
+ * reading frames from the device.
+ *
+ * @return LE_OK if successful.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartStreaming
+(
+    void
+)
+{
+    le_result_t r;
+
+    // The buffer must be disabled while it's being configured.
+    (void)file_WriteInt(BUFFER_DIR "enable", 0);
+
+    for (Channel_t channel = 0; channel < CHANNEL_COUNT; channel++)
+    {
+        r = ConfigureScanElement(channel);
+        if (r != LE_OK)
+        {
+            goto fail;
+        }
+    }
+
+    r = ComputeFrameLayout();
+    if (r != LE_OK)
+    {
+        goto fail;
+    }
+
+    r = ReadScales();
+    if (r != LE_OK)
+    {
+        goto fail;
+    }
+
+    if (ApplySampleRate() != LE_OK)
+    {
+        LE_WARN("Driver rejected sampling rate of %lf Hz.", SampleRateHz);
+    }
+
+    // Ask for monotonic timestamps, which are converted to sample clock time (see sampleClock.h),
+    // so a wall clock change can't reorder the frames.  Older drivers only support wall-clock
+    // timestamps, and don't have this file.
+    IsMonotonicClock = (file_WriteStr(DRIVER_DIR "current_timestamp_clock", "monotonic") == LE_OK);
+
+    r = file_WriteInt(BUFFER_DIR "length", KERNEL_BUFFER_LENGTH);
+    if (r != LE_OK)
+    {
+        goto fail;
+    }
+
+    ApplyWatermark();
+
+    // Try the chip's FIFO first, which the driver uses if there's no trigger.  Drivers without
+    // FIFO support refuse to enable the buffer, and need the data-ready trigger.
+    (void)file_WriteStr(DRIVER_DIR "trigger/current_trigger", "\n");
+
+    IsHwFifo = (file_WriteInt(BUFFER_DIR "enable", 1) == LE_OK);
+
+    if (!IsHwFifo)
+    {
+        r = file_WriteStr(DRIVER_DIR "trigger/current_trigger", TRIGGER_NAME);
+        if (r != LE_OK)
+        {
+            goto fail;
+        }
+
+        r = file_WriteInt(BUFFER_DIR "enable", 1);
+        if (r != LE_OK)
+        {
+            goto fail;
+        }
+    }
+
+    DeviceFd = open(DEVICE_NODE, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (DeviceFd < 0)
+    {
+        LE_ERROR("Couldn't open '%s' - %m", DEVICE_NODE);
+        r = LE_IO_ERROR;
+        goto fail;
+    }
+
+    DeviceMonitor = le_fdMonitor_Create("imuStream", DeviceFd, DeviceEventHandler, POLLIN);
+
+    LE_INFO("IMU streaming at %lf Hz (%zu byte frames) from its %s, in bursts of %d.",
+            OdrHz,
+            FrameBytes,
+            IsHwFifo ? "FIFO" : "data-ready trigger",
+            Watermark);
+
+    return LE_OK;
+
+fail:
+    LE_ERROR("Failed to start IMU streaming (%s).", LE_RESULT_TXT(r));
+    StopStreaming();
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Timer handler called to restart the stream after it failed.  Tries again later if it fails
+ * again.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RestartTimerExpired
+(
+    le_timer_Ref_t timerRef
+)
+{
+    if (le_dls_IsEmpty(&HandlerList))
+    {
+        return;
+    }
+
+    LE_INFO("Restarting IMU streaming.");
+
+    if (StartStreaming() != LE_OK)
+    {
+        le_timer_Start(RestartTimer);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop a stream that failed (which removes its device handler), and restart it after
+ * RESTART_DELAY_MS.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleStreamError
+(
+    void
+)
+{
+    StopStreaming();
+
+    LE_WARN("IMU streaming stopped.  Restarting it in %d ms.", RESTART_DELAY_MS);
+
+    le_timer_Start(RestartTimer);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a function to be called with each block of streamed samples.  The first registration
+ * starts streaming.
+ *
+ * @return Reference to the handler, or NULL if streaming could not be started.
+ */
+//--------------------------------------------------------------------------------------------------
+imuStream_HandlerRef_t imuStream_AddBlockHandler
+(
+    imuStream_BlockHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    if (le_dls_IsEmpty(&HandlerList) && (StartStreaming() != LE_OK))
+    {
+        return NULL;
+    }
+
+    Handler_t* newHandlerPtr = le_mem_ForceAlloc(HandlerPool);
+
+    newHandlerPtr->link = LE_DLS_LINK_INIT;
+    newHandlerPtr->handlerPtr = handlerPtr;
+    newHandlerPtr->contextPtr = contextPtr;
+
+    le_dls_Queue(&HandlerList, &newHandlerPtr->link);
+
+    return newHandlerPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a block handler.  Removing the last one stops streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_RemoveBlockHandler
+(
+    imuStream_HandlerRef_t handlerRef
+)
+{
+    le_dls_Remove(&HandlerList, &handlerRef->link);
+    le_mem_Release(handlerRef);
+
+    if (le_dls_IsEmpty(&HandlerList))
+    {
+        le_timer_Stop(RestartTimer);
+        StopStreaming();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the sampling rate of the accelerometer and gyroscope used while streaming.  Takes effect
+ * immediately if already streaming, along with a burst size to suit the new rate.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_IO_ERROR if the driver rejected the rate.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imuStream_SetSampleRate
+(
+    double sampleRateHz
+)
+{
+    SampleRateHz = sampleRateHz;
+
+    if (DeviceFd < 0)
+    {
+        return LE_OK;
+    }
+
+    // The watermark is a number of scans, so it has to follow the rate to keep the wake-ups
+    // WAKE_PERIOD apart, and the driver only lets it be changed while the buffer is disabled.
+    (void)file_WriteInt(BUFFER_DIR "enable", 0);
+
+    le_result_t r = ApplySampleRate();
+
+    ApplyWatermark();
+
+    if (file_WriteInt(BUFFER_DIR "enable", 1) != LE_OK)
+    {
+        LE_ERROR("Failed to re-enable the IIO buffer after changing the sampling rate.");
+        HandleStreamError();
+        return LE_IO_ERROR;
+    }
+
+    LE_INFO("IMU streaming at %lf Hz, in bursts of %d.", OdrHz, Watermark);
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Re-read the accelerometer and gyroscope scales from the driver.  Must be called whenever the
+ * range of the accelerometer or gyroscope is reconfigured, so that the streamed samples are
+ * converted with the new scales.  Does nothing if not streaming, as the scales are read when
+ * streaming starts.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_IO_ERROR if a scale file could not be read, or LE_FORMAT_ERROR if it held no number
+ *    (the old scales are kept).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imuStream_RefreshCalibration
+(
+    void
+)
+{
+    if (DeviceFd < 0)
+    {
+        return LE_OK;
+    }
+
+    le_result_t r = ReadScales();
+
+    LE_DEBUG("Stream calibration: accel scale %lf, gyro scale %lf (%s).",
+             AccelScale, GyroScale, LE_RESULT_TXT(r));
+
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the most recently streamed sample.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_UNAVAILABLE if not streaming, or no sample has been received yet.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t imuStream_GetLatest
+(
+    imuStream_Frame_t* framePtr
+)
+{
+    if (!HaveLatestFrame)
+    {
+        return LE_UNAVAILABLE;
+    }
+
+    *framePtr = LatestFrame;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Apply the sampling rate set in the config tree, if any.  Called at start-up and whenever the
+ * streaming settings change.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadSampleRate
+(
+    void* contextPtr
+)
+{
+    le_cfg_IteratorRef_t iteratorRef = le_cfg_CreateReadTxn(STREAM_CONFIG_PATH);
+    double sampleRateHz = le_cfg_GetFloat(iteratorRef, SAMPLE_RATE_NODE, DEFAULT_SAMPLE_RATE_HZ);
+    le_cfg_CancelTxn(iteratorRef);
+
+    if (sampleRateHz <= 0.0)
+    {
+        LE_ERROR("Invalid IMU sampling rate %lf Hz in the config tree.  Ignoring it.",
+                 sampleRateHz);
+        return;
+    }
+
+    if (sampleRateHz == SampleRateHz)
+    {
+        return;
+    }
+
+    le_result_t r = imuStream_SetSampleRate(sampleRateHz);
+    if (r != LE_OK)
+    {
+        LE_WARN("Driver rejected sampling rate of %lf Hz (%s).", sampleRateHz, LE_RESULT_TXT(r));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the streaming module.  Called by the IMU component's COMPONENT_INIT.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_Init
+(
+    void
+)
+{
+    HandlerPool = le_mem_CreatePool("imuStreamHandler", sizeof(Handler_t));
+    le_mem_ExpandPool(HandlerPool, HANDLER_POOL_SIZE);
+
+    RestartTimer = le_timer_Create("imuStreamRestart");
+    le_timer_SetHandler(RestartTimer, RestartTimerExpired);
+    le_timer_SetMsInterval(RestartTimer, RESTART_DELAY_MS);
+
+    LoadSampleRate(NULL);
+    le_cfg_AddChangeHandler(STREAM_CONFIG_PATH, LoadSampleRate, NULL);
+}
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file imuStream.h
+ *
+ * High-rate streaming acquisition from the Inertial Measurement Unit (IMU).
+ *
+ * Instead of polling the driver's sysfs files one sample at a time, the streaming mode enables
+ * the IIO buffer of the IMU's driver (scan elements plus a trigger) and reads packed binary scan
+ * frames from the IIO character device in bulk.  Each frame is timestamped using the IIO
+ * timestamp channel, and the frames are delivered to local consumers in blocks.
+ *
+ * The frames are read in bursts, about every half second, so the application processor can sleep
+ * in between (using the IMU's on-chip FIFO, if the driver supports it).  So the newest frame
+ * delivered can be up to that old.
+ *
+ * Streaming starts when the first block handler is added and stops when the last one is removed.
+ * If the device fails while streaming, the stream is restarted after a few seconds.
+ * While streaming, the driver won't allow its sysfs raw readings to be read, so imu_ReadAccel()
+ * and imu_ReadGyro() report the most recent streamed frame instead.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef IMU_STREAM_H_INCLUDE_GUARD
+#define IMU_STREAM_H_INCLUDE_GUARD
+
+/// Maximum number of frames delivered to a block handler in one call.
+#define IMU_STREAM_MAX_BLOCK_FRAMES 64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * One streamed IMU sample.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    double timestamp;   ///< When the sample was taken (seconds since the Epoch).
+    double accel[3];    ///< x, y and z linear acceleration (m/s2).
+    double gyro[3];     ///< x, y and z angular velocity (rad/s).
+}
+imuStream_Frame_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function that receives a block of streamed IMU samples, oldest first.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*imuStream_BlockHandlerFunc_t)
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount,
+    void* contextPtr
+);
+
+/// Reference to a block handler registered using imuStream_AddBlockHandler().
+typedef struct imuStream_Handler* imuStream_HandlerRef_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a function to be called with each block of streamed samples.  The first registration
+ * starts streaming.
+ *
+ * @note Handlers must not remove other handlers from inside the block handler callback.
+ *
+ * @return Reference to the handler, or NULL if streaming could not be started.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED imuStream_HandlerRef_t imuStream_AddBlockHandler
+(
+    imuStream_BlockHandlerFunc_t handlerPtr,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a block handler.  Removing the last one stops streaming.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void imuStream_RemoveBlockHandler
+(
+    imuStream_HandlerRef_t handlerRef
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the sampling rate of the accelerometer and gyroscope used while streaming.  Takes effect
+ * immediately if already streaming, along with a burst size to suit the new rate.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_IO_ERROR if the driver rejected the rate.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t imuStream_SetSampleRate
+(
+    double sampleRateHz
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Re-read the accelerometer and gyroscope scales from the driver.  Must be called whenever the
+ * range of the accelerometer or gyroscope is reconfigured, so that the streamed samples are
+ * converted with the new scales.  Does nothing if not streaming, as the scales are read when
+ * streaming starts.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_IO_ERROR if a scale file could not be read, or LE_FORMAT_ERROR if it held no number
+ *    (the old scales are kept).
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t imuStream_RefreshCalibration
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the most recently streamed sample.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_UNAVAILABLE if not streaming, or no sample has been received yet.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t imuStream_GetLatest
+(
+    imuStream_Frame_t* framePtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the streaming module.  Called by the IMU component's COMPONENT_INIT.
+ */
+//--------------------------------------------------------------------------------------------------
+void imuStream_Init
+(
+    void
+);
+
+#endif // IMU_STREAM_H_INCLUDE_GUARD
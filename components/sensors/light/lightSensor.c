@@ -2,7 +2,15 @@
 /**
  * Implementation of the mangOH Red light sensor interface.
  *
- * Provides the accelerometer and gyro IPC API services and plugs into the Legato Data Hub.
+ * Provides the light sensor IPC API service and plugs into the Legato Data Hub.
+ *
+ * The light sensor's ADC readings are noisy, so each reading is the trimmed mean of several
+ * ADC samples taken back to back: the samples are sorted, the lowest and highest few are
+ * dropped, and the rest are averaged.  That keeps single-sample spikes from tripping the sensor's
+ * change-by filter and causing needless pushes.  The number of samples and the number dropped
+ * from each end default to LIGHT_OVERSAMPLE_COUNT and LIGHT_TRIM_COUNT, and can be changed at
+ * run-time by pushing numbers to the Data Hub Outputs "light/oversample" and "light/trim"
+ * (e.g., 1 sample for raw readings, or a trim of (oversample - 1) / 2 for the median).
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -11,6 +19,7 @@
 #include "legato.h"
 #include "interfaces.h"
 #include "periodicSensor.h"
+#include "sampleClock.h"
 #include "lightSensor.h"
 
 #ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
@@ -21,6 +30,25 @@
 
 const char lightSensorAdc[] = "EXT_ADC3";
 
+/// Default number of ADC samples taken per reading.
+#define LIGHT_OVERSAMPLE_COUNT 8
+
+/// Default number of the lowest and of the highest ADC samples dropped from each reading.
+#define LIGHT_TRIM_COUNT 2
+
+/// Largest number of ADC samples that can be taken per reading.
+#define LIGHT_MAX_OVERSAMPLE_COUNT 32
+
+/// Data Hub Outputs that the oversampling settings are received from.
+#define LIGHT_OVERSAMPLE_PATH   LIGHT_PREFIX_NAME "light/oversample"
+#define LIGHT_TRIM_PATH         LIGHT_PREFIX_NAME "light/trim"
+
+/// Number of ADC samples taken per reading.
+static size_t OversampleCount = LIGHT_OVERSAMPLE_COUNT;
+
+/// Number of the lowest and of the highest ADC samples dropped from each reading.
+static size_t TrimCount = LIGHT_TRIM_COUNT;
+
 
 static void Sample
 (
@@ -34,7 +62,7 @@ static void Sample
 
     if (result == LE_OK)
     {
-        psensor_PushNumeric(ref, 0 /* now */, (double)sample);
+        psensor_PushNumeric(ref, sampleClock_Now(), (double)sample);
     }
     else
     {
@@ -43,15 +71,72 @@ static void Sample
 }
 
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a new number of ADC samples per reading pushed to the oversample Output.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleOversamplePush
+(
+    double timestamp,
+    double value,
+    void* contextPtr
+)
+{
+    if (!(value >= 1.0) || (value > LIGHT_MAX_OVERSAMPLE_COUNT))
+    {
+        LE_ERROR("Invalid light oversample count %lf (1 to %d).", value,
+                 LIGHT_MAX_OVERSAMPLE_COUNT);
+        return;
+    }
+
+    OversampleCount = (size_t)value;
+
+    LE_INFO("Taking %zu ADC samples per light reading.", OversampleCount);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a new number of ADC samples to drop from each end pushed to the trim Output.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleTrimPush
+(
+    double timestamp,
+    double value,
+    void* contextPtr
+)
+{
+    if (!(value >= 0.0) || (value >= LIGHT_MAX_OVERSAMPLE_COUNT))
+    {
+        LE_ERROR("Invalid light trim count %lf.", value);
+        return;
+    }
+
+    TrimCount = (size_t)value;
+
+    LE_INFO("Dropping the %zu lowest and highest ADC samples of each light reading.", TrimCount);
+}
+
+
 COMPONENT_INIT
 {
     psensor_Create(LIGHT_PREFIX_NAME "light", IO_DATA_TYPE_NUMERIC, "", Sample, NULL);
+
+    LE_ASSERT_OK(dhub_CreateOutput(LIGHT_OVERSAMPLE_PATH, DHUB_DATA_TYPE_NUMERIC, ""));
+    dhub_SetNumericDefault(LIGHT_OVERSAMPLE_PATH, LIGHT_OVERSAMPLE_COUNT);
+    dhub_AddNumericPushHandler(LIGHT_OVERSAMPLE_PATH, HandleOversamplePush, NULL);
+
+    LE_ASSERT_OK(dhub_CreateOutput(LIGHT_TRIM_PATH, DHUB_DATA_TYPE_NUMERIC, ""));
+    dhub_SetNumericDefault(LIGHT_TRIM_PATH, LIGHT_TRIM_COUNT);
+    dhub_AddNumericPushHandler(LIGHT_TRIM_PATH, HandleTrimPush, NULL);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Read the light intensity measurement.
+ * Read the light intensity measurement: the trimmed mean of OversampleCount ADC samples.
  *
  * @return LE_OK if successful.
  */
@@ -62,5 +147,38 @@ le_result_t light_Read
         ///< [OUT] Where the light intensity reading will be put if LE_OK is returned.
 )
 {
-    return le_adc_ReadValue(lightSensorAdc, readingPtr);
+    int32_t samples[LIGHT_MAX_OVERSAMPLE_COUNT];
+    const size_t count = OversampleCount;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        le_result_t result = le_adc_ReadValue(lightSensorAdc, &samples[i]);
+        if (result != LE_OK)
+        {
+            return result;
+        }
+
+        // Insertion sort as the samples come in (there are only a few).
+        for (size_t j = i; (j > 0) && (samples[j - 1] > samples[j]); j--)
+        {
+            int32_t t = samples[j];
+            samples[j] = samples[j - 1];
+            samples[j - 1] = t;
+        }
+    }
+
+    // Always keep at least the middle sample (or the middle two).
+    const size_t trim = (TrimCount <= ((count - 1) / 2)) ? TrimCount : ((count - 1) / 2);
+    int64_t sum = 0;
+
+    for (size_t i = trim; i < (count - trim); i++)
+    {
+        sum += samples[i];
+    }
+
+    // Round to the nearest integer.
+    const int64_t kept = count - (2 * trim);
+    *readingPtr = (int32_t)(((sum >= 0) ? (sum + (kept / 2)) : (sum - (kept / 2))) / kept);
+
+    return LE_OK;
 }
@@ -4,7 +4,8 @@
  *
  * Implementation of the mangOH Red pressure/temperature sensor interface component.
  *
- * Publishes the pressure and temperature readings to the Data Hub.
+ * Publishes the pressure and temperature readings to the Data Hub, and the pressure readings to
+ * the shared memory pressure ring too (see shm.h).
  *
  * Copyright (C) Sierra Wireless Inc.
  */
@@ -14,6 +15,8 @@
 #include "interfaces.h"
 #include "periodicSensor.h"
 #include "fileUtils.h"
+#include "sampleClock.h"
+#include "shm.h"
 
 #ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
 #define PRESSURE_PREFIX_NAME   "/app/redSensor/"
@@ -24,6 +27,10 @@
 static const char PressureFile[] = "/driver/in_pressure_input";
 static const char TemperatureFile[] = "/driver/in_temp_input";
 
+/// The above files, kept open between samples.
+static file_AttrRef_t PressureAttr;
+static file_AttrRef_t TemperatureAttr;
+
 
 static void SamplePressure
 (
@@ -37,7 +44,10 @@ static void SamplePressure
 
     if (result == LE_OK)
     {
-        psensor_PushNumeric(ref, 0 /* now */, sample);
+        double timestamp = sampleClock_Now();
+
+        psensor_PushNumeric(ref, timestamp, sample);
+        shm_PublishPressure(timestamp, sample);
     }
     else
     {
@@ -58,7 +68,7 @@ static void SampleTemperature
 
     if (result == LE_OK)
     {
-        psensor_PushNumeric(ref, 0 /* now */, sample);
+        psensor_PushNumeric(ref, sampleClock_Now(), sample);
     }
     else
     {
@@ -80,7 +90,7 @@ le_result_t pressure_Read
         ///< [OUT] Where the pressure reading (kPa) will be put if LE_OK is returned.
 )
 {
-    return file_ReadDouble(PressureFile, readingPtr);
+    return file_ReadAttrDouble(PressureAttr, readingPtr);
 }
 
 
@@ -98,7 +108,7 @@ le_result_t temperature_Read
 )
 {
     int temp;
-    le_result_t r = file_ReadInt(TemperatureFile, &temp);
+    le_result_t r = file_ReadAttrInt(TemperatureAttr, &temp);
     if (r != LE_OK)
     {
         return r;
@@ -114,6 +124,9 @@ le_result_t temperature_Read
 
 COMPONENT_INIT
 {
+    PressureAttr = file_OpenAttr(PressureFile);
+    TemperatureAttr = file_OpenAttr(TemperatureFile);
+
     // Use the periodic sensor component from the Data Hub to implement the timers and the
     // interface to the Data Hub.
     psensor_Create(PRESSURE_PREFIX_NAME "pressure",
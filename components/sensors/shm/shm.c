@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file shm.c
+ *
+ * Implementation of the mangOH Red sensor shared memory component.
+ *
+ * Keeps rings of IMU frames and air pressure samples in shared memory (see sensorRing.h), and
+ * gives their files to clients of the sensorShm API, which can then read them directly.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "imuStream.h"
+#include "sensorRing.h"
+#include "shm.h"
+
+/// Number of IMU frames kept (about 5 s at the default stream rate).
+#define IMU_RING_RECORDS 1024
+
+/// Number of pressure samples kept.
+#define PRESSURE_RING_RECORDS 64
+
+static sensorRing_ProducerRef_t ImuRing;
+static sensorRing_ProducerRef_t PressureRing;
+
+/// The IMU stream is only started once a client opens the IMU ring.
+static imuStream_HandlerRef_t ImuHandlerRef;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish each block of IMU frames to the IMU ring.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFrames
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        const imuStream_Frame_t* framePtr = &framesPtr[i];
+        sensorRing_ImuRecord_t record = {
+            timestamp: framePtr->timestamp,
+            accel: { framePtr->accel[0], framePtr->accel[1], framePtr->accel[2] },
+            gyro: { framePtr->gyro[0], framePtr->gyro[1], framePtr->gyro[2] }
+        };
+
+        sensorRing_Publish(ImuRing, &record);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish an air pressure sample to the pressure ring.
+ */
+//--------------------------------------------------------------------------------------------------
+void shm_PublishPressure
+(
+    double timestamp,   ///< When the sample was taken (seconds since the Epoch).
+    double pressure     ///< Air pressure (kPa).
+)
+{
+    if (PressureRing != NULL)
+    {
+        sensorRing_PressureRecord_t record = {
+            timestamp: timestamp,
+            pressure: pressure
+        };
+
+        sensorRing_Publish(PressureRing, &record);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a new file descriptor for the pressure ring, so that other components in this process can
+ * read it too (see sensorRing_Attach()).  The caller owns the descriptor.
+ *
+ * @return The file descriptor, or -1 if the ring is unavailable.
+ */
+//--------------------------------------------------------------------------------------------------
+int shm_GetPressureFd
+(
+    void
+)
+{
+    if (PressureRing == NULL)
+    {
+        return -1;
+    }
+
+    return sensorRing_GetFd(PressureRing);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the shared memory file of a sensor stream's ring.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_UNAVAILABLE if the stream couldn't be started
+ *  - LE_FAULT on any other failure.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t sensorShm_Open
+(
+    sensorShm_Stream_t stream,  ///< Stream to read.
+    int* ringFilePtr            ///< [OUT] Ring's file, if LE_OK.
+)
+{
+    sensorRing_ProducerRef_t ringRef;
+
+    switch (stream)
+    {
+        case SENSORSHM_IMU:
+            ringRef = ImuRing;
+            if ((ringRef != NULL) && (ImuHandlerRef == NULL))
+            {
+                ImuHandlerRef = imuStream_AddBlockHandler(HandleFrames, NULL);
+                if (ImuHandlerRef == NULL)
+                {
+                    LE_ERROR("Failed to start the IMU stream.");
+                    return LE_UNAVAILABLE;
+                }
+            }
+            break;
+
+        case SENSORSHM_PRESSURE:
+            ringRef = PressureRing;
+            break;
+
+        default:
+            LE_ERROR("Unknown stream %d.", stream);
+            return LE_FAULT;
+    }
+
+    if (ringRef == NULL)
+    {
+        return LE_FAULT;
+    }
+
+    // The IPC layer closes the descriptor once it's sent, so hand over a duplicate.
+    int fd = sensorRing_GetFd(ringRef);
+    if (fd < 0)
+    {
+        return LE_FAULT;
+    }
+
+    *ringFilePtr = fd;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the sensor shared memory component.  The IMU and sensorRing components'
+ * COMPONENT_INITs run first, as this component depends on them.
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    ImuRing = sensorRing_Create(sizeof(sensorRing_ImuRecord_t), IMU_RING_RECORDS);
+    PressureRing = sensorRing_Create(sizeof(sensorRing_PressureRecord_t), PRESSURE_RING_RECORDS);
+
+    if ((ImuRing == NULL) || (PressureRing == NULL))
+    {
+        LE_ERROR("Failed to create the sensor rings.  Shared memory streams are unavailable.");
+    }
+}
@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file shm.h
+ *
+ * Interface between the sensor shared memory component and the sensor components that feed or
+ * read its rings.  The IMU ring is fed by the shared memory component itself.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SHM_H_INCLUDE_GUARD
+#define SHM_H_INCLUDE_GUARD
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish an air pressure sample to the pressure ring.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void shm_PublishPressure
+(
+    double timestamp,   ///< When the sample was taken (seconds since the Epoch).
+    double pressure     ///< Air pressure (kPa).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a new file descriptor for the pressure ring, so that other components in this process can
+ * read it too (see sensorRing_Attach()).  The caller owns the descriptor.
+ *
+ * @return The file descriptor, or -1 if the ring is unavailable.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED int shm_GetPressureFd
+(
+    void
+);
+
+#endif // SHM_H_INCLUDE_GUARD
@@ -0,0 +1,662 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file trigger.c
+ *
+ * Event trigger engine: captures high-rate IMU data around shock and vibration events, so they
+ * can be uploaded in full while the routine uploads stay at their slow periodic rates.
+ *
+ * Every accelerometer and gyroscope frame streamed by the IMU component (see imuStream.h) is
+ * kept in a ring buffer holding the last RING_FRAMES frames, and checked against a set of trigger
+ * rules.  A rule fires when the magnitude of the acceleration or angular velocity vector goes
+ * above a threshold, or changes faster than a given rate.  When one does, the engine waits until
+ * the rule's post-trigger time has passed, then publishes:
+ *
+ *  - an alarm, to the Data Hub Input "event/<rule>", as a JSON value with the triggering value
+ *    and the times of the captured window, e.g.,
+ *    { "value": 25.1, "start": 1546300798.0, "end": 1546300803.0, "frames": 1000 }
+ *  - every frame from the rule's pre-trigger time before the trigger to its post-trigger time
+ *    after it, packed into compact blocks (see columnCodec.h) of up to COLUMN_CODEC_MAX_SAMPLES
+ *    frames each, to the Inputs "event/accel" and "event/gyro"
+ *  - the air pressure samples taken during the window, read from the shared memory pressure ring
+ *    (see shm.h), packed the same way, to the Input "event/pressure".
+ *
+ * A window of 1000 frames thus takes a handful of Data Hub updates per channel, rather than one
+ * per frame.  Each block is timestamped with its newest sample.  avPublisher pushes the blocks to
+ * AirVantage as they are.  Only one window is captured at a time, and no rule fires again until
+ * HOLDOFF_SECONDS after a window has been published, which bounds the upload cost of a burst of
+ * events.
+ *
+ * The frames are delivered by the IMU component on the main thread's event loop, which is also
+ * where they are published, so the ring buffer needs no locking.
+ *
+ * The default rules are in the BuiltInRules table.  They can be changed, and more rules added,
+ * in the app's config tree:
+ *
+ * @verbatim
+    triggers/
+        <name>/                 e.g., "shock" for the built-in shock rule
+            enable          bool    false to disable a built-in rule (default true)
+            quantity        string  "accel" (m/s2) or "gyro" (rad/s) vector magnitude
+            above           float   fire when the magnitude goes above this (0 = never)
+            rateAbove       float   fire when the magnitude changes faster than this, per second
+                                    (0 = never)
+            preSeconds      float   seconds of frames to capture before the trigger
+            postSeconds     float   seconds of frames to capture after the trigger
+   @endverbatim
+ *
+ * The alarms of extra rules can be pushed to AirVantage by adding "json" sensors to avPublisher
+ * that take their samples from "/app/redSensor/event/<name>".
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "imuStream.h"
+#include "columnCodec.h"
+#include "sensorRing.h"
+#include "shm.h"
+
+#ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
+#define TRIGGER_PREFIX_NAME "/app/redSensor/"
+#else
+#define TRIGGER_PREFIX_NAME ""
+#endif
+
+/// Data Hub Inputs that the captured frames are published to.
+#define EVENT_ACCEL_PATH    TRIGGER_PREFIX_NAME "event/accel"
+#define EVENT_GYRO_PATH     TRIGGER_PREFIX_NAME "event/gyro"
+#define EVENT_PRESSURE_PATH TRIGGER_PREFIX_NAME "event/pressure"
+
+/// Prefix of the Data Hub Inputs that the alarms are published to (<prefix><rule>).
+#define EVENT_ALARM_PREFIX  TRIGGER_PREFIX_NAME "event/"
+
+/// Number of frames kept in the ring buffer (about 10 seconds at the default stream rate).  The
+/// pre- plus post-trigger time of a rule must fit, or the start of its windows is cut off.
+#define RING_FRAMES 2048
+
+#if COLUMN_CODEC_TEXT_BYTES > (DHUB_MAX_STRING_VALUE_LEN + 1)
+#error "Event blocks don't fit in a Data Hub string value."
+#endif
+
+// Resolutions of the values in the event blocks (powers of ten):
+
+#define ACCEL_RESOLUTION_EXP -3     // 0.001 m/s2
+#define GYRO_RESOLUTION_EXP -4      // 0.0001 rad/s
+#define PRESSURE_RESOLUTION_EXP -4  // 0.1 Pa
+
+/// Time after a window has been published during which no rule can fire (seconds).
+#define HOLDOFF_SECONDS 10.0
+
+/// Path of the trigger rules in the config tree.
+#define TRIGGERS_CONFIG_PATH "triggers"
+
+/// Maximum number of trigger rules (built-in ones plus those added in the config tree).
+#define MAX_RULES 8
+
+/// Maximum size of a rule name (including null terminator).
+#define MAX_RULE_NAME_BYTES 32
+
+/// Quantity that a rule is evaluated on.
+typedef enum
+{
+    QUANTITY_ACCEL,     ///< Magnitude of the acceleration (m/s2, including gravity).
+    QUANTITY_GYRO,      ///< Magnitude of the angular velocity (rad/s).
+}
+Quantity_t;
+
+/// Trigger rule.
+typedef struct
+{
+    char name[MAX_RULE_NAME_BYTES];
+    Quantity_t quantity;
+    double above;           ///< Threshold on the magnitude (0 = none).
+    double rateAbove;       ///< Threshold on the magnitude's rate of change, per second (0 = none).
+    double preSeconds;      ///< Time to capture before the trigger (seconds).
+    double postSeconds;     ///< Time to capture after the trigger (seconds).
+    char alarmPath[DHUB_MAX_RESOURCE_PATH_LEN + 1]; ///< Data Hub Input the alarms go to.
+    double lastValue;       ///< Magnitude in the previous frame.
+    double lastTimestamp;   ///< Timestamp of the previous frame (0 = none yet).
+}
+Rule_t;
+
+/// Default trigger rules.
+static const Rule_t BuiltInRules[] =
+{
+    // Linear shock of more than about 1 g on top of gravity.
+    {
+        name: "shock",
+        quantity: QUANTITY_ACCEL,
+        above: 20.0,
+        rateAbove: 0.0,
+        preSeconds: 1.0,
+        postSeconds: 4.0,
+    },
+    // Fast rotation, e.g., the board being knocked over.
+    {
+        name: "spin",
+        quantity: QUANTITY_GYRO,
+        above: 5.0,
+        rateAbove: 0.0,
+        preSeconds: 1.0,
+        postSeconds: 2.0,
+    },
+};
+
+/// Trigger rules in use.
+static Rule_t Rules[MAX_RULES];
+static size_t RuleCount = 0;
+
+/// The most recent frames, oldest first starting at RingHead.
+static imuStream_Frame_t Ring[RING_FRAMES];
+static size_t RingHead = 0;
+static size_t RingCount = 0;
+
+/// Resolutions of the columns of each channel's blocks.
+static const int8_t AccelExponents[] =
+    { ACCEL_RESOLUTION_EXP, ACCEL_RESOLUTION_EXP, ACCEL_RESOLUTION_EXP };
+static const int8_t GyroExponents[] =
+    { GYRO_RESOLUTION_EXP, GYRO_RESOLUTION_EXP, GYRO_RESOLUTION_EXP };
+static const int8_t PressureExponents[] = { PRESSURE_RESOLUTION_EXP };
+
+/// Shared memory pressure ring, read when a window is published (NULL if unavailable).
+static sensorRing_ConsumerRef_t PressureRingRef = NULL;
+
+/// Block of one channel's samples being packed for publishing.
+static struct
+{
+    const char* path;           ///< Data Hub Input the block goes to.
+    size_t columnCount;
+    const int8_t* exponentsPtr;
+    double newest;              ///< Timestamp of the newest sample in the block.
+    columnCodec_Block_t codec;
+}
+Block;
+
+/// Window being captured.
+static struct
+{
+    bool isActive;          ///< true while waiting for the post-trigger frames.
+    const Rule_t* rulePtr;  ///< Rule that fired.
+    double value;           ///< Magnitude (or rate of change) that made it fire.
+    double start;           ///< Timestamp of the start of the window.
+    double triggerTime;     ///< Timestamp of the frame that fired the rule.
+    double end;             ///< Timestamp of the end of the window.
+    double holdoffEnd;      ///< No rule can fire before this timestamp.
+}
+Capture;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the magnitude of the quantity a rule is evaluated on.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetMagnitude
+(
+    const Rule_t* rulePtr,
+    const imuStream_Frame_t* framePtr
+)
+{
+    const double* v = (rulePtr->quantity == QUANTITY_ACCEL) ? framePtr->accel : framePtr->gyro;
+
+    return sqrt((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a frame against a rule.
+ *
+ * @return true if the rule fires (*valuePtr is then set to the magnitude or rate that fired it).
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsTriggered
+(
+    Rule_t* rulePtr,
+    const imuStream_Frame_t* framePtr,
+    double* valuePtr
+)
+{
+    double magnitude = GetMagnitude(rulePtr, framePtr);
+    double dt = framePtr->timestamp - rulePtr->lastTimestamp;
+    double rate = ((rulePtr->lastTimestamp > 0.0) && (dt > 0.0))
+                ? ((magnitude - rulePtr->lastValue) / dt)
+                : 0.0;
+
+    rulePtr->lastValue = magnitude;
+    rulePtr->lastTimestamp = framePtr->timestamp;
+
+    if ((rulePtr->above > 0.0) && (magnitude > rulePtr->above))
+    {
+        *valuePtr = magnitude;
+        return true;
+    }
+
+    if ((rulePtr->rateAbove > 0.0) && (fabs(rate) > rulePtr->rateAbove))
+    {
+        *valuePtr = rate;
+        return true;
+    }
+
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start packing a channel's samples into a block.
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartBlock
+(
+    const char* path,           ///< Data Hub Input the channel's blocks go to.
+    size_t columnCount,
+    const int8_t* exponentsPtr  ///< Resolution of each column.
+)
+{
+    Block.path = path;
+    Block.columnCount = columnCount;
+    Block.exponentsPtr = exponentsPtr;
+
+    columnCodec_Start(&Block.codec, columnCount, exponentsPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the block being packed to the Data Hub, if it holds any samples, and start a new one
+ * for the same channel.
+ */
+//--------------------------------------------------------------------------------------------------
+static void FlushBlock
+(
+    void
+)
+{
+    static char text[COLUMN_CODEC_TEXT_BYTES];
+
+    if (columnCodec_GetCount(&Block.codec) == 0)
+    {
+        return;
+    }
+
+    LE_ASSERT_OK(columnCodec_Encode(&Block.codec, text, sizeof(text)));
+
+    dhub_PushString(Block.path, Block.newest, text);
+
+    columnCodec_Start(&Block.codec, Block.columnCount, Block.exponentsPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a sample to the block being packed, publishing the block first if it's full.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToBlock
+(
+    double timestamp,
+    const double* values    ///< One value per column.
+)
+{
+    le_result_t result = columnCodec_Add(&Block.codec, timestamp, values);
+
+    if (result == LE_OVERFLOW)
+    {
+        FlushBlock();
+        result = columnCodec_Add(&Block.codec, timestamp, values);
+    }
+
+    if (result != LE_OK)
+    {
+        LE_WARN("Dropping sample at %.3f from '%s' (%s).",
+                timestamp,
+                Block.path,
+                LE_RESULT_TXT(result));
+        return;
+    }
+
+    Block.newest = timestamp;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the pressure samples taken during the captured window.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishPressure
+(
+    void
+)
+{
+    sensorRing_PressureRecord_t record;
+
+    if (PressureRingRef == NULL)
+    {
+        return;
+    }
+
+    StartBlock(EVENT_PRESSURE_PATH, NUM_ARRAY_MEMBERS(PressureExponents), PressureExponents);
+
+    // The ring holds the most recent samples, which easily cover the window at the pressure
+    // sensor's rate.  Those from before it (since the last window) are just passed over.
+    while (sensorRing_Read(PressureRingRef, &record, NULL) == LE_OK)
+    {
+        if ((record.timestamp >= Capture.start) && (record.timestamp <= Capture.end))
+        {
+            AddToBlock(record.timestamp, &record.pressure);
+        }
+    }
+
+    FlushBlock();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the captured window: the alarm, then the frames in the window that are still in the
+ * ring buffer, then the pressure samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PublishCapture
+(
+    void
+)
+{
+    size_t first = RingCount;
+    size_t frameCount = 0;
+
+    for (size_t i = 0; i < RingCount; i++)
+    {
+        double timestamp = Ring[(RingHead + i) % RING_FRAMES].timestamp;
+
+        if ((timestamp >= Capture.start) && (timestamp <= Capture.end))
+        {
+            if (first == RingCount)
+            {
+                first = i;
+            }
+            frameCount++;
+        }
+    }
+
+    if ((frameCount > 0) && (Ring[(RingHead + first) % RING_FRAMES].timestamp > Capture.start))
+    {
+        LE_WARN("Start of '%s' event window was lost (RING_FRAMES is too small).",
+                Capture.rulePtr->name);
+    }
+
+    char alarm[256];
+
+    int len = snprintf(alarm,
+                       sizeof(alarm),
+                       "{\"value\":%.6g,\"start\":%.3f,\"end\":%.3f,\"frames\":%zu}",
+                       Capture.value,
+                       Capture.start,
+                       Capture.end,
+                       frameCount);
+    if (len >= sizeof(alarm))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(alarm));
+    }
+
+    LE_INFO("'%s' event: %s", Capture.rulePtr->name, alarm);
+
+    dhub_PushJson(Capture.rulePtr->alarmPath, Capture.triggerTime, alarm);
+
+    StartBlock(EVENT_ACCEL_PATH, NUM_ARRAY_MEMBERS(AccelExponents), AccelExponents);
+    for (size_t i = first; i < (first + frameCount); i++)
+    {
+        const imuStream_Frame_t* framePtr = &Ring[(RingHead + i) % RING_FRAMES];
+
+        AddToBlock(framePtr->timestamp, framePtr->accel);
+    }
+    FlushBlock();
+
+    StartBlock(EVENT_GYRO_PATH, NUM_ARRAY_MEMBERS(GyroExponents), GyroExponents);
+    for (size_t i = first; i < (first + frameCount); i++)
+    {
+        const imuStream_Frame_t* framePtr = &Ring[(RingHead + i) % RING_FRAMES];
+
+        AddToBlock(framePtr->timestamp, framePtr->gyro);
+    }
+    FlushBlock();
+
+    PublishPressure();
+
+    Capture.isActive = false;
+    Capture.holdoffEnd = Capture.end + HOLDOFF_SECONDS;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a block of streamed IMU frames.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFrames
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        const imuStream_Frame_t* framePtr = &framesPtr[i];
+
+        // Keep the frame, overwriting the oldest one if the ring is full.
+        if (RingCount < RING_FRAMES)
+        {
+            Ring[(RingHead + RingCount) % RING_FRAMES] = *framePtr;
+            RingCount++;
+        }
+        else
+        {
+            Ring[RingHead] = *framePtr;
+            RingHead = (RingHead + 1) % RING_FRAMES;
+        }
+
+        // Note: the rules are evaluated even while they can't fire, to keep their rates current.
+        for (size_t r = 0; r < RuleCount; r++)
+        {
+            double value;
+
+            if (   IsTriggered(&Rules[r], framePtr, &value)
+                && !Capture.isActive
+                && (framePtr->timestamp >= Capture.holdoffEnd) )
+            {
+                Capture.isActive = true;
+                Capture.rulePtr = &Rules[r];
+                Capture.value = value;
+                Capture.triggerTime = framePtr->timestamp;
+                Capture.start = framePtr->timestamp - Rules[r].preSeconds;
+                Capture.end = framePtr->timestamp + Rules[r].postSeconds;
+            }
+        }
+
+        if (Capture.isActive && (framePtr->timestamp >= Capture.end))
+        {
+            PublishCapture();
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a rule, overriding its settings with those in the config tree, and create its alarm's Data
+ * Hub Input.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddRule
+(
+    le_cfg_IteratorRef_t iteratorRef,   ///< Positioned at the rule's node (which may not exist).
+    const Rule_t* defaultsPtr           ///< The rule's default settings.
+)
+{
+    if (!le_cfg_GetBool(iteratorRef, "enable", true))
+    {
+        LE_INFO("Trigger rule '%s' is disabled.", defaultsPtr->name);
+        return;
+    }
+
+    if (RuleCount >= MAX_RULES)
+    {
+        LE_ERROR("Too many trigger rules.  Ignoring '%s'.", defaultsPtr->name);
+        return;
+    }
+
+    Rule_t* rulePtr = &Rules[RuleCount];
+    *rulePtr = *defaultsPtr;
+
+    char quantity[8];
+
+    if (le_cfg_GetString(iteratorRef,
+                         "quantity",
+                         quantity,
+                         sizeof(quantity),
+                         (rulePtr->quantity == QUANTITY_ACCEL) ? "accel" : "gyro") != LE_OK)
+    {
+        quantity[0] = '\0';
+    }
+
+    if (strcmp(quantity, "accel") == 0)
+    {
+        rulePtr->quantity = QUANTITY_ACCEL;
+    }
+    else if (strcmp(quantity, "gyro") == 0)
+    {
+        rulePtr->quantity = QUANTITY_GYRO;
+    }
+    else
+    {
+        LE_ERROR("Unknown quantity for trigger rule '%s'.  Ignoring it.", rulePtr->name);
+        return;
+    }
+
+    rulePtr->above = le_cfg_GetFloat(iteratorRef, "above", rulePtr->above);
+    rulePtr->rateAbove = le_cfg_GetFloat(iteratorRef, "rateAbove", rulePtr->rateAbove);
+    rulePtr->preSeconds = le_cfg_GetFloat(iteratorRef, "preSeconds", rulePtr->preSeconds);
+    rulePtr->postSeconds = le_cfg_GetFloat(iteratorRef, "postSeconds", rulePtr->postSeconds);
+
+    if ((rulePtr->preSeconds < 0.0) || (rulePtr->postSeconds < 0.0))
+    {
+        LE_ERROR("Negative capture time for trigger rule '%s'.  Ignoring it.", rulePtr->name);
+        return;
+    }
+
+    int len = snprintf(rulePtr->alarmPath,
+                       sizeof(rulePtr->alarmPath),
+                       "%s%s",
+                       EVENT_ALARM_PREFIX,
+                       rulePtr->name);
+    LE_ASSERT((len > 0) && ((size_t)len < sizeof(rulePtr->alarmPath)));
+
+    LE_ASSERT_OK(dhub_CreateInput(rulePtr->alarmPath, DHUB_DATA_TYPE_JSON, ""));
+    dhub_SetJsonExample(rulePtr->alarmPath,
+                        "{\"value\":25.1,\"start\":1546300798.0,\"end\":1546300803.0,"
+                        "\"frames\":1000}");
+
+    LE_INFO("Trigger rule '%s': %s above %lf or changing faster than %lf/s, capturing %lf s"
+            " before and %lf s after.",
+            rulePtr->name,
+            (rulePtr->quantity == QUANTITY_ACCEL) ? "accel" : "gyro",
+            rulePtr->above,
+            rulePtr->rateAbove,
+            rulePtr->preSeconds,
+            rulePtr->postSeconds);
+
+    RuleCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Load the built-in rules (with any settings overridden in the config tree) and the rules added
+ * in the config tree.
+ */
+//--------------------------------------------------------------------------------------------------
+static void LoadRules
+(
+    void
+)
+{
+    le_cfg_IteratorRef_t iteratorRef = le_cfg_CreateReadTxn(TRIGGERS_CONFIG_PATH);
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(BuiltInRules); i++)
+    {
+        le_cfg_GoToNode(iteratorRef, BuiltInRules[i].name);
+        AddRule(iteratorRef, &BuiltInRules[i]);
+        le_cfg_GoToNode(iteratorRef, "..");
+    }
+
+    if (le_cfg_GoToFirstChild(iteratorRef) == LE_OK)
+    {
+        do
+        {
+            // Extra rules default to a rule that never fires, so they must set a threshold.
+            Rule_t defaults = { quantity: QUANTITY_ACCEL };
+            bool isBuiltIn = false;
+
+            if (le_cfg_GetNodeName(iteratorRef, "", defaults.name, sizeof(defaults.name))
+                != LE_OK)
+            {
+                LE_ERROR("Trigger rule name too long.  Ignoring it.");
+                continue;
+            }
+
+            for (size_t i = 0; i < NUM_ARRAY_MEMBERS(BuiltInRules); i++)
+            {
+                isBuiltIn = isBuiltIn || (strcmp(BuiltInRules[i].name, defaults.name) == 0);
+            }
+
+            if (!isBuiltIn)
+            {
+                AddRule(iteratorRef, &defaults);
+            }
+        }
+        while (le_cfg_GoToNextSibling(iteratorRef) == LE_OK);
+    }
+
+    le_cfg_CancelTxn(iteratorRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the trigger component.  The IMU and shared memory components' COMPONENT_INITs
+ * (which set up streaming and the pressure ring) run first, as this component depends on them.
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    LE_ASSERT_OK(dhub_CreateInput(EVENT_ACCEL_PATH, DHUB_DATA_TYPE_STRING, "m/s2"));
+    LE_ASSERT_OK(dhub_CreateInput(EVENT_GYRO_PATH, DHUB_DATA_TYPE_STRING, "rad/s"));
+    LE_ASSERT_OK(dhub_CreateInput(EVENT_PRESSURE_PATH, DHUB_DATA_TYPE_STRING, "kPa"));
+
+    int fd = shm_GetPressureFd();
+    if (   (fd < 0)
+        || (sensorRing_Attach(fd, sizeof(sensorRing_PressureRecord_t), &PressureRingRef) != LE_OK))
+    {
+        LE_WARN("Pressure ring unavailable.  Events will be captured without pressure samples.");
+        PressureRingRef = NULL;
+    }
+
+    LoadRules();
+
+    if (RuleCount == 0)
+    {
+        LE_INFO("No trigger rules.");
+        return;
+    }
+
+    if (imuStream_AddBlockHandler(HandleFrames, NULL) == NULL)
+    {
+        LE_ERROR("Failed to start the IMU stream.  No events will be captured.");
+    }
+}
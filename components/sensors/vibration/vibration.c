@@ -0,0 +1,555 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file vibration.c
+ *
+ * Spectral feature extraction from the accelerometer, for vibration (machine-health) monitoring.
+ *
+ * The accelerometer frames streamed by the IMU component (see imuStream.h) are cut into segments
+ * of FFT_SIZE frames, overlapping by half.  Each axis of each segment has its mean (gravity and
+ * any tilt) removed, is tapered with a Hann window, and goes through a real FFT.  The power
+ * spectra of the three axes are added together, and averaged over all the segments in a report
+ * period (Welch's method), which makes the estimate much steadier than a single FFT's.
+ *
+ * Every REPORT_PERIOD seconds, the following features are published to the Data Hub, from which
+ * avPublisher pushes them to AirVantage:
+ *
+ *  - to the Input "vibration/value", a JSON value holding the vibration's RMS acceleration
+ *    (m/s2), its crest factor (peak over RMS), and its dominant frequency (Hz), e.g.,
+ *    { "rms": 0.35, "crest": 3.2, "peakHz": 49.8 }
+ *  - to the Input "vibration/bandEnergy", a packed vector (see packedVector.h) of the energy
+ *    (mean square acceleration, in (m/s2)^2) in each of BAND_COUNT frequency bands.  The band
+ *    energies add up to the square of the RMS if the bands cover the whole spectrum.
+ *
+ * The bands are set by BAND_COUNT + 1 ascending edge frequencies (Hz), band i running from edge i
+ * up to edge i + 1.  They default to DefaultBandEdges, and can be changed at run-time by pushing a
+ * JSON array of edges to the Data Hub Output "vibration/bands", which avPublisher does when
+ * AirVantage writes the /Settings/vibration/Bands setting, e.g., [ 0, 5, 10, 20, 50, 100, ... ].
+ * Bands above the Nyquist frequency (half the stream's sample rate) are always empty.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+
+#include "imuStream.h"
+#include "packedVector.h"
+
+#ifdef MK_CONFIG_PERIODIC_SENSOR_ABSOLUTE
+#define VIBRATION_PREFIX_NAME "/app/redSensor/"
+#else
+#define VIBRATION_PREFIX_NAME ""
+#endif
+
+/// Data Hub Inputs that the features are published to.
+#define FEATURES_PATH       VIBRATION_PREFIX_NAME "vibration/value"
+#define BAND_ENERGY_PATH    VIBRATION_PREFIX_NAME "vibration/bandEnergy"
+
+/// Data Hub Output that the band edges are received from.
+#define BANDS_PATH          VIBRATION_PREFIX_NAME "vibration/bands"
+
+/// Number of frames in each FFT segment (a power of two).  At the stream's default rate, this is
+/// 1.28 s, giving a resolution of 0.78 Hz.
+#define FFT_SIZE 256
+
+/// Number of frequency bands that the energy is reported in.
+#define BAND_COUNT 8
+
+/// Time between feature reports (seconds).
+#define REPORT_PERIOD 10.0
+
+/// Longest gap between frames that a segment can span (seconds).  After a longer gap (e.g., the
+/// stream restarting), the partial segment is thrown away.
+#define MAX_FRAME_GAP 0.1
+
+/// Default band edges (Hz).
+static const double DefaultBandEdges[BAND_COUNT + 1] = { 1, 5, 10, 20, 30, 45, 60, 80, 100 };
+
+/// Band edges in use (Hz).
+static double BandEdges[BAND_COUNT + 1];
+
+/// Hann window, and its sum of squares (for scaling the power spectrum).
+static float Window[FFT_SIZE];
+static double WindowPower;
+
+/// Twiddle factors, e^(-2 pi i k / FFT_SIZE), for k < FFT_SIZE / 2.
+static float TwiddleRe[FFT_SIZE / 2];
+static float TwiddleIm[FFT_SIZE / 2];
+
+/// Frames of the segment being filled.
+static struct
+{
+    double timestamps[FFT_SIZE];
+    float accel[3][FFT_SIZE];
+    size_t count;               ///< Number of frames in the segment so far.
+}
+Segment;
+
+/// Features accumulated since the last report.
+static struct
+{
+    double power[(FFT_SIZE / 2) + 1];   ///< Sum of the segments' power spectra ((m/s2)^2).
+    double meanSquareSum;       ///< Sum of the segments' mean square accelerations.
+    double peak;                ///< Largest acceleration in any of the segments (m/s2).
+    double sampleRateSum;       ///< Sum of the segments' sample rates (Hz).
+    size_t segmentCount;        ///< Number of segments accumulated.
+    double nextReportTime;      ///< When the next report is due (seconds since the Epoch, 0 = on
+                                ///  the first segment).
+}
+Features;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the window and twiddle factor tables.
+ */
+//--------------------------------------------------------------------------------------------------
+static void InitTables
+(
+    void
+)
+{
+    WindowPower = 0.0;
+
+    for (size_t n = 0; n < FFT_SIZE; n++)
+    {
+        Window[n] = 0.5f - (0.5f * (float)cos((2.0 * M_PI * n) / FFT_SIZE));
+        WindowPower += (double)Window[n] * Window[n];
+    }
+
+    for (size_t k = 0; k < (FFT_SIZE / 2); k++)
+    {
+        TwiddleRe[k] = (float)cos((2.0 * M_PI * k) / FFT_SIZE);
+        TwiddleIm[k] = (float)-sin((2.0 * M_PI * k) / FFT_SIZE);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transform FFT_SIZE / 2 complex numbers in place (iterative radix-2 decimation in time).
+ */
+//--------------------------------------------------------------------------------------------------
+static void ComplexFft
+(
+    float* re,
+    float* im
+)
+{
+    const size_t n = FFT_SIZE / 2;
+
+    // Put the inputs in bit-reversed order.
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j)
+        {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        // The twiddle factors of an n-point transform are every other one of FFT_SIZE's.
+        size_t stride = FFT_SIZE / len;
+
+        for (size_t start = 0; start < n; start += len)
+        {
+            for (size_t k = 0; k < (len / 2); k++)
+            {
+                float wRe = TwiddleRe[k * stride];
+                float wIm = TwiddleIm[k * stride];
+                size_t a = start + k;
+                size_t b = a + (len / 2);
+
+                float tRe = (re[b] * wRe) - (im[b] * wIm);
+                float tIm = (re[b] * wIm) + (im[b] * wRe);
+
+                re[b] = re[a] - tRe;
+                im[b] = im[a] - tIm;
+                re[a] += tRe;
+                im[a] += tIm;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the power spectrum of FFT_SIZE real numbers, using a complex FFT of half the size (the
+ * even samples as the real parts and the odd ones as the imaginary parts), and add it to the
+ * accumulated spectrum.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddPowerSpectrum
+(
+    const float* x,         ///< FFT_SIZE windowed samples.
+    double* power           ///< [IN/OUT] FFT_SIZE / 2 + 1 bins to add the power to.
+)
+{
+    const size_t half = FFT_SIZE / 2;
+    float re[FFT_SIZE / 2];
+    float im[FFT_SIZE / 2];
+
+    for (size_t i = 0; i < half; i++)
+    {
+        re[i] = x[2 * i];
+        im[i] = x[(2 * i) + 1];
+    }
+
+    ComplexFft(re, im);
+
+    // Scale so that the bins add up to the mean square of the (unwindowed) signal.  All bins but
+    // DC and Nyquist stand for a positive and a negative frequency.
+    double scale = 1.0 / (FFT_SIZE * WindowPower);
+
+    for (size_t k = 0; k <= half; k++)
+    {
+        // Split the two interleaved real transforms apart: X[k] = E[k] + W^k O[k].
+        size_t i = k % half;
+        size_t j = (half - k) % half;
+
+        float eRe = 0.5f * (re[i] + re[j]);
+        float eIm = 0.5f * (im[i] - im[j]);
+        float oRe = 0.5f * (im[i] + im[j]);
+        float oIm = -0.5f * (re[i] - re[j]);
+
+        float wRe = (k < half) ? TwiddleRe[k] : -1.0f;
+        float wIm = (k < half) ? TwiddleIm[k] : 0.0f;
+
+        float xRe = eRe + (wRe * oRe) - (wIm * oIm);
+        float xIm = eIm + (wRe * oIm) + (wIm * oRe);
+
+        double binPower = ((double)xRe * xRe) + ((double)xIm * xIm);
+
+        power[k] += binPower * scale * (((k == 0) || (k == half)) ? 1.0 : 2.0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Analyze a full segment and add its features to those accumulated for the report.
+ */
+//--------------------------------------------------------------------------------------------------
+static void AnalyzeSegment
+(
+    void
+)
+{
+    double duration = Segment.timestamps[FFT_SIZE - 1] - Segment.timestamps[0];
+
+    if (!(duration > 0.0))
+    {
+        return;
+    }
+
+    double residual[FFT_SIZE] = { 0.0 };   // Squared magnitude of each frame's acceleration.
+    float x[FFT_SIZE];
+
+    for (size_t axis = 0; axis < 3; axis++)
+    {
+        const float* a = Segment.accel[axis];
+        double mean = 0.0;
+
+        for (size_t n = 0; n < FFT_SIZE; n++)
+        {
+            mean += a[n];
+        }
+        mean /= FFT_SIZE;
+
+        for (size_t n = 0; n < FFT_SIZE; n++)
+        {
+            float v = a[n] - (float)mean;
+
+            residual[n] += (double)v * v;
+            x[n] = v * Window[n];
+        }
+
+        AddPowerSpectrum(x, Features.power);
+    }
+
+    double meanSquare = 0.0;
+
+    for (size_t n = 0; n < FFT_SIZE; n++)
+    {
+        meanSquare += residual[n];
+
+        if (residual[n] > (Features.peak * Features.peak))
+        {
+            Features.peak = sqrt(residual[n]);
+        }
+    }
+
+    Features.meanSquareSum += meanSquare / FFT_SIZE;
+    Features.sampleRateSum += (FFT_SIZE - 1) / duration;
+    Features.segmentCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Publish the features accumulated since the last report, then start accumulating afresh.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReportFeatures
+(
+    double timestamp
+)
+{
+    const size_t count = Features.segmentCount;
+    const double binWidth = (Features.sampleRateSum / count) / FFT_SIZE;   // Hz
+
+    double energies[BAND_COUNT] = { 0.0 };
+    size_t peakBin = 1;
+
+    for (size_t k = 1; k <= (FFT_SIZE / 2); k++)
+    {
+        double frequency = k * binWidth;
+        double power = Features.power[k] / count;
+
+        for (size_t band = 0; band < BAND_COUNT; band++)
+        {
+            if ((frequency >= BandEdges[band]) && (frequency < BandEdges[band + 1]))
+            {
+                energies[band] += power;
+            }
+        }
+
+        if (Features.power[k] > Features.power[peakBin])
+        {
+            peakBin = k;
+        }
+    }
+
+    // Refine the dominant frequency by fitting a parabola through the peak bin and its neighbours.
+    double offset = 0.0;
+
+    if ((peakBin > 1) && (peakBin < (FFT_SIZE / 2)))
+    {
+        double left = Features.power[peakBin - 1];
+        double centre = Features.power[peakBin];
+        double right = Features.power[peakBin + 1];
+        double curvature = left - (2.0 * centre) + right;
+
+        if (curvature < 0.0)
+        {
+            offset = 0.5 * (left - right) / curvature;
+        }
+    }
+
+    double rms = sqrt(Features.meanSquareSum / count);
+    double crest = (rms > 0.0) ? (Features.peak / rms) : 0.0;
+
+    char features[128];
+
+    int len = snprintf(features,
+                       sizeof(features),
+                       "{\"rms\":%.6g,\"crest\":%.4g,\"peakHz\":%.4g}",
+                       rms,
+                       crest,
+                       (peakBin + offset) * binWidth);
+    if (len >= sizeof(features))
+    {
+        LE_FATAL("JSON string (len %d) is longer than buffer (size %zu).", len, sizeof(features));
+    }
+
+    dhub_PushJson(FEATURES_PATH, timestamp, features);
+
+    char packed[PACKED_VECTOR_BUFFER_BYTES(BAND_COUNT)];
+
+    LE_ASSERT_OK(packedVector_Encode(energies, BAND_COUNT, packed, sizeof(packed)));
+
+    dhub_PushString(BAND_ENERGY_PATH, timestamp, packed);
+
+    memset(Features.power, 0, sizeof(Features.power));
+    Features.meanSquareSum = 0.0;
+    Features.peak = 0.0;
+    Features.sampleRateSum = 0.0;
+    Features.segmentCount = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a block of streamed IMU frames.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleFrames
+(
+    const imuStream_Frame_t* framesPtr,
+    size_t frameCount,
+    void* contextPtr
+)
+{
+    for (size_t i = 0; i < frameCount; i++)
+    {
+        const imuStream_Frame_t* framePtr = &framesPtr[i];
+
+        if (   (Segment.count > 0)
+            && (   (framePtr->timestamp <= Segment.timestamps[Segment.count - 1])
+                || (framePtr->timestamp > (Segment.timestamps[Segment.count - 1] + MAX_FRAME_GAP))))
+        {
+            Segment.count = 0;
+        }
+
+        Segment.timestamps[Segment.count] = framePtr->timestamp;
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            Segment.accel[axis][Segment.count] = (float)framePtr->accel[axis];
+        }
+        Segment.count++;
+
+        if (Segment.count < FFT_SIZE)
+        {
+            continue;
+        }
+
+        AnalyzeSegment();
+
+        if (Features.nextReportTime == 0.0)
+        {
+            Features.nextReportTime = framePtr->timestamp + REPORT_PERIOD;
+        }
+        else if ((framePtr->timestamp >= Features.nextReportTime) && (Features.segmentCount > 0))
+        {
+            ReportFeatures(framePtr->timestamp);
+
+            Features.nextReportTime = framePtr->timestamp + REPORT_PERIOD;
+        }
+
+        // Keep the second half of the segment as the first half of the next one.
+        const size_t half = FFT_SIZE / 2;
+
+        memmove(Segment.timestamps, &Segment.timestamps[half], half * sizeof(double));
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            memmove(Segment.accel[axis], &Segment.accel[axis][half], half * sizeof(float));
+        }
+        Segment.count = half;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a JSON array of BAND_COUNT + 1 ascending band edges.
+ *
+ * @return
+ *  - LE_OK if successful
+ *  - LE_FORMAT_ERROR if the value isn't such an array.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseBandEdges
+(
+    const char* value,
+    double* edges       ///< [OUT] BAND_COUNT + 1 edges (Hz).
+)
+{
+    const char* p = value;
+
+    while (isspace((unsigned char)*p))
+    {
+        p++;
+    }
+
+    if (*p != '[')
+    {
+        return LE_FORMAT_ERROR;
+    }
+    p++;
+
+    for (size_t i = 0; i <= BAND_COUNT; i++)
+    {
+        char* endPtr;
+
+        edges[i] = strtod(p, &endPtr);
+        if ((endPtr == p) || !(edges[i] >= 0.0) || ((i > 0) && !(edges[i] > edges[i - 1])))
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        p = endPtr;
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+
+        if (*p != ((i < BAND_COUNT) ? ',' : ']'))
+        {
+            return LE_FORMAT_ERROR;
+        }
+        p++;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a new set of band edges pushed to the bands Output.
+ */
+//--------------------------------------------------------------------------------------------------
+static void HandleBandsPush
+(
+    double timestamp,
+    const char* value,
+    void* contextPtr
+)
+{
+    double edges[BAND_COUNT + 1];
+
+    if (ParseBandEdges(value, edges) != LE_OK)
+    {
+        LE_ERROR("Invalid vibration bands '%s' (need %d ascending edges).  Keeping the old ones.",
+                 value,
+                 BAND_COUNT + 1);
+        return;
+    }
+
+    LE_INFO("Vibration bands changed to %s.", value);
+
+    memcpy(BandEdges, edges, sizeof(BandEdges));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initializes the vibration component.  The IMU component's COMPONENT_INIT (which sets up
+ * streaming) runs first, as this component depends on it.
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    InitTables();
+    memcpy(BandEdges, DefaultBandEdges, sizeof(BandEdges));
+
+    LE_ASSERT_OK(dhub_CreateInput(FEATURES_PATH, DHUB_DATA_TYPE_JSON, ""));
+    dhub_SetJsonExample(FEATURES_PATH, "{\"rms\":0.35,\"crest\":3.2,\"peakHz\":49.8}");
+
+    LE_ASSERT_OK(dhub_CreateInput(BAND_ENERGY_PATH, DHUB_DATA_TYPE_STRING, "(m/s2)^2"));
+
+    LE_ASSERT_OK(dhub_CreateOutput(BANDS_PATH, DHUB_DATA_TYPE_JSON, "Hz"));
+    dhub_AddJsonPushHandler(BANDS_PATH, HandleBandsPush, NULL);
+
+    if (imuStream_AddBlockHandler(HandleFrames, NULL) == NULL)
+    {
+        LE_ERROR("Failed to start the IMU stream.  No vibration features will be reported.");
+    }
+}
@@ -0,0 +1,884 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file avPublisherBench.c
+ *
+ * Host benchmark of avPublisher's push pipeline.  avPublisher is run against the host stand-ins
+ * for Legato and its services (see test/host), on a virtual clock, while a workload is replayed
+ * into the Data Hub: either samples of an extra numeric "bench" sensor at a steady rate, or a
+ * trace recorded from a device.  Each scenario runs in a child process of its own, so it starts
+ * from empty sample queues.
+ *
+ *  - steady: the workload as given, reporting samples per second, pushes per sample, bytes per
+ *    sample and CPU time per sample.
+ *  - outage: the same with the AirVantage session down for a while, reporting how long the backlog
+ *    takes to drain once the session is back.  Fails if it doesn't drain.
+ *  - sweep: the bench sensor at doubling rates, up to --max-rate, reporting the highest rate at
+ *    which the backlog doesn't grow.
+ *  - change-by overflow: a vector bench sensor with a change-by threshold, whose pushes in flight
+ *    fail in an outage, after which the records are limited to about one compact block, so the
+ *    failed ranges are resent in parts.  Fails unless exactly the samples that change-by filtering
+ *    of the whole workload keeps are delivered.
+ *
+ * A trace is a CSV file of "timestamp,obsPath,value" lines, e.g., "1600000000.25,/obs/bench,21.5",
+ * with the timestamps in seconds; values that aren't numbers are pushed as strings or JSON.  Blank
+ * lines and lines starting with '#' are skipped.  See exampleTrace.csv.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "hostLegato.h"
+#include "hostServices.h"
+#include "packedVector.h"
+
+#include <ftw.h>
+#include <getopt.h>
+#include <sys/wait.h>
+
+/// Name of the extra sensor that the generated workload is pushed to.
+#define BENCH_SENSOR "bench"
+
+/// Observation of the bench sensor.
+#define BENCH_OBS_PATH "/obs/" BENCH_SENSOR
+
+/// Parent of the AirVantage variables that avPublisher publishes its metrics to.
+#define METRICS_PATH "/Metrics"
+
+/// How often avPublisher publishes its metrics (seconds).  See METRICS_PERIOD_MS in avPublisher.
+#define METRICS_PERIOD 60.0
+
+/// Age of the oldest undelivered sample below which a backlog counts as keeping up (seconds).
+#define SUSTAINED_BACKLOG_SECONDS 10.0
+
+/// Longest time a backlog is given to drain after the workload ends (seconds).
+#define MAX_DRAIN_SECONDS (6 * 3600.0)
+
+/// Maximum length of a trace line.
+#define MAX_TRACE_LINE_BYTES 8192
+
+/// Number of fields of the vector bench sensor.
+#define VECTOR_FIELD_COUNT 3
+
+// Change-by overflow scenario: workload, outage, and the record size limit from the start of the
+// outage, which holds one compact block of the vector bench sensor, but not two.
+
+#define OVERFLOW_RATE 800.0
+#define OVERFLOW_DURATION 120.0
+#define OVERFLOW_OUTAGE_START 40.0
+#define OVERFLOW_OUTAGE_LENGTH 2.0
+#define OVERFLOW_CHANGE_BY 0.05
+#define OVERFLOW_RECORD_BYTES 1000
+
+/// Options.
+typedef struct
+{
+    const char* tracePath;  ///< Trace to replay (NULL to generate the workload).
+    double speed;           ///< Replay speed, relative to the trace's own.
+    double rate;            ///< Rate of the generated workload (samples per second).
+    double duration;        ///< Length of the generated workload (seconds).
+    double latency;         ///< Time from a push to its acknowledgement (seconds).
+    double failureRate;     ///< Fraction of the pushes that fail.
+    double outageStart;     ///< Time into the workload that the outage starts (seconds).
+    double outageLength;    ///< Length of the outage (seconds, 0 for none).
+    double maxRate;         ///< Highest rate to sweep to (samples per second, 0 to skip it).
+    int batchCount;         ///< Bench sensor's batch count (0 for avPublisher's default).
+    int pushWindow;         ///< Bench sensor's push window (0 for avPublisher's default).
+    double changeBy;        ///< Change-by threshold of a vector bench sensor (0 for the numeric
+                            ///  one).
+    size_t recordBytes;     ///< Record size limit from the start of the outage (0 = unlimited).
+}
+Options_t;
+
+/// Results of a run, passed back from the child process that ran it.
+typedef struct
+{
+    uint64_t sampleCount;   ///< Samples pushed into the Data Hub.
+    double virtualSeconds;  ///< Length of the workload (seconds of virtual time).
+    double wallSeconds;     ///< Real time the run took (seconds).
+    double cpuSeconds;      ///< CPU time the run took (seconds).
+    double cpuPerSample;    ///< avPublisher's own CpuPerSample metric for the bench sensor (us).
+    double received;        ///< Samples avPublisher received.
+    double pushed;          ///< Samples avPublisher delivered.
+    double backlogMid;      ///< Largest BacklogSeconds halfway through the workload.
+    double backlogEnd;      ///< Largest BacklogSeconds at the end of the workload.
+    double drainSeconds;    ///< Time from the end of the workload until the backlog drained.
+    bool isDrained;         ///< true if the backlog drained within MAX_DRAIN_SECONDS.
+    uint64_t keptCount;     ///< Samples that change-by filtering keeps (vector bench sensor only).
+    hostAv_Stats_t avStats; ///< AirVantage stub's totals.
+}
+Result_t;
+
+/// Sample to push into the Data Hub.
+typedef struct
+{
+    double timestamp;
+    char obsPath[DHUBADMIN_MAX_RESOURCE_PATH_LEN + 1];
+    char value[MAX_TRACE_LINE_BYTES];
+    bool isString;          ///< true to push the value as a string, even if it reads as a number.
+}
+Sample_t;
+
+/// Source of the samples of a run.
+typedef struct
+{
+    FILE* traceFile;        ///< Trace being replayed (NULL if the workload is generated).
+    double traceStart;      ///< Timestamp of the trace's first sample.
+    double speed;
+    double rate;
+    double duration;
+    double start;           ///< Virtual time the workload starts at.
+    uint64_t index;         ///< Number of samples produced so far.
+    uint64_t lineCount;     ///< Number of trace lines read so far.
+    double changeBy;        ///< Change-by threshold of the vector workload (0 for a numeric one).
+    double reference[VECTOR_FIELD_COUNT]; ///< Last sample that change-by filtering kept.
+    uint64_t keptCount;     ///< Number of samples that change-by filtering kept so far.
+}
+Workload_t;
+
+/// Entries in the config tree for the bench sensor.
+static const char* const BenchConfig[][2] =
+{
+    { "sensors/" BENCH_SENSOR "/type", "numeric" },
+    { "sensors/" BENCH_SENSOR "/input", "/app/bench/value" },
+    { "sensors/" BENCH_SENSOR "/priority", "high" },
+    { "sensors/" BENCH_SENSOR "/compactAvPath", "Bench.Backlog" },
+    { "sensors/" BENCH_SENSOR "/fields/0/avPath", "Bench.Value" },
+    { "sensors/" BENCH_SENSOR "/fields/0/resolution", "-2" },
+};
+
+/// Entries in the config tree for the vector bench sensor (its changeBy is set separately).
+static const char* const VectorBenchConfig[][2] =
+{
+    { "sensors/" BENCH_SENSOR "/type", "vector" },
+    { "sensors/" BENCH_SENSOR "/input", "/app/bench/value" },
+    { "sensors/" BENCH_SENSOR "/priority", "high" },
+    { "sensors/" BENCH_SENSOR "/compactAvPath", "Bench.Backlog" },
+    { "sensors/" BENCH_SENSOR "/fields/0/avPath", "Bench.X" },
+    { "sensors/" BENCH_SENSOR "/fields/0/resolution", "-2" },
+    { "sensors/" BENCH_SENSOR "/fields/1/avPath", "Bench.Y" },
+    { "sensors/" BENCH_SENSOR "/fields/1/resolution", "-2" },
+    { "sensors/" BENCH_SENSOR "/fields/2/avPath", "Bench.Z" },
+    { "sensors/" BENCH_SENSOR "/fields/2/resolution", "-2" },
+};
+
+/// Component initializers (see COMPONENT_INIT_NAME in legato.h).
+void _packedVector_COMPONENT_INIT(void);
+void _columnCodec_COMPONENT_INIT(void);
+void _sampleQueue_COMPONENT_INIT(void);
+void _avPublisher_COMPONENT_INIT(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a clock's time.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetClock
+(
+    clockid_t clockId
+)
+{
+    struct timespec now;
+
+    LE_ASSERT(clock_gettime(clockId, &now) == 0);
+
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a file or directory, for nftw().
+ *
+ * @return 0 to carry on.
+ */
+//--------------------------------------------------------------------------------------------------
+static int RemoveEntry
+(
+    const char* path,
+    const struct stat* statPtr,
+    int flag,
+    struct FTW* ftwPtr
+)
+{
+    if (remove(path) != 0)
+    {
+        LE_WARN("Failed to remove '%s' (%m).", path);
+    }
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the next sample of a workload.
+ *
+ * @return
+ *  - LE_OK if there is one.
+ *  - LE_OUT_OF_RANGE if the workload has ended.
+ *  - LE_FORMAT_ERROR if a trace line is malformed (it's skipped).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetSample
+(
+    Workload_t* workloadPtr,
+    Sample_t* samplePtr     ///< [OUT]
+)
+{
+    if (workloadPtr->traceFile == NULL)
+    {
+        if (workloadPtr->index >= (uint64_t)(workloadPtr->duration * workloadPtr->rate))
+        {
+            return LE_OUT_OF_RANGE;
+        }
+
+        // A slow swing with some noise, so consecutive values differ.
+        double t = workloadPtr->index / workloadPtr->rate;
+        samplePtr->timestamp = workloadPtr->start + t;
+        snprintf(samplePtr->obsPath, sizeof(samplePtr->obsPath), "%s", BENCH_OBS_PATH);
+        workloadPtr->index++;
+
+        if (workloadPtr->changeBy <= 0.0)
+        {
+            snprintf(samplePtr->value, sizeof(samplePtr->value), "%.2f",
+                     20.0 + (5.0 * sin(t * (2.0 * M_PI / 300.0))) + (rand() % 100) / 100.0);
+            samplePtr->isString = false;
+
+            return LE_OK;
+        }
+
+        // The same for each field of a vector, with noise of up to one and a half times the
+        // change-by threshold, so that change-by filtering drops some of the samples but not all.
+        // The last sample steps away from the others, so it's kept, and the backlog drains.
+        double values[VECTOR_FIELD_COUNT];
+        double sumOfSquares = 0.0;
+        uint64_t count = workloadPtr->duration * workloadPtr->rate;
+        double step = (workloadPtr->index == count) ? (10.0 * workloadPtr->changeBy) : 0.0;
+
+        for (size_t i = 0; i < VECTOR_FIELD_COUNT; i++)
+        {
+            values[i] = (5.0 * sin((t + (i * 20.0)) * (2.0 * M_PI / 60.0)))
+                      + (1.5 * workloadPtr->changeBy * (rand() % 100) / 100.0) + step;
+
+            double difference = values[i] - workloadPtr->reference[i];
+            sumOfSquares += difference * difference;
+        }
+
+        // Filter it the way avPublisher does (see IsWithinChangeBy()).
+        if ((workloadPtr->keptCount == 0) || !(sqrt(sumOfSquares) < workloadPtr->changeBy))
+        {
+            memcpy(workloadPtr->reference, values, sizeof(values));
+            workloadPtr->keptCount++;
+        }
+
+        le_result_t result = packedVector_Encode(values,
+                                                 VECTOR_FIELD_COUNT,
+                                                 samplePtr->value,
+                                                 sizeof(samplePtr->value));
+        LE_ASSERT_OK(result);
+        samplePtr->isString = true;
+
+        return LE_OK;
+    }
+
+    char line[MAX_TRACE_LINE_BYTES];
+    do
+    {
+        if (fgets(line, sizeof(line), workloadPtr->traceFile) == NULL)
+        {
+            return LE_OUT_OF_RANGE;
+        }
+
+        workloadPtr->lineCount++;
+        line[strcspn(line, "\r\n")] = '\0';
+    }
+    while ((line[0] == '#') || (line[0] == '\0'));
+
+    char* obsPathPtr = strchr(line, ',');
+    char* valuePtr = (obsPathPtr == NULL) ? NULL : strchr(obsPathPtr + 1, ',');
+    char* endPtr;
+    double timestamp = strtod(line, &endPtr);
+
+    if ((valuePtr == NULL) || (endPtr != obsPathPtr))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *obsPathPtr++ = '\0';
+    *valuePtr++ = '\0';
+
+    if (workloadPtr->index == 0)
+    {
+        workloadPtr->traceStart = timestamp;
+    }
+
+    samplePtr->timestamp = workloadPtr->start
+                         + ((timestamp - workloadPtr->traceStart) / workloadPtr->speed);
+    if (   (le_utf8_Copy(samplePtr->obsPath, obsPathPtr, sizeof(samplePtr->obsPath), NULL) != LE_OK)
+        || (le_utf8_Copy(samplePtr->value, valuePtr, sizeof(samplePtr->value), NULL) != LE_OK))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    samplePtr->isString = false;
+    workloadPtr->index++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a sample into the Data Hub.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushSample
+(
+    const Sample_t* samplePtr
+)
+{
+    char* endPtr;
+    double value = strtod(samplePtr->value, &endPtr);
+    le_result_t result;
+
+    if (!samplePtr->isString && (endPtr != samplePtr->value) && (*endPtr == '\0'))
+    {
+        result = hostDhub_PushNumeric(samplePtr->obsPath, samplePtr->timestamp, value);
+    }
+    else
+    {
+        result = hostDhub_PushString(samplePtr->obsPath, samplePtr->timestamp, samplePtr->value);
+    }
+
+    if (result != LE_OK)
+    {
+        LE_WARN("Nothing is observing '%s'.", samplePtr->obsPath);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the largest of the sensors' BacklogSeconds metrics.
+ *
+ * @return Seconds.
+ */
+//--------------------------------------------------------------------------------------------------
+static double GetBacklog
+(
+    void
+)
+{
+    double sum;
+    double max;
+
+    hostAv_GetTotal(METRICS_PATH, "BacklogSeconds", &sum, &max);
+
+    return max;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run avPublisher on a workload, in this process.
+ */
+//--------------------------------------------------------------------------------------------------
+static void Run
+(
+    const Options_t* optionsPtr,
+    double rate,            ///< Rate of the generated workload (samples per second).
+    double outageLength,    ///< Length of the outage (seconds, 0 for none).
+    Result_t* resultPtr     ///< [OUT]
+)
+{
+    Workload_t workload =
+    {
+        traceFile: NULL,
+        traceStart: 0.0,
+        speed: optionsPtr->speed,
+        rate: rate,
+        duration: optionsPtr->duration,
+        start: 0.0,
+        index: 0,
+        lineCount: 0,
+        changeBy: optionsPtr->changeBy,
+        reference: { 0.0 },
+        keptCount: 0,
+    };
+    char number[32];
+
+    memset(resultPtr, 0, sizeof(*resultPtr));
+
+    if (optionsPtr->tracePath != NULL)
+    {
+        workload.traceFile = fopen(optionsPtr->tracePath, "r");
+        LE_FATAL_IF(workload.traceFile == NULL,
+                    "Failed to open '%s' (%m).",
+                    optionsPtr->tracePath);
+    }
+
+    (void)nftw(QUEUE_ROOT, RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+
+    if (optionsPtr->changeBy > 0.0)
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(VectorBenchConfig); i++)
+        {
+            hostCfg_Set(VectorBenchConfig[i][0], VectorBenchConfig[i][1]);
+        }
+        snprintf(number, sizeof(number), "%.17g", optionsPtr->changeBy);
+        hostCfg_Set("sensors/" BENCH_SENSOR "/changeBy", number);
+    }
+    else
+    {
+        for (size_t i = 0; i < NUM_ARRAY_MEMBERS(BenchConfig); i++)
+        {
+            hostCfg_Set(BenchConfig[i][0], BenchConfig[i][1]);
+        }
+    }
+    if (optionsPtr->batchCount > 0)
+    {
+        snprintf(number, sizeof(number), "%d", optionsPtr->batchCount);
+        hostCfg_Set("sensors/" BENCH_SENSOR "/batchCount", number);
+    }
+    if (optionsPtr->pushWindow > 0)
+    {
+        snprintf(number, sizeof(number), "%d", optionsPtr->pushWindow);
+        hostCfg_Set("sensors/" BENCH_SENSOR "/pushWindow", number);
+    }
+
+    hostAv_SetLink(optionsPtr->latency, optionsPtr->failureRate);
+
+    double wallStart = GetClock(CLOCK_MONOTONIC);
+    double cpuStart = GetClock(CLOCK_PROCESS_CPUTIME_ID);
+
+    _packedVector_COMPONENT_INIT();
+    _columnCodec_COMPONENT_INIT();
+    _sampleQueue_COMPONENT_INIT();
+    _avPublisher_COMPONENT_INIT();
+
+    hostAv_StartSession();
+
+    // Let the sensors' setup finish before the first sample.
+    workload.start = hostLegato_GetTime() + 1.0;
+    hostLegato_RunUntil(workload.start);
+
+    double outageStart = workload.start + optionsPtr->outageStart;
+    double outageEnd = outageStart + outageLength;
+    bool isOutageOver = (outageLength <= 0.0);
+    bool isSessionUp = true;
+    double midpoint = workload.start + (optionsPtr->duration / 2.0);
+    bool isPastMidpoint = false;
+    double end = workload.start;
+    Sample_t sample;
+    le_result_t result;
+
+    while ((result = GetSample(&workload, &sample)) != LE_OUT_OF_RANGE)
+    {
+        if (result != LE_OK)
+        {
+            LE_WARN("Skipping malformed trace line %" PRIu64 ".", workload.lineCount);
+            continue;
+        }
+
+        if (!isOutageOver && isSessionUp && (sample.timestamp >= outageStart))
+        {
+            hostLegato_RunUntil(outageStart);
+            hostAv_StopSession();
+            hostAv_SetRecordLimit(optionsPtr->recordBytes);
+            isSessionUp = false;
+        }
+        if (!isOutageOver && !isSessionUp && (sample.timestamp >= outageEnd))
+        {
+            hostLegato_RunUntil(outageEnd);
+            hostAv_StartSession();
+            isSessionUp = true;
+            isOutageOver = true;
+        }
+        if (!isPastMidpoint && (sample.timestamp >= midpoint))
+        {
+            hostLegato_RunUntil(midpoint);
+            resultPtr->backlogMid = GetBacklog();
+            isPastMidpoint = true;
+        }
+
+        if (sample.timestamp > hostLegato_GetTime())
+        {
+            hostLegato_RunUntil(sample.timestamp);
+        }
+
+        PushSample(&sample);
+        resultPtr->sampleCount++;
+        end = sample.timestamp;
+    }
+
+    if (workload.traceFile != NULL)
+    {
+        fclose(workload.traceFile);
+    }
+
+    if (!isSessionUp)
+    {
+        hostAv_StartSession();
+    }
+
+    // The metrics last published before the end of the workload give its backlog at the end.
+    // Then wait for the backlog to drain.
+    resultPtr->virtualSeconds = end - workload.start;
+    resultPtr->backlogEnd = GetBacklog();
+
+    double time = end + METRICS_PERIOD;
+    hostLegato_RunUntil(time);
+    while ((GetBacklog() > 0.0) && (time < (end + MAX_DRAIN_SECONDS)))
+    {
+        time += METRICS_PERIOD;
+        hostLegato_RunUntil(time);
+    }
+
+    double dropped;
+    double max;
+
+    resultPtr->isDrained = !(GetBacklog() > 0.0);
+    resultPtr->keptCount = workload.keptCount;
+    resultPtr->drainSeconds = time - end;
+    resultPtr->wallSeconds = GetClock(CLOCK_MONOTONIC) - wallStart;
+    resultPtr->cpuSeconds = GetClock(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    hostAv_GetTotal(METRICS_PATH, "Received", &resultPtr->received, &max);
+    hostAv_GetTotal(METRICS_PATH, "Pushed", &resultPtr->pushed, &max);
+    hostAv_GetTotal(METRICS_PATH, "Dropped", &dropped, &max);
+    (void)le_avdata_GetFloat(METRICS_PATH "/" BENCH_SENSOR "/CpuPerSample",
+                             &resultPtr->cpuPerSample);
+    hostAv_GetStats(&resultPtr->avStats);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run avPublisher on a workload, in a child process.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FAULT if the child process failed.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunInChild
+(
+    const Options_t* optionsPtr,
+    double rate,
+    double outageLength,
+    Result_t* resultPtr     ///< [OUT]
+)
+{
+    int fds[2];
+
+    LE_ASSERT(pipe(fds) == 0);
+    fflush(NULL);
+
+    pid_t pid = fork();
+    LE_ASSERT(pid >= 0);
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        Run(optionsPtr, rate, outageLength, resultPtr);
+        _exit(write(fds[1], resultPtr, sizeof(*resultPtr)) == sizeof(*resultPtr) ? 0 : 1);
+    }
+
+    close(fds[1]);
+
+    ssize_t readCount = read(fds[0], resultPtr, sizeof(*resultPtr));
+    int status;
+
+    close(fds[0]);
+    LE_ASSERT(waitpid(pid, &status, 0) == pid);
+
+    if ((readCount != sizeof(*resultPtr)) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+    {
+        LE_ERROR("Run at %g samples/s failed.", rate);
+        return LE_FAULT;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Print the results of a run.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrintResult
+(
+    const char* name,
+    const Result_t* resultPtr
+)
+{
+    double samples = (resultPtr->sampleCount == 0) ? 1.0 : resultPtr->sampleCount;
+
+    printf("%s:\n", name);
+    printf("    samples            %" PRIu64 " over %.0f s (%.2f samples/s)\n",
+           resultPtr->sampleCount,
+           resultPtr->virtualSeconds,
+           (resultPtr->virtualSeconds > 0.0) ? (resultPtr->sampleCount / resultPtr->virtualSeconds)
+                                             : 0.0);
+    printf("    delivered          %.0f of %.0f received\n",
+           resultPtr->pushed,
+           resultPtr->received);
+    printf("    pushes/sample      %.4f (%" PRIu64 " pushes, %" PRIu64 " failed)\n",
+           resultPtr->avStats.pushCount / samples,
+           resultPtr->avStats.pushCount,
+           resultPtr->avStats.failedCount);
+    printf("    bytes/sample       %.1f\n", resultPtr->avStats.byteCount / samples);
+    printf("    CPU/sample         %.2f us (avPublisher's own: %.2f us)\n",
+           (resultPtr->cpuSeconds * 1e6) / samples,
+           resultPtr->cpuPerSample);
+    printf("    backlog            %.1f s halfway, %.1f s at the end\n",
+           resultPtr->backlogMid,
+           resultPtr->backlogEnd);
+    printf("    drained            %s, %.0f s after the end\n",
+           resultPtr->isDrained ? "yes" : "NO",
+           resultPtr->drainSeconds);
+    printf("    wall time          %.2f s\n", resultPtr->wallSeconds);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Print the usage message.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrintUsage
+(
+    const char* programName
+)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTION]...\n"
+            "  --trace FILE           replay a trace of \"timestamp,obsPath,value\" lines\n"
+            "  --speed X              replay the trace X times faster (default 1)\n"
+            "  --rate R               generate R samples/s (default 10)\n"
+            "  --duration S           generate S seconds of samples (default 3600; with\n"
+            "                         --trace, only used to place the outage)\n"
+            "  --latency S            acknowledge pushes after S seconds (default 0.5)\n"
+            "  --failure-rate F       fail a fraction F of the pushes (default 0)\n"
+            "  --outage-start S       start the outage S seconds in (default duration / 3)\n"
+            "  --outage-length S      take the session down for S seconds (default duration / 6)\n"
+            "  --max-rate R           sweep the rate up to R samples/s (default 1000, 0 = skip)\n"
+            "  --batch-count N        bench sensor's batch count\n"
+            "  --push-window N        bench sensor's push window\n"
+            "  --help                 print this message\n",
+            programName);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the options.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_BAD_PARAMETER if they're invalid.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseOptions
+(
+    int argc,
+    char* argv[],
+    Options_t* optionsPtr   ///< [OUT]
+)
+{
+    static const struct option longOptions[] =
+    {
+        { "trace", required_argument, NULL, 't' },
+        { "speed", required_argument, NULL, 's' },
+        { "rate", required_argument, NULL, 'r' },
+        { "duration", required_argument, NULL, 'd' },
+        { "latency", required_argument, NULL, 'l' },
+        { "failure-rate", required_argument, NULL, 'f' },
+        { "outage-start", required_argument, NULL, 'o' },
+        { "outage-length", required_argument, NULL, 'O' },
+        { "max-rate", required_argument, NULL, 'm' },
+        { "batch-count", required_argument, NULL, 'b' },
+        { "push-window", required_argument, NULL, 'w' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    *optionsPtr = (Options_t)
+    {
+        tracePath: NULL,
+        speed: 1.0,
+        rate: 10.0,
+        duration: 3600.0,
+        latency: 0.5,
+        failureRate: 0.0,
+        outageStart: -1.0,
+        outageLength: -1.0,
+        maxRate: 1000.0,
+        batchCount: 0,
+        pushWindow: 0,
+        changeBy: 0.0,
+        recordBytes: 0,
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "", longOptions, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 't': optionsPtr->tracePath = optarg; break;
+            case 's': optionsPtr->speed = atof(optarg); break;
+            case 'r': optionsPtr->rate = atof(optarg); break;
+            case 'd': optionsPtr->duration = atof(optarg); break;
+            case 'l': optionsPtr->latency = atof(optarg); break;
+            case 'f': optionsPtr->failureRate = atof(optarg); break;
+            case 'o': optionsPtr->outageStart = atof(optarg); break;
+            case 'O': optionsPtr->outageLength = atof(optarg); break;
+            case 'm': optionsPtr->maxRate = atof(optarg); break;
+            case 'b': optionsPtr->batchCount = atoi(optarg); break;
+            case 'w': optionsPtr->pushWindow = atoi(optarg); break;
+            default: return LE_BAD_PARAMETER;
+        }
+    }
+
+    if (   (optind != argc)
+        || !(optionsPtr->speed > 0.0)
+        || !(optionsPtr->rate > 0.0)
+        || !(optionsPtr->duration > 0.0)
+        || (optionsPtr->latency < 0.0)
+        || (optionsPtr->failureRate < 0.0)
+        || (optionsPtr->failureRate > 1.0))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    if (optionsPtr->outageStart < 0.0)
+    {
+        optionsPtr->outageStart = optionsPtr->duration / 3.0;
+    }
+    if (optionsPtr->outageLength < 0.0)
+    {
+        optionsPtr->outageLength = optionsPtr->duration / 6.0;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the scenarios.
+ *
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if a run failed or a backlog didn't drain.
+ */
+//--------------------------------------------------------------------------------------------------
+int main
+(
+    int argc,
+    char* argv[]
+)
+{
+    Options_t options;
+    Result_t result;
+    bool isOk = true;
+
+    if (ParseOptions(argc, argv, &options) != LE_OK)
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (getenv("HOST_LOG_LEVEL") == NULL)
+    {
+        hostLegato_SetLogLevel(LE_LOG_ERR);
+    }
+
+    printf("latency %.3f s, failure rate %.3f\n", options.latency, options.failureRate);
+
+    if (RunInChild(&options, options.rate, 0.0, &result) != LE_OK)
+    {
+        return EXIT_FAILURE;
+    }
+    PrintResult(options.tracePath != NULL ? "steady (trace)" : "steady", &result);
+    isOk = isOk && result.isDrained;
+
+    if (options.outageLength > 0.0)
+    {
+        if (RunInChild(&options, options.rate, options.outageLength, &result) != LE_OK)
+        {
+            return EXIT_FAILURE;
+        }
+        printf("outage of %.0f s, %.0f s in\n", options.outageLength, options.outageStart);
+        PrintResult("outage", &result);
+        isOk = isOk && result.isDrained;
+    }
+
+    if (options.maxRate > 0.0)
+    {
+        // The sweep always uses the generated workload.
+        Options_t sweepOptions = options;
+        double sustainedRate = 0.0;
+
+        sweepOptions.tracePath = NULL;
+
+        printf("sweep:\n");
+        for (double rate = options.rate; rate <= options.maxRate; rate *= 2.0)
+        {
+            if (RunInChild(&sweepOptions, rate, 0.0, &result) != LE_OK)
+            {
+                return EXIT_FAILURE;
+            }
+
+            bool isSustained = (result.backlogEnd <= SUSTAINED_BACKLOG_SECONDS)
+                            || (result.backlogEnd <= result.backlogMid);
+
+            printf("    %8.1f samples/s: backlog %.1f s -> %.1f s, %.4f pushes/sample, "
+                   "%.2f us CPU/sample%s\n",
+                   rate,
+                   result.backlogMid,
+                   result.backlogEnd,
+                   result.avStats.pushCount / (double)result.sampleCount,
+                   (result.cpuSeconds * 1e6) / result.sampleCount,
+                   isSustained ? "" : " (backlog growing)");
+
+            if (!isSustained)
+            {
+                break;
+            }
+            sustainedRate = rate;
+        }
+
+        printf("    max sustained rate %.1f samples/s\n", sustainedRate);
+    }
+
+    // The change-by overflow scenario always uses its own generated workload.
+    Options_t overflowOptions = options;
+
+    overflowOptions.tracePath = NULL;
+    overflowOptions.duration = OVERFLOW_DURATION;
+    overflowOptions.failureRate = 0.0;
+    overflowOptions.outageStart = OVERFLOW_OUTAGE_START;
+    overflowOptions.changeBy = OVERFLOW_CHANGE_BY;
+    overflowOptions.recordBytes = OVERFLOW_RECORD_BYTES;
+
+    if (RunInChild(&overflowOptions, OVERFLOW_RATE, OVERFLOW_OUTAGE_LENGTH, &result) != LE_OK)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("change-by %g, records of %d bytes after an outage of %.0f s, %.0f s in\n",
+           OVERFLOW_CHANGE_BY,
+           OVERFLOW_RECORD_BYTES,
+           OVERFLOW_OUTAGE_LENGTH,
+           OVERFLOW_OUTAGE_START);
+    PrintResult("change-by overflow", &result);
+    printf("    change-by keeps    %" PRIu64 "%s\n",
+           result.keptCount,
+           (result.pushed == result.keptCount) ? "" : " (MISMATCH)");
+    isOk = isOk && result.isDrained && (result.pushed == result.keptCount);
+
+    return isOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1298 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file hostLegato.c
+ *
+ * Host stand-in for the parts of the Legato framework that the components use.  See legato.h and
+ * hostLegato.h.
+ *
+ * The timers and the functions scheduled by the service stubs share one queue of events, ordered
+ * by due time (and by the order they were scheduled in, for those due at the same time).  A timer
+ * that is stopped or restarted leaves its old event in the queue; the timer's generation number
+ * tells that it's stale when it comes up.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "hostLegato.h"
+
+/// Virtual clock time when the tests start, unless they set it (seconds since the Epoch).
+#define DEFAULT_START_TIME 1600000000.0
+
+/// How long the device has been up when the tests start (seconds).
+#define UPTIME_AT_START 100.0
+
+/// Maximum number of functions waiting in the queue of deferred functions.
+#define MAX_DEFERRED_COUNT 1024
+
+/// Header in front of each object allocated from a memory pool.
+typedef union
+{
+    size_t refCount;
+    long double alignment;      ///< Keeps the object after the header aligned for any type.
+    void* alignmentPtr;
+    long long alignmentInt;
+}
+ObjHeader_t;
+
+/// A memory pool.  Objects are allocated from the heap, one by one.
+struct le_mem_Pool
+{
+    size_t objSize;
+};
+
+/// A timer.
+struct le_timer
+{
+    char name[32];
+    le_timer_ExpiryHandler_t handlerFunc;
+    void* contextPtr;
+    uint32_t intervalMs;
+    uint32_t repeatCount;   ///< Number of times to expire once started (0 = forever).
+    uint32_t expiryCount;   ///< Number of times it has expired since it was started.
+    bool isRunning;
+    double expiryTime;      ///< When it's due to expire next, if it's running.
+    uint64_t generation;    ///< Incremented on each start and stop, to spot stale events.
+};
+
+/// An event in the queue: a timer expiry or a scheduled function call.
+typedef struct
+{
+    double time;            ///< When it's due.
+    uint64_t seq;           ///< Order it was scheduled in.
+    le_timer_Ref_t timerRef; ///< Timer that expires (NULL for a function call).
+    uint64_t generation;    ///< Generation of the timer when the event was queued.
+    hostLegato_Func_t func; ///< Function to call (timerRef == NULL only).
+    void* contextPtr;
+}
+Event_t;
+
+/// A deferred function call (see le_event_QueueFunction()).
+typedef struct
+{
+    le_event_DeferredFunc_t func;
+    void* param1Ptr;
+    void* param2Ptr;
+}
+DeferredCall_t;
+
+/// A thread.  Only the main thread can be run.
+struct le_thread
+{
+    char name[32];
+    le_thread_MainFunc_t mainFunc;
+};
+
+/// A semaphore.
+struct le_sem
+{
+    int32_t count;
+};
+
+static double Now = DEFAULT_START_TIME;
+static double BootTime = DEFAULT_START_TIME - UPTIME_AT_START;
+
+/// Binary min-heap of events, ordered by time then sequence number.
+static Event_t* Events = NULL;
+static size_t EventCount = 0;
+static size_t EventCapacity = 0;
+static uint64_t NextSeq = 0;
+
+/// Circular queue of deferred function calls.
+static DeferredCall_t DeferredCalls[MAX_DEFERRED_COUNT];
+static size_t DeferredHead = 0;
+static size_t DeferredCount = 0;
+
+static struct le_thread MainThread = { name: "main", mainFunc: NULL };
+
+static le_log_Level_t LogLevel = LE_LOG_WARN;
+static bool IsLogLevelSet = false;
+
+/// State of the random number generator (xorshift64), fixed so runs can be repeated.
+static uint64_t RandomState = 0x9e3779b97f4a7c15ull;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether one event is due before another.
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsBefore
+(
+    const Event_t* aPtr,
+    const Event_t* bPtr
+)
+{
+    return (aPtr->time < bPtr->time) || ((aPtr->time == bPtr->time) && (aPtr->seq < bPtr->seq));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an event to the queue.
+ */
+//--------------------------------------------------------------------------------------------------
+static void PushEvent
+(
+    Event_t event
+)
+{
+    if (EventCount == EventCapacity)
+    {
+        EventCapacity = (EventCapacity == 0) ? 64 : (EventCapacity * 2);
+        Events = realloc(Events, EventCapacity * sizeof(Event_t));
+        LE_ASSERT(Events != NULL);
+    }
+
+    event.seq = NextSeq++;
+
+    size_t i = EventCount++;
+    while ((i > 0) && IsBefore(&event, &Events[(i - 1) / 2]))
+    {
+        Events[i] = Events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    Events[i] = event;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the earliest event from the queue.
+ */
+//--------------------------------------------------------------------------------------------------
+static Event_t PopEvent
+(
+    void
+)
+{
+    Event_t first = Events[0];
+    Event_t last = Events[--EventCount];
+
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = (2 * i) + 1;
+        if (child >= EventCount)
+        {
+            break;
+        }
+        if (((child + 1) < EventCount) && IsBefore(&Events[child + 1], &Events[child]))
+        {
+            child++;
+        }
+        if (!IsBefore(&Events[child], &last))
+        {
+            break;
+        }
+        Events[i] = Events[child];
+        i = child;
+    }
+    if (EventCount > 0)
+    {
+        Events[i] = last;
+    }
+
+    return first;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a running timer's next expiry.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ArmTimer
+(
+    le_timer_Ref_t timerRef,
+    double expiryTime
+)
+{
+    timerRef->expiryTime = expiryTime;
+    PushEvent((Event_t){
+        time: expiryTime,
+        timerRef: timerRef,
+        generation: timerRef->generation,
+        func: NULL,
+        contextPtr: NULL
+    });
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run one event that has come up.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunEvent
+(
+    const Event_t* eventPtr
+)
+{
+    le_timer_Ref_t timerRef = eventPtr->timerRef;
+
+    if (timerRef == NULL)
+    {
+        eventPtr->func(eventPtr->contextPtr);
+        return;
+    }
+
+    if (!timerRef->isRunning || (eventPtr->generation != timerRef->generation))
+    {
+        return;
+    }
+
+    timerRef->expiryCount++;
+    if ((timerRef->repeatCount != 0) && (timerRef->expiryCount >= timerRef->repeatCount))
+    {
+        timerRef->isRunning = false;
+        timerRef->generation++;
+    }
+    else
+    {
+        ArmTimer(timerRef, timerRef->expiryTime + (timerRef->intervalMs / 1000.0));
+    }
+
+    if (timerRef->handlerFunc != NULL)
+    {
+        timerRef->handlerFunc(timerRef);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run all the deferred function calls, including those queued by the ones being run.
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunDeferredCalls
+(
+    void
+)
+{
+    while (DeferredCount > 0)
+    {
+        DeferredCall_t call = DeferredCalls[DeferredHead];
+
+        DeferredHead = (DeferredHead + 1) % MAX_DEFERRED_COUNT;
+        DeferredCount--;
+
+        call.func(call.param1Ptr, call.param2Ptr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a time in seconds to an le_clk_Time_t.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_clk_Time_t ToClkTime
+(
+    double time
+)
+{
+    double sec = floor(time);
+
+    return (le_clk_Time_t){ sec: (time_t)sec, usec: (long)((time - sec) * 1000000.0) };
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the virtual clock.  Only used before anything has been scheduled on it.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_SetTime
+(
+    double time             ///< Seconds since the Epoch.
+)
+{
+    LE_ASSERT(EventCount == 0);
+
+    Now = time;
+    BootTime = time - UPTIME_AT_START;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the virtual clock.
+ *
+ * @return Seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+double hostLegato_GetTime
+(
+    void
+)
+{
+    return Now;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call a function when the virtual clock reaches a given time, like a one-shot timer.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_Schedule
+(
+    double delay,           ///< Seconds from now.
+    hostLegato_Func_t func,
+    void* contextPtr
+)
+{
+    PushEvent((Event_t){
+        time: Now + ((delay > 0.0) ? delay : 0.0),
+        timerRef: NULL,
+        generation: 0,
+        func: func,
+        contextPtr: contextPtr
+    });
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the queued functions, then the timers and scheduled functions that are due, in order,
+ * moving the virtual clock up to each one, until there's nothing left to do before a given time.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_RunUntil
+(
+    double time             ///< Seconds since the Epoch.
+)
+{
+    for (;;)
+    {
+        RunDeferredCalls();
+
+        if ((EventCount == 0) || (Events[0].time > time))
+        {
+            break;
+        }
+
+        Event_t event = PopEvent();
+        if (event.time > Now)
+        {
+            Now = event.time;
+        }
+
+        RunEvent(&event);
+    }
+
+    if (time > Now)
+    {
+        Now = time;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lowest level of log messages written to stderr.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_SetLogLevel
+(
+    le_log_Level_t level
+)
+{
+    LogLevel = level;
+    IsLogLevelSet = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a result code.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* le_result_ToString
+(
+    le_result_t result
+)
+{
+    static const char* const names[] =
+    {
+        "LE_OK", "LE_NOT_FOUND", "LE_NOT_POSSIBLE", "LE_OUT_OF_RANGE", "LE_NO_MEMORY",
+        "LE_NOT_PERMITTED", "LE_FAULT", "LE_COMM_ERROR", "LE_TIMEOUT", "LE_OVERFLOW",
+        "LE_UNDERFLOW", "LE_WOULD_BLOCK", "LE_DEADLOCK", "LE_FORMAT_ERROR", "LE_DUPLICATE",
+        "LE_BAD_PARAMETER", "LE_CLOSED", "LE_BUSY", "LE_UNSUPPORTED", "LE_IO_ERROR",
+        "LE_NOT_IMPLEMENTED", "LE_UNAVAILABLE", "LE_TERMINATED", "LE_IN_PROGRESS",
+    };
+
+    if ((result > 0) || ((size_t)-result >= NUM_ARRAY_MEMBERS(names)))
+    {
+        return "(unknown)";
+    }
+
+    return names[-result];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a log message to stderr, if it's at or above the log level.
+ */
+//--------------------------------------------------------------------------------------------------
+void _le_log_Send
+(
+    le_log_Level_t level,
+    const char* fileName,
+    unsigned int line,
+    const char* format,
+    ...
+)
+{
+    static const char* const levelNames[] = { "DBUG", "INFO", "WARN", "ERR ", "CRT ", "EMR " };
+
+    if (!IsLogLevelSet)
+    {
+        const char* envLevel = getenv("HOST_LOG_LEVEL");
+
+        if (envLevel != NULL)
+        {
+            LogLevel = (strcmp(envLevel, "debug") == 0) ? LE_LOG_DEBUG
+                     : (strcmp(envLevel, "info") == 0) ? LE_LOG_INFO
+                     : (strcmp(envLevel, "error") == 0) ? LE_LOG_ERR
+                     : LE_LOG_WARN;
+        }
+        IsLogLevelSet = true;
+    }
+
+    if (level < LogLevel)
+    {
+        return;
+    }
+
+    const char* baseName = strrchr(fileName, '/');
+
+    fprintf(stderr, "%.3f %s | %s:%u | ",
+            Now, levelNames[level], (baseName != NULL) ? (baseName + 1) : fileName, line);
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    fputc('\n', stderr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the absolute time (the virtual clock).
+ */
+//--------------------------------------------------------------------------------------------------
+le_clk_Time_t le_clk_GetAbsoluteTime
+(
+    void
+)
+{
+    return ToClkTime(Now);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time since boot (on the virtual clock).
+ */
+//--------------------------------------------------------------------------------------------------
+le_clk_Time_t le_clk_GetRelativeTime
+(
+    void
+)
+{
+    return ToClkTime(Now - BootTime);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a memory pool.
+ */
+//--------------------------------------------------------------------------------------------------
+le_mem_PoolRef_t le_mem_CreatePool
+(
+    const char* name,
+    size_t objSize
+)
+{
+    le_mem_PoolRef_t pool = malloc(sizeof(*pool));
+
+    LE_ASSERT(pool != NULL);
+    pool->objSize = objSize;
+
+    return pool;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Expand a memory pool.  There's nothing to do, as objects come from the heap.
+ */
+//--------------------------------------------------------------------------------------------------
+le_mem_PoolRef_t le_mem_ExpandPool
+(
+    le_mem_PoolRef_t pool,
+    size_t numObjects
+)
+{
+    return pool;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate an object from a pool, or return NULL if there's no memory left.
+ */
+//--------------------------------------------------------------------------------------------------
+void* le_mem_TryAlloc
+(
+    le_mem_PoolRef_t pool
+)
+{
+    ObjHeader_t* headerPtr = malloc(sizeof(ObjHeader_t) + pool->objSize);
+
+    if (headerPtr == NULL)
+    {
+        return NULL;
+    }
+
+    headerPtr->refCount = 1;
+
+    return headerPtr + 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Allocate an object from a pool.
+ */
+//--------------------------------------------------------------------------------------------------
+void* le_mem_ForceAlloc
+(
+    le_mem_PoolRef_t pool
+)
+{
+    void* objPtr = le_mem_TryAlloc(pool);
+
+    LE_ASSERT(objPtr != NULL);
+
+    return objPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a reference to an object.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_mem_AddRef
+(
+    void* objPtr
+)
+{
+    ((ObjHeader_t*)objPtr - 1)->refCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Release a reference to an object, freeing it when there are none left.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_mem_Release
+(
+    void* objPtr
+)
+{
+    ObjHeader_t* headerPtr = (ObjHeader_t*)objPtr - 1;
+
+    LE_ASSERT(headerPtr->refCount > 0);
+
+    if (--headerPtr->refCount == 0)
+    {
+        free(headerPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a link to the end of a list.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_dls_Queue
+(
+    le_dls_List_t* listPtr,
+    le_dls_Link_t* newLinkPtr
+)
+{
+    le_dls_Link_t* headPtr = listPtr->headLinkPtr;
+
+    if (headPtr == NULL)
+    {
+        newLinkPtr->nextPtr = newLinkPtr;
+        newLinkPtr->prevPtr = newLinkPtr;
+        listPtr->headLinkPtr = newLinkPtr;
+        return;
+    }
+
+    newLinkPtr->nextPtr = headPtr;
+    newLinkPtr->prevPtr = headPtr->prevPtr;
+    headPtr->prevPtr->nextPtr = newLinkPtr;
+    headPtr->prevPtr = newLinkPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a link to the start of a list.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_dls_Stack
+(
+    le_dls_List_t* listPtr,
+    le_dls_Link_t* newLinkPtr
+)
+{
+    le_dls_Queue(listPtr, newLinkPtr);
+    listPtr->headLinkPtr = newLinkPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a link from a list.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_dls_Remove
+(
+    le_dls_List_t* listPtr,
+    le_dls_Link_t* linkToRemovePtr
+)
+{
+    if (linkToRemovePtr->nextPtr == linkToRemovePtr)
+    {
+        listPtr->headLinkPtr = NULL;
+    }
+    else
+    {
+        linkToRemovePtr->prevPtr->nextPtr = linkToRemovePtr->nextPtr;
+        linkToRemovePtr->nextPtr->prevPtr = linkToRemovePtr->prevPtr;
+
+        if (listPtr->headLinkPtr == linkToRemovePtr)
+        {
+            listPtr->headLinkPtr = linkToRemovePtr->nextPtr;
+        }
+    }
+
+    *linkToRemovePtr = LE_DLS_LINK_INIT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove the first link from a list.
+ *
+ * @return The link, or NULL if the list is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+le_dls_Link_t* le_dls_Pop
+(
+    le_dls_List_t* listPtr
+)
+{
+    le_dls_Link_t* linkPtr = listPtr->headLinkPtr;
+
+    if (linkPtr != NULL)
+    {
+        le_dls_Remove(listPtr, linkPtr);
+    }
+
+    return linkPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the first link of a list.
+ *
+ * @return The link, or NULL if the list is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+le_dls_Link_t* le_dls_Peek
+(
+    const le_dls_List_t* listPtr
+)
+{
+    return listPtr->headLinkPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the link after a given one in a list.
+ *
+ * @return The link, or NULL if the given one is the last.
+ */
+//--------------------------------------------------------------------------------------------------
+le_dls_Link_t* le_dls_PeekNext
+(
+    const le_dls_List_t* listPtr,
+    const le_dls_Link_t* currentLinkPtr
+)
+{
+    return (currentLinkPtr->nextPtr == listPtr->headLinkPtr) ? NULL : currentLinkPtr->nextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a list is empty.
+ */
+//--------------------------------------------------------------------------------------------------
+bool le_dls_IsEmpty
+(
+    const le_dls_List_t* listPtr
+)
+{
+    return (listPtr->headLinkPtr == NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count the links in a list.
+ */
+//--------------------------------------------------------------------------------------------------
+size_t le_dls_NumLinks
+(
+    const le_dls_List_t* listPtr
+)
+{
+    size_t count = 0;
+
+    for (const le_dls_Link_t* linkPtr = le_dls_Peek(listPtr);
+         linkPtr != NULL;
+         linkPtr = le_dls_PeekNext(listPtr, linkPtr))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a timer.  It's a one-shot timer with a zero interval until told otherwise.
+ */
+//--------------------------------------------------------------------------------------------------
+le_timer_Ref_t le_timer_Create
+(
+    const char* nameStr
+)
+{
+    le_timer_Ref_t timerRef = calloc(1, sizeof(*timerRef));
+
+    LE_ASSERT(timerRef != NULL);
+    (void)le_utf8_Copy(timerRef->name, nameStr, sizeof(timerRef->name), NULL);
+    timerRef->repeatCount = 1;
+
+    return timerRef;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a timer.  Its stale events are left behind, so it's never freed.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_timer_Delete
+(
+    le_timer_Ref_t timerRef
+)
+{
+    le_timer_Stop(timerRef);
+    timerRef->handlerFunc = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the function called when a timer expires.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_SetHandler
+(
+    le_timer_Ref_t timerRef,
+    le_timer_ExpiryHandler_t handlerFunc
+)
+{
+    timerRef->handlerFunc = handlerFunc;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a timer's interval.  A running timer is restarted with the new interval.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_SetMsInterval
+(
+    le_timer_Ref_t timerRef,
+    uint32_t interval
+)
+{
+    timerRef->intervalMs = interval;
+
+    if (timerRef->isRunning)
+    {
+        le_timer_Stop(timerRef);
+        le_timer_Start(timerRef);
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of times a timer expires once started (0 = forever).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_SetRepeat
+(
+    le_timer_Ref_t timerRef,
+    uint32_t repeatCount
+)
+{
+    timerRef->repeatCount = repeatCount;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the context pointer of a timer.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_SetContextPtr
+(
+    le_timer_Ref_t timerRef,
+    void* contextPtr
+)
+{
+    timerRef->contextPtr = contextPtr;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the context pointer of a timer.
+ */
+//--------------------------------------------------------------------------------------------------
+void* le_timer_GetContextPtr
+(
+    le_timer_Ref_t timerRef
+)
+{
+    return timerRef->contextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a timer.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_BUSY if it's already running.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_Start
+(
+    le_timer_Ref_t timerRef
+)
+{
+    if (timerRef->isRunning)
+    {
+        return LE_BUSY;
+    }
+
+    timerRef->isRunning = true;
+    timerRef->expiryCount = 0;
+    timerRef->generation++;
+    ArmTimer(timerRef, Now + (timerRef->intervalMs / 1000.0));
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop a timer.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_FAULT if it wasn't running.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_timer_Stop
+(
+    le_timer_Ref_t timerRef
+)
+{
+    if (!timerRef->isRunning)
+    {
+        return LE_FAULT;
+    }
+
+    timerRef->isRunning = false;
+    timerRef->generation++;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a timer is running.
+ */
+//--------------------------------------------------------------------------------------------------
+bool le_timer_IsRunning
+(
+    le_timer_Ref_t timerRef
+)
+{
+    return timerRef->isRunning;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a thread.  It can't be started on the host.
+ */
+//--------------------------------------------------------------------------------------------------
+le_thread_Ref_t le_thread_Create
+(
+    const char* name,
+    le_thread_MainFunc_t mainFunc,
+    void* contextPtr
+)
+{
+    le_thread_Ref_t threadRef = calloc(1, sizeof(*threadRef));
+
+    LE_ASSERT(threadRef != NULL);
+    (void)le_utf8_Copy(threadRef->name, name, sizeof(threadRef->name), NULL);
+    threadRef->mainFunc = mainFunc;
+
+    return threadRef;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a thread.  Not supported on the host: everything runs on the main thread.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_thread_Start
+(
+    le_thread_Ref_t threadRef
+)
+{
+    LE_FATAL("Thread '%s' can't be started on the host.", threadRef->name);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the calling thread (always the main thread).
+ */
+//--------------------------------------------------------------------------------------------------
+le_thread_Ref_t le_thread_GetCurrent
+(
+    void
+)
+{
+    return &MainThread;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a function to be called from the event loop.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_event_QueueFunction
+(
+    le_event_DeferredFunc_t func,
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    LE_FATAL_IF(DeferredCount == MAX_DEFERRED_COUNT, "Too many deferred function calls.");
+
+    DeferredCalls[(DeferredHead + DeferredCount) % MAX_DEFERRED_COUNT] = (DeferredCall_t){
+        func: func,
+        param1Ptr: param1Ptr,
+        param2Ptr: param2Ptr
+    };
+    DeferredCount++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a function to be called from a thread's event loop (only the main thread's, on the host).
+ */
+//--------------------------------------------------------------------------------------------------
+void le_event_QueueFunctionToThread
+(
+    le_thread_Ref_t thread,
+    le_event_DeferredFunc_t func,
+    void* param1Ptr,
+    void* param2Ptr
+)
+{
+    LE_ASSERT(thread == &MainThread);
+
+    le_event_QueueFunction(func, param1Ptr, param2Ptr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a thread's event loop.  Only threads other than the main thread call this, and they can't
+ * be started on the host.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_event_RunLoop
+(
+    void
+)
+{
+    LE_FATAL("The event loop is driven by hostLegato_RunUntil() on the host.");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a semaphore.
+ */
+//--------------------------------------------------------------------------------------------------
+le_sem_Ref_t le_sem_Create
+(
+    const char* name,
+    int32_t initialCount
+)
+{
+    le_sem_Ref_t semaphorePtr = malloc(sizeof(*semaphorePtr));
+
+    LE_ASSERT(semaphorePtr != NULL);
+    semaphorePtr->count = initialCount;
+
+    return semaphorePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete a semaphore.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_sem_Delete
+(
+    le_sem_Ref_t semaphorePtr
+)
+{
+    free(semaphorePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait on a semaphore.  With only one thread, waiting on one that isn't posted never ends.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_sem_Wait
+(
+    le_sem_Ref_t semaphorePtr
+)
+{
+    LE_FATAL_IF(semaphorePtr->count <= 0, "Waiting on a semaphore would block forever.");
+
+    semaphorePtr->count--;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Post a semaphore.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_sem_Post
+(
+    le_sem_Ref_t semaphorePtr
+)
+{
+    semaphorePtr->count++;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Block a signal, so that it can be taken by an event handler.  Does nothing on the host.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_sig_Block
+(
+    int sigNum
+)
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the handler of a blocked signal.  Signals aren't delivered on the host, so it's never
+ * called.
+ */
+//--------------------------------------------------------------------------------------------------
+void le_sig_SetEventHandler
+(
+    int sigNum,
+    le_sig_EventHandlerFunc_t sigEventHandler
+)
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Copy a string, truncating it (on a character boundary) if it doesn't fit.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the string was truncated.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_utf8_Copy
+(
+    char* destStr,
+    const char* srcStr,
+    size_t destSize,
+    size_t* numBytesPtr     ///< [OUT] Number of bytes copied, not counting the terminator.
+)
+{
+    LE_ASSERT(destSize > 0);
+
+    size_t len = strlen(srcStr);
+    le_result_t result = LE_OK;
+
+    if (len >= destSize)
+    {
+        len = destSize - 1;
+
+        // Don't leave half a character behind.
+        while ((len > 0) && ((srcStr[len] & 0xC0) == 0x80))
+        {
+            len--;
+        }
+        result = LE_OVERFLOW;
+    }
+
+    memcpy(destStr, srcStr, len);
+    destStr[len] = '\0';
+
+    if (numBytesPtr != NULL)
+    {
+        *numBytesPtr = len;
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Create a directory, and any of its parents that don't exist yet.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_DUPLICATE if the directory already exists.
+ *  - LE_FAULT if it couldn't be created.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t le_dir_MakePath
+(
+    const char* pathNamePtr,
+    mode_t mode
+)
+{
+    char path[PATH_MAX];
+    struct stat status;
+
+    if ((stat(pathNamePtr, &status) == 0) && S_ISDIR(status.st_mode))
+    {
+        return LE_DUPLICATE;
+    }
+
+    if (le_utf8_Copy(path, pathNamePtr, sizeof(path), NULL) != LE_OK)
+    {
+        return LE_FAULT;
+    }
+
+    for (char* slashPtr = strchr(path + 1, '/');
+         slashPtr != NULL;
+         slashPtr = strchr(slashPtr + 1, '/'))
+    {
+        *slashPtr = '\0';
+        if ((mkdir(path, mode) != 0) && (errno != EEXIST))
+        {
+            return LE_FAULT;
+        }
+        *slashPtr = '/';
+    }
+
+    if ((mkdir(path, mode) != 0) && (errno != EEXIST))
+    {
+        return LE_FAULT;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a pseudo-random number between two values (inclusive).  The sequence is the same on every
+ * run.
+ */
+//--------------------------------------------------------------------------------------------------
+uint32_t le_rand_GetNumBetween
+(
+    uint32_t min,
+    uint32_t max
+)
+{
+    LE_ASSERT(max >= min);
+
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 7;
+    RandomState ^= RandomState << 17;
+
+    uint64_t range = (uint64_t)max - min + 1;
+
+    return min + (uint32_t)(RandomState % range);
+}
@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file hostLegato.h
+ *
+ * Controls for the host stand-in of the Legato framework (see legato.h), used by the host tests
+ * to drive the virtual clock that the timers and queued functions run on.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef HOST_LEGATO_H_INCLUDE_GUARD
+#define HOST_LEGATO_H_INCLUDE_GUARD
+
+/// Function called back at a scheduled time (see hostLegato_Schedule()).
+typedef void (*hostLegato_Func_t)(void* contextPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the virtual clock.  Only used before anything has been scheduled on it.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_SetTime
+(
+    double time             ///< Seconds since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the virtual clock.
+ *
+ * @return Seconds since the Epoch.
+ */
+//--------------------------------------------------------------------------------------------------
+double hostLegato_GetTime
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call a function when the virtual clock reaches a given time, like a one-shot timer.  Used by the
+ * service stubs to deliver their call-backs late.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_Schedule
+(
+    double delay,           ///< Seconds from now.
+    hostLegato_Func_t func,
+    void* contextPtr
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the queued functions, then the timers and scheduled functions that are due, in order,
+ * moving the virtual clock up to each one, until there's nothing left to do before a given time.
+ * The clock is then left at that time.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_RunUntil
+(
+    double time             ///< Seconds since the Epoch.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lowest level of log messages written to stderr (warnings by default, or the level named
+ * by the HOST_LOG_LEVEL environment variable: "debug", "info", "warn" or "error").
+ */
+//--------------------------------------------------------------------------------------------------
+void hostLegato_SetLogLevel
+(
+    le_log_Level_t level
+);
+
+
+#endif // HOST_LEGATO_H_INCLUDE_GUARD
@@ -0,0 +1,1329 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file hostServices.c
+ *
+ * Stubs of the AirVantage data, Data Hub and config tree services.  See hostServices.h.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include "json.h"
+#include "hostLegato.h"
+#include "hostServices.h"
+
+/// Maximum number of AirVantage resources.
+#define MAX_RESOURCES 1024
+
+/// Maximum number of Data Hub observations.
+#define MAX_OBSERVATIONS 64
+
+/// Maximum number of nodes with values in the config tree.
+#define MAX_CONFIG_NODES 256
+
+/// Maximum number of children of one config tree node.
+#define MAX_CONFIG_CHILDREN 64
+
+/// Size of the timestamp of a recorded entry, in the estimate of a record's size (bytes).
+#define ENTRY_TIMESTAMP_BYTES 8
+
+/// An AirVantage resource.
+typedef struct
+{
+    char path[LE_AVDATA_PATH_NAME_LEN + 1];
+    char* valuePtr;             ///< Value, as text (NULL if never set).
+    le_avdata_ResourceHandlerFunc_t handlerPtr;
+    void* contextPtr;
+}
+Resource_t;
+
+/// A record being filled in.
+struct le_avdata_Record
+{
+    uint64_t entryCount;
+    uint64_t byteCount;
+};
+
+/// A push in flight.
+typedef struct
+{
+    le_dls_Link_t link;         ///< Link in the PushList.
+    le_avdata_CallbackResultFunc_t handlerPtr;
+    void* contextPtr;
+    bool willFail;              ///< true if it's going to fail when acknowledged.
+    bool isDone;                ///< true if it's been failed early, as the session went down.
+    uint64_t entryCount;
+    uint64_t byteCount;
+}
+Push_t;
+
+/// Kinds of push handlers on an observation.
+typedef enum
+{
+    HANDLER_NONE,
+    HANDLER_NUMERIC,
+    HANDLER_STRING,
+    HANDLER_JSON,
+}
+HandlerKind_t;
+
+/// A Data Hub observation.
+typedef struct
+{
+    char path[DHUBADMIN_MAX_RESOURCE_PATH_LEN + 1];
+    char source[DHUBADMIN_MAX_RESOURCE_PATH_LEN + 1]; ///< Input it takes samples from ("" if none).
+    uint32_t bufferMaxCount;
+    double changeBy;
+    HandlerKind_t handlerKind;
+    void* handlerPtr;
+    void* contextPtr;
+    bool hasLastValue;
+    double lastValue;           ///< Last numeric value let through, for change-by filtering.
+}
+Observation_t;
+
+/// A value in the config tree.
+typedef struct
+{
+    char path[LE_CFG_STR_LEN_BYTES];
+    char value[LE_CFG_STR_LEN_BYTES];
+}
+ConfigNode_t;
+
+/// A config tree iterator.
+struct le_cfg_Iterator
+{
+    char path[LE_CFG_STR_LEN_BYTES];    ///< Node the iterator is at ("" for the root).
+};
+
+static Resource_t Resources[MAX_RESOURCES];
+static size_t ResourceCount = 0;
+
+static le_avdata_SessionStateHandlerFunc_t SessionHandlerPtr = NULL;
+static void* SessionContextPtr = NULL;
+static bool IsSessionUp = false;
+
+static double Latency = 0.1;
+static double FailureRate = 0.0;
+static size_t RecordLimit = 0;
+static unsigned int LinkRandomSeed = 1;
+
+static le_dls_List_t PushList = LE_DLS_LIST_INIT;
+static hostAv_Stats_t Stats;
+
+static Observation_t Observations[MAX_OBSERVATIONS];
+static size_t ObservationCount = 0;
+
+static ConfigNode_t ConfigNodes[MAX_CONFIG_NODES];
+static size_t ConfigNodeCount = 0;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find an AirVantage resource, optionally adding it if it doesn't exist.
+ *
+ * @return The resource, or NULL if not found (and not added).
+ */
+//--------------------------------------------------------------------------------------------------
+static Resource_t* FindResource
+(
+    const char* path,
+    bool isAdded
+)
+{
+    for (size_t i = 0; i < ResourceCount; i++)
+    {
+        if (strcmp(Resources[i].path, path) == 0)
+        {
+            return &Resources[i];
+        }
+    }
+
+    if (!isAdded)
+    {
+        return NULL;
+    }
+
+    LE_FATAL_IF(ResourceCount == MAX_RESOURCES, "Too many AirVantage resources.");
+
+    Resource_t* resourcePtr = &Resources[ResourceCount++];
+    LE_ASSERT(le_utf8_Copy(resourcePtr->path, path, sizeof(resourcePtr->path), NULL) == LE_OK);
+
+    return resourcePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the value of an AirVantage resource, as text.
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetResourceValue
+(
+    const char* path,
+    const char* value
+)
+{
+    Resource_t* resourcePtr = FindResource(path, true);
+
+    free(resourcePtr->valuePtr);
+    resourcePtr->valuePtr = strdup(value);
+    LE_ASSERT(resourcePtr->valuePtr != NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the value of an AirVantage resource, as text.
+ *
+ * @return The value, or NULL if it has none.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* GetResourceValue
+(
+    const char* path
+)
+{
+    Resource_t* resourcePtr = FindResource(path, false);
+
+    return (resourcePtr == NULL) ? NULL : resourcePtr->valuePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add an entry to a record.
+ *
+ * @return
+ *  - LE_OK if successful.
+ *  - LE_OVERFLOW if the record is full (the entry was not added).
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t AddEntry
+(
+    le_avdata_RecordRef_t recordRef,
+    const char* path,
+    size_t valueBytes
+)
+{
+    size_t entryBytes = strlen(path) + valueBytes + ENTRY_TIMESTAMP_BYTES;
+
+    if ((RecordLimit > 0) && ((recordRef->byteCount + entryBytes) > RecordLimit))
+    {
+        return LE_OVERFLOW;
+    }
+
+    recordRef->entryCount++;
+    recordRef->byteCount += entryBytes;
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Call a push's handler with its result, unless it's been failed early, and free it.
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompletePush
+(
+    void* contextPtr        ///< Push_t.
+)
+{
+    Push_t* pushPtr = contextPtr;
+
+    if (!pushPtr->isDone)
+    {
+        le_dls_Remove(&PushList, &pushPtr->link);
+
+        if (pushPtr->willFail)
+        {
+            Stats.failedCount++;
+        }
+        else
+        {
+            Stats.deliveredCount++;
+            Stats.entryCount += pushPtr->entryCount;
+            Stats.byteCount += pushPtr->byteCount;
+        }
+
+        pushPtr->handlerPtr(pushPtr->willFail ? LE_AVDATA_PUSH_FAILED : LE_AVDATA_PUSH_SUCCESS,
+                            pushPtr->contextPtr);
+    }
+
+    free(pushPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find a Data Hub observation, adding it if it doesn't exist.
+ */
+//--------------------------------------------------------------------------------------------------
+static Observation_t* FindObservation
+(
+    const char* path
+)
+{
+    for (size_t i = 0; i < ObservationCount; i++)
+    {
+        if (strcmp(Observations[i].path, path) == 0)
+        {
+            return &Observations[i];
+        }
+    }
+
+    LE_FATAL_IF(ObservationCount == MAX_OBSERVATIONS, "Too many Data Hub observations.");
+
+    Observation_t* obsPtr = &Observations[ObservationCount++];
+    LE_ASSERT(le_utf8_Copy(obsPtr->path, path, sizeof(obsPtr->path), NULL) == LE_OK);
+
+    return obsPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Register a push handler on a Data Hub observation.
+ *
+ * @return A reference to the handler (never NULL).
+ */
+//--------------------------------------------------------------------------------------------------
+static void* AddPushHandler
+(
+    const char* path,
+    HandlerKind_t kind,
+    void* handlerPtr,
+    void* contextPtr
+)
+{
+    Observation_t* obsPtr = FindObservation(path);
+
+    obsPtr->handlerKind = kind;
+    obsPtr->handlerPtr = handlerPtr;
+    obsPtr->contextPtr = contextPtr;
+
+    return obsPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the value of a config tree node.
+ *
+ * @return The value, or NULL if the node has none.
+ */
+//--------------------------------------------------------------------------------------------------
+static const char* FindConfigValue
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path        ///< Relative to the iterator's node ("" for the node itself).
+)
+{
+    struct le_cfg_Iterator node = *iteratorRef;
+
+    le_cfg_GoToNode(&node, path);
+
+    for (size_t i = 0; i < ConfigNodeCount; i++)
+    {
+        if (strcmp(ConfigNodes[i].path, node.path) == 0)
+        {
+            return ConfigNodes[i].value;
+        }
+    }
+
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * List the names of the children of a config tree node, in the order they were first set.
+ *
+ * @return The number of children.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t ListConfigChildren
+(
+    const char* path,       ///< Node ("" for the root).
+    char names[MAX_CONFIG_CHILDREN][LE_CFG_NAME_LEN_BYTES]
+)
+{
+    size_t count = 0;
+    size_t prefixLen = strlen(path);
+
+    for (size_t i = 0; i < ConfigNodeCount; i++)
+    {
+        const char* childPtr = ConfigNodes[i].path;
+
+        if (prefixLen > 0)
+        {
+            if ((strncmp(childPtr, path, prefixLen) != 0) || (childPtr[prefixLen] != '/'))
+            {
+                continue;
+            }
+            childPtr += prefixLen + 1;
+        }
+
+        char name[LE_CFG_NAME_LEN_BYTES];
+        size_t nameLen = strcspn(childPtr, "/");
+        LE_ASSERT(nameLen < sizeof(name));
+        memcpy(name, childPtr, nameLen);
+        name[nameLen] = '\0';
+
+        size_t j = 0;
+        while ((j < count) && (strcmp(names[j], name) != 0))
+        {
+            j++;
+        }
+
+        if (j == count)
+        {
+            LE_FATAL_IF(count == MAX_CONFIG_CHILDREN, "Too many children of '%s'.", path);
+            strcpy(names[count++], name);
+        }
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set how the link to AirVantage behaves.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_SetLink
+(
+    double latency,
+    double failureRate
+)
+{
+    Latency = latency;
+    FailureRate = failureRate;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the size limit of the records.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_SetRecordLimit
+(
+    size_t maxBytes
+)
+{
+    RecordLimit = maxBytes;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Bring the AirVantage session up.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_StartSession
+(
+    void
+)
+{
+    IsSessionUp = true;
+
+    if (SessionHandlerPtr != NULL)
+    {
+        SessionHandlerPtr(LE_AVDATA_SESSION_STARTED, SessionContextPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take the AirVantage session down.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_StopSession
+(
+    void
+)
+{
+    IsSessionUp = false;
+
+    le_dls_Link_t* linkPtr;
+    while ((linkPtr = le_dls_Pop(&PushList)) != NULL)
+    {
+        Push_t* pushPtr = CONTAINER_OF(linkPtr, Push_t, link);
+
+        pushPtr->isDone = true;
+        Stats.failedCount++;
+        pushPtr->handlerPtr(LE_AVDATA_PUSH_FAILED, pushPtr->contextPtr);
+    }
+
+    if (SessionHandlerPtr != NULL)
+    {
+        SessionHandlerPtr(LE_AVDATA_SESSION_STOPPED, SessionContextPtr);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Execute an AirVantage command.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostAv_Execute
+(
+    const char* path
+)
+{
+    Resource_t* resourcePtr = FindResource(path, false);
+
+    if ((resourcePtr == NULL) || (resourcePtr->handlerPtr == NULL))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    resourcePtr->handlerPtr(path, LE_AVDATA_ACCESS_EXEC, NULL, resourcePtr->contextPtr);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the AirVantage stub's totals.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_GetStats
+(
+    hostAv_Stats_t* statsPtr
+)
+{
+    *statsPtr = Stats;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add up the values of a family of AirVantage variables.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_GetTotal
+(
+    const char* prefix,
+    const char* name,
+    double* sumPtr,
+    double* maxPtr
+)
+{
+    size_t prefixLen = strlen(prefix);
+    size_t nameLen = strlen(name);
+
+    *sumPtr = 0.0;
+    *maxPtr = 0.0;
+
+    for (size_t i = 0; i < ResourceCount; i++)
+    {
+        const char* path = Resources[i].path;
+        size_t pathLen = strlen(path);
+
+        // Match <prefix>/<anything without a slash>/<name>.
+        if (   (Resources[i].valuePtr == NULL)
+            || (pathLen <= (prefixLen + nameLen + 2))
+            || (strncmp(path, prefix, prefixLen) != 0)
+            || (path[prefixLen] != '/')
+            || (strcmp(path + pathLen - nameLen, name) != 0)
+            || (path[pathLen - nameLen - 1] != '/')
+            || (strchr(path + prefixLen + 1, '/') != (path + pathLen - nameLen - 1)))
+        {
+            continue;
+        }
+
+        double value = strtod(Resources[i].valuePtr, NULL);
+
+        *sumPtr += value;
+        if (value > *maxPtr)
+        {
+            *maxPtr = value;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a numeric sample to a Data Hub observation.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostDhub_PushNumeric
+(
+    const char* obsPath,
+    double timestamp,
+    double value
+)
+{
+    Observation_t* obsPtr = FindObservation(obsPath);
+
+    if (obsPtr->handlerKind != HANDLER_NUMERIC)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    if (   obsPtr->hasLastValue
+        && (obsPtr->changeBy > 0.0)
+        && (fabs(value - obsPtr->lastValue) < obsPtr->changeBy))
+    {
+        return LE_OK;
+    }
+
+    obsPtr->hasLastValue = true;
+    obsPtr->lastValue = value;
+
+    ((dhubAdmin_NumericPushHandlerFunc_t)obsPtr->handlerPtr)(timestamp, value, obsPtr->contextPtr);
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a string or JSON sample to a Data Hub observation.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostDhub_PushString
+(
+    const char* obsPath,
+    double timestamp,
+    const char* value
+)
+{
+    Observation_t* obsPtr = FindObservation(obsPath);
+
+    switch (obsPtr->handlerKind)
+    {
+        case HANDLER_STRING:
+
+            ((dhubAdmin_StringPushHandlerFunc_t)obsPtr->handlerPtr)(timestamp,
+                                                                    value,
+                                                                    obsPtr->contextPtr);
+            return LE_OK;
+
+        case HANDLER_JSON:
+
+            ((dhubAdmin_JsonPushHandlerFunc_t)obsPtr->handlerPtr)(timestamp,
+                                                                  value,
+                                                                  obsPtr->contextPtr);
+            return LE_OK;
+
+        default:
+
+            return LE_NOT_FOUND;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a value in the config tree.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostCfg_Set
+(
+    const char* path,
+    const char* value
+)
+{
+    ConfigNode_t* nodePtr = NULL;
+
+    for (size_t i = 0; i < ConfigNodeCount; i++)
+    {
+        if (strcmp(ConfigNodes[i].path, path) == 0)
+        {
+            nodePtr = &ConfigNodes[i];
+        }
+    }
+
+    if (nodePtr == NULL)
+    {
+        LE_FATAL_IF(ConfigNodeCount == MAX_CONFIG_NODES, "Too many config tree nodes.");
+        nodePtr = &ConfigNodes[ConfigNodeCount++];
+        LE_ASSERT(le_utf8_Copy(nodePtr->path, path, sizeof(nodePtr->path), NULL) == LE_OK);
+    }
+
+    LE_ASSERT(le_utf8_Copy(nodePtr->value, value, sizeof(nodePtr->value), NULL) == LE_OK);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * le_avdata
+ */
+//--------------------------------------------------------------------------------------------------
+
+void le_avdata_ConnectService
+(
+    void
+)
+{
+}
+
+le_result_t le_avdata_CreateResource
+(
+    const char* path,
+    le_avdata_AccessMode_t accessMode
+)
+{
+    (void)FindResource(path, true);
+
+    return LE_OK;
+}
+
+le_avdata_ResourceEventHandlerRef_t le_avdata_AddResourceEventHandler
+(
+    const char* path,
+    le_avdata_ResourceHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    Resource_t* resourcePtr = FindResource(path, true);
+
+    resourcePtr->handlerPtr = handlerPtr;
+    resourcePtr->contextPtr = contextPtr;
+
+    return (le_avdata_ResourceEventHandlerRef_t)resourcePtr;
+}
+
+le_result_t le_avdata_GetInt
+(
+    const char* path,
+    int32_t* valuePtr
+)
+{
+    const char* value = GetResourceValue(path);
+
+    if (value == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    *valuePtr = (int32_t)strtol(value, NULL, 10);
+
+    return LE_OK;
+}
+
+le_result_t le_avdata_SetInt
+(
+    const char* path,
+    int32_t value
+)
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), "%" PRId32, value);
+    SetResourceValue(path, text);
+
+    return LE_OK;
+}
+
+le_result_t le_avdata_GetFloat
+(
+    const char* path,
+    double* valuePtr
+)
+{
+    const char* value = GetResourceValue(path);
+
+    if (value == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    *valuePtr = strtod(value, NULL);
+
+    return LE_OK;
+}
+
+le_result_t le_avdata_SetFloat
+(
+    const char* path,
+    double value
+)
+{
+    char text[32];
+
+    snprintf(text, sizeof(text), "%.17g", value);
+    SetResourceValue(path, text);
+
+    return LE_OK;
+}
+
+le_result_t le_avdata_GetString
+(
+    const char* path,
+    char* value,
+    size_t valueSize
+)
+{
+    const char* text = GetResourceValue(path);
+
+    if (text == NULL)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    return le_utf8_Copy(value, text, valueSize, NULL);
+}
+
+le_result_t le_avdata_SetString
+(
+    const char* path,
+    const char* value
+)
+{
+    SetResourceValue(path, value);
+
+    return LE_OK;
+}
+
+le_result_t le_avdata_GetStringArg
+(
+    le_avdata_ArgumentListRef_t argumentListRef,
+    const char* argName,
+    char* strArg,
+    size_t strArgSize
+)
+{
+    return LE_NOT_FOUND;
+}
+
+void le_avdata_ReplyExecResult
+(
+    le_avdata_ArgumentListRef_t argumentListRef,
+    le_result_t result
+)
+{
+}
+
+le_avdata_RecordRef_t le_avdata_CreateRecord
+(
+    void
+)
+{
+    le_avdata_RecordRef_t recordRef = calloc(1, sizeof(*recordRef));
+
+    LE_ASSERT(recordRef != NULL);
+
+    return recordRef;
+}
+
+void le_avdata_DeleteRecord
+(
+    le_avdata_RecordRef_t recordRef
+)
+{
+    free(recordRef);
+}
+
+le_result_t le_avdata_RecordInt
+(
+    le_avdata_RecordRef_t recordRef,
+    const char* path,
+    int32_t value,
+    uint64_t timestamp
+)
+{
+    return AddEntry(recordRef, path, sizeof(value));
+}
+
+le_result_t le_avdata_RecordFloat
+(
+    le_avdata_RecordRef_t recordRef,
+    const char* path,
+    double value,
+    uint64_t timestamp
+)
+{
+    return AddEntry(recordRef, path, sizeof(value));
+}
+
+le_result_t le_avdata_RecordString
+(
+    le_avdata_RecordRef_t recordRef,
+    const char* path,
+    const char* value,
+    uint64_t timestamp
+)
+{
+    return AddEntry(recordRef, path, strlen(value));
+}
+
+le_result_t le_avdata_PushRecord
+(
+    le_avdata_RecordRef_t recordRef,
+    le_avdata_CallbackResultFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    Stats.pushCount++;
+
+    if (!IsSessionUp)
+    {
+        Stats.failedCount++;
+        return LE_FAULT;
+    }
+
+    Push_t* pushPtr = calloc(1, sizeof(*pushPtr));
+    LE_ASSERT(pushPtr != NULL);
+
+    pushPtr->link = LE_DLS_LINK_INIT;
+    pushPtr->handlerPtr = handlerPtr;
+    pushPtr->contextPtr = contextPtr;
+    pushPtr->willFail = ((double)rand_r(&LinkRandomSeed) / RAND_MAX) < FailureRate;
+    pushPtr->entryCount = recordRef->entryCount;
+    pushPtr->byteCount = recordRef->byteCount;
+
+    le_dls_Queue(&PushList, &pushPtr->link);
+    hostLegato_Schedule(Latency, CompletePush, pushPtr);
+
+    return LE_OK;
+}
+
+le_avdata_SessionStateHandlerRef_t le_avdata_AddSessionStateHandler
+(
+    le_avdata_SessionStateHandlerFunc_t handlerPtr,
+    void* contextPtr
+)
+{
+    SessionHandlerPtr = handlerPtr;
+    SessionContextPtr = contextPtr;
+
+    return (le_avdata_SessionStateHandlerRef_t)&SessionHandlerPtr;
+}
+
+le_avdata_RequestSessionObjRef_t le_avdata_RequestSession
+(
+    void
+)
+{
+    return (le_avdata_RequestSessionObjRef_t)&IsSessionUp;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * dhubIO
+ */
+//--------------------------------------------------------------------------------------------------
+
+void dhubIO_ConnectService
+(
+    void
+)
+{
+}
+
+le_result_t dhubIO_CreateInput
+(
+    const char* path,
+    dhubIO_DataType_t type,
+    const char* units
+)
+{
+    return LE_OK;
+}
+
+void dhubIO_SetJsonExample
+(
+    const char* path,
+    const char* example
+)
+{
+}
+
+void dhubIO_PushJson
+(
+    const char* path,
+    double timestamp,
+    const char* value
+)
+{
+    LE_DEBUG("%s = %s", path, value);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * dhubAdmin
+ */
+//--------------------------------------------------------------------------------------------------
+
+void dhubAdmin_ConnectService
+(
+    void
+)
+{
+}
+
+le_result_t dhubAdmin_CreateObs
+(
+    const char* path
+)
+{
+    (void)FindObservation(path);
+
+    return LE_OK;
+}
+
+void dhubAdmin_SetBufferMaxCount
+(
+    const char* obsPath,
+    uint32_t maxCount
+)
+{
+    FindObservation(obsPath)->bufferMaxCount = maxCount;
+}
+
+uint32_t dhubAdmin_GetBufferMaxCount
+(
+    const char* obsPath
+)
+{
+    return FindObservation(obsPath)->bufferMaxCount;
+}
+
+void dhubAdmin_SetChangeBy
+(
+    const char* obsPath,
+    double change
+)
+{
+    FindObservation(obsPath)->changeBy = change;
+}
+
+double dhubAdmin_GetChangeBy
+(
+    const char* obsPath
+)
+{
+    return FindObservation(obsPath)->changeBy;
+}
+
+le_result_t dhubAdmin_SetSource
+(
+    const char* destPath,
+    const char* srcPath
+)
+{
+    Observation_t* obsPtr = FindObservation(destPath);
+
+    return le_utf8_Copy(obsPtr->source, srcPath, sizeof(obsPtr->source), NULL);
+}
+
+le_result_t dhubAdmin_GetSource
+(
+    const char* destPath,
+    char* srcPath,
+    size_t srcPathSize
+)
+{
+    Observation_t* obsPtr = FindObservation(destPath);
+
+    if (obsPtr->source[0] == '\0')
+    {
+        return LE_NOT_FOUND;
+    }
+
+    return le_utf8_Copy(srcPath, obsPtr->source, srcPathSize, NULL);
+}
+
+void dhubAdmin_SetNumericDefault
+(
+    const char* path,
+    double value
+)
+{
+}
+
+void dhubAdmin_SetJsonDefault
+(
+    const char* path,
+    const char* value
+)
+{
+}
+
+void dhubAdmin_PushNumeric
+(
+    const char* path,
+    double timestamp,
+    double value
+)
+{
+    LE_DEBUG("%s = %lf", path, value);
+}
+
+void dhubAdmin_PushBoolean
+(
+    const char* path,
+    double timestamp,
+    bool value
+)
+{
+    LE_DEBUG("%s = %d", path, value);
+}
+
+void dhubAdmin_PushJson
+(
+    const char* path,
+    double timestamp,
+    const char* value
+)
+{
+    LE_DEBUG("%s = %s", path, value);
+}
+
+dhubAdmin_NumericPushHandlerRef_t dhubAdmin_AddNumericPushHandler
+(
+    const char* path,
+    dhubAdmin_NumericPushHandlerFunc_t callbackPtr,
+    void* contextPtr
+)
+{
+    return AddPushHandler(path, HANDLER_NUMERIC, (void*)callbackPtr, contextPtr);
+}
+
+dhubAdmin_StringPushHandlerRef_t dhubAdmin_AddStringPushHandler
+(
+    const char* path,
+    dhubAdmin_StringPushHandlerFunc_t callbackPtr,
+    void* contextPtr
+)
+{
+    return AddPushHandler(path, HANDLER_STRING, (void*)callbackPtr, contextPtr);
+}
+
+dhubAdmin_JsonPushHandlerRef_t dhubAdmin_AddJsonPushHandler
+(
+    const char* path,
+    dhubAdmin_JsonPushHandlerFunc_t callbackPtr,
+    void* contextPtr
+)
+{
+    return AddPushHandler(path, HANDLER_JSON, (void*)callbackPtr, contextPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * le_cfg
+ */
+//--------------------------------------------------------------------------------------------------
+
+void le_cfg_ConnectService
+(
+    void
+)
+{
+}
+
+le_cfg_IteratorRef_t le_cfg_CreateReadTxn
+(
+    const char* basePath
+)
+{
+    le_cfg_IteratorRef_t iteratorRef = calloc(1, sizeof(*iteratorRef));
+
+    LE_ASSERT(iteratorRef != NULL);
+    le_cfg_GoToNode(iteratorRef, basePath);
+
+    return iteratorRef;
+}
+
+void le_cfg_CancelTxn
+(
+    le_cfg_IteratorRef_t iteratorRef
+)
+{
+    free(iteratorRef);
+}
+
+void le_cfg_GoToNode
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* newPath     ///< Relative to the iterator's node; ".." steps up.
+)
+{
+    char path[LE_CFG_STR_LEN_BYTES];
+    LE_ASSERT(le_utf8_Copy(path, newPath, sizeof(path), NULL) == LE_OK);
+
+    char* savePtr = NULL;
+    for (char* namePtr = strtok_r(path, "/", &savePtr);
+         namePtr != NULL;
+         namePtr = strtok_r(NULL, "/", &savePtr))
+    {
+        if (strcmp(namePtr, "..") == 0)
+        {
+            char* slashPtr = strrchr(iteratorRef->path, '/');
+            *((slashPtr != NULL) ? slashPtr : iteratorRef->path) = '\0';
+        }
+        else if (strcmp(namePtr, ".") != 0)
+        {
+            size_t len = strlen(iteratorRef->path);
+            snprintf(iteratorRef->path + len, sizeof(iteratorRef->path) - len, "%s%s",
+                     (len > 0) ? "/" : "", namePtr);
+        }
+    }
+}
+
+le_result_t le_cfg_GoToFirstChild
+(
+    le_cfg_IteratorRef_t iteratorRef
+)
+{
+    char names[MAX_CONFIG_CHILDREN][LE_CFG_NAME_LEN_BYTES];
+
+    if (ListConfigChildren(iteratorRef->path, names) == 0)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    le_cfg_GoToNode(iteratorRef, names[0]);
+
+    return LE_OK;
+}
+
+le_result_t le_cfg_GoToNextSibling
+(
+    le_cfg_IteratorRef_t iteratorRef
+)
+{
+    char names[MAX_CONFIG_CHILDREN][LE_CFG_NAME_LEN_BYTES];
+    char parent[LE_CFG_STR_LEN_BYTES];
+    const char* slashPtr = strrchr(iteratorRef->path, '/');
+    const char* name = (slashPtr != NULL) ? (slashPtr + 1) : iteratorRef->path;
+    int parentLen = (slashPtr != NULL) ? (int)(slashPtr - iteratorRef->path) : 0;
+
+    snprintf(parent, sizeof(parent), "%.*s", parentLen, iteratorRef->path);
+
+    size_t count = ListConfigChildren(parent, names);
+    for (size_t i = 0; (i + 1) < count; i++)
+    {
+        if (strcmp(names[i], name) == 0)
+        {
+            le_cfg_GoToNode(iteratorRef, "..");
+            le_cfg_GoToNode(iteratorRef, names[i + 1]);
+            return LE_OK;
+        }
+    }
+
+    return LE_NOT_FOUND;
+}
+
+le_result_t le_cfg_GetNodeName
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path,
+    char* name,
+    size_t nameSize
+)
+{
+    le_cfg_IteratorRef_t nodeRef = le_cfg_CreateReadTxn(iteratorRef->path);
+    le_cfg_GoToNode(nodeRef, path);
+
+    const char* slashPtr = strrchr(nodeRef->path, '/');
+    le_result_t result = le_utf8_Copy(name,
+                                      (slashPtr != NULL) ? (slashPtr + 1) : nodeRef->path,
+                                      nameSize,
+                                      NULL);
+
+    le_cfg_CancelTxn(nodeRef);
+
+    return result;
+}
+
+bool le_cfg_NodeExists
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path
+)
+{
+    char names[MAX_CONFIG_CHILDREN][LE_CFG_NAME_LEN_BYTES];
+    le_cfg_IteratorRef_t nodeRef = le_cfg_CreateReadTxn(iteratorRef->path);
+    le_cfg_GoToNode(nodeRef, path);
+
+    bool exists = (FindConfigValue(nodeRef, "") != NULL)
+               || (ListConfigChildren(nodeRef->path, names) > 0);
+
+    le_cfg_CancelTxn(nodeRef);
+
+    return exists;
+}
+
+le_result_t le_cfg_GetString
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path,
+    char* value,
+    size_t valueSize,
+    const char* defaultValue
+)
+{
+    const char* text = FindConfigValue(iteratorRef, path);
+
+    return le_utf8_Copy(value, (text != NULL) ? text : defaultValue, valueSize, NULL);
+}
+
+int32_t le_cfg_GetInt
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path,
+    int32_t defaultValue
+)
+{
+    const char* text = FindConfigValue(iteratorRef, path);
+
+    return (text != NULL) ? (int32_t)strtol(text, NULL, 10) : defaultValue;
+}
+
+double le_cfg_GetFloat
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path,
+    double defaultValue
+)
+{
+    const char* text = FindConfigValue(iteratorRef, path);
+
+    return (text != NULL) ? strtod(text, NULL) : defaultValue;
+}
+
+bool le_cfg_GetBool
+(
+    le_cfg_IteratorRef_t iteratorRef,
+    const char* path,
+    bool defaultValue
+)
+{
+    const char* text = FindConfigValue(iteratorRef, path);
+
+    return (text != NULL) ? (strcmp(text, "true") == 0) : defaultValue;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * json
+ */
+//--------------------------------------------------------------------------------------------------
+
+const char* json_GetDataTypeName
+(
+    json_DataType_t type
+)
+{
+    static const char* const names[] = { "null", "boolean", "number", "string", "object", "array" };
+
+    return ((size_t)type < NUM_ARRAY_MEMBERS(names)) ? names[type] : "unknown";
+}
@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file hostServices.h
+ *
+ * Stubs of the services avPublisher uses (AirVantage data, the Data Hub and the config tree, see
+ * interfaces.h), and the controls the host tests use to drive them.
+ *
+ * The AirVantage stub acknowledges each record pushed after a set latency, failing a set fraction
+ * of them, on the virtual clock (see hostLegato.h).  While the session is down, pushes are refused
+ * and the ones in flight fail.  Records can be given a size limit, past which entries are refused
+ * with LE_OVERFLOW, as they are when the AirVantage Agent's record buffer is full.  Resource values
+ * are kept, so that the settings avPublisher reads and the metrics it publishes can be read back
+ * with le_avdata_GetFloat() and friends.
+ *
+ * The Data Hub stub hands the samples a test pushes to an observation to the push handler
+ * registered on it, filtering numeric samples by the observation's change-by threshold, as the
+ * Data Hub does.  The config tree stub reads the values a test has set.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef HOST_SERVICES_H_INCLUDE_GUARD
+#define HOST_SERVICES_H_INCLUDE_GUARD
+
+/// Totals kept by the AirVantage stub.
+typedef struct
+{
+    uint64_t pushCount;         ///< Records pushed.
+    uint64_t failedCount;       ///< Pushes that failed (including those refused).
+    uint64_t deliveredCount;    ///< Pushes acknowledged as delivered.
+    uint64_t entryCount;        ///< Entries recorded in the records delivered.
+    uint64_t byteCount;         ///< Estimated size of the records delivered (bytes).
+}
+hostAv_Stats_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set how the link to AirVantage behaves, from the next push on.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_SetLink
+(
+    double latency,         ///< Time from a push to its acknowledgement (seconds).
+    double failureRate      ///< Fraction of the pushes that fail (0 to 1).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the size limit of the records, from the next entry on.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_SetRecordLimit
+(
+    size_t maxBytes         ///< Largest estimated size of a record (bytes, 0 = unlimited).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Bring the AirVantage session up, telling the session state handlers.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_StartSession
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take the AirVantage session down, failing the pushes in flight and telling the session state
+ * handlers.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_StopSession
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Execute an AirVantage command.
+ *
+ * @return
+ *  - LE_OK if the command's handler was called.
+ *  - LE_NOT_FOUND if there's no handler for it.
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostAv_Execute
+(
+    const char* path
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the AirVantage stub's totals.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_GetStats
+(
+    hostAv_Stats_t* statsPtr    ///< [OUT] Totals since the start.
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add up the values of a family of AirVantage variables, e.g., the sensors' Received metrics
+ * with hostAv_GetTotal("/Metrics", "Received", ...), which covers /Metrics/<name>/Received.
+ * Variables that have no value yet are left out.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostAv_GetTotal
+(
+    const char* prefix,     ///< Path of the variables' parent's parent.
+    const char* name,       ///< Name of the variables.
+    double* sumPtr,         ///< [OUT] Sum of their values.
+    double* maxPtr          ///< [OUT] Largest of their values (0 if none).
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a numeric sample to a Data Hub observation.
+ *
+ * @return
+ *  - LE_OK if it was handed to the observation's push handler, or filtered out by change-by.
+ *  - LE_NOT_FOUND if the observation has no numeric push handler (yet).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostDhub_PushNumeric
+(
+    const char* obsPath,
+    double timestamp,
+    double value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Push a string or JSON sample to a Data Hub observation.
+ *
+ * @return
+ *  - LE_OK if it was handed to the observation's push handler.
+ *  - LE_NOT_FOUND if the observation has no string or JSON push handler (yet).
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t hostDhub_PushString
+(
+    const char* obsPath,
+    double timestamp,
+    const char* value
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set a value in the config tree, e.g., hostCfg_Set("sensors/light/period", "30").  Values are
+ * kept as text, and converted to the type asked for when read.
+ */
+//--------------------------------------------------------------------------------------------------
+void hostCfg_Set
+(
+    const char* path,       ///< Path of the node, relative to the app's root.
+    const char* value
+);
+
+
+#endif // HOST_SERVICES_H_INCLUDE_GUARD
@@ -0,0 +1,199 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file interfaces.h
+ *
+ * Host stand-in for the generated client-side interfaces of the APIs that avPublisher uses:
+ * le_avdata (AirVantage data), the Data Hub's io and admin APIs (as dhubIO and dhubAdmin) and
+ * le_cfg (the config tree).  Only the functions and definitions avPublisher needs are declared.
+ * They are implemented by the service stubs (see hostServices.h).
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef INTERFACES_H_INCLUDE_GUARD
+#define INTERFACES_H_INCLUDE_GUARD
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * le_avdata
+ */
+//--------------------------------------------------------------------------------------------------
+
+#define LE_AVDATA_PATH_NAME_LEN 511
+#define LE_AVDATA_STRING_VALUE_LEN 5000
+
+typedef struct le_avdata_Record* le_avdata_RecordRef_t;
+typedef struct le_avdata_ArgumentList* le_avdata_ArgumentListRef_t;
+typedef struct le_avdata_RequestSessionObj* le_avdata_RequestSessionObjRef_t;
+typedef struct le_avdata_SessionStateHandler* le_avdata_SessionStateHandlerRef_t;
+typedef struct le_avdata_ResourceEventHandler* le_avdata_ResourceEventHandlerRef_t;
+
+typedef enum
+{
+    LE_AVDATA_ACCESS_VARIABLE = 0x1,
+    LE_AVDATA_ACCESS_SETTING = 0x2,
+    LE_AVDATA_ACCESS_COMMAND = 0x4,
+}
+le_avdata_AccessMode_t;
+
+typedef enum
+{
+    LE_AVDATA_ACCESS_READ = 0x1,
+    LE_AVDATA_ACCESS_WRITE = 0x2,
+    LE_AVDATA_ACCESS_EXEC = 0x4,
+}
+le_avdata_AccessType_t;
+
+typedef enum
+{
+    LE_AVDATA_PUSH_SUCCESS,
+    LE_AVDATA_PUSH_FAILED,
+}
+le_avdata_PushStatus_t;
+
+typedef enum
+{
+    LE_AVDATA_SESSION_STARTED,
+    LE_AVDATA_SESSION_STOPPED,
+}
+le_avdata_SessionState_t;
+
+typedef void (*le_avdata_CallbackResultFunc_t)(le_avdata_PushStatus_t status, void* contextPtr);
+typedef void (*le_avdata_SessionStateHandlerFunc_t)(le_avdata_SessionState_t sessionState,
+                                                    void* contextPtr);
+typedef void (*le_avdata_ResourceHandlerFunc_t)(const char* path,
+                                               le_avdata_AccessType_t accessType,
+                                               le_avdata_ArgumentListRef_t argumentListRef,
+                                               void* contextPtr);
+
+void le_avdata_ConnectService(void);
+le_result_t le_avdata_CreateResource(const char* path, le_avdata_AccessMode_t accessMode);
+le_avdata_ResourceEventHandlerRef_t le_avdata_AddResourceEventHandler
+    (const char* path, le_avdata_ResourceHandlerFunc_t handlerPtr, void* contextPtr);
+le_result_t le_avdata_GetInt(const char* path, int32_t* valuePtr);
+le_result_t le_avdata_SetInt(const char* path, int32_t value);
+le_result_t le_avdata_GetFloat(const char* path, double* valuePtr);
+le_result_t le_avdata_SetFloat(const char* path, double value);
+le_result_t le_avdata_GetString(const char* path, char* value, size_t valueSize);
+le_result_t le_avdata_SetString(const char* path, const char* value);
+le_result_t le_avdata_GetStringArg(le_avdata_ArgumentListRef_t argumentListRef,
+                                   const char* argName, char* strArg, size_t strArgSize);
+void le_avdata_ReplyExecResult(le_avdata_ArgumentListRef_t argumentListRef, le_result_t result);
+le_avdata_RecordRef_t le_avdata_CreateRecord(void);
+void le_avdata_DeleteRecord(le_avdata_RecordRef_t recordRef);
+le_result_t le_avdata_RecordInt(le_avdata_RecordRef_t recordRef, const char* path,
+                                int32_t value, uint64_t timestamp);
+le_result_t le_avdata_RecordFloat(le_avdata_RecordRef_t recordRef, const char* path,
+                                  double value, uint64_t timestamp);
+le_result_t le_avdata_RecordString(le_avdata_RecordRef_t recordRef, const char* path,
+                                   const char* value, uint64_t timestamp);
+le_result_t le_avdata_PushRecord(le_avdata_RecordRef_t recordRef,
+                                 le_avdata_CallbackResultFunc_t handlerPtr, void* contextPtr);
+le_avdata_SessionStateHandlerRef_t le_avdata_AddSessionStateHandler
+    (le_avdata_SessionStateHandlerFunc_t handlerPtr, void* contextPtr);
+le_avdata_RequestSessionObjRef_t le_avdata_RequestSession(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Data Hub io API (dhubIO)
+ */
+//--------------------------------------------------------------------------------------------------
+
+#define IO_MAX_RESOURCE_PATH_LEN 79
+#define IO_MAX_STRING_VALUE_LEN 50000
+#define DHUBIO_MAX_RESOURCE_PATH_LEN IO_MAX_RESOURCE_PATH_LEN
+
+typedef enum
+{
+    IO_DATA_TYPE_TRIGGER,
+    IO_DATA_TYPE_BOOLEAN,
+    IO_DATA_TYPE_NUMERIC,
+    IO_DATA_TYPE_STRING,
+    IO_DATA_TYPE_JSON,
+}
+io_DataType_t;
+
+typedef io_DataType_t dhubIO_DataType_t;
+
+#define DHUBIO_DATA_TYPE_TRIGGER IO_DATA_TYPE_TRIGGER
+#define DHUBIO_DATA_TYPE_BOOLEAN IO_DATA_TYPE_BOOLEAN
+#define DHUBIO_DATA_TYPE_NUMERIC IO_DATA_TYPE_NUMERIC
+#define DHUBIO_DATA_TYPE_STRING IO_DATA_TYPE_STRING
+#define DHUBIO_DATA_TYPE_JSON IO_DATA_TYPE_JSON
+
+void dhubIO_ConnectService(void);
+le_result_t dhubIO_CreateInput(const char* path, dhubIO_DataType_t type, const char* units);
+void dhubIO_SetJsonExample(const char* path, const char* example);
+void dhubIO_PushJson(const char* path, double timestamp, const char* value);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Data Hub admin API (dhubAdmin)
+ */
+//--------------------------------------------------------------------------------------------------
+
+#define DHUBADMIN_MAX_RESOURCE_PATH_LEN IO_MAX_RESOURCE_PATH_LEN
+
+typedef void (*dhubAdmin_NumericPushHandlerFunc_t)(double timestamp, double value,
+                                                   void* contextPtr);
+typedef void (*dhubAdmin_StringPushHandlerFunc_t)(double timestamp, const char* value,
+                                                  void* contextPtr);
+typedef void (*dhubAdmin_JsonPushHandlerFunc_t)(double timestamp, const char* value,
+                                                void* contextPtr);
+typedef struct dhubAdmin_NumericPushHandler* dhubAdmin_NumericPushHandlerRef_t;
+typedef struct dhubAdmin_StringPushHandler* dhubAdmin_StringPushHandlerRef_t;
+typedef struct dhubAdmin_JsonPushHandler* dhubAdmin_JsonPushHandlerRef_t;
+
+void dhubAdmin_ConnectService(void);
+le_result_t dhubAdmin_CreateObs(const char* path);
+void dhubAdmin_SetBufferMaxCount(const char* obsPath, uint32_t maxCount);
+uint32_t dhubAdmin_GetBufferMaxCount(const char* obsPath);
+void dhubAdmin_SetChangeBy(const char* obsPath, double change);
+double dhubAdmin_GetChangeBy(const char* obsPath);
+le_result_t dhubAdmin_SetSource(const char* destPath, const char* srcPath);
+le_result_t dhubAdmin_GetSource(const char* destPath, char* srcPath, size_t srcPathSize);
+void dhubAdmin_SetNumericDefault(const char* path, double value);
+void dhubAdmin_SetJsonDefault(const char* path, const char* value);
+void dhubAdmin_PushNumeric(const char* path, double timestamp, double value);
+void dhubAdmin_PushBoolean(const char* path, double timestamp, bool value);
+void dhubAdmin_PushJson(const char* path, double timestamp, const char* value);
+dhubAdmin_NumericPushHandlerRef_t dhubAdmin_AddNumericPushHandler
+    (const char* path, dhubAdmin_NumericPushHandlerFunc_t callbackPtr, void* contextPtr);
+dhubAdmin_StringPushHandlerRef_t dhubAdmin_AddStringPushHandler
+    (const char* path, dhubAdmin_StringPushHandlerFunc_t callbackPtr, void* contextPtr);
+dhubAdmin_JsonPushHandlerRef_t dhubAdmin_AddJsonPushHandler
+    (const char* path, dhubAdmin_JsonPushHandlerFunc_t callbackPtr, void* contextPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * le_cfg
+ */
+//--------------------------------------------------------------------------------------------------
+
+#define LE_CFG_STR_LEN_BYTES 512
+#define LE_CFG_NAME_LEN_BYTES 128
+
+typedef struct le_cfg_Iterator* le_cfg_IteratorRef_t;
+
+void le_cfg_ConnectService(void);
+le_cfg_IteratorRef_t le_cfg_CreateReadTxn(const char* basePath);
+void le_cfg_CancelTxn(le_cfg_IteratorRef_t iteratorRef);
+void le_cfg_GoToNode(le_cfg_IteratorRef_t iteratorRef, const char* newPath);
+le_result_t le_cfg_GoToFirstChild(le_cfg_IteratorRef_t iteratorRef);
+le_result_t le_cfg_GoToNextSibling(le_cfg_IteratorRef_t iteratorRef);
+le_result_t le_cfg_GetNodeName(le_cfg_IteratorRef_t iteratorRef, const char* path,
+                               char* name, size_t nameSize);
+bool le_cfg_NodeExists(le_cfg_IteratorRef_t iteratorRef, const char* path);
+le_result_t le_cfg_GetString(le_cfg_IteratorRef_t iteratorRef, const char* path,
+                             char* value, size_t valueSize, const char* defaultValue);
+int32_t le_cfg_GetInt(le_cfg_IteratorRef_t iteratorRef, const char* path, int32_t defaultValue);
+double le_cfg_GetFloat(le_cfg_IteratorRef_t iteratorRef, const char* path, double defaultValue);
+bool le_cfg_GetBool(le_cfg_IteratorRef_t iteratorRef, const char* path, bool defaultValue);
+
+
+#endif // INTERFACES_H_INCLUDE_GUARD
@@ -0,0 +1,38 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file json.h
+ *
+ * Host stand-in for the Data Hub's JSON utility component, for the parts avPublisher uses.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef JSON_H_INCLUDE_GUARD
+#define JSON_H_INCLUDE_GUARD
+
+/// Types of JSON values.
+typedef enum
+{
+    JSON_TYPE_NULL,
+    JSON_TYPE_BOOLEAN,
+    JSON_TYPE_NUMBER,
+    JSON_TYPE_STRING,
+    JSON_TYPE_OBJECT,
+    JSON_TYPE_ARRAY,
+}
+json_DataType_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the name of a JSON data type, for log messages.
+ */
+//--------------------------------------------------------------------------------------------------
+const char* json_GetDataTypeName
+(
+    json_DataType_t type
+);
+
+
+#endif // JSON_H_INCLUDE_GUARD
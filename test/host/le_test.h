@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file le_test.h
+ *
+ * Host stand-in for Legato's unit test macros, for the parts the host tests use.  Results are
+ * written to stdout in TAP format:
+ *
+ * @code
+ *  LE_TEST_PLAN(LE_TEST_NO_PLAN);
+ *  LE_TEST_OK(packedVector_Decode(text, values, 3) == LE_OK, "decode 3 members");
+ *  LE_TEST_EXIT;
+ * @endcode
+ *
+ * Each test program includes it once, as it holds the test's counters.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LE_TEST_H_INCLUDE_GUARD
+#define LE_TEST_H_INCLUDE_GUARD
+
+/// Plan for a test that doesn't say up front how many tests it has.
+#define LE_TEST_NO_PLAN -1
+
+/// Number of tests run so far.
+static int _le_test_Count = 0;
+
+/// Number of tests failed so far.
+static int _le_test_FailedCount = 0;
+
+/// Number of tests planned (LE_TEST_NO_PLAN if not said).
+static int _le_test_PlannedCount = LE_TEST_NO_PLAN;
+
+/// Start a test, with the number of tests it has.
+#define LE_TEST_PLAN(count)                                                                        \
+    do                                                                                             \
+    {                                                                                              \
+        _le_test_PlannedCount = (count);                                                           \
+        if (_le_test_PlannedCount >= 0)                                                            \
+        {                                                                                          \
+            printf("1..%d\n", _le_test_PlannedCount);                                              \
+        }                                                                                          \
+    } while (0)
+
+/// Check a test's result.  Evaluates to the result.
+#define LE_TEST_OK(test, ...)                                                                      \
+    ({                                                                                             \
+        bool _isOk = (test);                                                                       \
+        _le_test_Count++;                                                                          \
+        if (!_isOk)                                                                                \
+        {                                                                                          \
+            _le_test_FailedCount++;                                                                \
+            printf("not ok %d - ", _le_test_Count);                                                \
+        }                                                                                          \
+        else                                                                                       \
+        {                                                                                          \
+            printf("ok %d - ", _le_test_Count);                                                    \
+        }                                                                                          \
+        printf(__VA_ARGS__);                                                                       \
+        printf("\n");                                                                              \
+        if (!_isOk)                                                                                \
+        {                                                                                          \
+            printf("# failed: '%s' at %s:%d\n", #test, __FILE__, __LINE__);                        \
+        }                                                                                          \
+        _isOk;                                                                                     \
+    })
+
+/// Check a test's result, and stop here if it failed.
+#define LE_TEST_ASSERT(test, ...)                                                                  \
+    do                                                                                             \
+    {                                                                                              \
+        if (!LE_TEST_OK(test, __VA_ARGS__))                                                        \
+        {                                                                                          \
+            printf("# bailing out\n");                                                             \
+            exit(EXIT_FAILURE);                                                                    \
+        }                                                                                          \
+    } while (0)
+
+/// Print a note among the results.
+#define LE_TEST_INFO(...)                                                                          \
+    do                                                                                             \
+    {                                                                                              \
+        printf("# ");                                                                              \
+        printf(__VA_ARGS__);                                                                       \
+        printf("\n");                                                                              \
+    } while (0)
+
+/// End the test, exiting with its status.
+#define LE_TEST_EXIT                                                                               \
+    do                                                                                             \
+    {                                                                                              \
+        if (_le_test_PlannedCount < 0)                                                             \
+        {                                                                                          \
+            printf("1..%d\n", _le_test_Count);                                                     \
+        }                                                                                          \
+        else if (_le_test_PlannedCount != _le_test_Count)                                          \
+        {                                                                                          \
+            printf("# planned %d tests, ran %d\n", _le_test_PlannedCount, _le_test_Count);         \
+            _le_test_FailedCount++;                                                                \
+        }                                                                                          \
+        exit((_le_test_FailedCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE);                           \
+    } while (0)
+
+#endif // LE_TEST_H_INCLUDE_GUARD
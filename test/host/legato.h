@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file legato.h
+ *
+ * Host stand-in for the parts of the Legato framework API that the components use, so they can be
+ * built and run on a development machine by the host tests (see test/CMakeLists.txt).
+ *
+ * Everything runs on one thread, against a virtual clock: timers and queued functions only run
+ * when the test advances the clock (see hostLegato.h).  Logging goes to stderr.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef LEGATO_H_INCLUDE_GUARD
+#define LEGATO_H_INCLUDE_GUARD
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LE_SHARED
+
+/// Each component's sources are built with COMPONENT_INIT_NAME set to a name of its own, e.g.,
+/// _sampleQueue_COMPONENT_INIT, which the tests call to initialize the component.
+#define COMPONENT_INIT void COMPONENT_INIT_NAME(void)
+
+#define NUM_ARRAY_MEMBERS(array) (sizeof(array) / sizeof((array)[0]))
+
+#define CONTAINER_OF(memberPtr, type, member) \
+    ((type*)(((uint8_t*)(memberPtr)) - offsetof(type, member)))
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Result codes.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef enum
+{
+    LE_OK = 0,
+    LE_NOT_FOUND = -1,
+    LE_NOT_POSSIBLE = -2,
+    LE_OUT_OF_RANGE = -3,
+    LE_NO_MEMORY = -4,
+    LE_NOT_PERMITTED = -5,
+    LE_FAULT = -6,
+    LE_COMM_ERROR = -7,
+    LE_TIMEOUT = -8,
+    LE_OVERFLOW = -9,
+    LE_UNDERFLOW = -10,
+    LE_WOULD_BLOCK = -11,
+    LE_DEADLOCK = -12,
+    LE_FORMAT_ERROR = -13,
+    LE_DUPLICATE = -14,
+    LE_BAD_PARAMETER = -15,
+    LE_CLOSED = -16,
+    LE_BUSY = -17,
+    LE_UNSUPPORTED = -18,
+    LE_IO_ERROR = -19,
+    LE_NOT_IMPLEMENTED = -20,
+    LE_UNAVAILABLE = -21,
+    LE_TERMINATED = -22,
+    LE_IN_PROGRESS = -23,
+}
+le_result_t;
+
+const char* le_result_ToString(le_result_t result);
+
+#define LE_RESULT_TXT(result) le_result_ToString(result)
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Logging.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef enum
+{
+    LE_LOG_DEBUG,
+    LE_LOG_INFO,
+    LE_LOG_WARN,
+    LE_LOG_ERR,
+    LE_LOG_CRIT,
+    LE_LOG_EMERG,
+}
+le_log_Level_t;
+
+void _le_log_Send(le_log_Level_t level, const char* fileName, unsigned int line,
+                  const char* format, ...) __attribute__((format(printf, 4, 5)));
+
+#define _LE_LOG(level, ...) _le_log_Send((level), __FILE__, __LINE__, __VA_ARGS__)
+
+#define LE_DEBUG(...) _LE_LOG(LE_LOG_DEBUG, __VA_ARGS__)
+#define LE_INFO(...) _LE_LOG(LE_LOG_INFO, __VA_ARGS__)
+#define LE_WARN(...) _LE_LOG(LE_LOG_WARN, __VA_ARGS__)
+#define LE_ERROR(...) _LE_LOG(LE_LOG_ERR, __VA_ARGS__)
+#define LE_CRIT(...) _LE_LOG(LE_LOG_CRIT, __VA_ARGS__)
+#define LE_EMERG(...) _LE_LOG(LE_LOG_EMERG, __VA_ARGS__)
+
+#define LE_DEBUG_IF(condition, ...) do { if (condition) { LE_DEBUG(__VA_ARGS__); } } while (0)
+#define LE_INFO_IF(condition, ...) do { if (condition) { LE_INFO(__VA_ARGS__); } } while (0)
+#define LE_WARN_IF(condition, ...) do { if (condition) { LE_WARN(__VA_ARGS__); } } while (0)
+#define LE_ERROR_IF(condition, ...) do { if (condition) { LE_ERROR(__VA_ARGS__); } } while (0)
+
+#define LE_FATAL(...) do { LE_EMERG(__VA_ARGS__); abort(); } while (0)
+#define LE_FATAL_IF(condition, ...) do { if (condition) { LE_FATAL(__VA_ARGS__); } } while (0)
+#define LE_ASSERT(condition) LE_FATAL_IF(!(condition), "Assert Failed: '%s'", #condition)
+#define LE_ASSERT_OK(condition) LE_FATAL_IF((condition) != LE_OK, "Assert Failed: '%s'", #condition)
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Clock.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+    time_t sec;     ///< Seconds.
+    long usec;      ///< Microseconds.
+}
+le_clk_Time_t;
+
+le_clk_Time_t le_clk_GetAbsoluteTime(void);
+le_clk_Time_t le_clk_GetRelativeTime(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Memory pools.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_mem_Pool* le_mem_PoolRef_t;
+
+le_mem_PoolRef_t le_mem_CreatePool(const char* name, size_t objSize);
+le_mem_PoolRef_t le_mem_ExpandPool(le_mem_PoolRef_t pool, size_t numObjects);
+void* le_mem_ForceAlloc(le_mem_PoolRef_t pool);
+void* le_mem_TryAlloc(le_mem_PoolRef_t pool);
+void le_mem_AddRef(void* objPtr);
+void le_mem_Release(void* objPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Doubly linked lists.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_dls_Link
+{
+    struct le_dls_Link* nextPtr;
+    struct le_dls_Link* prevPtr;
+}
+le_dls_Link_t;
+
+typedef struct
+{
+    le_dls_Link_t* headLinkPtr;     ///< First link, whose prevPtr is the last (NULL if empty).
+}
+le_dls_List_t;
+
+#define LE_DLS_LIST_INIT (le_dls_List_t){ NULL }
+#define LE_DLS_LINK_INIT (le_dls_Link_t){ NULL, NULL }
+
+void le_dls_Queue(le_dls_List_t* listPtr, le_dls_Link_t* newLinkPtr);
+void le_dls_Stack(le_dls_List_t* listPtr, le_dls_Link_t* newLinkPtr);
+le_dls_Link_t* le_dls_Pop(le_dls_List_t* listPtr);
+le_dls_Link_t* le_dls_Peek(const le_dls_List_t* listPtr);
+le_dls_Link_t* le_dls_PeekNext(const le_dls_List_t* listPtr, const le_dls_Link_t* currentLinkPtr);
+void le_dls_Remove(le_dls_List_t* listPtr, le_dls_Link_t* linkToRemovePtr);
+bool le_dls_IsEmpty(const le_dls_List_t* listPtr);
+size_t le_dls_NumLinks(const le_dls_List_t* listPtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Timers.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_timer* le_timer_Ref_t;
+typedef void (*le_timer_ExpiryHandler_t)(le_timer_Ref_t timerRef);
+
+le_timer_Ref_t le_timer_Create(const char* nameStr);
+void le_timer_Delete(le_timer_Ref_t timerRef);
+le_result_t le_timer_SetHandler(le_timer_Ref_t timerRef, le_timer_ExpiryHandler_t handlerFunc);
+le_result_t le_timer_SetMsInterval(le_timer_Ref_t timerRef, uint32_t interval);
+le_result_t le_timer_SetRepeat(le_timer_Ref_t timerRef, uint32_t repeatCount);
+le_result_t le_timer_SetContextPtr(le_timer_Ref_t timerRef, void* contextPtr);
+void* le_timer_GetContextPtr(le_timer_Ref_t timerRef);
+le_result_t le_timer_Start(le_timer_Ref_t timerRef);
+le_result_t le_timer_Stop(le_timer_Ref_t timerRef);
+bool le_timer_IsRunning(le_timer_Ref_t timerRef);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Threads, events and semaphores.  There's only the one thread on the host.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef struct le_thread* le_thread_Ref_t;
+typedef void* (*le_thread_MainFunc_t)(void* contextPtr);
+
+le_thread_Ref_t le_thread_Create(const char* name, le_thread_MainFunc_t mainFunc, void* contextPtr);
+void le_thread_Start(le_thread_Ref_t threadRef);
+le_thread_Ref_t le_thread_GetCurrent(void);
+
+typedef void (*le_event_DeferredFunc_t)(void* param1Ptr, void* param2Ptr);
+
+void le_event_QueueFunction(le_event_DeferredFunc_t func, void* param1Ptr, void* param2Ptr);
+void le_event_QueueFunctionToThread(le_thread_Ref_t thread, le_event_DeferredFunc_t func,
+                                    void* param1Ptr, void* param2Ptr);
+void le_event_RunLoop(void) __attribute__((noreturn));
+
+typedef struct le_sem* le_sem_Ref_t;
+
+le_sem_Ref_t le_sem_Create(const char* name, int32_t initialCount);
+void le_sem_Delete(le_sem_Ref_t semaphorePtr);
+void le_sem_Wait(le_sem_Ref_t semaphorePtr);
+void le_sem_Post(le_sem_Ref_t semaphorePtr);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Signals.  No signals are delivered to the handlers on the host.
+ */
+//--------------------------------------------------------------------------------------------------
+
+typedef void (*le_sig_EventHandlerFunc_t)(int sigNum);
+
+void le_sig_Block(int sigNum);
+void le_sig_SetEventHandler(int sigNum, le_sig_EventHandlerFunc_t sigEventHandler);
+
+
+//--------------------------------------------------------------------------------------------------
+/*
+ * Strings, directories and random numbers.
+ */
+//--------------------------------------------------------------------------------------------------
+
+le_result_t le_utf8_Copy(char* destStr, const char* srcStr, size_t destSize, size_t* numBytesPtr);
+le_result_t le_dir_MakePath(const char* pathNamePtr, mode_t mode);
+uint32_t le_rand_GetNumBetween(uint32_t min, uint32_t max);
+
+
+#endif // LEGATO_H_INCLUDE_GUARD
@@ -0,0 +1,491 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file columnCodecTest.c
+ *
+ * Unit tests of the columnCodec component.  The component only encodes (AirVantage decodes), so
+ * the blocks are checked by decoding them here, following the format documented in columnCodec.h:
+ * round trips, a known block, the COLUMN_CODEC_MAX_SAMPLES and COLUMN_CODEC_MAX_BYTES limits,
+ * values and timestamps that can't be represented, and timestamps just short of a millisecond.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "le_test.h"
+#include "columnCodec.h"
+
+/// Largest magnitude of a quantized value.  See MAX_QUANTIZED in columnCodec.c.
+#define MAX_QUANTIZED 4.0e18
+
+/// A decoded block.
+typedef struct
+{
+    uint8_t version;
+    size_t columnCount;
+    size_t sampleCount;
+    int8_t exponents[COLUMN_CODEC_MAX_COLUMNS];
+    uint64_t timestamps[COLUMN_CODEC_MAX_SAMPLES];  ///< Milliseconds since the Epoch.
+    int64_t values[COLUMN_CODEC_MAX_SAMPLES][COLUMN_CODEC_MAX_COLUMNS];  ///< Quantized.
+    size_t byteCount;       ///< Size of the block before base64 conversion.
+}
+Decoded_t;
+
+/// Blocks used by the tests (too big for the stack).
+static columnCodec_Block_t Block;
+static Decoded_t Decoded;
+static char Text[COLUMN_CODEC_TEXT_BYTES];
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode standard base64 text.
+ *
+ * @return Number of bytes, or -1 if the text isn't valid base64.
+ */
+//--------------------------------------------------------------------------------------------------
+static ssize_t DecodeBase64
+(
+    const char* text,
+    uint8_t* bytes,
+    size_t size
+)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t len = strlen(text);
+    size_t count = 0;
+
+    if ((len % 4) != 0)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < len; i += 4)
+    {
+        uint32_t group = 0;
+        size_t padCount = 0;
+
+        for (size_t j = 0; j < 4; j++)
+        {
+            const char* digitPtr = strchr(digits, text[i + j]);
+
+            if ((text[i + j] == '=') && ((i + 4) == len) && (j >= 2))
+            {
+                padCount++;
+                group <<= 6;
+            }
+            else if ((digitPtr == NULL) || (padCount > 0))
+            {
+                return -1;
+            }
+            else
+            {
+                group = (group << 6) | (uint32_t)(digitPtr - digits);
+            }
+        }
+
+        for (size_t j = 0; j < (3 - padCount); j++)
+        {
+            if (count == size)
+            {
+                return -1;
+            }
+            bytes[count++] = (uint8_t)(group >> (16 - (8 * j)));
+        }
+    }
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a varint.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if it runs off the end of the bytes or is too long.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetVarint
+(
+    const uint8_t** bytePtrPtr,
+    const uint8_t* endPtr,
+    uint64_t* valuePtr
+)
+{
+    uint64_t value = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+        if (*bytePtrPtr == endPtr)
+        {
+            return LE_FORMAT_ERROR;
+        }
+
+        uint8_t byte = *(*bytePtrPtr)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            *valuePtr = value;
+            return LE_OK;
+        }
+    }
+
+    return LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a block from its base64 text.
+ *
+ * @return LE_OK, or LE_FORMAT_ERROR if it isn't a well-formed block.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t DecodeBlock
+(
+    const char* text,
+    Decoded_t* decodedPtr   ///< [OUT]
+)
+{
+    uint8_t bytes[COLUMN_CODEC_MAX_BYTES + 3];
+    ssize_t byteCount = DecodeBase64(text, bytes, sizeof(bytes));
+    uint64_t number;
+
+    if (byteCount < 3)
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    const uint8_t* bytePtr = bytes;
+    const uint8_t* endPtr = bytes + byteCount;
+
+    decodedPtr->byteCount = byteCount;
+    decodedPtr->version = *bytePtr++;
+    decodedPtr->columnCount = *bytePtr++;
+    if (   (decodedPtr->columnCount > COLUMN_CODEC_MAX_COLUMNS)
+        || (GetVarint(&bytePtr, endPtr, &number) != LE_OK)
+        || (number > COLUMN_CODEC_MAX_SAMPLES)
+        || ((endPtr - bytePtr) < (ssize_t)decodedPtr->columnCount))
+    {
+        return LE_FORMAT_ERROR;
+    }
+    decodedPtr->sampleCount = number;
+
+    for (size_t col = 0; col < decodedPtr->columnCount; col++)
+    {
+        decodedPtr->exponents[col] = (int8_t)*bytePtr++;
+    }
+
+    uint64_t timestamp = 0;
+    for (size_t i = 0; i < decodedPtr->sampleCount; i++)
+    {
+        if (GetVarint(&bytePtr, endPtr, &number) != LE_OK)
+        {
+            return LE_FORMAT_ERROR;
+        }
+        timestamp += number;
+        decodedPtr->timestamps[i] = timestamp;
+    }
+
+    for (size_t col = 0; col < decodedPtr->columnCount; col++)
+    {
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < decodedPtr->sampleCount; i++)
+        {
+            if (GetVarint(&bytePtr, endPtr, &number) != LE_OK)
+            {
+                return LE_FORMAT_ERROR;
+            }
+
+            // Undo the zigzag mapping, then the delta (wrapping, as the encoder's deltas may).
+            value += (number >> 1) ^ (~(number & 1) + 1);
+            decodedPtr->values[i][col] = (int64_t)value;
+        }
+    }
+
+    return (bytePtr == endPtr) ? LE_OK : LE_FORMAT_ERROR;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that a block of IMU-like samples decodes to its samples, at the columns' resolutions.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRoundTrip
+(
+    void
+)
+{
+    const int8_t exponents[] = { -3, -3, -2, 0 };
+    const size_t count = 100;
+    double samples[100][4];
+    bool isAdded = true;
+
+    columnCodec_Start(&Block, NUM_ARRAY_MEMBERS(exponents), exponents);
+    LE_TEST_OK(columnCodec_GetCount(&Block) == 0, "a new block is empty");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double timestamp = 1600000000.0 + (i * 0.01) + ((i % 3) * 0.001);
+
+        samples[i][0] = sin(i * 0.1) * 2.0;
+        samples[i][1] = -9.80665 + (i * 0.0001);
+        samples[i][2] = (i % 2) ? 123.45 : -123.45;
+        samples[i][3] = (double)i * i;
+
+        isAdded = isAdded && (columnCodec_Add(&Block, timestamp, samples[i]) == LE_OK);
+    }
+    LE_TEST_ASSERT(isAdded && (columnCodec_GetCount(&Block) == count), "add %zu samples", count);
+
+    LE_TEST_ASSERT(columnCodec_Encode(&Block, Text, sizeof(Text)) == LE_OK, "encode the block");
+    LE_TEST_ASSERT(DecodeBlock(Text, &Decoded) == LE_OK, "the block decodes");
+
+    LE_TEST_OK(   (Decoded.version == COLUMN_CODEC_VERSION)
+               && (Decoded.columnCount == NUM_ARRAY_MEMBERS(exponents))
+               && (Decoded.sampleCount == count)
+               && (memcmp(Decoded.exponents, exponents, sizeof(exponents)) == 0),
+               "header holds the version, columns, count and exponents");
+
+    bool isTimestampOk = true;
+    bool isValueOk = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t ms = 1600000000000 + (i * 10) + (i % 3);
+
+        isTimestampOk = isTimestampOk && (Decoded.timestamps[i] == ms);
+
+        for (size_t col = 0; col < NUM_ARRAY_MEMBERS(exponents); col++)
+        {
+            double resolution = pow(10.0, exponents[col]);
+            double value = Decoded.values[i][col] * resolution;
+
+            isValueOk = isValueOk && (fabs(value - samples[i][col]) <= (resolution / 2.0));
+        }
+    }
+    LE_TEST_OK(isTimestampOk, "timestamps decode to the millisecond");
+    LE_TEST_OK(isValueOk, "values decode to within half their resolution");
+    size_t rawBytes = count * (NUM_ARRAY_MEMBERS(exponents) + 1) * sizeof(double);
+    LE_TEST_OK(Decoded.byteCount < (rawBytes / 4),
+               "the block is under a quarter of the raw doubles (%zu bytes for %zu samples)",
+               Decoded.byteCount, count);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the encoding of a block small enough to work out by hand.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestKnownBlock
+(
+    void
+)
+{
+    const int8_t exponent = 0;
+    const double value = -1.0;
+    char text[13];
+
+    // Version 1, 1 column, 1 sample, exponent 0, timestamp 1000 ms (e8 07), zigzag(-1) = 1.
+    columnCodec_Start(&Block, 1, &exponent);
+    LE_TEST_ASSERT(columnCodec_Add(&Block, 1.0, &value) == LE_OK, "add one sample");
+    LE_TEST_OK(columnCodec_Encode(&Block, text, sizeof(text) - 1) == LE_OVERFLOW,
+               "a buffer one byte short overflows");
+    LE_TEST_OK((columnCodec_Encode(&Block, text, sizeof(text)) == LE_OK)
+               && (strcmp(text, "AQEBAOgHAQ==") == 0),
+               "one sample encodes as 'AQEBAOgHAQ==' ('%s')", text);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that a block takes up to COLUMN_CODEC_MAX_SAMPLES samples.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestMaxSamples
+(
+    void
+)
+{
+    const int8_t exponent = -1;
+    bool isAdded = true;
+
+    columnCodec_Start(&Block, 1, &exponent);
+
+    for (size_t i = 0; i < COLUMN_CODEC_MAX_SAMPLES; i++)
+    {
+        double value = i * 0.1;
+
+        isAdded = isAdded && (columnCodec_Add(&Block, 100.0 + i, &value) == LE_OK);
+    }
+    LE_TEST_OK(isAdded, "%d samples fit", COLUMN_CODEC_MAX_SAMPLES);
+
+    double value = 0.0;
+    LE_TEST_OK(columnCodec_Add(&Block, 1000.0, &value) == LE_OVERFLOW, "one more overflows");
+    LE_TEST_OK(columnCodec_GetCount(&Block) == COLUMN_CODEC_MAX_SAMPLES,
+               "and isn't added");
+    LE_TEST_OK((columnCodec_Encode(&Block, Text, sizeof(Text)) == LE_OK)
+               && (DecodeBlock(Text, &Decoded) == LE_OK)
+               && (Decoded.sampleCount == COLUMN_CODEC_MAX_SAMPLES)
+               && (Decoded.timestamps[COLUMN_CODEC_MAX_SAMPLES - 1]
+                   == (100 + COLUMN_CODEC_MAX_SAMPLES - 1) * 1000),
+               "the full block decodes");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that a block stops at COLUMN_CODEC_MAX_BYTES, with samples that barely compress.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestMaxBytes
+(
+    void
+)
+{
+    const int8_t exponents[COLUMN_CODEC_MAX_COLUMNS] = { 0 };
+    double values[COLUMN_CODEC_MAX_COLUMNS];
+    le_result_t result = LE_OK;
+    size_t count = 0;
+
+    columnCodec_Start(&Block, COLUMN_CODEC_MAX_COLUMNS, exponents);
+
+    // Swing between the extremes, so every delta takes the longest varint.
+    while ((result == LE_OK) && (count <= COLUMN_CODEC_MAX_SAMPLES))
+    {
+        for (size_t col = 0; col < COLUMN_CODEC_MAX_COLUMNS; col++)
+        {
+            values[col] = (count % 2) ? MAX_QUANTIZED : -MAX_QUANTIZED;
+        }
+
+        result = columnCodec_Add(&Block, 1e6 * count, values);
+        if (result == LE_OK)
+        {
+            count++;
+        }
+    }
+
+    LE_TEST_OK((result == LE_OVERFLOW) && (count < COLUMN_CODEC_MAX_SAMPLES),
+               "the block fills up by size, after %zu samples", count);
+    LE_TEST_OK(columnCodec_GetCount(&Block) == count, "the sample that didn't fit isn't added");
+    LE_TEST_OK((columnCodec_Encode(&Block, Text, sizeof(Text)) == LE_OK)
+               && (DecodeBlock(Text, &Decoded) == LE_OK)
+               && (Decoded.byteCount <= COLUMN_CODEC_MAX_BYTES)
+               && (Decoded.byteCount > (COLUMN_CODEC_MAX_BYTES - 100))
+               && (strlen(Text) < COLUMN_CODEC_TEXT_BYTES),
+               "it decodes, and is just under COLUMN_CODEC_MAX_BYTES (%zu bytes)",
+               Decoded.byteCount);
+    LE_TEST_OK(   (Decoded.values[0][0] == -(int64_t)MAX_QUANTIZED)
+               && (Decoded.values[count - 1][COLUMN_CODEC_MAX_COLUMNS - 1]
+                   == (((count - 1) % 2) ? (int64_t)MAX_QUANTIZED : -(int64_t)MAX_QUANTIZED)),
+               "the extreme values survive their deltas");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that values and timestamps that can't be represented are refused.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestOutOfRange
+(
+    void
+)
+{
+    const int8_t exponent = -3;
+    double value;
+
+    columnCodec_Start(&Block, 1, &exponent);
+
+    value = MAX_QUANTIZED / 1000.0;
+    LE_TEST_OK(columnCodec_Add(&Block, 10.0, &value) == LE_OK,
+               "the largest value at the column's resolution is accepted");
+
+    static const struct
+    {
+        double value;
+        const char* why;
+    }
+    cases[] =
+    {
+        { MAX_QUANTIZED / 100.0, "a value too large at the resolution" },
+        { -MAX_QUANTIZED / 100.0, "a value too negative at the resolution" },
+        { NAN, "NaN" },
+        { INFINITY, "infinity" },
+    };
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(cases); i++)
+    {
+        LE_TEST_OK(columnCodec_Add(&Block, 11.0, &cases[i].value) == LE_OUT_OF_RANGE,
+                   "%s is refused", cases[i].why);
+    }
+
+    value = 1.0;
+    LE_TEST_OK(columnCodec_Add(&Block, 9.999, &value) == LE_OUT_OF_RANGE,
+               "a timestamp older than the previous sample's is refused");
+    LE_TEST_OK(columnCodec_Add(&Block, -1.0, &value) == LE_OUT_OF_RANGE,
+               "a negative timestamp is refused");
+    LE_TEST_OK(columnCodec_GetCount(&Block) == 1, "none of them were added");
+    LE_TEST_OK(columnCodec_Add(&Block, 10.0, &value) == LE_OK,
+               "a timestamp equal to the previous sample's is accepted");
+
+    LE_TEST_OK((columnCodec_Encode(&Block, Text, sizeof(Text)) == LE_OK)
+               && (DecodeBlock(Text, &Decoded) == LE_OK)
+               && (Decoded.sampleCount == 2)
+               && (Decoded.timestamps[1] == Decoded.timestamps[0])
+               && (Decoded.values[1][0] == 1000),
+               "the block still decodes");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that a timestamp a floating point error short of a millisecond boundary is taken as that
+ * millisecond, as avPublisher records it, rather than truncated to the millisecond before.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestTimestampRounding
+(
+    void
+)
+{
+    const int8_t exponent = 0;
+    const double value = 1.0;
+
+    // 1546300800.002 s, as the sensors' microsecond timestamp 1546300800002000 * 1e-6 comes out.
+    double timestamp = nextafter(1546300800.002, 0.0);
+
+    LE_TEST_OK((uint64_t)(timestamp * 1000.0) == 1546300800001,
+               "the timestamp truncates to the millisecond before");
+    LE_TEST_OK(columnCodec_TimestampToMs(timestamp) == 1546300800002,
+               "the timestamp converts to its millisecond");
+
+    columnCodec_Start(&Block, 1, &exponent);
+    LE_TEST_ASSERT(columnCodec_Add(&Block, timestamp, &value) == LE_OK, "add the sample");
+    LE_TEST_OK((columnCodec_Encode(&Block, Text, sizeof(Text)) == LE_OK)
+               && (DecodeBlock(Text, &Decoded) == LE_OK)
+               && (Decoded.timestamps[0] == 1546300800002),
+               "the block holds the timestamp's millisecond (%"PRIu64")", Decoded.timestamps[0]);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main
+(
+    void
+)
+{
+    LE_TEST_PLAN(LE_TEST_NO_PLAN);
+
+    TestRoundTrip();
+    TestKnownBlock();
+    TestMaxSamples();
+    TestMaxBytes();
+    TestOutOfRange();
+    TestTimestampRounding();
+
+    LE_TEST_EXIT;
+}
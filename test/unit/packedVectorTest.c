@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file packedVectorTest.c
+ *
+ * Unit tests of the packedVector component: round trips of values that decimal text would mangle,
+ * the fixed layout, buffer sizes at the boundary and malformed strings.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "le_test.h"
+#include "packedVector.h"
+
+/// Values that must come back bit for bit.
+static const double RoundTripValues[] =
+{
+    0.0, -0.0, 1.0, -1.0, 0.1, 9.80665, 1e-300, -1e300, 4.9e-324, 1.7976931348623157e308,
+    INFINITY, -INFINITY,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that values survive an encode and a decode unchanged, bit for bit.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRoundTrip
+(
+    void
+)
+{
+    const size_t count = NUM_ARRAY_MEMBERS(RoundTripValues);
+    char packed[PACKED_VECTOR_BUFFER_BYTES(NUM_ARRAY_MEMBERS(RoundTripValues))];
+    double values[NUM_ARRAY_MEMBERS(RoundTripValues)];
+
+    LE_TEST_ASSERT(packedVector_Encode(RoundTripValues, count, packed, sizeof(packed)) == LE_OK,
+                   "encode %zu members", count);
+    LE_TEST_OK(strlen(packed) == (count * PACKED_VECTOR_CHARS_PER_MEMBER),
+               "packed vector is %zu characters", count * PACKED_VECTOR_CHARS_PER_MEMBER);
+    LE_TEST_ASSERT(packedVector_Decode(packed, values, count) == LE_OK,
+                   "decode %zu members", count);
+    LE_TEST_OK(memcmp(values, RoundTripValues, sizeof(values)) == 0,
+               "values are bit for bit equal");
+
+    double nan = NAN;
+    double nanBack;
+    char nanPacked[PACKED_VECTOR_BUFFER_BYTES(1)];
+
+    LE_TEST_OK((packedVector_Encode(&nan, 1, nanPacked, sizeof(nanPacked)) == LE_OK)
+               && (packedVector_Decode(nanPacked, &nanBack, 1) == LE_OK)
+               && isnan(nanBack),
+               "NaN survives");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the layout: big-endian hex digits of the IEEE-754 representation, in member order.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestLayout
+(
+    void
+)
+{
+    const double values[] = { 1.0, -2.0 };
+    char packed[PACKED_VECTOR_BUFFER_BYTES(2)];
+
+    LE_TEST_OK((packedVector_Encode(values, 2, packed, sizeof(packed)) == LE_OK)
+               && (strcmp(packed, "3ff0000000000000c000000000000000") == 0),
+               "1.0, -2.0 packs as '%s'", packed);
+
+    double value;
+    LE_TEST_OK((packedVector_Decode("3FF0000000000000", &value, 1) == LE_OK) && (value == 1.0),
+               "upper-case digits are accepted");
+
+    char empty[PACKED_VECTOR_BUFFER_BYTES(0)];
+    LE_TEST_OK((packedVector_Encode(values, 0, empty, sizeof(empty)) == LE_OK)
+               && (empty[0] == '\0')
+               && (packedVector_Decode("", &value, 0) == LE_OK),
+               "a vector of no members is empty");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the buffer sizes at the boundary.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestOverflow
+(
+    void
+)
+{
+    const double values[] = { 1.0, 2.0, 3.0 };
+    char packed[PACKED_VECTOR_BUFFER_BYTES(3)];
+
+    LE_TEST_OK(packedVector_Encode(values, 3, packed, sizeof(packed)) == LE_OK,
+               "a buffer of PACKED_VECTOR_BUFFER_BYTES(3) is enough");
+
+    memset(packed, 'x', sizeof(packed));
+    LE_TEST_OK(packedVector_Encode(values, 3, packed, sizeof(packed) - 1) == LE_OVERFLOW,
+               "one byte less overflows");
+    LE_TEST_OK(packed[0] == 'x', "nothing is written on overflow");
+    LE_TEST_OK(packedVector_Encode(values, 0, packed, 0) == LE_OVERFLOW,
+               "an empty vector still needs its terminator");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that malformed strings are rejected.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestFormatErrors
+(
+    void
+)
+{
+    static const struct
+    {
+        const char* packed;
+        const char* why;
+    }
+    cases[] =
+    {
+        { "3ff000000000000", "one digit short" },
+        { "3ff00000000000000", "one digit too many" },
+        { "3ff0000000000000c000000000000000", "a member too many" },
+        { "3ff000000000000g", "a character that isn't hex" },
+        { "3ff0000000000 00", "a space" },
+        { "", "an empty string" },
+        { "1.0", "decimal text" },
+    };
+    double value;
+
+    for (size_t i = 0; i < NUM_ARRAY_MEMBERS(cases); i++)
+    {
+        LE_TEST_OK(packedVector_Decode(cases[i].packed, &value, 1) == LE_FORMAT_ERROR,
+                   "%s is rejected", cases[i].why);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main
+(
+    void
+)
+{
+    LE_TEST_PLAN(LE_TEST_NO_PLAN);
+
+    TestRoundTrip();
+    TestLayout();
+    TestOverflow();
+    TestFormatErrors();
+
+    LE_TEST_EXIT;
+}
@@ -0,0 +1,435 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sampleQueueTest.c
+ *
+ * Unit tests of the sampleQueue component: round trips, duplicate and oversized samples, segment
+ * rollover, the delivered cursor, and recovery after a crash that left unsynced samples and a
+ * torn record behind.  A restart is simulated by writing the queue in a child process, and
+ * opening it again in this one.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "le_test.h"
+#include "sampleQueue.h"
+
+#include <dirent.h>
+#include <ftw.h>
+#include <sys/wait.h>
+
+/// Size of a numeric record in a segment file: a 24-byte header and the value.
+#define NUMERIC_RECORD_BYTES (24 + sizeof(double))
+
+/// Largest string value a queue can hold (bytes).  See MAX_VALUE_BYTES in sampleQueue.c.
+#define MAX_VALUE_BYTES 4096
+
+void _sampleQueue_COMPONENT_INIT(void);
+
+/// Function run in a child process.  Returns its exit status.
+typedef int (*ChildFunc_t)(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remove a file or directory, for nftw().
+ *
+ * @return 0 to carry on.
+ */
+//--------------------------------------------------------------------------------------------------
+static int RemoveEntry
+(
+    const char* path,
+    const struct stat* statPtr,
+    int flag,
+    struct FTW* ftwPtr
+)
+{
+    (void)remove(path);
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a queue's segment files, and find the newest one.
+ *
+ * @return The number of segment files.
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t CountSegments
+(
+    const char* name,
+    char* newestPath,       ///< [OUT] Path of the newest segment file (NULL if not wanted).
+    size_t newestPathSize
+)
+{
+    char dirPath[PATH_MAX];
+    uint32_t newestSeq = 0;
+    size_t count = 0;
+
+    snprintf(dirPath, sizeof(dirPath), "%s/%s", QUEUE_ROOT, name);
+
+    DIR* dirPtr = opendir(dirPath);
+    LE_ASSERT(dirPtr != NULL);
+
+    struct dirent* entryPtr;
+    while ((entryPtr = readdir(dirPtr)) != NULL)
+    {
+        uint32_t seq;
+
+        if (sscanf(entryPtr->d_name, "seg-%08" SCNx32, &seq) == 1)
+        {
+            count++;
+            if (seq > newestSeq)
+            {
+                newestSeq = seq;
+                if (newestPath != NULL)
+                {
+                    LE_ASSERT(snprintf(newestPath, newestPathSize, "%s/%s",
+                                       dirPath, entryPtr->d_name) < (int)newestPathSize);
+                }
+            }
+        }
+    }
+
+    closedir(dirPtr);
+
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a function in a child process, as if it were an earlier run of the app.
+ *
+ * @return The child's exit status, or -1 if it didn't exit normally.
+ */
+//--------------------------------------------------------------------------------------------------
+static int RunInChild
+(
+    ChildFunc_t func
+)
+{
+    fflush(NULL);
+
+    pid_t pid = fork();
+    LE_ASSERT(pid >= 0);
+
+    if (pid == 0)
+    {
+        // Exit without syncing or flushing anything, as a crash would.
+        _exit(func());
+    }
+
+    int status;
+    LE_ASSERT(waitpid(pid, &status, 0) == pid);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that numeric and string samples read back in order, with their types.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRoundTrip
+(
+    void
+)
+{
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("roundTrip", 4, 4096);
+    double timestamp;
+    double value;
+    char text[16];
+
+    LE_TEST_OK(sampleQueue_GetNewest(queueRef) == 0.0, "a new queue has no newest sample");
+    LE_TEST_OK(sampleQueue_ReadNumeric(queueRef, 0.0, &timestamp, &value) == LE_NOT_FOUND,
+               "a new queue is empty");
+
+    LE_TEST_ASSERT((sampleQueue_AppendNumeric(queueRef, 100.0, 1.5) == LE_OK)
+                   && (sampleQueue_AppendString(queueRef, 100.25, "{\"a\":1}") == LE_OK)
+                   && (sampleQueue_AppendNumeric(queueRef, 100.5, -0.0) == LE_OK)
+                   && (sampleQueue_AppendString(queueRef, 101.0, "") == LE_OK),
+                   "append numeric and string samples");
+    LE_TEST_OK(sampleQueue_GetNewest(queueRef) == 101.0, "newest is the last appended");
+
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, 0.0, &timestamp, &value) == LE_OK)
+               && (timestamp == 100.0) && (value == 1.5),
+               "first sample reads back");
+    LE_TEST_OK(sampleQueue_ReadNumeric(queueRef, timestamp, &timestamp, &value)
+               == LE_FORMAT_ERROR,
+               "reading a string sample as numeric fails");
+    LE_TEST_OK(timestamp == 100.25, "but gives its timestamp, to skip it");
+    LE_TEST_OK(sampleQueue_ReadString(queueRef, 100.0, &timestamp, text, 7) == LE_OVERFLOW,
+               "a string sample too big for the buffer overflows");
+    LE_TEST_OK((sampleQueue_ReadString(queueRef, 100.0, &timestamp, text, 8) == LE_OK)
+               && (timestamp == 100.25) && (strcmp(text, "{\"a\":1}") == 0),
+               "a buffer of exactly its size is enough");
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, timestamp, &timestamp, &value) == LE_OK)
+               && (timestamp == 100.5) && (value == 0.0) && signbit(value),
+               "negative zero reads back");
+    LE_TEST_OK((sampleQueue_ReadString(queueRef, timestamp, &timestamp, text, sizeof(text))
+                == LE_OK)
+               && (timestamp == 101.0) && (text[0] == '\0'),
+               "an empty string reads back");
+    LE_TEST_OK(sampleQueue_ReadNumeric(queueRef, timestamp, &timestamp, &value) == LE_NOT_FOUND,
+               "nothing after the newest sample");
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, 100.1, &timestamp, &value) == LE_FORMAT_ERROR)
+               && (timestamp == 100.25),
+               "reading after a timestamp between samples finds the next one");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that samples no newer than the newest one, and oversized ones, are refused.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRefused
+(
+    void
+)
+{
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("refused", 4, 16384);
+    static char bigValue[MAX_VALUE_BYTES + 2];
+    double timestamp;
+    double value;
+
+    LE_TEST_ASSERT(sampleQueue_AppendNumeric(queueRef, 10.0, 1.0) == LE_OK, "append a sample");
+    LE_TEST_OK(sampleQueue_AppendNumeric(queueRef, 10.0, 2.0) == LE_DUPLICATE,
+               "same timestamp is a duplicate");
+    LE_TEST_OK(sampleQueue_AppendString(queueRef, 9.0, "x") == LE_DUPLICATE,
+               "older timestamp is a duplicate");
+
+    memset(bigValue, 'x', MAX_VALUE_BYTES);
+    LE_TEST_OK(sampleQueue_AppendString(queueRef, 11.0, bigValue) == LE_OK,
+               "a %d-byte string fits", MAX_VALUE_BYTES);
+    bigValue[MAX_VALUE_BYTES] = 'x';
+    LE_TEST_OK(sampleQueue_AppendString(queueRef, 12.0, bigValue) == LE_IO_ERROR,
+               "a %d-byte string doesn't", MAX_VALUE_BYTES + 1);
+    LE_TEST_OK(sampleQueue_GetNewest(queueRef) == 11.0, "refused samples aren't the newest");
+
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, 0.0, &timestamp, &value) == LE_OK)
+               && (timestamp == 10.0) && (value == 1.0),
+               "the duplicate didn't replace the original");
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, 10.0, &timestamp, &value) == LE_FORMAT_ERROR)
+               && (timestamp == 11.0)
+               && (sampleQueue_ReadNumeric(queueRef, 11.0, &timestamp, &value) == LE_NOT_FOUND),
+               "nothing was written for the refused samples");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that segments roll over when full, and that the oldest is dropped when the queue is.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRollover
+(
+    void
+)
+{
+    // Ten numeric records per segment, three segments.
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("rollover", 3, 10 * NUMERIC_RECORD_BYTES);
+    double timestamp;
+    double value;
+
+    for (int i = 1; i <= 10; i++)
+    {
+        LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, i, i));
+    }
+    LE_TEST_OK(CountSegments("rollover", NULL, 0) == 1, "a full segment is still one segment");
+
+    LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, 11, 11));
+    LE_TEST_OK(CountSegments("rollover", NULL, 0) == 2, "one more sample starts a new one");
+
+    for (int i = 12; i <= 35; i++)
+    {
+        LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, i, i));
+    }
+    LE_TEST_OK(CountSegments("rollover", NULL, 0) == 3, "the queue stops at three segments");
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, 0.0, &timestamp, &value) == LE_OK)
+               && (timestamp == 11.0),
+               "the oldest segment was dropped (oldest sample now %g)", timestamp);
+
+    int count = 0;
+    double last = 0.0;
+    while (sampleQueue_ReadNumeric(queueRef, last, &timestamp, &value) == LE_OK)
+    {
+        LE_ASSERT(timestamp > last);
+        LE_ASSERT(value == timestamp);
+        last = timestamp;
+        count++;
+    }
+    LE_TEST_OK((count == 25) && (last == 35.0),
+               "the samples left read back in order, across segments (%d)", count);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a queue for TestCursor(), and deliver some of it.
+ *
+ * @return 0
+ */
+//--------------------------------------------------------------------------------------------------
+static int WriteCursorQueue
+(
+    void
+)
+{
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("cursor", 8, 10 * NUMERIC_RECORD_BYTES);
+
+    for (int i = 1; i <= 30; i++)
+    {
+        LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, i, i));
+    }
+
+    sampleQueue_SetDelivered(queueRef, 25.0);
+    sampleQueue_SyncAll();
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that the delivered cursor frees delivered segments and survives a restart.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestCursor
+(
+    void
+)
+{
+    LE_TEST_ASSERT(RunInChild(WriteCursorQueue) == 0, "write and deliver in an earlier run");
+    LE_TEST_OK(CountSegments("cursor", NULL, 0) == 1,
+               "segments holding only delivered samples were deleted");
+
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("cursor", 8, 10 * NUMERIC_RECORD_BYTES);
+    double timestamp;
+    double value;
+
+    LE_TEST_OK(sampleQueue_GetDelivered(queueRef) == 25.0, "the cursor survived the restart");
+    LE_TEST_OK(sampleQueue_GetNewest(queueRef) == 30.0, "so did the newest sample");
+    LE_TEST_OK((sampleQueue_ReadNumeric(queueRef, sampleQueue_GetDelivered(queueRef),
+                                        &timestamp, &value) == LE_OK)
+               && (timestamp == 26.0),
+               "reading resumes after the cursor");
+
+    sampleQueue_SetDelivered(queueRef, 30.0);
+    LE_TEST_OK(CountSegments("cursor", NULL, 0) == 0, "delivering everything empties the queue");
+    LE_TEST_OK(sampleQueue_AppendNumeric(queueRef, 30.0, 0.0) == LE_DUPLICATE,
+               "but it still refuses samples no newer than the cursor");
+    LE_TEST_OK(sampleQueue_AppendNumeric(queueRef, 31.0, 31.0) == LE_OK,
+               "and takes newer ones");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a queue for TestCrash(), syncing only part of it, then crash.
+ *
+ * @return 0
+ */
+//--------------------------------------------------------------------------------------------------
+static int WriteCrashQueue
+(
+    void
+)
+{
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("crash", 4, 16384);
+
+    for (int i = 1; i <= 20; i++)
+    {
+        LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, i, i * 0.5));
+    }
+    sampleQueue_SyncAll();
+
+    // Still in the page cache when the process dies, so they must survive it.
+    for (int i = 21; i <= 25; i++)
+    {
+        LE_ASSERT_OK(sampleQueue_AppendNumeric(queueRef, i, i * 0.5));
+    }
+
+    return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that a queue reopens consistently after a crash that tore its last record.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestCrash
+(
+    void
+)
+{
+    char segmentPath[PATH_MAX];
+    struct stat fileStat;
+
+    LE_TEST_ASSERT(RunInChild(WriteCrashQueue) == 0, "write and crash in an earlier run");
+    LE_TEST_ASSERT(CountSegments("crash", segmentPath, sizeof(segmentPath)) == 1,
+                   "the crash left one segment");
+
+    // Tear a record: half of a plausible header, as if the power failed mid-write.
+    static const uint8_t tornRecord[] = { 0x31, 0x52, 0x51, 0x53, 0x08, 0x00, 0x00, 0x00,
+                                          0x00, 0x00, 0x00 };
+    int fd = open(segmentPath, O_WRONLY | O_APPEND);
+    LE_ASSERT(fd >= 0);
+    LE_ASSERT(write(fd, tornRecord, sizeof(tornRecord)) == sizeof(tornRecord));
+    close(fd);
+
+    sampleQueue_Ref_t queueRef = sampleQueue_Open("crash", 4, 16384);
+    double timestamp;
+    double value;
+    double last = 0.0;
+    int count = 0;
+
+    while (sampleQueue_ReadNumeric(queueRef, last, &timestamp, &value) == LE_OK)
+    {
+        if ((timestamp != (last + 1.0)) || (value != (timestamp * 0.5)))
+        {
+            break;
+        }
+        last = timestamp;
+        count++;
+    }
+    LE_TEST_OK(count == 25, "all 25 samples recovered, in order (%d)", count);
+    LE_TEST_OK(sampleQueue_GetNewest(queueRef) == 25.0, "the newest sample is the last whole one");
+    LE_TEST_OK((stat(segmentPath, &fileStat) == 0)
+               && (fileStat.st_size == (off_t)(25 * NUMERIC_RECORD_BYTES)),
+               "the torn record was cut off");
+
+    LE_TEST_OK((sampleQueue_AppendNumeric(queueRef, 26.0, 13.0) == LE_OK)
+               && (sampleQueue_ReadNumeric(queueRef, 25.0, &timestamp, &value) == LE_OK)
+               && (timestamp == 26.0) && (value == 13.0),
+               "appending carries on after the last whole record");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main
+(
+    void
+)
+{
+    LE_TEST_PLAN(LE_TEST_NO_PLAN);
+
+    (void)nftw(QUEUE_ROOT, RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+
+    _sampleQueue_COMPONENT_INIT();
+
+    TestRoundTrip();
+    TestRefused();
+    TestRollover();
+    TestCursor();
+    TestCrash();
+
+    LE_TEST_EXIT;
+}
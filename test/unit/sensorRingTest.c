@@ -0,0 +1,422 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file sensorRingTest.c
+ *
+ * Unit tests of the sensorRing component: round trips of records, within a process and across a
+ * fork, empty rings, consumers that fall behind by up to and more than the capacity, ring
+ * geometries at the boundary and files that aren't rings of the expected records.
+ *
+ * Copyright (C) Sierra Wireless Inc.
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "le_test.h"
+#include "sensorRing.h"
+
+#include <sys/wait.h>
+
+/// Size of the header at the start of a ring file (bytes).  See RingHeader_t in sensorRing.c.
+#define RING_HEADER_BYTES 24
+
+/// Largest number of records a ring can hold.  See MAX_CAPACITY in sensorRing.c.
+#define MAX_CAPACITY (1 << 20)
+
+void _sensorRing_COMPONENT_INIT(void);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Make the IMU record that carries a given number in each of its fields.
+ *
+ * @return The record.
+ */
+//--------------------------------------------------------------------------------------------------
+static sensorRing_ImuRecord_t ImuRecord
+(
+    uint64_t n
+)
+{
+    return (sensorRing_ImuRecord_t){
+        timestamp: 1700000000.0 + (n * 0.01),
+        accel: { n, -(double)n, n * 0.5 },
+        gyro: { n * 0.25, -(n * 0.125), 9.80665 * n }
+    };
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Attach to a producer's ring.
+ *
+ * @return The consumer (the test bails out if the attach fails).
+ */
+//--------------------------------------------------------------------------------------------------
+static sensorRing_ConsumerRef_t Attach
+(
+    sensorRing_ProducerRef_t producerRef,
+    size_t recordBytes
+)
+{
+    sensorRing_ConsumerRef_t consumerRef = NULL;
+
+    LE_TEST_ASSERT(sensorRing_Attach(sensorRing_GetFd(producerRef), recordBytes, &consumerRef)
+                   == LE_OK, "attach to a ring of %zu byte records", recordBytes);
+
+    return consumerRef;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that records come back as published, in order, and that a consumer only gets the records
+ * published after it attached.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestRoundTrip
+(
+    void
+)
+{
+    sensorRing_ProducerRef_t producerRef = sensorRing_Create(sizeof(sensorRing_ImuRecord_t), 16);
+    LE_TEST_ASSERT(producerRef != NULL, "create an IMU ring");
+
+    sensorRing_ImuRecord_t record = ImuRecord(0);
+    sensorRing_Publish(producerRef, &record);
+
+    sensorRing_ConsumerRef_t consumerRef = Attach(producerRef, sizeof(sensorRing_ImuRecord_t));
+
+    for (uint64_t n = 1; n <= 10; n++)
+    {
+        record = ImuRecord(n);
+        sensorRing_Publish(producerRef, &record);
+    }
+
+    bool isSame = true;
+    uint64_t lostCount = 1;
+    for (uint64_t n = 1; n <= 10; n++)
+    {
+        sensorRing_ImuRecord_t expected = ImuRecord(n);
+        if (   (sensorRing_Read(consumerRef, &record, &lostCount) != LE_OK)
+            || (lostCount != 0)
+            || (memcmp(&record, &expected, sizeof(record)) != 0))
+        {
+            isSame = false;
+        }
+    }
+    LE_TEST_OK(isSame, "the 10 records published after the attach come back in order, none lost");
+    LE_TEST_OK(sensorRing_Read(consumerRef, &record, NULL) == LE_WOULD_BLOCK,
+               "and nothing else");
+
+    // A second consumer has its own cursor.
+    sensorRing_ConsumerRef_t otherRef = Attach(producerRef, sizeof(sensorRing_ImuRecord_t));
+    record = ImuRecord(11);
+    sensorRing_Publish(producerRef, &record);
+
+    sensorRing_ImuRecord_t otherRecord;
+    LE_TEST_OK((sensorRing_Read(consumerRef, &record, NULL) == LE_OK)
+               && (sensorRing_Read(otherRef, &otherRecord, NULL) == LE_OK)
+               && (memcmp(&record, &otherRecord, sizeof(record)) == 0)
+               && (record.timestamp == ImuRecord(11).timestamp),
+               "two consumers both read the same record");
+
+    sensorRing_Detach(otherRef);
+    sensorRing_Detach(consumerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that reading an empty ring doesn't block, and reports nothing lost.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestEmpty
+(
+    void
+)
+{
+    sensorRing_ProducerRef_t producerRef =
+        sensorRing_Create(sizeof(sensorRing_PressureRecord_t), 4);
+    LE_TEST_ASSERT(producerRef != NULL, "create a pressure ring");
+
+    sensorRing_ConsumerRef_t consumerRef = Attach(producerRef,
+                                                  sizeof(sensorRing_PressureRecord_t));
+    sensorRing_PressureRecord_t record;
+    uint64_t lostCount = 1;
+
+    LE_TEST_OK((sensorRing_Read(consumerRef, &record, &lostCount) == LE_WOULD_BLOCK)
+               && (lostCount == 0),
+               "a new ring is empty");
+
+    record = (sensorRing_PressureRecord_t){ timestamp: 1700000000.0, pressure: 101.325 };
+    sensorRing_Publish(producerRef, &record);
+    LE_TEST_OK(sensorRing_Read(consumerRef, &record, NULL) == LE_OK, "read one record");
+
+    lostCount = 1;
+    LE_TEST_OK((sensorRing_Read(consumerRef, &record, &lostCount) == LE_WOULD_BLOCK)
+               && (lostCount == 0),
+               "the ring is empty again once it's read");
+
+    sensorRing_Detach(consumerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a consumer that falls behind: by exactly the capacity (rounded up to a power of two), it
+ * loses nothing; by more, it loses the oldest records, and is told how many, once.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestWrapAround
+(
+    void
+)
+{
+    // 5 rounds up to 8.
+    sensorRing_ProducerRef_t producerRef = sensorRing_Create(sizeof(sensorRing_ImuRecord_t), 5);
+    LE_TEST_ASSERT(producerRef != NULL, "create a ring of 5 records");
+
+    sensorRing_ConsumerRef_t consumerRef = Attach(producerRef, sizeof(sensorRing_ImuRecord_t));
+    sensorRing_ImuRecord_t record;
+    uint64_t n = 0;
+    uint64_t lostCount;
+
+    for (int i = 0; i < 8; i++, n++)
+    {
+        record = ImuRecord(n);
+        sensorRing_Publish(producerRef, &record);
+    }
+
+    int readCount = 0;
+    uint64_t totalLost = 0;
+    bool isInOrder = true;
+    while (sensorRing_Read(consumerRef, &record, &lostCount) == LE_OK)
+    {
+        isInOrder = isInOrder && (record.timestamp == ImuRecord(readCount).timestamp);
+        readCount++;
+        totalLost += lostCount;
+    }
+    LE_TEST_OK((readCount == 8) && (totalLost == 0) && isInOrder,
+               "8 records behind, all 8 are read in order (%d read, %"PRIu64" lost)",
+               readCount, totalLost);
+
+    // Fall behind by three laps and three records.
+    for (int i = 0; i < (3 * 8) + 3; i++, n++)
+    {
+        record = ImuRecord(n);
+        sensorRing_Publish(producerRef, &record);
+    }
+
+    LE_TEST_OK((sensorRing_Read(consumerRef, &record, &lostCount) == LE_OK)
+               && (lostCount == (3 * 8) + 3 - 8)
+               && (record.timestamp == ImuRecord(n - 8).timestamp),
+               "27 records behind, the oldest 19 are lost (%"PRIu64" lost)", lostCount);
+
+    readCount = 1;
+    totalLost = 0;
+    while (sensorRing_Read(consumerRef, &record, &lostCount) == LE_OK)
+    {
+        readCount++;
+        totalLost += lostCount;
+    }
+    LE_TEST_OK((readCount == 8) && (totalLost == 0)
+               && (record.timestamp == ImuRecord(n - 1).timestamp),
+               "then the last 8 are read, with nothing more lost");
+
+    sensorRing_Detach(consumerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that records published by another process (sharing the ring's file) are read.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestAcrossFork
+(
+    void
+)
+{
+    sensorRing_ProducerRef_t producerRef =
+        sensorRing_Create(sizeof(sensorRing_PressureRecord_t), 64);
+    LE_TEST_ASSERT(producerRef != NULL, "create a pressure ring");
+
+    sensorRing_ConsumerRef_t consumerRef = Attach(producerRef,
+                                                  sizeof(sensorRing_PressureRecord_t));
+
+    fflush(stdout);
+    pid_t pid = fork();
+    LE_TEST_ASSERT(pid >= 0, "fork a producer");
+    if (pid == 0)
+    {
+        for (int i = 0; i < 50; i++)
+        {
+            sensorRing_PressureRecord_t record = { timestamp: i, pressure: 100.0 + i };
+            sensorRing_Publish(producerRef, &record);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    int status;
+    LE_TEST_ASSERT((waitpid(pid, &status, 0) == pid) && WIFEXITED(status)
+                   && (WEXITSTATUS(status) == EXIT_SUCCESS), "producer exits");
+
+    sensorRing_PressureRecord_t record;
+    int readCount = 0;
+    bool isSame = true;
+    while (sensorRing_Read(consumerRef, &record, NULL) == LE_OK)
+    {
+        isSame = isSame && (record.timestamp == readCount)
+                        && (record.pressure == 100.0 + readCount);
+        readCount++;
+    }
+    LE_TEST_OK((readCount == 50) && isSame,
+               "the 50 records the other process published are read (%d)", readCount);
+
+    sensorRing_Detach(consumerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the ring geometries at the boundary.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestGeometry
+(
+    void
+)
+{
+    LE_TEST_OK(sensorRing_Create(0, 8) == NULL, "records of 0 bytes are refused");
+    LE_TEST_OK(sensorRing_Create(UINT16_MAX + 1, 1) == NULL,
+               "records of %d bytes are refused", UINT16_MAX + 1);
+    LE_TEST_OK(sensorRing_Create(1, MAX_CAPACITY + 1) == NULL,
+               "rings of %d records are refused", MAX_CAPACITY + 1);
+
+    sensorRing_ProducerRef_t producerRef = sensorRing_Create(UINT16_MAX, 1);
+    LE_TEST_ASSERT(producerRef != NULL, "a ring of one %d byte record is created", UINT16_MAX);
+
+    // Odd record sizes are padded in the ring, but only the record itself is copied out.
+    uint8_t published[UINT16_MAX];
+    uint8_t read[UINT16_MAX + 1];
+    for (size_t i = 0; i < sizeof(published); i++)
+    {
+        published[i] = i * 7;
+    }
+    memset(read, 0xa5, sizeof(read));
+
+    sensorRing_ConsumerRef_t consumerRef = Attach(producerRef, UINT16_MAX);
+    sensorRing_Publish(producerRef, published);
+    LE_TEST_OK((sensorRing_Read(consumerRef, read, NULL) == LE_OK)
+               && (memcmp(read, published, sizeof(published)) == 0)
+               && (read[UINT16_MAX] == 0xa5),
+               "the record comes back, and nothing past it is written");
+    sensorRing_Detach(consumerRef);
+
+    LE_TEST_OK(sensorRing_Create(1, MAX_CAPACITY) != NULL,
+               "a ring of %d records is created", MAX_CAPACITY);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a copy of the start of a ring's file to a new file, and attach to it.
+ *
+ * @return The result of the attach.
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t AttachToCopy
+(
+    sensorRing_ProducerRef_t producerRef,
+    size_t copyBytes,       ///< Number of bytes of the ring's file to copy.
+    size_t recordBytes
+)
+{
+    int ringFd = sensorRing_GetFd(producerRef);
+    LE_ASSERT(ringFd >= 0);
+
+    uint8_t buffer[copyBytes];
+    LE_ASSERT(pread(ringFd, buffer, copyBytes, 0) == (ssize_t)copyBytes);
+    close(ringFd);
+
+    FILE* filePtr = tmpfile();
+    LE_ASSERT(filePtr != NULL);
+    int fd = dup(fileno(filePtr));
+    LE_ASSERT(fd >= 0);
+    fclose(filePtr);
+    LE_ASSERT(pwrite(fd, buffer, copyBytes, 0) == (ssize_t)copyBytes);
+
+    sensorRing_ConsumerRef_t consumerRef;
+    le_result_t result = sensorRing_Attach(fd, recordBytes, &consumerRef);
+    if (result == LE_OK)
+    {
+        sensorRing_Detach(consumerRef);
+    }
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check that files that aren't rings of the expected records are refused.
+ */
+//--------------------------------------------------------------------------------------------------
+static void TestFormatErrors
+(
+    void
+)
+{
+    const size_t recordBytes = sizeof(sensorRing_PressureRecord_t);
+    sensorRing_ProducerRef_t producerRef = sensorRing_Create(recordBytes, 4);
+    LE_TEST_ASSERT(producerRef != NULL, "create a ring of 4 pressure records");
+
+    // The header, then 4 slots of a sequence number and the record.
+    const size_t fileBytes = RING_HEADER_BYTES + (4 * (sizeof(uint64_t) + recordBytes));
+
+    sensorRing_ConsumerRef_t consumerRef;
+    LE_TEST_OK(sensorRing_Attach(sensorRing_GetFd(producerRef), sizeof(sensorRing_ImuRecord_t),
+                                 &consumerRef) == LE_FORMAT_ERROR,
+               "IMU records are refused on a pressure ring");
+    LE_TEST_OK(sensorRing_Attach(sensorRing_GetFd(producerRef), recordBytes - 1, &consumerRef)
+               == LE_FORMAT_ERROR,
+               "records a byte short are refused");
+
+    LE_TEST_OK(AttachToCopy(producerRef, fileBytes, recordBytes) == LE_OK,
+               "a full copy of the ring is accepted");
+    LE_TEST_OK(AttachToCopy(producerRef, fileBytes - 1, recordBytes) == LE_FORMAT_ERROR,
+               "a copy a byte short is refused");
+    LE_TEST_OK(AttachToCopy(producerRef, RING_HEADER_BYTES - 1, recordBytes) == LE_FAULT,
+               "a file shorter than the header can't be read");
+
+    FILE* filePtr = tmpfile();
+    LE_ASSERT(filePtr != NULL);
+    int fd = dup(fileno(filePtr));
+    LE_ASSERT(fd >= 0);
+    fclose(filePtr);
+    uint8_t zeros[sizeof(uint64_t) * 16] = { 0 };
+    LE_ASSERT(pwrite(fd, zeros, sizeof(zeros), 0) == sizeof(zeros));
+    LE_TEST_OK(sensorRing_Attach(fd, recordBytes, &consumerRef) == LE_FORMAT_ERROR,
+               "a file of zeros is refused");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+int main
+(
+    void
+)
+{
+    LE_TEST_PLAN(LE_TEST_NO_PLAN);
+
+    _sensorRing_COMPONENT_INIT();
+
+    TestRoundTrip();
+    TestEmpty();
+    TestWrapAround();
+    TestAcrossFork();
+    TestGeometry();
+    TestFormatErrors();
+
+    LE_TEST_EXIT;
+}